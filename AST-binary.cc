@@ -0,0 +1,426 @@
+#include <fstream>
+#include <typeinfo>
+#include <sstream>
+#include <vector>
+#include "AST.h"
+#include "AST_binary.h"
+#include "visitors/binary_writer_visitor.h"
+
+/*
+ * Saving and reloading the AST in binary form; see AST_binary.h for the format
+ */
+
+static const string binary_magic = "TAST";
+static const int binary_version = 2;  // 2 added the offsets of fields
+
+bool AST_save_binary(A_root_ *root, string file_name, string source_file_name, bool with_attributes)
+{
+	BinaryWriterVisitor writer;
+	VoidContext ctx;
+	writer.with_attributes = with_attributes;
+	writer.string_number(source_file_name);  // always string 0
+	writer.accept(root, ctx);
+
+	// the header and string table use the same variable-length numbers as the nodes
+	BinaryWriterVisitor header;
+	header.nodes = binary_magic;
+	header.put_uint(binary_version);
+	header.put_uint(with_attributes);
+	header.put_uint(writer.strings.size());
+	for (const string &s : writer.strings) {
+		header.put_uint(s.length());
+		header.nodes += s;
+	}
+
+	std::ofstream out(file_name, std::ios::binary);
+	if (!out) {
+		EM_error("Could not write AST to " + file_name);
+		return false;
+	}
+	out << header.nodes << writer.nodes;
+	EM_DEBUG(EM_general, "Wrote AST to " + file_name + " (" + std::to_string(header.nodes.length() + writer.nodes.length()) + " bytes)");
+	return bool(out);
+}
+
+bool AST_is_binary_file(string file_name)
+{
+	std::ifstream in(file_name, std::ios::binary);
+	char start[4];
+	return in.read(start, 4) && string(start, 4) == binary_magic;
+}
+
+
+class AST_binary_reader {
+public:
+	AST_binary_reader(const string &file_contents, string file_name) :
+		next(file_contents.data()), end(file_contents.data() + file_contents.length()), file_name(file_name) { }
+
+	void read_header(string &source_file_name);
+	A_root_ *read_root();
+
+	struct bad_file { };  // thrown by fail, after the error message, and caught in AST_load_binary
+
+private:
+	const char *next, *end;
+	string file_name;
+	bool with_attributes = false;
+	std::vector<Symbol> symbols;  // one for each string in the table, shared by all the nodes that use it
+
+	void fail(string why);
+	unsigned int get_uint();
+	int get_int();
+	const string &get_string();
+	Symbol get_symbol();
+	A_pos get_pos();
+
+	AST_node_ *get_node();
+	template<typename Node> Node *get(const char *what, bool optional = false);
+	void get_attributes(AST_node_ *node);
+	template<typename List, typename Element>
+	List *get_list(List *(*make_list)(Element *, List *));
+};
+
+void AST_binary_reader::fail(string why)
+{
+	EM_error("Can't load AST from " + file_name + ": " + why);
+	throw bad_file();
+}
+
+unsigned int AST_binary_reader::get_uint()
+{
+	unsigned int result = 0;
+	int shift = 0;
+	while (true) {
+		if (next >= end) {
+			fail("file ends in the middle of the AST");
+		}
+		unsigned char byte = *next++;
+		if (shift >= 32 || (shift == 28 && (byte & 0x7f) > 0xf)) {
+			fail("a number is too big");
+		}
+		result |= (byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return result;
+		shift += 7;
+	}
+}
+
+int AST_binary_reader::get_int()
+{
+	unsigned int zig_zag = get_uint();
+	return int(zig_zag >> 1) ^ -int(zig_zag & 1);
+}
+
+const string &AST_binary_reader::get_string()
+{
+	unsigned int index = get_uint();
+	if (index >= symbols.size()) {
+		fail("string number " + std::to_string(index) + " is not in the string table");
+	}
+	return *symbols[index];
+}
+
+Symbol AST_binary_reader::get_symbol()
+{
+	unsigned int index = get_uint();
+	if (index == 0) return 0;
+	if (index > symbols.size()) {
+		fail("symbol number " + std::to_string(index) + " is not in the string table");
+	}
+	return symbols[index-1];
+}
+
+A_pos AST_binary_reader::get_pos()
+{
+	int begin_line = get_uint();
+	if (begin_line == 0) return Position::undefined();
+	int begin_column = get_uint();
+	int end_line = begin_line + get_int();
+	int end_column = get_uint();
+	return Position::fromLinesAndColumns(begin_line, begin_column, end_line, end_column);
+}
+
+void AST_binary_reader::read_header(string &source_file_name)
+{
+	if (end - next < 4 || string(next, 4) != binary_magic) {
+		fail("not an AST file");
+	}
+	next += 4;
+	unsigned int version = get_uint();
+	if (version != binary_version) {
+		fail("it is version " + std::to_string(version) + ", and we only know about version " + std::to_string(binary_version));
+	}
+	with_attributes = get_uint();
+	unsigned int string_count = get_uint();
+	if ((unsigned long) (end - next) < string_count) {  // each string takes at least a byte, for its length
+		fail("file ends in the middle of the string table");
+	}
+	symbols.reserve(string_count);
+	for (unsigned int i = 0; i < string_count; i++) {
+		unsigned int length = get_uint();
+		if ((unsigned long) (end - next) < length) {
+			fail("file ends in the middle of the string table");
+		}
+		symbols.push_back(to_Symbol(string(next, length)));
+		next += length;
+	}
+	if (symbols.empty()) fail("no source file name");
+	source_file_name = *symbols[0];
+}
+
+// get a node of a particular type, e.g. get<A_exp_>("an expression");
+//  only optional ones (an else clause, or a list, which is null when empty) may be missing
+template<typename Node> Node *AST_binary_reader::get(const char *what, bool optional)
+{
+	AST_node_ *node = get_node();
+	if (node == 0) {
+		if (!optional) fail(string("missing ") + what);
+		return 0;
+	}
+	Node *it = dynamic_cast<Node *>(node);
+	if (it == 0) fail(string("expected ") + what + " but found " + typeid(*node).name());
+	return it;
+}
+
+void AST_binary_reader::get_attributes(AST_node_ *node)
+{
+	unsigned int type_kind = get_uint();
+	if (type_kind == Ty_error+1) node->set_stored_type(Ty_Error());
+	else if (type_kind == Ty_nil+1) node->set_stored_type(Ty_Nil());
+	else if (type_kind == Ty_int+1) node->set_stored_type(Ty_Int());
+	else if (type_kind == Ty_bool+1) node->set_stored_type(Ty_Bool());
+	else if (type_kind == Ty_void+1) node->set_stored_type(Ty_Void());
+	else if (type_kind == Ty_string+1) node->set_stored_type(Ty_String());
+	A_exp_ *exp = dynamic_cast<A_exp_ *>(node);
+	if (exp != 0) {
+		exp->set_result_reg(get_int());
+	}
+	A_letExp_ *let = dynamic_cast<A_letExp_ *>(node);
+	if (let != 0) {
+		let->set_my_let_number(get_int());
+	}
+	A_fieldVar_ *field = dynamic_cast<A_fieldVar_ *>(node);
+	if (field != 0) {
+		field->set_offset(get_int());
+	}
+}
+
+// Lists are a count and then the elements; build them from the back, with the Appel constructor
+template<typename List, typename Element>
+List *AST_binary_reader::get_list(List *(*make_list)(Element *, List *))
+{
+	unsigned int count = get_uint();
+	std::vector<Element *> elements;
+	for (unsigned int i = 0; i < count; i++) {
+		elements.push_back(get<Element>("a list element"));
+	}
+	List *list = 0;
+	for (int i = int(elements.size()) - 1; i >= 0; i--) {
+		list = make_list(elements[i], list);
+	}
+	return list;
+}
+
+AST_node_ *AST_binary_reader::get_node()
+{
+	AST_node_kind tag = AST_node_kind(get_uint());
+	AST_node_ *node = 0;
+	A_pos pos = Position::undefined();
+	if (tag != AST_kind_unknown && tag != AST_kind_root && tag != AST_kind_efield &&
+	    tag != AST_kind_expList && tag != AST_kind_efieldList && tag != AST_kind_decList &&
+	    tag != AST_kind_fundecList && tag != AST_kind_nametyList && tag != AST_kind_fieldList) {
+		pos = get_pos();  // the others get their position from their first child
+	}
+
+	switch (tag) {
+	case AST_kind_unknown:
+		return 0;
+	case AST_kind_root: {
+		node = A_RootExp(get<A_exp_>("the main expression"));
+		break;
+	}
+	case AST_kind_nilExp:
+		node = A_NilExp(pos);
+		break;
+	case AST_kind_boolExp:
+		node = A_BoolExp(pos, get_uint());
+		break;
+	case AST_kind_intExp:
+		node = A_IntExp(pos, get_int());
+		break;
+	case AST_kind_stringExp:
+		node = A_StringExp(pos, get_string());
+		break;
+	case AST_kind_recordExp: {
+		Symbol typ = get_symbol();
+		node = A_RecordExp(pos, typ, get<A_efieldList_>("record fields", true));
+		break;
+	}
+	case AST_kind_arrayExp: {
+		Symbol typ = get_symbol();
+		A_exp size = get<A_exp_>("an array size");
+		node = A_ArrayExp(pos, typ, size, get<A_exp_>("an array initial value"));
+		break;
+	}
+	case AST_kind_varExp:
+		node = A_VarExp(pos, get<A_var_>("a variable"));
+		break;
+	case AST_kind_opExp: {
+		unsigned int oper_number = get_uint();
+		if (oper_number > A_geOp) fail("unknown operator " + std::to_string(oper_number));
+		A_oper oper = A_oper(oper_number);
+		A_exp left = get<A_exp_>("an operand");
+		node = A_OpExp(pos, oper, left, get<A_exp_>("an operand"));
+		break;
+	}
+	case AST_kind_assignExp: {
+		A_var var = get<A_var_>("a variable");
+		node = A_AssignExp(pos, var, get<A_exp_>("an expression"));
+		break;
+	}
+	case AST_kind_letExp: {
+		A_decList decs = get<A_decList_>("declarations", true);
+		node = A_LetExp(pos, decs, get<A_expList_>("a let body", true));
+		break;
+	}
+	case AST_kind_callExp: {
+		Symbol func = get_symbol();
+		node = A_CallExp(pos, func, get<A_expList_>("arguments", true));
+		break;
+	}
+	case AST_kind_ifExp: {
+		A_exp test = get<A_exp_>("an if test");
+		A_exp then = get<A_exp_>("a then clause");
+		node = A_IfExp(pos, test, then, get<A_exp_>("an else clause", true));
+		break;
+	}
+	case AST_kind_whileExp: {
+		A_exp test = get<A_exp_>("a while test");
+		node = A_WhileExp(pos, test, get<A_exp_>("a loop body"));
+		break;
+	}
+	case AST_kind_forExp: {
+		Symbol var = get_symbol();
+		A_exp lo = get<A_exp_>("a lower bound");
+		A_exp hi = get<A_exp_>("an upper bound");
+		node = A_ForExp(pos, var, lo, hi, get<A_exp_>("a loop body"));
+		break;
+	}
+	case AST_kind_breakExp:
+		node = A_BreakExp(pos);
+		break;
+	case AST_kind_seqExp:
+		node = A_SeqExp(pos, get<A_expList_>("a sequence", true));
+		break;
+	case AST_kind_simpleVar:
+		node = A_SimpleVar(pos, get_symbol());
+		break;
+	case AST_kind_fieldVar: {
+		A_var var = get<A_var_>("a record variable");
+		node = A_FieldVar(pos, var, get_symbol());
+		break;
+	}
+	case AST_kind_subscriptVar: {
+		A_var var = get<A_var_>("an array variable");
+		node = A_SubscriptVar(pos, var, get<A_exp_>("a subscript"));
+		break;
+	}
+	case AST_kind_expList:
+		node = get_list(A_ExpList);
+		break;
+	case AST_kind_efield: {
+		Symbol name = get_symbol();
+		A_exp exp = get<A_exp_>("a field value");
+		node = A_Efield(name, exp);
+		break;
+	}
+	case AST_kind_efieldList:
+		node = get_list(A_EfieldList);
+		break;
+	case AST_kind_decList:
+		node = get_list(A_DecList);
+		break;
+	case AST_kind_varDec: {
+		Symbol var = get_symbol();
+		Symbol typ = get_symbol();
+		node = A_VarDec(pos, var, typ, get<A_exp_>("an initial value"));
+		break;
+	}
+	case AST_kind_typeDec:
+		node = A_TypeDec(pos, get<A_nametyList_>("type declarations", true));
+		break;
+	case AST_kind_functionDec:
+		node = A_FunctionDec(pos, get<A_fundecList_>("function declarations", true));
+		break;
+	case AST_kind_fundecList:
+		node = get_list(A_FundecList);
+		break;
+	case AST_kind_fundec: {
+		Symbol name = get_symbol();
+		A_fieldList params = get<A_fieldList_>("parameters", true);
+		Symbol result = get_symbol();
+		node = A_Fundec(pos, name, params, result, get<A_exp_>("a function body"));
+		break;
+	}
+	case AST_kind_namety: {
+		Symbol name = get_symbol();
+		node = new A_namety_(pos, name, get<A_ty_>("a type"));
+		break;
+	}
+	case AST_kind_nametyList:
+		node = get_list(A_NametyList);
+		break;
+	case AST_kind_fieldList:
+		node = get_list(A_FieldList);
+		break;
+	case AST_kind_field: {
+		Symbol name = get_symbol();
+		node = A_Field(pos, name, get_symbol());
+		break;
+	}
+	case AST_kind_nameTy:
+		node = A_NameTy(pos, get_symbol());
+		break;
+	case AST_kind_recordty:
+		node = A_RecordTy(pos, get<A_fieldList_>("record fields", true));
+		break;
+	case AST_kind_arrayty:
+		node = A_ArrayTy(pos, get_symbol());
+		break;
+	default:
+		fail("unknown node tag " + std::to_string(tag));
+	}
+
+	if (with_attributes) get_attributes(node);
+	return node;
+}
+
+A_root_ *AST_binary_reader::read_root()
+{
+	A_root_ *root = get<A_root_>("the root of the tree");
+	if (next != end) fail("extra bytes after the end of the tree");
+	return root;
+}
+
+
+A_root_ *AST_load_binary(string file_name, string &source_file_name)
+{
+	std::ifstream in(file_name, std::ios::binary);
+	if (!in) {
+		EM_error("Can't open " + file_name);
+		return 0;
+	}
+	std::stringstream contents;  // read it all at once, then work directly from the buffer
+	contents << in.rdbuf();
+	string buffer = contents.str();
+
+	AST_binary_reader reader(buffer, file_name);
+	A_root_ *root;
+	try {
+		reader.read_header(source_file_name);
+		root = reader.read_root();
+	} catch (AST_binary_reader::bad_file) {
+		return 0;  // fail has already reported it
+	}
+	EM_DEBUG(EM_general, "Loaded AST from " + file_name + " (originally " + source_file_name + ")", root->pos());
+	return root;
+}
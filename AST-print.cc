@@ -114,6 +114,28 @@ static String as_comment(const String &s)
 	}
 }
 
+// Print a list the way Appel's constructors would build it, e.g. A_ExpList(e1, A_ExpList(e2, 0)),
+//  though it's just one node now; build the string with a loop, since lists can be long
+template<typename List>
+static String print_list_rep(const char *constructor, const List &list, int indent, bool with_attributes, const String &attributes)
+{
+	String result = "";
+	std::vector<String> closings;
+	int i = 0;
+	for (auto element : list) {
+		int element_indent = indent + (i+1)*tab;
+		result += constructor + String("(") +
+			linebreak(element_indent) + element->print_rep(element_indent, with_attributes) + ", " +
+			(i+1 < list.length() ? linebreak(element_indent) : String("0"));
+		closings.push_back((with_attributes?linebreak(element_indent)+as_comment(attributes):"") + ")");
+		i++;
+	}
+	for (int c = closings.size()-1; c >= 0; c--) {
+		result += closings[c];
+	}
+	return result;
+}
+
 /*
  * And now, the actual printing functions for the AST node types...
  */
@@ -240,10 +262,7 @@ String A_subscriptVar_::print_rep(int indent, bool with_attributes)
 }
 String A_expList_::print_rep(int indent, bool with_attributes)
 {
-	return "A_ExpList(" + 
-		linebreak(indent+tab) + _head->print_rep(indent+tab, with_attributes) + ", " + 
-		print_rep_or_zero(_tail, indent+tab, with_attributes) + 
-		(with_attributes?linebreak(indent+tab)+as_comment(attributes_for_printing()):"") + ")";
+	return print_list_rep("A_ExpList", *this, indent, with_attributes, attributes_for_printing());
 }
 String A_efield_::print_rep(int indent, bool with_attributes)
 {
@@ -253,17 +272,11 @@ String A_efield_::print_rep(int indent, bool with_attributes)
 }
 String A_efieldList_::print_rep(int indent, bool with_attributes)
 {
-	return "A_EfieldList(" + 
-		linebreak(indent+tab) + _head->print_rep(indent+tab, with_attributes) + ", " + 
-		print_rep_or_zero(_tail, indent+tab, with_attributes) + 
-		(with_attributes?linebreak(indent+tab)+as_comment(attributes_for_printing()):"") + ")";
+	return print_list_rep("A_EfieldList", *this, indent, with_attributes, attributes_for_printing());
 }
 String A_decList_::print_rep(int indent, bool with_attributes)
 {
-	return "A_DecList(" + 
-		linebreak(indent+tab) + _head->print_rep(indent+tab, with_attributes) + ", " + 
-		print_rep_or_zero(_tail, indent+tab, with_attributes) + 
-		(with_attributes?linebreak(indent+tab)+as_comment(attributes_for_printing()):"") + ")";
+	return print_list_rep("A_DecList", *this, indent, with_attributes, attributes_for_printing());
 }
 String A_varDec_::print_rep(int indent, bool with_attributes)
 {
@@ -280,10 +293,7 @@ String A_functionDec_::print_rep(int indent, bool with_attributes)
 
 String A_fundecList_::print_rep(int indent, bool with_attributes)
 {
-	return "A_FundecList(" + 
-		linebreak(indent+tab) + _head->print_rep(indent+tab, with_attributes) + ", " +
-		print_rep_or_zero(_tail, indent+tab, with_attributes) + 
-		(with_attributes?linebreak(indent+tab)+as_comment(attributes_for_printing()):"") + ")";
+	return print_list_rep("A_FundecList", *this, indent, with_attributes, attributes_for_printing());
 }
 String A_fundec_::print_rep(int indent, bool with_attributes)
 {
@@ -301,10 +311,7 @@ String A_typeDec_::print_rep(int indent, bool with_attributes)
 }
 String A_nametyList_::print_rep(int indent, bool with_attributes)
 {
-	return "A_NametyList(" + 
-		linebreak(indent+tab) + _head->print_rep(indent+tab, with_attributes) + ", " + 
-		print_rep_or_zero(_tail, indent+tab, with_attributes) + 
-		(with_attributes?linebreak(indent+tab)+as_comment(attributes_for_printing()):"") + ")";
+	return print_list_rep("A_NametyList", *this, indent, with_attributes, attributes_for_printing());
 }
 String A_namety_::print_rep(int indent, bool with_attributes)
 {
@@ -314,10 +321,7 @@ String A_namety_::print_rep(int indent, bool with_attributes)
 }
 String A_fieldList_::print_rep(int indent, bool with_attributes)
 {
-	return "A_FieldList(" + 
-		linebreak(indent+tab) + _head->print_rep(indent+tab, with_attributes) + ", " + 
-		print_rep_or_zero(_tail, indent+tab, with_attributes) + 
-		(with_attributes?linebreak(indent+tab)+as_comment(attributes_for_printing()):"") + ")";
+	return print_list_rep("A_FieldList", *this, indent, with_attributes, attributes_for_printing());
 }
 String A_field_::print_rep(int indent, bool with_attributes)
 {
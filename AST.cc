@@ -52,7 +52,7 @@ void AST_examples()
 					     ) // end of main list of expressions with two calls
 				   ); // end of top A_SeqExp
 
-	EM_debug(repr(all), all->pos());
+	EM_DEBUG(EM_general, repr(all), all->pos());
 }
 
 void AST_example_let()
@@ -147,13 +147,13 @@ void AST_example_let()
 
 	// Phew. Done at last. Let's print it.
 
-	EM_debug("Here's a simple AST for 14+6, printed with to_String");
-	EM_debug(str(twenty));
+	EM_DEBUG(EM_general, "Here's a simple AST for 14+6, printed with to_String");
+	EM_DEBUG(EM_general, str(twenty));
 
-	EM_debug("Now,  here's the HERA code we get at the moment for that:");
-	EM_debug(twenty->HERA_code());
+	EM_DEBUG(EM_general, "Now,  here's the HERA code we get at the moment for that:");
+	EM_DEBUG(EM_general, twenty->HERA_code());
 
-	EM_debug("Here's the full example AST, printed with to_String");
+	EM_DEBUG(EM_general, "Here's the full example AST, printed with to_String");
 	// EM_debug(str(local_AST_root));
 }
 
@@ -204,7 +204,7 @@ void AST_example_functions()
 					A_CallExp(u, to_Symbol("printint"),
 						  A_ExpList(A_VarExp(u, A_SimpleVar(u, to_Symbol("it"))), 0))));
 	*/
-	EM_debug("Here's the example from AST_example_functions:");
+	EM_DEBUG(EM_general, "Here's the example from AST_example_functions:");
 	// EM_debug(str(r));
 }
 
@@ -233,6 +233,7 @@ AST_node_::~AST_node_()
 
 A_root_::A_root_(A_exp main_exp) : AST_node_(main_exp->pos()), main_expr(main_exp) 
 {
+	stored_kind = AST_kind_root;
 }
 
 
@@ -255,53 +256,64 @@ A_leafExp_::A_leafExp_(A_pos p) : A_literalExp_(p)
 
 A_nilExp_::A_nilExp_(A_pos pos) :  A_leafExp_(pos)
 {
+	stored_kind = AST_kind_nilExp;
 }
 
 A_boolExp_::A_boolExp_(A_pos pos, bool init) :  A_leafExp_(pos), value(init)
 {
+	stored_kind = AST_kind_boolExp;
 }
 
 A_intExp_::A_intExp_(A_pos pos, int i) :  A_leafExp_(pos), value(i)
 {
+	stored_kind = AST_kind_intExp;
 }
 
 A_stringExp_::A_stringExp_(A_pos pos, String s) : A_leafExp_(pos), value(s)
 {
+	stored_kind = AST_kind_stringExp;
 }
 A_recordExp_::A_recordExp_(A_pos pos, Symbol typ, A_efieldList fields) :  A_literalExp_(pos), _typ(typ), _fields(fields)
 {
+	stored_kind = AST_kind_recordExp;
 	precondition(typ != 0);
 }
 
 A_arrayExp_::A_arrayExp_(A_pos pos, Symbol typ, A_exp size, A_exp init) :  A_literalExp_(pos), _typ(typ), _size(size), _init(init)
 {
+	stored_kind = AST_kind_arrayExp;
 	precondition(typ!=0 && size!=0 && init!=0);
 }
 
 
 A_varExp_::A_varExp_(A_pos pos, A_var var) :  A_exp_(pos), _var(var)
 {
+	stored_kind = AST_kind_varExp;
 	precondition(var != 0);
 }
 
 
 A_opExp_::A_opExp_(A_pos pos, A_oper oper, A_exp left, A_exp right) :  A_exp_(pos), _oper(oper), _left(left), _right(right)
 {
+	stored_kind = AST_kind_opExp;
 	precondition(left != 0 && right != 0);
 }
 
 A_assignExp_::A_assignExp_(A_pos pos, A_var var, A_exp exp) : A_exp_(pos), _var(var), _exp(exp)
 {
+	stored_kind = AST_kind_assignExp;
 	precondition(exp != 0 && var != 0);
 }
 
 A_letExp_::A_letExp_(A_pos pos, A_decList decs, A_expList body) :  A_exp_(pos), _decs(decs), _body(body)
 {
+	stored_kind = AST_kind_letExp;
 	// Appel says body and decs can each be null
 }
 
 A_callExp_::A_callExp_(A_pos pos, Symbol func, A_expList args) :  A_exp_(pos), _func(func), _args(args)
 {
+	stored_kind = AST_kind_callExp;
 	precondition(func != 0);
 }
 
@@ -311,25 +323,30 @@ A_controlExp_::A_controlExp_(A_pos p) : A_exp_(p)
 
 A_ifExp_::A_ifExp_(A_pos pos, A_exp test, A_exp then, A_exp else_or_0_pointer_for_no_else) :  A_controlExp_(pos), _test(test), _then(then), _else_or_null(else_or_0_pointer_for_no_else)
 {
+	stored_kind = AST_kind_ifExp;
 	precondition(test != 0 && then != 0);
 }
 
 A_whileExp_::A_whileExp_(A_pos pos, A_exp test, A_exp body) : A_controlExp_(pos), _test(test), _body(body)
 {
+	stored_kind = AST_kind_whileExp;
 	precondition(test != 0 && body != 0);
 }
 
 A_forExp_::A_forExp_(A_pos pos, Symbol var, A_exp lo, A_exp hi, A_exp body) :  A_controlExp_(pos), _var(var), _lo(lo), _hi(hi), _body(body)
 {
+	stored_kind = AST_kind_forExp;
 	precondition(var != 0 && lo != 0 && hi != 0 && body != 0);
 }
 
 A_breakExp_::A_breakExp_(A_pos pos) :  A_controlExp_(pos)
 {
+	stored_kind = AST_kind_breakExp;
 }
 
 A_seqExp_::A_seqExp_(A_pos pos, A_expList seq) :  A_controlExp_(pos), _seq(seq)
 {
+	stored_kind = AST_kind_seqExp;
 }
 
 A_var_::A_var_(A_pos p) : AST_node_(p)
@@ -338,27 +355,31 @@ A_var_::A_var_(A_pos p) : AST_node_(p)
 
 A_simpleVar_::A_simpleVar_(A_pos pos, Symbol sym) :  A_var_(pos), _sym(sym)
 {
+	stored_kind = AST_kind_simpleVar;
 	precondition(sym != 0);
 }
 
 A_fieldVar_::A_fieldVar_(A_pos pos, A_var var, Symbol sym) :  A_var_(pos), _var(var), _sym(sym)
 {
+	stored_kind = AST_kind_fieldVar;
 	precondition(var != 0 && sym != 0);
 }
 
 A_subscriptVar_::A_subscriptVar_(A_pos pos, A_var var, A_exp exp) :  A_var_(pos), _var(var), _exp(exp)
 {
+	stored_kind = AST_kind_subscriptVar;
 	precondition(exp != 0 && var != 0);
 }
 
 
-A_expList_::A_expList_(A_exp head, A_expList tail) :  AST_node_(head->pos()), _head(head), _tail(tail)
+A_expList_::A_expList_(A_exp head) :  A_listOf_(head)
 {
-	precondition(head != 0);
+	stored_kind = AST_kind_expList;
 }
 
 A_efield_::A_efield_(Symbol name, A_exp exp) :  AST_node_(exp->pos()), _name(name), _exp(exp)
 {
+	stored_kind = AST_kind_efield;
 	precondition(exp != 0);
 }
 String A_efield_::fieldname()
@@ -366,9 +387,9 @@ String A_efield_::fieldname()
 	return Symbol_to_string(_name);
 }
 
-A_efieldList_::A_efieldList_(A_efield head, A_efieldList tail) :  AST_node_(head->pos()), _head(head), _tail(tail)
+A_efieldList_::A_efieldList_(A_efield head) :  A_listOf_(head)
 {
-	precondition(head != 0);
+	stored_kind = AST_kind_efieldList;
 }
 
 
@@ -377,31 +398,35 @@ A_dec_::A_dec_(A_pos p) : AST_node_(p)
 {
 }
 
-A_decList_::A_decList_(A_dec head, A_decList tail) :  A_dec_(head->pos()), _head(head), _tail(tail)
+A_decList_::A_decList_(A_dec head) :  A_listOf_(head)
 {
-	precondition(head != 0);
+	stored_kind = AST_kind_decList;
 }
 
 A_varDec_::A_varDec_(A_pos pos, Symbol var, Symbol typ, A_exp init) :  A_dec_(pos), _var(var), _typ(typ), _init(init)
 {
+	stored_kind = AST_kind_varDec;
 	precondition(var != 0 && init != 0);
 }
 
 A_functionDec_::A_functionDec_(A_pos pos, A_fundecList functions_that_might_call_each_other) : A_dec_(pos), theFunctions(functions_that_might_call_each_other)
 {
+	stored_kind = AST_kind_functionDec;
 	precondition(functions_that_might_call_each_other != 0);
 }
-A_fundecList_::A_fundecList_(A_fundec head, A_fundecList tail) :  AST_node_(head->pos()), _head(head), _tail(tail)
+A_fundecList_::A_fundecList_(A_fundec head) :  A_listOf_(head)
 {
-	precondition(head != 0);
+	stored_kind = AST_kind_fundecList;
 }
 A_fundec_::A_fundec_(A_pos pos, Symbol name, A_fieldList params, Symbol result,  A_exp body) :  AST_node_(pos), _name(name), _params(params), _result(result), _body(body)
 {
+	stored_kind = AST_kind_fundec;
 	precondition(name != 0 && body != 0);
 }
 
 A_typeDec_::A_typeDec_(A_pos pos, A_nametyList types_that_might_refer_to_each_other): A_dec_(pos), theTypes(types_that_might_refer_to_each_other)
 {
+	stored_kind = AST_kind_typeDec;
 	// lists can be null (empty-list), so it's possibly that theTypes could be 0
 }
 
@@ -409,36 +434,41 @@ A_typeDec_::A_typeDec_(A_pos pos, A_nametyList types_that_might_refer_to_each_ot
 A_ty_::A_ty_(A_pos p) : AST_node_(p)
 {
 }
-A_nametyList_::A_nametyList_(A_namety head, A_nametyList tail) :  AST_node_(head->pos()), _head(head), _tail(tail)
+A_nametyList_::A_nametyList_(A_namety head) :  A_listOf_(head)
 {
-	precondition(head != 0);
+	stored_kind = AST_kind_nametyList;
 }
 A_namety_::A_namety_(A_pos pos, Symbol name, A_ty ty) :  AST_node_(pos), _name(name), _ty(ty)
 {
+	stored_kind = AST_kind_namety;
 	precondition(name != 0 && ty != 0);
 }
 
-A_fieldList_::A_fieldList_(A_field head, A_fieldList tail) :  AST_node_(head->pos()), _head(head), _tail(tail)
+A_fieldList_::A_fieldList_(A_field head) :  A_listOf_(head)
 {
-	precondition(head != 0);
+	stored_kind = AST_kind_fieldList;
 }
 A_field_::A_field_(A_pos pos, Symbol name, Symbol typ) :  AST_node_(pos), _name(name), _typ(typ)
 {
+	stored_kind = AST_kind_field;
 	precondition(name != 0 && typ != 0);
 }
 
 
 A_nameTy_::A_nameTy_(A_pos pos, Symbol name) :  A_ty_(pos), _name(name)
 {
+	stored_kind = AST_kind_nameTy;
 	precondition(name != 0);
 }
 
 A_recordty_::A_recordty_(A_pos pos, A_fieldList record) :  A_ty_(pos), _record(record)
 {
+	stored_kind = AST_kind_recordty;
 }
 
 A_arrayty_::A_arrayty_(A_pos pos, Symbol array) :  A_ty_(pos), _array(array)
 {
+	stored_kind = AST_kind_arrayty;
 	precondition(array != 0);
 }
 
@@ -163,6 +163,8 @@ typedef Position A_pos;
 #include "types.h"  // we'll need this for attributes
 #include "ST.h"
 #include "visitors/visitor.h"
+#include <map>
+#include <vector>
 
 
 void AST_examples();  // Examples, to help understand what't going on here ... see AST.cc
@@ -174,6 +176,8 @@ void AST_examples();  // Examples, to help understand what't going on here ... s
   I've introduced C++ classes instead of Appel's C structs, and use an "_" at the end of each class name.
  */
 
+struct CG_summary;  // see call_graph.h
+
 typedef class A_var_ *A_var;
 typedef class A_exp_ *A_exp;
 typedef class A_dec_ *A_dec;
@@ -196,6 +200,12 @@ typedef class A_efieldList_ *A_efieldList;
 extern bool print_ASTs_with_attributes;  // defaults to false; can be overridden in main with "-A" option
 
 extern int min_reg;
+extern bool HERA_uses_arrays;  // set by HERA_data, so A_root_::HERA_code knows to include the bounds-check failure code
+extern bool HERA_uses_fields;  // and the code for a field of nil
+// Labels, strings and let expressions are numbered from 0 in each function, and the labels have the
+//  function's unique name in them, so its code doesn't depend on the functions before it (see
+//  A_fundec_::HERA_code): this is "" in the main program, or e.g. "f_3_" in function f_3.
+extern string HERA_label_scope;
 
 
 class AST_node_ {  // abstract class with some common data
@@ -223,9 +233,12 @@ public:
 	void EM_warning(string message, bool fatal=false) {   ::EM_warning(message, this->pos()); }
 	void EM_debug  (string message, bool fatal=false) {   ::EM_debug(message, this->pos()); }
 
-    template<typename T, typename Ctx>
-    T accept(Visitor<T, Ctx>& visitor, Ctx ctx) {
-        return acceptImpl(visitor, ctx);
+    // Which leaf class this is, so visitors can dispatch with a switch (see visitors/visitor.t)
+    AST_node_kind kind() const { return stored_kind; }
+
+    template<typename Derived, typename T, typename Ctx>
+    T accept(Visitor<Derived, T, Ctx>& visitor, Ctx ctx) {
+        return visitor.dispatch(this, ctx);
     };
 	
 	// And now, the attributes that exist in ALL kinds of AST nodes.
@@ -233,8 +246,9 @@ public:
 	virtual string HERA_code();  // defaults to a warning, with HERA code that would error if compiled; could be "=0" in final compiler
 	virtual string HERA_data();  // defaults to empty string 
 	virtual int am_i_in_loop(AST_node_ *child);
-	virtual int calculate_my_SP(AST_node_ *_parent_or_child);
 	virtual int am_i_in_assignExp_(AST_node_ *child);
+	virtual Ty_ty find_type(Symbol name, AST_node_ *child);  // 0 if there's no such type here
+	Ty_ty lookup_type(Symbol name) { return find_type(name, this); }  // the type with that name, as seen from here
 	int height();  // example we'll play with in class, not actually needed to compile
 	virtual int compute_height();  // just for an example, not needed to compile
 	int depth();   // example we'll play with in class, not actually needed to compile
@@ -246,6 +260,8 @@ public:
 		return stored_type;
 	}
 	virtual Ty_ty init_typecheck();
+	bool typecheck_done() { return stored_type != Ty_Placeholder(); }
+	void set_stored_type(Ty_ty type) { stored_type = type; }  // e.g. when reloading a saved AST with its attributes
 
     void set_stored_parent(AST_node_* parent) {
         stored_parent = parent;
@@ -256,8 +272,12 @@ public:
     void set_local_function_library(ST<function_info> library) {
         local_function_library = library;
     }
+    ST<var_info> get_local_variable_library() const { return local_variable_library; }
+    ST<function_info> get_local_function_library() const { return local_function_library; }
 protected:  // so that derived class's set_parent should be able to get at stored_parent for "this" object ... Smalltalk allows this by default
 	AST_node_ *stored_parent = 0;
+	AST_node_kind stored_kind = AST_kind_unknown;  // set by each leaf class's constructor
+	void set_stored_pos(A_pos pos) { stored_pos = pos; }  // for lists, which grow at the front
     ST<var_info> local_variable_library;
     ST<function_info> local_function_library;
 
@@ -267,18 +287,6 @@ private:
     };	// NOT FOR GENERAL USE: get the parent node, either before or after the 'set all parent nodes' pass, but note it will be incorrect if done before (this is usually just done for assertions)
 	A_pos stored_pos;
 	Ty_ty stored_type = Ty_Placeholder();
-
-    virtual string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return "";
-    };
-    virtual void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-    };
-    virtual ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return ST<var_info>();
-    };
-    virtual ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return ST<function_info>();
-    };
 };
 
 class A_exp_ : public AST_node_ {
@@ -296,12 +304,49 @@ public:
 		return "R" + std::to_string(this->result_reg());
 	}
 	virtual int init_result_reg();
+	void set_result_reg(int reg) { stored_result_reg = reg; }  // e.g. when reloading a saved AST with its attributes
 
 	// we'll need to print the register number attribute for exp's
 	virtual String attributes_for_printing();
 
+	// For the expressions whose code calls a function (calls, records, arrays and string comparisons):
+	//  how much of the frame is in use then, so the callee's frame can go just above that; or -1 in
+	//  another call's arguments, where it goes at SP (see visitors/frame_layout_visitor.h)
+	int get_frame_top() const { return frame_top; }
+	void set_frame_top(int words) { frame_top = words; }
+
 private:
 	int stored_result_reg = -1;  // Initialize to -1 to be sure it gets replaced by "if" in result_reg() above
+	int frame_top = -1;
+};
+
+// The lists (A_expList_, A_decList_, etc.) are single nodes holding all their elements,
+//  rather than Appel's head/tail cells, so length() is O(1) and nothing has to recurse down a long list.
+// The Appel constructors in AST_appel.h (A_ExpList(head, tail), etc.) still work: lists are built
+//  from the back, so the elements are stored last-first, and adding a new head is a push_back.
+// Each element's parent is the list itself; a list's pos is that of its first element.
+template<typename Element, typename Base>
+class A_listOf_ : public Base {
+public:
+	A_listOf_(Element head) : Base(head->pos()) {
+		reversed_elements.push_back(head);
+	}
+	void prepend(Element head) {
+		reversed_elements.push_back(head);
+		this->set_stored_pos(head->pos());
+	}
+
+	int length() const { return reversed_elements.size(); }
+	Element element(int i) const { return reversed_elements[reversed_elements.size()-1-i]; }  // element(0) is the first
+	Element first() const { return reversed_elements.back(); }
+	Element last() const  { return reversed_elements.front(); }
+
+	// first to last, e.g. for (A_exp e : *list) ...
+	typedef typename std::vector<Element>::const_reverse_iterator iterator;
+	iterator begin() const { return reversed_elements.rbegin(); }
+	iterator end() const   { return reversed_elements.rend(); }
+private:
+	std::vector<Element> reversed_elements;
 };
 
 class A_root_ : public AST_node_ {
@@ -313,8 +358,8 @@ public:
 	string HERA_data();
 	Ty_ty init_typecheck();
 	int am_i_in_loop(AST_node_ *child);
-	int calculate_my_SP(AST_node_ *_parent_or_child);
 	virtual int am_i_in_assignExp_(AST_node_ *child);
+	Ty_ty find_type(Symbol name, AST_node_ *child);
 	AST_node_ *parent() {
         assert("parent pointers have been set" && stored_parent);
         return stored_parent;
@@ -325,21 +370,12 @@ public:
 	virtual int compute_depth();  // just for an example, not needed to compile
 
     AST_node_* get_main_expr() const { return main_expr; }
+    // main's frame: how many words its variables need above FP (see layout_frames.cc)
+    int get_frame_size() const { return frame_size; }
+    void set_frame_size(int words) { frame_size = words; }
 private:
 	A_exp main_expr;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitRoot(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitRoot(this, ctx);
-    };
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitRoot(this, ctx);
-    };
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitRoot(this, ctx);
-    };
+	int frame_size = 0;
 };
 
 
@@ -360,19 +396,8 @@ class A_nilExp_ : public A_leafExp_ {
 public:
 	A_nilExp_(A_pos p);
 	virtual string print_rep(int indent, bool with_attributes);
-private:
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitNilExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitNilExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNilExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNilExp(this, ctx);
-    }
+	virtual string HERA_code();
+	Ty_ty init_typecheck();
 };
 
 
@@ -386,19 +411,6 @@ public:
     bool get_value() const { return value; }
 private:
     bool value;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitBoolExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitBoolExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitBoolExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitBoolExp(this, ctx);
-    }
 };
 
 class A_intExp_ : public A_leafExp_ {
@@ -409,22 +421,9 @@ public:
 	virtual string HERA_code();
 	Ty_ty init_typecheck();
 
-    bool get_value() const { return value; }
+    int get_value() const { return value; }
 private:
 	int value;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitIntExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitIntExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitIntExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitIntExp(this, ctx);
-    }
 };
 
 class A_stringExp_ : public A_leafExp_ {
@@ -433,25 +432,13 @@ public:
 	virtual string print_rep(int indent, bool with_attributes);
 
     String get_value() const { return value; }
+    int get_count() const { return count; }  // set by HERA_data, gives the string_N label (in HERA_label_scope)
 private:
 	int count;
 	String value;
 	virtual string HERA_code();
 	virtual string HERA_data();
 	Ty_ty init_typecheck();
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitStringExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitStringExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitStringExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitStringExp(this, ctx);
-    }
 };
 
 
@@ -459,31 +446,26 @@ class A_recordExp_ : public A_literalExp_ {
 public:
 	A_recordExp_(A_pos pos, Symbol typ, A_efieldList fields);
 	virtual string print_rep(int indent, bool with_attributes);
+	virtual string HERA_code();
+	virtual string HERA_data();
+	Ty_ty init_typecheck();
+	virtual int init_result_reg();
 
     Symbol get_typ() const { return _typ; }
     AST_node_*  get_fields() const;
 private:
 	Symbol _typ;
 	A_efieldList _fields;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitRecordExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitRecordExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitRecordExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitRecordExp(this, ctx);
-    }
 };
 
 class A_arrayExp_ : public A_literalExp_ {
 public:
 	A_arrayExp_(A_pos pos, Symbol typ, A_exp size, A_exp init);
 	virtual string print_rep(int indent, bool with_attributes);
+	virtual string HERA_code();
+	virtual string HERA_data();
+	Ty_ty init_typecheck();
+	virtual int init_result_reg();
 
     Symbol get_typ() const { return _typ; }
     AST_node_* get_size() const { return _size; }
@@ -492,19 +474,6 @@ private:
 	Symbol _typ;
 	A_exp _size;
 	A_exp _init;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitArrayExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitArrayExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitArrayExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitArrayExp(this, ctx);
-    }
 };
 
 
@@ -521,19 +490,6 @@ public:
     AST_node_* get_var() const;
 private:
 	A_var _var;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitVarExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitVarExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitVarExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitVarExp(this, ctx);
-    }
 };
 
 typedef enum {A_plusOp, A_minusOp, A_timesOp, A_divideOp,
@@ -556,19 +512,6 @@ private:
 	A_oper _oper;
 	A_exp _left;
 	A_exp _right;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitOpExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitOpExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitOpExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitOpExp(this, ctx);
-    }
 };
 
 class A_assignExp_ : public A_exp_ {
@@ -586,19 +529,6 @@ public:
 private:
 	A_var _var;
 	A_exp _exp;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitAssignExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitAssignExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitAssignExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitAssignExp(this, ctx);
-    }
 };
 
 class A_letExp_ : public A_exp_ {
@@ -609,10 +539,12 @@ A_letExp_(A_pos pos, A_decList decs, A_expList body);
 	virtual string HERA_data();
 	Ty_ty init_typecheck();
 	virtual int init_result_reg();
-	virtual int calculate_my_SP(AST_node_ *_parent_or_child);
+	Ty_ty find_type(Symbol name, AST_node_ *child);
 
     int get_my_letExp_number(AST_node_ *child);
 	string get_my_let_number_s() {return std::to_string(my_let_number);}
+	int get_my_let_number() const { return my_let_number; }
+	void set_my_let_number(int n) { my_let_number = n; }
 
     AST_node_* get_decs() const;
     AST_node_* get_body() const;
@@ -620,19 +552,6 @@ private:
     int my_let_number = -1;
 	A_decList _decs;
 	A_expList _body;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitLetExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitLetExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitLetExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitLetExp(this, ctx);
-    }
 };
 
 class A_callExp_ : public A_exp_ {
@@ -642,7 +561,6 @@ public:
 	virtual string HERA_data();
 	virtual int init_result_reg();
 	Ty_ty init_typecheck();
-	virtual int calculate_my_SP(AST_node_ *_parent_or_child);
 	virtual string print_rep(int indent, bool with_attributes);
 
 	string get_my_unique_function_name() {
@@ -657,22 +575,21 @@ public:
 
     Symbol get_func() const { return _func; }
     AST_node_* get_args() const;
+
+    // the callee's summary in the call graph, once CG_build has run (see call_graph.h)
+    const CG_summary *get_call_graph_summary() const { return call_graph_summary; }
+    void set_call_graph_summary(const CG_summary *summary) { call_graph_summary = summary; }
+    // which frame to pass as the callee's static link, counting out from the caller's (0), or -1 if the callee
+    //  doesn't take one; and the function the call is in, 0 for main (see visitors/static_link_visitor.h)
+    int get_static_link() const { return static_link; }
+    A_fundec_ *get_caller() const { return caller; }
+    void set_static_link(A_fundec_ *in_function, int frames_out) { caller = in_function; static_link = frames_out; }
 private:
 	Symbol _func;
 	A_expList _args;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitCallExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitCallExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitCallExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitCallExp(this, ctx);
-    }
+	const CG_summary *call_graph_summary = 0;
+	A_fundec_ *caller = 0;
+	int static_link = -1;
 };
 
 class A_controlExp_ : public A_exp_ {
@@ -696,19 +613,6 @@ private:
 	A_exp _test;
 	A_exp _then;
 	A_exp _else_or_null;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitIfExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitIfExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitIfExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitIfExp(this, ctx);
-    }
 };
 
 class A_whileExp_ : public A_controlExp_ {
@@ -727,19 +631,6 @@ private:
 	int my_num;
 	A_exp _test;
 	A_exp _body;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitWhileExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitWhileExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitWhileExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitWhileExp(this, ctx);
-    }
 };
 
 
@@ -752,30 +643,20 @@ public:
 	virtual int init_result_reg();
 	Ty_ty init_typecheck();
 	virtual int am_i_in_loop(AST_node_ *child);
-	virtual int calculate_my_SP(AST_node_ *child);
     Symbol get_var() const { return _var; }
     AST_node_* get_lo() const;
     AST_node_* get_hi() const;
     AST_node_* get_body() const;
+    // where the loop variable is in the frame; the upper bound is in the next word (see layout_frames.cc)
+    int get_frame_slot() const { return frame_slot; }
+    void set_frame_slot(int slot) { frame_slot = slot; }
 private:
+	int frame_slot = -1;
 	int my_num;
 	Symbol _var;
 	A_exp _lo;
 	A_exp _hi;
 	A_exp _body;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitForExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitForExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitForExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitForExp(this, ctx);
-    }
 };
 
 
@@ -787,19 +668,6 @@ public:
 	virtual string HERA_data();
 	virtual int init_result_reg();
 	Ty_ty init_typecheck();
-private:
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitBreakExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitBreakExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitBreakExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitBreakExp(this, ctx);
-    }
 };
 
 class A_seqExp_ : public A_controlExp_ {
@@ -822,24 +690,25 @@ public:
 private:
 	int stored_result_reg = -1;
 	A_expList _seq;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitSeqExp(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitSeqExp(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitSeqExp(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitSeqExp(this, ctx);
-    }
 };
 
 class A_var_ : public AST_node_ {
 public:
 	A_var_(A_pos p);
+
+	// The register the variable's value ends up in (the same for all simple variables),
+	//  which is also the highest one that getting at it uses
+	int result_reg() {
+		if (this->stored_result_reg < 0) this->stored_result_reg = this->init_result_reg();
+		return stored_result_reg;
+	}
+	string result_reg_s() { // return in string form, e.g. "R2"
+		return "R" + std::to_string(this->result_reg());
+	}
+	virtual int init_result_reg();
+
+private:
+	int stored_result_reg = -1;
 };
 
 class A_simpleVar_ : public A_var_ {
@@ -852,83 +721,64 @@ public:
 	virtual int am_i_in_assignExp_(AST_node_ *child);
 
     Symbol get_sym() const { return _sym; }
+    // how many functions out the variable was declared (0 for this one), and which function this use is in,
+    //  0 for main (see visitors/static_link_visitor.h)
+    int get_frames_out() const { return frames_out; }
+    A_fundec_ *get_function() const { return function; }
+    void set_frames_out(A_fundec_ *in_function, int frames) { function = in_function; frames_out = frames; }
 private:
 	Symbol _sym;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitSimpleVar(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitSimpleVar(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitSimpleVar(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitSimpleVar(this, ctx);
-    }
+	A_fundec_ *function = 0;
+	int frames_out = 0;
 };
 
 class A_fieldVar_ : public A_var_ {
 public:
 	A_fieldVar_(A_pos pos, A_var var, Symbol sym);
 	virtual string print_rep(int indent, bool with_attributes);
+	virtual string HERA_code();
+	virtual string HERA_data();
+	Ty_ty init_typecheck();
+	virtual int am_i_in_assignExp_(AST_node_ *child);
+	virtual int init_result_reg();
 
     Symbol get_sym() const { return _sym; }
     AST_node_* get_var() const;
+    int get_offset() { typecheck(); return offset; }  // where the field is in the record (see Ty_field_offset)
+    void set_offset(int o) { offset = o; }  // for a tree loaded with its attributes, which isn't typechecked again
 private:
 	A_var _var;
 	Symbol _sym;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitFieldVar(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitFieldVar(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFieldVar(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFieldVar(this, ctx);
-    }
+	int offset = -1;  // set by typechecking (or loading)
 };
 
 class A_subscriptVar_ : public A_var_ {
 public:
 	A_subscriptVar_(A_pos pos, A_var var, A_exp exp);
 	virtual string print_rep(int indent, bool with_attributes);
+	virtual string HERA_code();
+	virtual string HERA_data();
+	Ty_ty init_typecheck();
+	virtual int am_i_in_assignExp_(AST_node_ *child);
+	virtual int init_result_reg();
+	int constant_index();  // the subscript, if it's a constant small enough to be a LOAD or STORE offset; otherwise -1
 
     AST_node_* get_var() const;
     AST_node_* get_exp() const;
 private:
 	A_var _var;
 	A_exp _exp;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitSubscriptVar(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitSubscriptVar(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitSubscriptVar(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitSubscriptVar(this, ctx);
-    }
 };
 
 
-class A_expList_ : public AST_node_ {
+class A_expList_ : public A_listOf_<A_exp, AST_node_> {
 public:
-	A_expList_(A_exp head, A_expList tail);
+	A_expList_(A_exp head);
 	virtual string print_rep(int indent, bool with_attributes);
 	string HERA_data();
     string HERA_code();
 	virtual int init_result_reg();
 	Ty_ty init_typecheck();
-	int length();
 	int result_reg() {
 		if (this->stored_result_reg < 0) this->stored_result_reg = this->init_result_reg();
 		return stored_result_reg;
@@ -944,36 +794,20 @@ public:
 		return "R" + std::to_string(this->reg_usage());
 	}
     string store_HERA_code(int SP_loc) {
-        string hera_code = _head->HERA_code()
-                         + "    STORE(" + _head->result_reg_s() + ", " + std::to_string(SP_loc) + ", FP_alt)\n";
-        if (_tail) {
-            hera_code += _tail->store_HERA_code(SP_loc + 1);
+        string hera_code;
+        for (A_exp e : *this) {
+            hera_code += e->HERA_code()
+                       + "    STORE(" + e->result_reg_s() + ", " + std::to_string(SP_loc) + ", FP_alt)\n";
+            SP_loc++;
         }
         return hera_code;
     }
-    Ty_ty compare_types(Symbol _func, int arg_counter, Ty_fieldList expected_types);
+    Ty_ty compare_types(Symbol _func, Ty_fieldList expected_types);
 	int init_reg_usage();
 
-    AST_node_* get_head() const;
-    AST_node_* get_tail() const;
 private:
-	A_exp _head;
-	A_expList _tail;
 	int stored_result_reg = -1;
 	int stored_reg_usage = -1;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitExpList(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitExpList(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitExpList(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitExpList(this, ctx);
-    }
 };
 
 // The componends of a A_recordExp, e.g. point{X = 4, Y = 12}
@@ -988,44 +822,12 @@ public:
 private:
 	Symbol _name;
 	A_exp _exp;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitEfield(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitEfield(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitEfield(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitEfield(this, ctx);
-    }
 };
 
-class A_efieldList_ : public AST_node_ {
+class A_efieldList_ : public A_listOf_<A_efield, AST_node_> {
 public:
-	A_efieldList_(A_efield head, A_efieldList tail);
+	A_efieldList_(A_efield head);
 	virtual string print_rep(int indent, bool with_attributes);
-
-    AST_node_* get_head() const;
-    AST_node_* get_tail() const;
-private:
-	A_efield _head;
-	A_efieldList _tail;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitEfieldList(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitEfieldList(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitEfieldList(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitEfieldList(this, ctx);
-    }
 };
 
 
@@ -1044,35 +846,14 @@ private:
 	int stored_result_reg = -1;
 };
 
-class A_decList_ : public A_dec_ {
+class A_decList_ : public A_listOf_<A_dec, A_dec_> {
 public:
-	A_decList_(A_dec head, A_decList tail);
+	A_decList_(A_dec head);
 	virtual string print_rep(int indent, bool with_attributes);
 	virtual string HERA_code();
 	virtual string HERA_data();
 	virtual int init_result_reg();
 	Ty_ty init_typecheck();
-	virtual int calculate_my_SP(AST_node_ *_parent_or_child);
-	int length();
-
-    AST_node_* get_head() const;
-    AST_node_* get_tail() const;
-private:
-	A_dec _head;
-	A_decList _tail;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitDecList(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitDecList(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitDecList(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitDecList(this, ctx);
-    }
 };
 
 class A_varDec_ : public A_dec_ {
@@ -1083,12 +864,15 @@ public:
 	virtual string HERA_data();
 	Ty_ty init_typecheck();
 	virtual int init_result_reg();
-	virtual int calculate_my_SP(AST_node_ *_parent_or_child);
 
     Symbol get_var() const { return _var; }
     Symbol get_typ() const { return _typ; }
     AST_node_* get_init() const;
+    // where the variable is in the frame (see layout_frames.cc)
+    int get_frame_slot() const { return frame_slot; }
+    void set_frame_slot(int slot) { frame_slot = slot; }
 private:
+	int frame_slot = -1;
 	Symbol _var;
 	Symbol _typ;
 	A_exp _init;
@@ -1098,42 +882,20 @@ private:
 	// but it's really just an inherited attribute set during escape analysis,
 	// which is not necessary in the Haverford version of the labs,
 	// where we conservatively assume all variables escape
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitVarDec(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitVarDec(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitVarDec(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitVarDec(this, ctx);
-    }
 };
 
 class A_typeDec_: public A_dec_ {
 public:
 	A_typeDec_(A_pos pos, A_nametyList types_that_might_refer_to_each_other);
 	virtual string print_rep(int indent, bool with_attributes);
+	virtual string HERA_code();
+	Ty_ty init_typecheck();
+	virtual int init_result_reg();
+	Ty_ty type_named(Symbol name);  // the type it declares with that name, or 0
 
     AST_node_* get_theTypes() const;
 private:
 	A_nametyList theTypes;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitTypeDec(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitTypeDec(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitTypeDec(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitTypeDec(this, ctx);
-    }
 };
 
 class A_functionDec_: public A_dec_ {
@@ -1144,62 +906,30 @@ public:
 	virtual string HERA_data();
 	Ty_ty init_typecheck();
 	virtual int init_result_reg();
-	virtual int calculate_my_SP(AST_node_ *_parent_or_child);
 
     AST_node_* get_theFunctions() const;
 private:
 	A_fundecList theFunctions;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitFunctionDec(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitFunctionDec(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFunctionDec(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFunctionDec(this, ctx);
-    }
 };
 
-class A_fundecList_ : public AST_node_ {
+class A_fundecList_ : public A_listOf_<A_fundec, AST_node_> {
 public:
-	A_fundecList_(A_fundec head, A_fundecList tail);
+	A_fundecList_(A_fundec head);
 	virtual string print_rep(int indent, bool with_attributes);
 	virtual string HERA_code();
 	virtual string HERA_data();
 	Ty_ty init_typecheck();
-
-    AST_node_* get_head() const;
-    AST_node_* get_tail() const;
-private:
-	A_fundec _head;
-	A_fundecList _tail;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitFundecList(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitFundecList(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFundecList(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFundecList(this, ctx);
-    }
 };
 
 class A_fundec_ : public AST_node_ {  // possibly this would be happier as a subclass of "A_dec_"?
 public:
 	A_fundec_(A_pos pos, Symbol name, A_fieldList params, Symbol result_type,  A_exp body);
 	virtual string print_rep(int indent, bool with_attributes);
-	virtual string HERA_code();
+	virtual string HERA_code();  // in the function's own HERA_label_scope
+	string cached_HERA_code();   // reuses cached code for an unchanged function, if we have a HERA cache
+	string compile_HERA_code();
 	virtual string HERA_data();
 	Ty_ty init_typecheck();
-	virtual int calculate_my_SP(AST_node_ *_parent_or_child);
 	string store_HERA_code(int reg_count_to_replace, int offset);
 	string load_HERA_code(int reg_count_to_load, int offset);
 
@@ -1219,7 +949,32 @@ public:
     A_fieldList_* cast_params() const;
     Symbol get_result() const { return _result; }
     AST_node_* get_body() const;
+
+    // this function's summary in the call graph, once CG_build has run (see call_graph.h)
+    const CG_summary *get_call_graph_summary() const { return call_graph_summary; }
+    void set_call_graph_summary(const CG_summary *summary) { call_graph_summary = summary; }
+
+    // The function this is declared in (0 for main), whether callers pass it a static link, and how many
+    //  frame pointers it keeps in its display, for the frames 2, 3, ... out (see visitors/static_link_visitor.h)
+    void set_static_link(A_fundec_ *enclosing, bool has_link, int display) {
+        enclosing_function = enclosing; static_link = has_link; display_size = display;
+    }
+    A_fundec_ *get_enclosing_function() const { return enclosing_function; }
+    bool has_static_link() const { return static_link; }
+    // The frame starts with the return address, control link and caller's FP_alt, then the parameters
+    //  (or the result), then the static link and display; the saved registers come after that
+    int static_link_slot();
+    int frame_header_size() { return static_link_slot() + (static_link ? 1 : 0) + display_size; }
+    // The whole frame, up to the top of the local variables: the code moves SP past it when it starts (see layout_frames.cc)
+    int get_frame_size() const { return frame_size; }
+    void set_frame_size(int words) { frame_size = words; }
+    string frame_pointer_HERA_code(int frames_out, string reg);  // put the frame pointer of the function that many out in reg
 private:
+	const CG_summary *call_graph_summary = 0;
+	A_fundec_ *enclosing_function = 0;
+	bool static_link = false;
+	int display_size = 0;
+	int frame_size = 0;
 	bool firstPass = true;
 	ST<var_info> current_var_lib;
 	ST<function_info> this_func_ST;
@@ -1228,19 +983,6 @@ private:
 	A_fieldList _params;
 	Symbol _result;
 	A_exp _body;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitFundec(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitFundec(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFundec(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFundec(this, ctx);
-    }
 };
 
 //  Giving a name to a type with Namety -- this is a declaration of a type
@@ -1248,48 +990,21 @@ class A_namety_ : public AST_node_ {  // possibly this would be happier as a sub
 public:
 	A_namety_(A_pos pos, Symbol name, A_ty ty);
 	virtual string print_rep(int indent, bool with_attributes);
+	// The type this declares, built on first use: a Ty_Name for a record (so each declaration is a
+	//  new type, and it can refer to itself), or the type itself for another name for int, string or bool
+	Ty_ty declared_type();
 
+    Symbol get_name() const { return _name; }
     AST_node_* get_ty() const;
 private:
 	Symbol _name;
 	A_ty _ty;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitNamety(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitNamety(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNamety(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNamety(this, ctx);
-    }
+	Ty_ty stored_declared_type = 0;
 };
-class A_nametyList_ : public AST_node_ {   // possibly this would be happier as a subclass of "A_dec_"?
+class A_nametyList_ : public A_listOf_<A_namety, AST_node_> {   // possibly this would be happier as a subclass of "A_dec_"?
 public:
-	A_nametyList_(A_namety head, A_nametyList tail);
+	A_nametyList_(A_namety head);
 	virtual string print_rep(int indent, bool with_attributes);
-
-    AST_node_* get_head() const;
-    AST_node_* get_tail() const;
-private:
-	A_namety _head;
-	A_nametyList _tail;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitNametyList(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitNametyList(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNametyList(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNametyList(this, ctx);
-    }
 };
 
 
@@ -1297,33 +1012,11 @@ private:
 //  the function parameters: function power(B: INT, E: INT)
 //  or record fields:        type point = {X: INT, Y: INT)
 
-class A_fieldList_ : public AST_node_ {
+class A_fieldList_ : public A_listOf_<A_field, AST_node_> {
 public:
-	A_fieldList_(A_field head, A_fieldList tail);
+	A_fieldList_(A_field head);
 	virtual string print_rep(int indent, bool with_attributes);
 	Ty_ty init_typecheck();
-	int length();
-
-    AST_node_* get_head() const;
-    AST_node_* get_tail() const;
-    A_field_* cast_head() const;
-    A_fieldList_* cast_tail() const;
-private:
-	A_field _head;
-	A_fieldList _tail;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitFieldList(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitFieldList(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFieldList(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitFieldList(this, ctx);
-    }
 };
 
 class A_field_ : public AST_node_ {
@@ -1338,25 +1031,13 @@ private:
 	bool firstPass = true;
 	Symbol _name;
 	Symbol _typ;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitField(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitField(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitField(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitField(this, ctx);
-    }
 };
 
 
 class A_ty_ : public AST_node_ {
 public:
 	A_ty_(A_pos p);
+	virtual Ty_ty resolve_type() = 0;  // the Ty_ty this describes, looking up the names it uses
 };
 
 //  Using the name of a type to declare a variable with NameTy -- this is a use of a type
@@ -1365,75 +1046,42 @@ class A_nameTy_ : public A_ty_ {
 public:
 	A_nameTy_(A_pos pos, Symbol name);
 	virtual string print_rep(int indent, bool with_attributes);
+	Ty_ty resolve_type();
 
     Symbol get_name() const { return _name; }
 private:
 	Symbol _name;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitNameTy(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitNameTy(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNameTy(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitNameTy(this, ctx);
-    }
 };
 
 class A_recordty_ : public A_ty_ {
 public:
 	A_recordty_(A_pos pos, A_fieldList record);
 	virtual string print_rep(int indent, bool with_attributes);
+	Ty_ty resolve_type();
 
     AST_node_* get_record() const;
 private:
 	A_fieldList _record;
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitRecordty(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitRecordty(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitRecordty(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitRecordty(this, ctx);
-    }
 };
 
 class A_arrayty_ : public A_ty_ {
 public:
 	A_arrayty_(A_pos pos, Symbol array);
 	virtual string print_rep(int indent, bool with_attributes);
+	Ty_ty resolve_type();
 
     Symbol get_array() const { return _array; }
 private:
 	Symbol _array;   // type of element in the array
-
-    string acceptImpl(Visitor<string, StringContext>& visitor, StringContext ctx) {
-        return visitor.visitArrayty(this, ctx);
-    }
-    void acceptImpl(Visitor<void, VoidContext>& visitor, VoidContext ctx) {
-        visitor.visitArrayty(this, ctx);
-    }
-    ST<var_info> acceptImpl(Visitor<ST<var_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitArrayty(this, ctx);
-    }
-    ST<function_info> acceptImpl(Visitor<ST<function_info>, VoidContext>& visitor, VoidContext ctx) {
-        return visitor.visitArrayty(this, ctx);
-    }
 };
 
 
+void layout_frames(AST_node_ *root);  // where each variable goes in its function's frame, and how big the frames are
+
 extern bool have_AST_attrs;	// can be set to true with command-line arguments in tiger.cc, to print attributes
 const bool AST_print_positions=false;
 
 
 #include "AST_appel.h"  /* For compatibility with book, and more concise object creation */
+#include "visitors/visitor.t"  /* Visitor::dispatch needs the complete AST classes */
 #endif
@@ -81,9 +81,23 @@ inline A_var A_SubscriptVar(A_pos pos, A_var var, A_exp exp)
 	return new A_subscriptVar_(pos, var, exp);
 }
 
+// Lists are stored flat (see A_listOf_ in AST.h), so giving a list a new head puts the head
+//  at the front of that same list, rather than making a new cell that points to it;
+//  don't hang on to the tail and use it separately afterwards.
+template<typename List, typename Element>
+inline List *A_Cons(Element head, List *tail)
+{
+	precondition(head != 0);
+	if (tail == 0) {
+		return new List(head);
+	}
+	tail->prepend(head);
+	return tail;
+}
+
 inline A_expList A_ExpList(A_exp head, A_expList tail)
 {
-	return new A_expList_(head, tail);
+	return A_Cons(head, tail);
 }
 inline A_efield A_Efield(Symbol name, A_exp exp)
 {
@@ -91,14 +105,14 @@ inline A_efield A_Efield(Symbol name, A_exp exp)
 }
 inline A_efieldList A_EfieldList(A_efield head, A_efieldList tail)
 {
-	return new A_efieldList_(head, tail);
+	return A_Cons(head, tail);
 }
 
 
 // Declarationlists, and the things that live in them...
 inline A_decList A_DecList(A_dec head, A_decList tail)
 {
-	return new A_decList_(head, tail);
+	return A_Cons(head, tail);
 }
 inline A_dec A_VarDec(A_pos pos, Symbol var, Symbol typ, A_exp init)
 {
@@ -111,7 +125,7 @@ inline A_dec A_FunctionDec(A_pos pos, A_fundecList functions_that_might_call_eac
 }
 inline A_fundecList A_FundecList(A_fundec head, A_fundecList tail)
 {
-	return new A_fundecList_(head, tail);
+	return A_Cons(head, tail);
 }
 inline A_fundec A_Fundec(A_pos pos, Symbol name, A_fieldList params, Symbol result_type_or_0_pointer_for_no_result_type_in_declaration,  A_exp body)
 {
@@ -124,7 +138,7 @@ inline A_dec A_TypeDec(A_pos pos, A_nametyList types_that_might_refer_to_each_ot
 }
 inline A_nametyList A_NametyList(A_namety head, A_nametyList tail)
 {
-	return new A_nametyList_(head, tail);
+	return A_Cons(head, tail);
 }
 inline A_namety A_Namety(Symbol name, A_ty ty)
 {
@@ -149,7 +163,7 @@ inline A_ty A_NameTy(A_pos pos, Symbol name)
 
 inline A_fieldList A_FieldList(A_field head, A_fieldList tail)
 {
-	return new A_fieldList_(head, tail);
+	return A_Cons(head, tail);
 }
 inline A_field A_Field(A_pos pos, Symbol name, Symbol type_or_0_pointer_for_no_type_in_declaration)
 {
@@ -0,0 +1,28 @@
+#if ! defined _AST_BINARY_H
+#define _AST_BINARY_H 1
+
+#include "AST.h"
+
+// A compact binary form of the AST (".tast" files), so tools that come after parsing
+//  (analysis, codegen experiments, the printer in AST-print.cc) can skip flex and bison.
+//
+// A file holds a header, a table of every distinct string (symbols, string literals, and the
+//  name of the source file), and then the nodes in preorder: a tag (the node's AST_node_kind, from
+//  visitors/visitor.h, with AST_kind_unknown for a missing child), the position as line/column
+//  numbers, the node's own fields (strings as indices into the table), and its children.
+//  Lists are written as a count followed by their elements.  Numbers are variable-length,
+//  so small ones take one byte.
+// If saved "with attributes", each node is followed by its type (for the primitive types),
+//  expressions by their result_reg, let expressions by their let number, and field variables by
+//  the field's offset in the record, so a reloaded tree doesn't need to be typechecked again.
+//  SP offsets are not saved, since layout_frames works them out again for the reloaded tree anyway.
+//
+// Loading reads the whole file in one go and makes one Symbol per entry in the string table,
+//  which all the nodes using that name then share.  It is not zero-copy: each string is copied
+//  out of the buffer into its Symbol (which outlives the buffer), and the nodes are built one by one.
+
+bool AST_save_binary(A_root_ *root, string file_name, string source_file_name, bool with_attributes);
+bool AST_is_binary_file(string file_name);                          // does it start with the ".tast" header?
+A_root_ *AST_load_binary(string file_name, string &source_file_name);  // 0 (after an EM_error) if it can't
+
+#endif
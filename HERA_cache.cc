@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include "errormsg.h"
+#include "HERA_cache.h"
+
+// Cache file format: a header line, then for each entry a line
+//     <key> <code length> <nested_code length>
+//  followed by the code and nested code themselves (which contain newlines, hence the lengths).
+
+static const string cache_header = "HERA-cache 2";  // 2 numbered labels within each function
+
+static bool cache_on = false;
+static string cache_file_name;
+static std::map<string, HERA_cache_entry> old_entries;   // from the cache file
+static std::map<string, HERA_cache_entry> used_entries;  // hit or created in this compilation
+static int hits = 0, misses = 0;
+
+void HERA_cache_open(string cache_file)
+{
+	cache_on = true;
+	cache_file_name = cache_file;
+
+	std::ifstream in(cache_file, std::ios::binary);
+	if (!in) {
+		EM_DEBUG(EM_cache, "No HERA cache in " + cache_file + " yet; compiling all functions");
+		return;
+	}
+	string header;
+	if (!std::getline(in, header) || header != cache_header) {
+		EM_warning("Ignoring HERA cache " + cache_file + ", since it is not in the expected format");
+		return;
+	}
+	string key;
+	HERA_cache_entry entry;
+	size_t code_length, nested_length;
+	while (in >> key >> code_length >> nested_length) {
+		in.get();  // the newline after the lengths
+		entry.code.resize(code_length);
+		entry.nested_code.resize(nested_length);
+		if (!in.read(&entry.code[0], code_length) || !in.read(&entry.nested_code[0], nested_length)) {
+			EM_warning("HERA cache " + cache_file + " is truncated; ignoring the rest of it");
+			break;
+		}
+		old_entries[key] = entry;
+	}
+	EM_DEBUG(EM_cache, "Read " + std::to_string(old_entries.size()) + " function(s) from HERA cache " + cache_file);
+}
+
+void HERA_cache_close()
+{
+	if (!cache_on) return;
+	EM_DEBUG(EM_cache, "HERA cache: reused " + std::to_string(hits) + " function(s), compiled " + std::to_string(misses));
+
+	// only keep what this compilation used, so stale versions of functions don't pile up
+	std::ofstream out(cache_file_name, std::ios::binary);
+	if (!out) {
+		EM_warning("Could not write HERA cache " + cache_file_name);
+		return;
+	}
+	out << cache_header << "\n";
+	for (auto &key_and_entry : used_entries) {
+		const HERA_cache_entry &entry = key_and_entry.second;
+		out << key_and_entry.first << " " << entry.code.length() << " " << entry.nested_code.length() << "\n"
+		    << entry.code << entry.nested_code;
+	}
+	cache_on = false;
+}
+
+bool HERA_cache_enabled()
+{
+	return cache_on;
+}
+
+string HERA_cache_key(const string &fingerprint)
+{
+	// 64-bit FNV-1a; std::hash isn't guaranteed to give the same answer from one run to the next
+	unsigned long long hash = 14695981039346656037ULL;
+	for (unsigned char c : fingerprint) {
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	char digest[17];
+	snprintf(digest, sizeof digest, "%016llx", hash);
+	return string(digest) + "-" + std::to_string(fingerprint.length());
+}
+
+bool HERA_cache_lookup(const string &key, HERA_cache_entry &entry)
+{
+	auto found = old_entries.find(key);
+	if (found == old_entries.end()) {
+		misses++;
+		return false;
+	}
+	hits++;
+	entry = found->second;
+	used_entries[key] = entry;
+	return true;
+}
+
+void HERA_cache_store(const string &key, const HERA_cache_entry &entry)
+{
+	used_entries[key] = entry;
+}
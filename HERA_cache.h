@@ -0,0 +1,30 @@
+#if ! defined _HERA_CACHE_H
+#define _HERA_CACHE_H 1
+
+#include "util.h"
+
+// Per-function cache of generated HERA code, for incremental recompilation (the -i flag in tiger.cc).
+//
+// Each A_fundec_ gets a fingerprint of its subtree (see visitors/fingerprint_visitor.h), its signature,
+//  and what it uses from outside (the callees' names, the frames of enclosing functions' variables);
+//  if a previous compilation already produced HERA code for that fingerprint, we reuse it rather
+//  than walking the body again. Labels and strings are numbered within each function (see
+//  HERA_label_scope), so editing one function doesn't change the fingerprints of the others.
+// Code for nested functions (which A_functionDec_ appends to func_HERA_code instead of returning)
+//  is stored along with it, so a cache hit leaves the rest of code generation exactly as if we had
+//  compiled the function.
+
+struct HERA_cache_entry {
+	string code;          // what A_fundec_::HERA_code returned
+	string nested_code;   // what was appended to func_HERA_code along the way
+};
+
+void HERA_cache_open(string cache_file);   // turn on caching, reading entries from cache_file if it exists
+void HERA_cache_close();                   // write the entries used in this compilation back to the cache file
+bool HERA_cache_enabled();
+
+string HERA_cache_key(const string &fingerprint);  // a short (hex) digest of the fingerprint
+bool HERA_cache_lookup(const string &key, HERA_cache_entry &entry);
+void HERA_cache_store(const string &key, const HERA_cache_entry &entry);
+
+#endif
@@ -1,10 +1,24 @@
+#include <functional>
+#include <set>
 #include "AST.h"
 #include "ST.h"
+#include "HERA_cache.h"
+#include "HERA_select.h"
+#include "call_graph.h"
+#include "optimize.h"
+#include "visitors/fingerprint_visitor.h"
 
 // IfExp Counter for branching expressions
 int if_counter = 0;
 int comp_counter = 0;
 int loop_counter = 0;
+int let_code_counter = 0;  // for the comments around let expressions
+// The for loops whose copy without bounds checks we're generating (see A_forExp_::HERA_code)
+static std::set<AST_node_ *> unchecked_loops;
+// The loop-invariant expressions we're computing before their loops, rather than loading (see optimize.h)
+static std::set<AST_node_ *> hoisting;
+// The expressions we're computing to keep their values in the frame for later (see optimize.h)
+static std::set<AST_node_ *> keeping;
 
 /*
  * HERA_code methods
@@ -19,6 +33,9 @@ const string indent_math = "    ";  // might want to use something different for
 	A_expList_
 	A_stringExp_
 	A_boolExp_
+	A_nilExp_
+	A_recordExp_
+	A_arrayExp_
 	A_ifExp_
 	A_seqExp_
 	A_whileExp_
@@ -26,9 +43,12 @@ const string indent_math = "    ";  // might want to use something different for
 	A_forExp_
 	A_varExp_
 	A_simpleVar_
+	A_fieldVar_
+	A_subscriptVar_
 	A_letExp_
 	A_decList_
 	A_varDec_
+	A_typeDec_
 	A_assignExp_
 	A_functionDec_
 	A_fundecList_
@@ -36,7 +56,7 @@ const string indent_math = "    ";  // might want to use something different for
 */
 
 string AST_node_::HERA_code() {  // Default used during development; could be removed in final version
-    EM_debug("Compiling AST_node");
+    EM_DEBUG(EM_codegen, "Compiling AST_node");
 	string message = "HERA_code() requested for AST node type not yet having a HERA_code() method";
 	EM_error(message);
 	return "#error " + message;  //if somehow we try to HERA-C-Run this, it will fail
@@ -44,12 +64,97 @@ string AST_node_::HERA_code() {  // Default used during development; could be re
 
 string func_HERA_code = "";
 
+// Where a failed bounds check (or an array with a negative size) goes: print why, and stop
+//  with the same exit status as a run-time error in "tiger -run"
+static const string array_error_code =
+	"LABEL(tiger_bad_subscript)\n"
+	+ indent_math + "SET(R1, tiger_bad_subscript_message)\n"
+	+ indent_math + "BR(tiger_run_time_error)\n"
+	+ "LABEL(tiger_bad_array_size)\n"
+	+ indent_math + "SET(R1, tiger_bad_array_size_message)\n"
+	+ indent_math + "BR(tiger_run_time_error)\n";
+
+// Where a field access on nil goes
+static const string field_error_code =
+	"LABEL(tiger_nil_record)\n"
+	+ indent_math + "SET(R1, tiger_nil_record_message)\n"
+	+ indent_math + "BR(tiger_run_time_error)\n";
+
+// Print the message in R1, and stop
+static const string run_time_error_code =
+	"LABEL(tiger_run_time_error)\n"
+	+ indent_math + "MOVE(FP_alt, SP)\n"
+	+ indent_math + "INC(SP, 4)\n"
+	+ indent_math + "STORE(R1, 3, FP_alt)\n"
+	+ indent_math + "CALL(FP_alt, print)\n"
+	+ indent_math + "SET(R1, 3)\n"
+	+ indent_math + "STORE(R1, 3, FP_alt)\n"
+	+ indent_math + "CALL(FP_alt, exit)\n"
+	+ indent_math + "HALT()\n\n";
+
+// Move SP up (INC) or down (DEC) past a whole frame; INC and DEC only take 1 to 64
+static string SP_HERA_code(string op, int words)
+{
+	string output;
+	for (; words > 0; words -= 64) {
+		output += indent_math + op + "(SP, " + std::to_string(std::min(words, 64)) + ")\n";
+	}
+	return output;
+}
+
+// Add words, which may be negative (or 0, for no code at all), to a register
+static string add_HERA_code(string reg, int words)
+{
+	string output;
+	for (; words > 0; words -= std::min(words, 64)) {
+		output += indent_math + "INC(" + reg + ", " + std::to_string(std::min(words, 64)) + ")\n";
+	}
+	for (; words < 0; words += std::min(-words, 64)) {
+		output += indent_math + "DEC(" + reg + ", " + std::to_string(std::min(-words, 64)) + ")\n";
+	}
+	return output;
+}
+
+// The function whose code we're generating (0 for main), and the size of its frame
+static A_fundec_ *current_function = 0;
+static int current_frame_size = 0;
+
+// A call from the code of an expression starts by pointing FP_alt at the callee's frame, which
+//  the caller fills in up to "words" (3 + the arguments), and moving SP past that. The frame goes
+//  just above the part of ours that's in use (get_frame_top, see visitors/frame_layout_visitor.h),
+//  so some way below SP; or at SP, in another call's arguments, or if the optimizer keeps values
+//  at the top of our frame (see optimize.h).
+static int call_frame_below(A_exp_ *exp)
+{
+	int top = exp->get_frame_top();
+	return top >= 0 && !OPT_keeps_values_in_frame(current_function) ? current_frame_size - top : 0;
+}
+static string call_start_HERA_code(A_exp_ *exp, int words)
+{
+	return indent_math + "MOVE(FP_alt, SP)\n"
+	     + add_HERA_code("FP_alt", -call_frame_below(exp))
+	     + add_HERA_code("SP", words - call_frame_below(exp));
+}
+// ... and ends (once FP_alt has been restored, if need be) by moving SP back to the top of our frame
+static string call_end_HERA_code(A_exp_ *exp, int words)
+{
+	return add_HERA_code("SP", call_frame_below(exp) - words);
+}
+
 string A_root_::HERA_code() {
-    EM_debug("Compiling root");
+    EM_DEBUG(EM_codegen, "Compiling root");
+	current_function = 0;
+	current_frame_size = frame_size;
+	string main_code = main_expr->HERA_code();  // first, since it adds the functions to func_HERA_code
 	string output = "";
     output += "\nCBON()\n\n" + 
-              main_expr->HERA_code() +// was SETCB for HERA 2.3
+              // room for main's variables (see layout_frames.cc)
+              SP_HERA_code("INC", frame_size) +
+              main_code +// was SETCB for HERA 2.3
 		      "\nHALT()\n\n" + 
+              (HERA_uses_arrays ? array_error_code : "") +
+              (HERA_uses_fields ? field_error_code : "") +
+              (HERA_uses_arrays || HERA_uses_fields ? run_time_error_code : "") +
               func_HERA_code;
 
 	return output;
@@ -58,7 +163,7 @@ string A_root_::HERA_code() {
 
 
 string A_intExp_::HERA_code() {
-    EM_debug("Compiling intExp");
+    EM_DEBUG(EM_codegen, "Compiling intExp");
 	return indent_math + "SET(" + result_reg_s() + ", " + str(value) +")\n";
 }
 
@@ -102,8 +207,104 @@ static string HERA_math_op(Position p, A_oper op) { // needed for opExp
 	}
 }
 
+// The code for an expression whose value is in the frame (see optimize.h): a loop-invariant one, inside
+//  its loop, or one that was computed already, just loads it; one that's computed for later stores it
+//  as soon as it has it. "" for anything else
+static string frame_value_HERA_code(A_exp_ *exp)
+{
+	int slot = OPT_hoisted_slot(exp);
+	if (slot >= 0 && !hoisting.count(exp)) {
+		return indent_math + "LOAD(" + exp->result_reg_s() + ", " + std::to_string(slot) + ", FP)" + indent_math + "// computed before the loop\n";
+	}
+	slot = OPT_reused_slot(exp);
+	if (slot >= 0) {
+		return indent_math + "LOAD(" + exp->result_reg_s() + ", " + std::to_string(slot) + ", FP)" + indent_math + "// computed already\n";
+	}
+	slot = OPT_kept_slot(exp);
+	if (slot >= 0 && !keeping.count(exp)) {
+		keeping.insert(exp);
+		string code = exp->HERA_code();
+		keeping.erase(exp);
+		return code + indent_math + "STORE(" + exp->result_reg_s() + ", " + std::to_string(slot) + ", FP)" + indent_math + "// kept for later\n";
+	}
+	return "";
+}
+
+// ... and this is where the loop computes them, before it starts
+static string preheader_HERA_code(AST_node_ *loop)
+{
+	string code = "";
+	for (AST_node_ *node : OPT_hoisted_by(loop)) {
+		A_exp_ *exp = static_cast<A_exp_ *>(node);
+		hoisting.insert(exp);
+		code = code + exp->HERA_code()
+		     + indent_math + "STORE(" + exp->result_reg_s() + ", " + std::to_string(OPT_hoisted_slot(exp)) + ", FP)" + indent_math + "// loop invariant\n";
+		hoisting.erase(exp);
+	}
+	return code;
+}
+
+// How many instructions some code has, leaving out comments and labels (for OPT_unroll_factor)
+static int HERA_instruction_count(const string &code)
+{
+	int count = 0;
+	size_t start = 0;
+	while (start < code.length()) {
+		size_t end = code.find('\n', start);
+		if (end == string::npos) {
+			end = code.length();
+		}
+		size_t first = code.find_first_not_of(" \t", start);
+		if (first < end && code.compare(first, 2, "//") != 0 && code.compare(first, 6, "LABEL(") != 0) {
+			count++;
+		}
+		start = end + 1;
+	}
+	return count;
+}
+
+// Arithmetic covered by one of the rules other than reg op reg (see HERA_select.h)
+static string selected_HERA_code(A_exp_ *node, A_oper op, const HERA_selection &selection)
+{
+	string result_reg_s = node->result_reg_s();
+	if (selection.rule == HERA_rule_constant) {
+		return indent_math + "SET(" + result_reg_s + ", " + std::to_string(selection.value) + ")\n";
+	}
+	string output = selection.operand->HERA_code();  // leaves it in our register
+	switch (selection.rule) {
+	case HERA_rule_increment:
+		return output + indent_math + "INC(" + result_reg_s + ", " + std::to_string(selection.value) + ")\n";
+	case HERA_rule_decrement:
+		return output + indent_math + "DEC(" + result_reg_s + ", " + std::to_string(selection.value) + ")\n";
+	case HERA_rule_negate:
+		return output + indent_math + "SUB(" + result_reg_s + ", R0, " + result_reg_s + ")\n";
+	case HERA_rule_shift_left:
+	case HERA_rule_shift_right:
+		for (int k = 0; k < selection.value; k++) {
+			output += indent_math + (selection.rule == HERA_rule_shift_left ? "LSL(" : "LSR(") + result_reg_s + ", " + result_reg_s + ")\n";
+		}
+		return output;
+	case HERA_rule_constant_operand:
+		output += indent_math + "SET(R1, " + std::to_string(selection.value) + ")\n";
+		return output + indent_math + HERA_math_op(node->pos(), op) + "(" + result_reg_s + ", "
+		       + (selection.constant_first ? "R1, " + result_reg_s : result_reg_s + ", R1") + ")\n";
+	default:  // HERA_rule_same
+		return output;
+	}
+}
+
 string A_opExp_::HERA_code() {
-    EM_debug("Compiling opExp");
+    EM_DEBUG(EM_codegen, "Compiling opExp");
+	string in_frame = frame_value_HERA_code(this);
+	if (in_frame != "") {
+		return in_frame;
+	}
+	if (_oper == A_plusOp || _oper == A_minusOp || _oper == A_timesOp || _oper == A_divideOp) {
+		const HERA_selection &selection = HERA_select(this);
+		if (selection.rule != HERA_rule_registers) {
+			return selected_HERA_code(this, _oper, selection);
+		}
+	}
 	/* Modify to follow S-U algorithm child with more registers should be first */
 	int left_reg = _left->result_reg();
 	string left_reg_s = _left->result_reg_s();
@@ -138,27 +339,24 @@ string A_opExp_::HERA_code() {
 		// A few string vars for label creation
 		int this_comp_counter = comp_counter;
 		comp_counter++;
-		string label = "else_comp_" + std::to_string(this_comp_counter);
-		string end_label = "end_of_comp_" + std::to_string(this_comp_counter);
+		string label = "else_comp_" + HERA_label_scope + std::to_string(this_comp_counter);
+		string end_label = "end_of_comp_" + HERA_label_scope + std::to_string(this_comp_counter);
 
-		// Int Comparisons
-		if (_left->typecheck() == Ty_Int()) {
+		// Int Comparisons, and records (which compare by address)
+		if (_left->typecheck() != Ty_String()) {
 			// Handle Comparison Operations
 			output = output + indent_math + "CMP(" + left_reg_s + ", " + right_reg_s + ")\n"; 
-		} else if (_left->typecheck() == Ty_String()) {
+		} else {
 			// String comparison. Function call to tstrcmp
-            int SP_counter = calculate_my_SP(this);
             // TODO: replace opExp node having tstrcmp to a callExp node
 			output = output 
-				+ "// Start of Function Call for function tstrcmp in opExp. Current SP at: " + std::to_string(SP_counter) 
-				+ indent_math + "MOVE(Rt, FP_alt)\n"
-				+ indent_math + "MOVE(FP_alt, SP)\n" 
-				+ indent_math + "INC(SP, 5)\n"
+				+ "// Start of Function Call for function tstrcmp in opExp\n"
+				+ call_start_HERA_code(this, 5)
 				+ indent_math + "STORE(" + left_reg_s + ", 3, FP_alt)\n"
 				+ indent_math + "STORE(" + right_reg_s + ", 4, FP_alt)\n"
 				+ indent_math + "CALL(FP_alt, tstrcmp)\n"
 				+ indent_math + "LOAD(" + output_reg_s + ", 3, FP_alt)\n"
-				+ indent_math + "DEC(SP, 5)\n"
+				+ call_end_HERA_code(this, 5)
 				+ indent_math + "CMP(" + output_reg_s + ", R0)\n"; 
 		}
 		// Comparison Operation and Branching. Generic to all comparisons
@@ -173,7 +371,14 @@ string A_opExp_::HERA_code() {
 }
 
 string A_callExp_::HERA_code() {
-    EM_debug("Compiling callExp");
+    EM_DEBUG(EM_codegen, "Compiling callExp");
+    string in_frame = frame_value_HERA_code(this);
+    if (in_frame != "") {
+        return in_frame;
+    }
+    if (HERA_is_division(this) && HERA_select(this).rule != HERA_rule_registers) {
+        return selected_HERA_code(this, A_divideOp, HERA_select(this));
+    }
     // From HERA Manual: To call a function that uses this convention, we:
     // • Set FP_alt←SP and increment SP to allocate initial stack frame (size 3 + #parameters [+ 1 if no parameters for return value])
     //      Three for Return Address, Dynamic Link, Static Link
@@ -186,14 +391,50 @@ string A_callExp_::HERA_code() {
     //
     int args_length = _args ? _args->length() : 0;
     string unique_func_name = get_my_unique_function_name();
-    string args_hera_code = _args ? _args->store_HERA_code(3) : "";
+    string args_hera_code = "";
+    string reload_hera_code = "";
+    // Under -O, some functions take their first few arguments in registers (see optimize.h)
+    A_fundec_ *callee = call_graph_summary ? call_graph_summary->fundec : 0;
+    bool in_registers = callee != 0 && OPT_uses_register_arguments(callee);
+    if (!in_registers) {
+        args_hera_code = _args ? _args->store_HERA_code(3) : "";
+    } else if (_args) {
+        int arg = 0;
+        for (A_exp e : *_args) {
+            string slot = std::to_string(3 + arg);
+            string arg_reg = "R" + std::to_string(OPT_first_argument_register + arg);
+            args_hera_code += e->HERA_code();
+            if (arg >= OPT_argument_registers || OPT_is_held_argument(this, arg)) {
+                args_hera_code += indent_math + "STORE(" + e->result_reg_s() + ", " + slot + ", FP_alt)\n";
+                if (arg < OPT_argument_registers) {  // a later argument needs the register, or a call might change it
+                    reload_hera_code += indent_math + "LOAD(" + arg_reg + ", " + slot + ", FP_alt)\n";
+                }
+            } else {
+                args_hera_code += indent_math + "MOVE(" + arg_reg + ", " + e->result_reg_s() + ")\n";
+            }
+            arg++;
+        }
+    }
+
+    // The static link goes just after the arguments (see visitors/static_link_visitor.h)
+    string link_hera_code = "";
+    if (static_link == 0) {
+        link_hera_code = indent_math + "STORE(FP, " + std::to_string(3 + args_length) + ", FP_alt)  // Static link\n";
+        args_length++;
+    } else if (static_link > 0) {
+        link_hera_code = caller->frame_pointer_HERA_code(static_link, "R1")
+                       + indent_math + "STORE(R1, " + std::to_string(3 + args_length) + ", FP_alt)  // Static link\n";
+        args_length++;
+    }
 
     ST<function_info> parent_function_library = local_function_library;
     string func_return_hera_code = "";
 	if (is_name_there(_func, parent_function_library)) {
 		function_info func_struct = lookup(_func, parent_function_library);
 		Ty_ty return_type = func_struct.my_return_type();
-		if (return_type != Ty_Void()) {
+		if (return_type != Ty_Void() && in_registers) {
+			func_return_hera_code = indent_math + "MOVE(" + this->result_reg_s() + ", R1)  // Result comes back in R1\n";
+		} else if (return_type != Ty_Void()) {
 			func_return_hera_code = indent_math + "LOAD(" + this->result_reg_s() + ", 3, FP_alt)  // Loading result into R4 for return\n";
             args_length = args_length > 0 ? args_length : 1; // Set to 1 here for return value
 		}
@@ -204,27 +445,28 @@ string A_callExp_::HERA_code() {
     // NOTE: added hack to save FP_alt for situations where functions call functions
 	string output = "// Start of Function Call for function " + unique_func_name + "\n"
             + indent_math + "MOVE(Rt, FP_alt)\n"
-			+ indent_math + "MOVE(FP_alt, SP)\n"
-			+ indent_math + "INC(SP, " + std::to_string(3 + args_length) + ")\n"
+			+ call_start_HERA_code(this, 3 + args_length)
             + indent_math + "STORE(Rt, 2, FP_alt)\n"
             + args_hera_code
+            + link_hera_code
+            + reload_hera_code
 			+ indent_math + "CALL(FP_alt, " + unique_func_name + ")\n"
             + func_return_hera_code
             + indent_math + "LOAD(FP_alt, 2, FP_alt)\n"
-			+ indent_math + "DEC(SP, " + std::to_string(3 + args_length) + ")\n"
+			+ call_end_HERA_code(this, 3 + args_length)
 	        + "// End of Function Call for function " + unique_func_name + "\n";
 	return output;
 }
 
 string A_stringExp_::HERA_code() {
-    EM_debug("Compiling stringExp");
+    EM_DEBUG(EM_codegen, "Compiling stringExp");
 	/* Add preamble string memory allocation */
-	string this_str_label = "string_" + std::to_string(count);
+	string this_str_label = "string_" + HERA_label_scope + std::to_string(count);
 	return indent_math + "SET(" + result_reg_s() + ", " + this_str_label + ")\n";
 }
 
 string A_boolExp_::HERA_code() {
-    EM_debug("Compiling boolExp");
+    EM_DEBUG(EM_codegen, "Compiling boolExp");
 	if (value) {
 		return indent_math + "SET(" + result_reg_s() + ", 1)\n";
 	} else {
@@ -232,15 +474,199 @@ string A_boolExp_::HERA_code() {
 	}  
 }
 
+string A_nilExp_::HERA_code() {
+    EM_DEBUG(EM_codegen, "Compiling nilExp");
+	return indent_math + "SET(" + result_reg_s() + ", 0)\n";
+}
+
+string A_recordExp_::HERA_code() {
+    EM_DEBUG(EM_codegen, "Compiling recordExp " + Symbol_to_string(_typ));
+	// Records come from a chunk of memory that we get from malloc a piece at a time and hand out
+	//  by bumping tiger_heap_next (see A_root_::HERA_data), so only every so often is there a call.
+	// The fields' offsets were worked out when the type was declared (see Ty_field_offset).
+	Ty_ty record_type = typecheck();
+	int size = Ty_record_size(record_type);
+	int chunk = std::max(256, size);
+	string record_reg_s = result_reg_s();
+	string size_s = std::to_string(size);
+	string allocated_label = "record_allocated_" + HERA_label_scope + std::to_string(comp_counter);
+	comp_counter++;
+	string bump_code = size <= 64 ? indent_math + "INC(R2, " + size_s + ")\n"
+	                              : indent_math + "SET(R1, " + size_s + ")\n" + indent_math + "ADD(R2, R2, R1)\n";
+
+	string output = "// Start of Record " + Symbol_to_string(_typ) + ": " + size_s + " cell(s)\n"
+	              + indent_math + "SET(R1, tiger_heap_next)\n"
+	              + indent_math + "LOAD(" + record_reg_s + ", 0, R1)\n"
+	              + indent_math + "MOVE(R2, " + record_reg_s + ")\n"
+	              + bump_code
+	              + indent_math + "SET(R1, tiger_heap_limit)\n"
+	              + indent_math + "LOAD(R1, 0, R1)\n"
+	              + indent_math + "CMP(R2, R1)\n"
+	              + indent_math + "BULE(" + allocated_label + ")\n"
+	              // Out of room: get a new chunk, and take the record from the start of it
+	              + indent_math + "MOVE(Rt, FP_alt)\n"
+	              + call_start_HERA_code(this, 4)
+	              + indent_math + "STORE(Rt, 2, FP_alt)\n"
+	              + indent_math + "SET(R1, " + std::to_string(chunk) + ")\n"
+	              + indent_math + "STORE(R1, 3, FP_alt)\n"
+	              + indent_math + "CALL(FP_alt, malloc)\n"
+	              + indent_math + "LOAD(" + record_reg_s + ", 3, FP_alt)\n"
+	              + indent_math + "LOAD(FP_alt, 2, FP_alt)\n"
+	              + call_end_HERA_code(this, 4)
+	              + indent_math + "SET(R1, " + std::to_string(chunk) + ")\n"
+	              + indent_math + "ADD(R1, " + record_reg_s + ", R1)\n"
+	              + indent_math + "SET(R2, tiger_heap_limit)\n"
+	              + indent_math + "STORE(R1, 0, R2)\n"
+	              + indent_math + "MOVE(R2, " + record_reg_s + ")\n"
+	              + bump_code
+	              + indent_math + "LABEL(" + allocated_label + ")\n"
+	              + indent_math + "SET(R1, tiger_heap_next)\n"
+	              + indent_math + "STORE(R2, 0, R1)\n";
+	// The fields go in registers below the record's, so they leave its address alone
+	int count = _fields ? _fields->length() : 0;
+	for (int i = 0; i < count; i++) {
+		A_efield field = _fields->element(i);
+		A_exp init = static_cast<A_exp_ *>(field->get_exp());
+		output = output + init->HERA_code()
+		       + indent_math + "STORE(" + init->result_reg_s() + ", " + std::to_string(Ty_field_offset(record_type, field->get_name())) + ", " + record_reg_s + ")"
+		       + indent_math + "// Field " + Symbol_to_string(field->get_name()) + "\n";
+	}
+	return output + "// End of Record " + Symbol_to_string(_typ) + "\n";
+}
+
+string A_arrayExp_::HERA_code() {
+    EM_DEBUG(EM_codegen, "Compiling arrayExp " + Symbol_to_string(_typ));
+	// An array is its length followed by its elements, and its address is that of the length, so
+	//  element i is at address+1+i; the length is there for the bounds checks (see A_subscriptVar_::HERA_code).
+	string array_reg_s = result_reg_s();
+	string size_reg_s = _size->result_reg_s();
+	string init_reg_s = _init->result_reg_s();
+	string fill_label = "array_fill_" + HERA_label_scope + std::to_string(comp_counter);
+	string filled_label = "array_filled_" + HERA_label_scope + std::to_string(comp_counter);
+	comp_counter++;
+
+	return "// Start of Array " + Symbol_to_string(_typ) + "\n"
+	       + _size->HERA_code()
+	       + indent_math + "CMP(" + size_reg_s + ", R0)\n"
+	       + indent_math + "BL(tiger_bad_array_size)\n"
+	       + indent_math + "MOVE(Rt, FP_alt)\n"
+	       + call_start_HERA_code(this, 4)
+	       + indent_math + "STORE(Rt, 2, FP_alt)\n"
+	       + indent_math + "MOVE(R1, " + size_reg_s + ")\n"
+	       + indent_math + "INC(R1, 1)\n"
+	       + indent_math + "STORE(R1, 3, FP_alt)\n"
+	       + indent_math + "CALL(FP_alt, malloc)\n"
+	       + indent_math + "LOAD(" + array_reg_s + ", 3, FP_alt)\n"
+	       + indent_math + "LOAD(FP_alt, 2, FP_alt)\n"
+	       + call_end_HERA_code(this, 4)
+	       + indent_math + "STORE(" + size_reg_s + ", 0, " + array_reg_s + ")  // Length\n"
+	       // The initial value goes in registers below the array's, but may need the size's
+	       + _init->HERA_code()
+	       + indent_math + "LOAD(R2, 0, " + array_reg_s + ")\n"
+	       + indent_math + "MOVE(R1, " + array_reg_s + ")\n"
+	       + indent_math + "LABEL(" + fill_label + ")\n"
+	       + indent_math + "CMP(R2, R0)\n"
+	       + indent_math + "BLE(" + filled_label + ")\n"
+	       + indent_math + "INC(R1, 1)\n"
+	       + indent_math + "STORE(" + init_reg_s + ", 0, R1)\n"
+	       + indent_math + "DEC(R2, 1)\n"
+	       + indent_math + "BR(" + fill_label + ")\n"
+	       + indent_math + "LABEL(" + filled_label + ")\n"
+	       + "// End of Array " + Symbol_to_string(_typ) + "\n";
+}
+
+// A chain of ifs that compare one variable with constants (see optimize.h): put the variable in
+//  its register once, then go to the right then by a jump table, indexed by the variable minus the
+//  smallest constant (times the size of an entry), or by a binary search of the constants. Each then (and the default) is laid
+//  out as the chain's own ifs would be, each going to one end label.
+static string switch_HERA_code(A_ifExp_ *node, const OPT_switch &chain)
+{
+	string number = HERA_label_scope + std::to_string(if_counter++);
+	string default_label = "else_label_" + number, end_label = "end_of_if_then_else_" + number;
+	auto case_label = [&](size_t k) { return "case_label_" + number + "_" + std::to_string(k); };
+
+	A_exp_ *var = static_cast<A_exp_ *>(chain.var);
+	string reg = var->result_reg_s();
+	string code = var->HERA_code();
+	if (chain.jump_table) {
+		int low = chain.cases.front().first, high = chain.cases.back().first;
+		string table_label = "jump_table_" + number;
+		// x - low, as an unsigned number, is past the end of the table for any x below low or above high
+		code += (low == 0 ? indent_math + "MOVE(R1, " + reg + ")\n"
+		                  : indent_math + "SET(R1, " + std::to_string(low) + ")\n" + indent_math + "SUB(R1, " + reg + ", R1)\n")
+		      + indent_math + "SET(R2, " + std::to_string(high - low) + ")\n"
+		      + indent_math + "CMP(R1, R2)\n"
+		      + indent_math + "BUG(" + default_label + ")\n"
+		      // each entry is a BR to a label, which HERA-C makes three words (SETLO, SETHI, BR(Rt)),
+		      //  so the entry for x - low is 3 * (x - low) words into the table
+		      + indent_math + "LSL(R2, R1)\n"
+		      + indent_math + "ADD(R1, R1, R2)\n"
+		      + indent_math + "SET(R2, " + table_label + ")\n"
+		      + indent_math + "ADD(R1, R1, R2)\n"
+		      + indent_math + "BR(R1)\n"
+		      + indent_math + "LABEL(" + table_label + ")\n";
+		size_t k = 0;
+		for (int value = low; value <= high; value++) {
+			code += indent_math + "BR(" + (chain.cases[k].first == value ? case_label(k++) : default_label) + ")"
+			      + indent_math + "// " + std::to_string(value) + "\n";
+		}
+	} else {
+		// cases [first, last): test the middle one, then search the half x must be in; a few are just tested in turn
+		std::function<string(size_t, size_t)> search = [&](size_t first, size_t last) {
+			string output = "";
+			if (last - first <= 3) {
+				for (size_t k = first; k < last; k++) {
+					output += indent_math + "SET(R1, " + std::to_string(chain.cases[k].first) + ")\n"
+					        + indent_math + "CMP(" + reg + ", R1)\n"
+					        + indent_math + "BZ(" + case_label(k) + ")\n";
+				}
+				return output + indent_math + "BR(" + default_label + ")\n";
+			}
+			size_t middle = (first + last) / 2;
+			string lower_label = "case_lower_" + number + "_" + std::to_string(middle);
+			return indent_math + "SET(R1, " + std::to_string(chain.cases[middle].first) + ")\n"
+			       + indent_math + "CMP(" + reg + ", R1)\n"
+			       + indent_math + "BZ(" + case_label(middle) + ")\n"
+			       + indent_math + "BL(" + lower_label + ")\n"
+			       + search(middle + 1, last)
+			       + indent_math + "LABEL(" + lower_label + ")\n"
+			       + search(first, middle);
+		};
+		code += search(0, chain.cases.size());
+	}
+
+	for (size_t k = 0; k < chain.cases.size(); k++) {
+		A_exp_ *then = static_cast<A_exp_ *>(chain.cases[k].second);
+		code += indent_math + "LABEL(" + case_label(k) + ")\n" + then->HERA_code();
+		if (then->result_reg() != node->result_reg()) {
+			code += indent_math + "MOVE(" + node->result_reg_s() + ", " + then->result_reg_s() + ")\n";
+		}
+		code += indent_math + "BR(" + end_label + ")\n";
+	}
+	code += indent_math + "LABEL(" + default_label + ")\n";
+	if (chain.default_or_null != 0) {
+		A_exp_ *rest = static_cast<A_exp_ *>(chain.default_or_null);
+		code += rest->HERA_code();
+		if (rest->result_reg() != node->result_reg()) {
+			code += indent_math + "MOVE(" + node->result_reg_s() + ", " + rest->result_reg_s() + ")\n";
+		}
+	}
+	return code + indent_math + "LABEL(" + end_label + ")\n";
+}
+
 string A_ifExp_::HERA_code() {
-    EM_debug("Compiling ifExp");
+    EM_DEBUG(EM_codegen, "Compiling ifExp");
+	const OPT_switch *chain = OPT_switch_at(this);
+	if (chain != 0) {
+		return switch_HERA_code(this, *chain);
+	}
 	// A few string vars for label creation
 	int this_if_counter = if_counter;
 	if_counter = if_counter +1;
-	string else_label = "else_label_" + std::to_string(this_if_counter);
+	string else_label = "else_label_" + HERA_label_scope + std::to_string(this_if_counter);
 	string end_label;
 	if (_else_or_null != 0) {
-		end_label = "end_of_if_then_else_" + std::to_string(this_if_counter);
+		end_label = "end_of_if_then_else_" + HERA_label_scope + std::to_string(this_if_counter);
 	}
 	// _test is either an int or 0. If int do _then, else do _else_or_null
 	// First do check
@@ -267,15 +693,16 @@ string A_ifExp_::HERA_code() {
 }
 
 string A_expList_::HERA_code() {
-    string code = _head->HERA_code();
-    if (_tail) {
-        code += _tail->HERA_code();
+    string code;
+    for (A_exp e : *this) {
+        if (OPT_is_dead(e)) continue;  // nothing uses its value (see optimize.h)
+        code += e->HERA_code();
     }
     return code;
 }
 
 string A_seqExp_::HERA_code() {
-    EM_debug("Compiling seqExp");
+    EM_DEBUG(EM_codegen, "Compiling seqExp");
 	string my_code = "";
 
 	if (_seq == 0) {
@@ -293,7 +720,7 @@ string A_seqExp_::HERA_code() {
 }
 
 string A_whileExp_::HERA_code() {
-    EM_debug("Compiling whileExp");
+    EM_DEBUG(EM_codegen, "Compiling whileExp");
 
 	// Evaluate _test
 	// Check if zero
@@ -302,9 +729,10 @@ string A_whileExp_::HERA_code() {
 	int this_loop_counter = loop_counter;
 	my_num = this_loop_counter;
 	loop_counter++;
-	string start_label = "loop_start_" + std::to_string(this_loop_counter);
-	string end_label = "loop_end_" + std::to_string(this_loop_counter);
+	string start_label = "loop_start_" + HERA_label_scope + std::to_string(this_loop_counter);
+	string end_label = "loop_end_" + HERA_label_scope + std::to_string(this_loop_counter);
 	string my_code = "// Start of While loop: " + std::to_string(my_num) + "\n"
+			+ preheader_HERA_code(this)
 			+ indent_math + "LABEL(" + start_label + ")\n"
 			+ _test->HERA_code()
 			+ indent_math + "CMP(" + _test->result_reg_s() + ", R0)\n" 
@@ -317,62 +745,165 @@ string A_whileExp_::HERA_code() {
 }
 
 string A_breakExp_::HERA_code() {
-    EM_debug("Compiling breakExp");
+    EM_DEBUG(EM_codegen, "Compiling breakExp");
 	int earliest_while = am_i_in_loop(this);
-	return indent_math + "BR(loop_end_" + std::to_string(earliest_while) + ")  // Break in LOOP\n";
+	return indent_math + "BR(loop_end_" + HERA_label_scope + std::to_string(earliest_while) + ")  // Break in LOOP\n";
 }
 
 string A_forExp_::HERA_code() {
-    EM_debug("Compiling forExp");
+    EM_DEBUG(EM_codegen, "Compiling forExp");
 	// Strings used for loop management
 	int this_loop_counter = loop_counter;
-	int this_SP_counter = calculate_my_SP(this);
+	int this_SP_counter = frame_slot;  // the variable, and the upper bound above it (see layout_frames.cc)
 
 	my_num = this_loop_counter;
 	loop_counter++;
 
-	string start_label = "loop_start_" + std::to_string(this_loop_counter);
-	string end_label = "loop_end_" + std::to_string(this_loop_counter);
+	string start_label = "loop_start_" + HERA_label_scope + std::to_string(this_loop_counter);
+	string end_label = "loop_end_" + HERA_label_scope + std::to_string(this_loop_counter);
 
 	// SP location strings for loop bounds
 	string _lo_sp_loc = std::to_string(this_SP_counter);
 	string _hi_sp_loc = std::to_string(this_SP_counter+1);
 
-	// Store the _var in Stack with _lo, and store _hi one above that
-	string output = "// Start of For Loop: " + std::to_string(my_num) + ". Current SP at: " + std::to_string(this_SP_counter) + "\n"
-				    + indent_math + "INC(SP, 2)\n"
-				    + _lo->HERA_code() 
-				    + indent_math + "STORE(" + _lo->result_reg_s() + ", " + _lo_sp_loc + ", FP)\n"
-		            + _hi->HERA_code()
-				    + indent_math + "STORE(" + _hi->result_reg_s() + ", " + _hi_sp_loc + ", FP)\n"
-	                + indent_math + "LABEL(" + start_label + ")\n"
+	auto increment_HERA_code = [&]() {
+		return indent_math + "LOAD(R1, " + _lo_sp_loc + ", FP) \t// Incrementing forLoop " + std::to_string(my_num) + " index\n"
+		       + indent_math + "INC(R1, 1)\n"
+		       + indent_math + "STORE(R1, " + _lo_sp_loc + ", FP)\n";
+	};
+
+	auto loop_HERA_code = [&](string start_label, string body_code) {
+		return indent_math + "LABEL(" + start_label + ")\n"
     // Load _var from Stack _lo and _hi
-	                + indent_math + "LOAD(R1, " + _lo_sp_loc + ", FP)\n" 
-					+ indent_math + "LOAD(R2, " + _hi_sp_loc + ", FP)\n"
+	           + indent_math + "LOAD(R1, " + _lo_sp_loc + ", FP)\n" 
+	           + indent_math + "LOAD(R2, " + _hi_sp_loc + ", FP)\n"
     // Compare _lo to _hi, if <= 0 go to end of loop, Otherwise go through loop
-	                + indent_math + "CMP(R2, R1)\n"
-					+ indent_math + "BL(" + end_label + ")\n"
+	           + indent_math + "CMP(R2, R1)\n"
+	           + indent_math + "BL(" + end_label + ")\n"
     // Run _body HERA_code
-	                + _body->HERA_code()
+	           + body_code
     // Increment _hi and store in _var in Stack
-	                + indent_math + "LOAD(R1, " + _lo_sp_loc + ", FP) \t// Incrementing forLoop " + std::to_string(my_num) + " index\n"
-					+ indent_math + "INC(R1, 1)\n"
-					+ indent_math + "STORE(R1, " + _lo_sp_loc + ", FP)\n"
+	           + increment_HERA_code()
     // Branch back to beginning of loop
-                    + indent_math + "BR(" + start_label + ")\n"
-    // End of Loop. Decrement the SP
+	           + indent_math + "BR(" + start_label + ")\n";
+	};
+
+	// The loop, or, if its bounds are constants and its body is small, copies of the body, as many
+	//  as OPT_unroll_factor says to run each time around (see optimize.h). Each copy is generated
+	//  again (with its own labels); body_code is the first. When every copy is there, with no loop
+	//  left, the code falls through to whatever comes after it, rather than branching to end_label.
+	auto unrolled_HERA_code = [&](string start_label, string body_code, bool &falls_through) {
+		int trips = OPT_trip_count(this);
+		int factor = OPT_unroll_factor(this, HERA_instruction_count(body_code));
+		falls_through = factor > 1 && factor == trips;
+		if (factor == 1) {
+			return loop_HERA_code(start_label, body_code);
+		}
+		EM_DEBUG(EM_codegen, "Unrolling forLoop " + std::to_string(my_num) + " " + std::to_string(factor) + " times, of " + std::to_string(trips));
+		bool first = true;
+		auto copy_HERA_code = [&]() {
+			string code = first ? body_code : _body->HERA_code();
+			first = false;
+			return code;
+		};
+		string output = "";
+		if (falls_through) {
+			// the variable starts at _lo, and is set to the next value before each copy after that
+			int lo;
+			HERA_constant_value(_lo, lo);
+			for (int trip = 0; trip < trips; trip++) {
+				if (trip > 0) {
+					output += indent_math + "SET(R1, " + std::to_string(lo + trip) + ")\n"
+					        + indent_math + "STORE(R1, " + _lo_sp_loc + ", FP) \t// forLoop " + std::to_string(my_num) + " index, unrolled\n";
+				}
+				output += copy_HERA_code();
+			}
+			return output;
+		}
+		// the copies left over come first, so the loop then runs a multiple of factor times, and
+		//  only has to check _var <= _hi before the first copy in each group
+		for (int trip = 0; trip < trips % factor; trip++) {
+			output += copy_HERA_code() + increment_HERA_code();
+		}
+		string copies = "";
+		for (int copy = 0; copy < factor; copy++) {
+			copies += (copy > 0 ? increment_HERA_code() : "") + copy_HERA_code();
+		}
+		return output + loop_HERA_code(start_label, copies);
+	};
+
+	const std::vector<AST_node_ *> &arrays = OPT_arrays_checked_by(this);
+	if (!arrays.empty()) {
+		// Check _lo >= 0 and _hi < each array's length now, and if so run a copy of the loop that
+		//  leaves out the bounds checks on array[_var] (see optimize.h); otherwise, the usual loop.
+		//  Breaks go to the same end label from either copy.
+		string checked_label = "loop_checked_" + HERA_label_scope + std::to_string(this_loop_counter);
+		string unchecked_label = "loop_unchecked_" + HERA_label_scope + std::to_string(this_loop_counter);
+		string checks = indent_math + "LOAD(R1, " + _lo_sp_loc + ", FP)\n"
+		              + indent_math + "CMP(R1, R0)\n"
+		              + indent_math + "BL(" + checked_label + ")\n";
+		for (AST_node_ *array : arrays) {
+			checks = checks + array->HERA_code()
+			       + indent_math + "LOAD(R1, 0, R" + std::to_string(min_reg) + ")\n"
+			       + indent_math + "LOAD(R2, " + _hi_sp_loc + ", FP)\n"
+			       + indent_math + "CMP(R2, R1)\n"
+			       + indent_math + "BGE(" + checked_label + ")\n";
+		}
+		unchecked_loops.insert(this);
+		bool falls_through;
+		string unchecked_code = unrolled_HERA_code(unchecked_label, _body->HERA_code(), falls_through);
+		unchecked_loops.erase(this);
+		if (falls_through) {
+			unchecked_code += indent_math + "BR(" + end_label + ")\n";  // past the usual loop
+		}
+		return "// Start of For Loop: " + std::to_string(my_num) + ", with bounds checked up front. Variable at SP: " + std::to_string(this_SP_counter) + "\n"
+		       + _lo->HERA_code()
+		       + indent_math + "STORE(" + _lo->result_reg_s() + ", " + _lo_sp_loc + ", FP)\n"
+		       + _hi->HERA_code()
+		       + indent_math + "STORE(" + _hi->result_reg_s() + ", " + _hi_sp_loc + ", FP)\n"
+		       + preheader_HERA_code(this)
+		       + checks
+		       + unchecked_code
+		       + indent_math + "LABEL(" + checked_label + ")\n"
+		       + loop_HERA_code(start_label, _body->HERA_code())
+		       + indent_math + "LABEL(" + end_label + ")\n"
+		       + "// End of For Loop: " + std::to_string(my_num) + "\n";
+	}
+
+	// Store the _var in Stack with _lo, and store _hi one above that
+	bool falls_through;
+	string output = "// Start of For Loop: " + std::to_string(my_num) + ". Variable at SP: " + std::to_string(this_SP_counter) + "\n"
+				    + _lo->HERA_code() 
+				    + indent_math + "STORE(" + _lo->result_reg_s() + ", " + _lo_sp_loc + ", FP)\n"
+		            + _hi->HERA_code()
+				    + indent_math + "STORE(" + _hi->result_reg_s() + ", " + _hi_sp_loc + ", FP)\n"
+	                + preheader_HERA_code(this)
+	                + unrolled_HERA_code(start_label, _body->HERA_code(), falls_through)
+    // End of Loop
 	                + indent_math + "LABEL(" + end_label + ")\n"
-					+ indent_math + "DEC(SP, 2)\n"
 					+ "// End of For Loop: " + std::to_string(my_num) + "\n";
 	return output;
 }
 
 string A_varExp_::HERA_code() {
-	return _var->HERA_code();
+	string in_frame = frame_value_HERA_code(this);
+	return in_frame != "" ? in_frame : _var->HERA_code();
+}
+
+// The register a parameter at this place in function f's frame stays in, if it came in one
+//  and wasn't stored in the frame; "" if not (see optimize.h)
+static string register_parameter_s(A_fundec_ *f, int SP)
+{
+	int param = SP - 3;
+	if (f == 0 || !OPT_uses_register_arguments(f) || param < 0 || param >= OPT_argument_registers
+	    || param >= (f->cast_params() ? f->cast_params()->length() : 0) || OPT_is_spilled_parameter(f, param)) {
+		return "";
+	}
+	return "R" + std::to_string(OPT_first_argument_register + param);
 }
 
 string A_simpleVar_::HERA_code() {
-    EM_debug("Compiling simpleVar " + Symbol_to_string(_sym));
+    EM_DEBUG(EM_codegen, "Compiling simpleVar " + Symbol_to_string(_sym));
 
     ST<var_info> my_variable_library = local_variable_library;
 	// Two cases: In A_simpleVar_ or A_assignExp_
@@ -382,12 +913,29 @@ string A_simpleVar_::HERA_code() {
 	string output = "";
 	if (is_name_there(_sym, my_variable_library)) {
 		var_info var_struct = lookup(_sym, my_variable_library);
-        string variable_comment = Symbol_to_string(_sym) + "' at SP: " + std::to_string(var_struct.my_SP()) + "\n";
+        string variable_comment = Symbol_to_string(_sym) + "' at SP: " + std::to_string(var_struct.my_SP())
+                                + (frames_out > 0 ? ", " + std::to_string(frames_out) + " frame(s) out" : "") + "\n";
+		// A variable of an enclosing function is in that function's frame (see visitors/static_link_visitor.h)
+		string frame = "FP";
+		string in_register = register_parameter_s(function, var_struct.my_SP());
+		if (frames_out == 0 && in_register != "") {
+			// A parameter that came in a register, and stays there (see optimize.h)
+			if (inAssignExp > 0) {
+				return indent_math + "MOVE(" + in_register + ", R" + std::to_string(inAssignExp) + ")" +
+				       indent_math + "// Reassigning Parameter '" + Symbol_to_string(_sym) + "' in " + in_register + "\n";
+			}
+			return indent_math + "MOVE(R" + std::to_string(min_reg) + ", " + in_register + ")" +
+			       indent_math + "// Accessing Parameter '" + Symbol_to_string(_sym) + "' in " + in_register + "\n";
+		}
+		if (frames_out > 0) {
+			output = function->frame_pointer_HERA_code(frames_out, "R1");
+			frame = "R1";
+		}
 		if (inAssignExp > 0) {
 			// Check if var is writable, otherwise produce error
 			bool writable = var_struct.am_i_writable();
 			if (writable) {
-				output = indent_math + "STORE(R" + std::to_string(inAssignExp) + ", " + std::to_string(var_struct.my_SP()) + ", FP)" +
+				output += indent_math + "STORE(R" + std::to_string(inAssignExp) + ", " + std::to_string(var_struct.my_SP()) + ", " + frame + ")" +
 				         indent_math + "// Reassigning Variable '" + variable_comment;
 			} else {
 				EM_error("ERROR: Tried to write to a variable that is not writable. This happens most often when trying to"
@@ -397,7 +945,7 @@ string A_simpleVar_::HERA_code() {
 			// In A_simpleVar_
 			// Access SP number from declaration
             string min_reg_s = "R" + std::to_string(min_reg);
-			output = indent_math + "LOAD(" + min_reg_s + ", " + std::to_string(var_struct.my_SP()) + ", FP)" + indent_math + "// Accessing Variable '" + variable_comment;
+			output += indent_math + "LOAD(" + min_reg_s + ", " + std::to_string(var_struct.my_SP()) + ", " + frame + ")" + indent_math + "// Accessing Variable '" + variable_comment;
 		}
 		return output;
 	} else {
@@ -406,43 +954,118 @@ string A_simpleVar_::HERA_code() {
 	}
 }
 
+// In v := r.f or v := a[i], getting at r or a[i] could overwrite v's register, so move v out of the way;
+//  R3 is safe from everything but another such assignment in the middle of the subscript.
+static string save_assigned_value(int value_reg, int highest_reg_used, string &value_reg_s) {
+	value_reg_s = "R" + std::to_string(value_reg);
+	if (value_reg > highest_reg_used) {
+		return "";
+	}
+	value_reg_s = "R3";
+	return indent_math + "MOVE(R3, R" + std::to_string(value_reg) + ")\n";
+}
+
+string A_fieldVar_::HERA_code() {
+    EM_DEBUG(EM_codegen, "Compiling fieldVar " + Symbol_to_string(_sym));
+	// The record's address ends up in the same register as the field's value (see A_var_::result_reg)
+	string record_reg_s = result_reg_s();
+	string offset_s = std::to_string(get_offset());
+	string nil_check = indent_math + "CMP(" + record_reg_s + ", R0)\n"
+	                 + indent_math + "BZ(tiger_nil_record)\n";
+	int inAssignExp = stored_parent->am_i_in_assignExp_(this);
+	if (inAssignExp > 0) {
+		string value_reg_s;
+		string save = save_assigned_value(inAssignExp, result_reg(), value_reg_s);
+		return save + _var->HERA_code() + nil_check
+		       + indent_math + "STORE(" + value_reg_s + ", " + offset_s + ", " + record_reg_s + ")" + indent_math + "// Reassigning field " + Symbol_to_string(_sym) + "\n";
+	}
+	return _var->HERA_code() + nil_check
+	       + indent_math + "LOAD(" + record_reg_s + ", " + offset_s + ", " + record_reg_s + ")" + indent_math + "// Accessing field " + Symbol_to_string(_sym) + "\n";
+}
+
+int A_subscriptVar_::constant_index() {
+	// the element is at 1 + the subscript, and a LOAD or STORE offset goes up to 31
+	int index;
+	return HERA_constant_value(_exp, index) && index >= 0 && index <= 30 ? index : -1;
+}
+
+string A_subscriptVar_::HERA_code() {
+    EM_DEBUG(EM_codegen, "Compiling subscriptVar");
+	// The array's address goes in our register, above the subscript's (see A_arrayExp_::HERA_code for the layout)
+	string array_reg_s = result_reg_s();
+	string index_reg_s = _exp->result_reg_s();
+	int inAssignExp = stored_parent->am_i_in_assignExp_(this);
+	string value_reg_s;
+	string output = inAssignExp > 0 ? save_assigned_value(inAssignExp, result_reg(), value_reg_s) : "";
+	output = output + _var->HERA_code()
+	       + (result_reg() != _var->result_reg() ? indent_math + "MOVE(" + array_reg_s + ", " + _var->result_reg_s() + ")\n" : "");
+	int index = constant_index();
+	if (index >= 0) {
+		// A constant subscript needs no register, and goes straight into the LOAD or STORE's offset
+		string offset = std::to_string(1 + index);
+		output = output + indent_math + "LOAD(R1, 0, " + array_reg_s + ")\n"
+		       + indent_math + "SET(R2, " + std::to_string(index) + ")\n"
+		       + indent_math + "CMP(R2, R1)\n"
+		       + indent_math + "BC(tiger_bad_subscript)\n";
+		if (inAssignExp > 0) {
+			return output + indent_math + "STORE(" + value_reg_s + ", " + offset + ", " + array_reg_s + ")" + indent_math + "// Reassigning element\n";
+		}
+		return output + indent_math + "LOAD(" + array_reg_s + ", " + offset + ", " + array_reg_s + ")" + indent_math + "// Accessing element\n";
+	}
+	output += _exp->HERA_code();
+	if (OPT_is_safe_subscript(this)) {
+		output = output + indent_math + "// No bounds check: the subscript is always in range\n";
+	} else if (unchecked_loops.count(OPT_bounds_checked_by(this))) {
+		output = output + indent_math + "// No bounds check: the loop checked before it started\n";
+	} else {
+		// An unsigned comparison catches negative subscripts too
+		output = output + indent_math + "LOAD(R1, 0, " + array_reg_s + ")\n"
+		       + indent_math + "CMP(" + index_reg_s + ", R1)\n"
+		       + indent_math + "BC(tiger_bad_subscript)\n";
+	}
+	output = output + indent_math + "ADD(R1, " + array_reg_s + ", " + index_reg_s + ")\n";
+	if (inAssignExp > 0) {
+		return output + indent_math + "STORE(" + value_reg_s + ", 1, R1)" + indent_math + "// Reassigning element\n";
+	}
+	return output + indent_math + "LOAD(" + array_reg_s + ", 1, R1)" + indent_math + "// Accessing element\n";
+}
+
 string A_letExp_::HERA_code() {
-    EM_debug("Compiling letExp");
+    EM_DEBUG(EM_codegen, "Compiling letExp");
 
-    int current_SP = calculate_my_SP(this);
-    int dec_SP = _decs ? _decs->calculate_my_SP(this) : 0;
-	string dec_SP_s = std::to_string(dec_SP);
-    string current_letExp_counter = get_my_let_number_s();
+    // The variables' space is already in the function's frame (see layout_frames.cc)
+    string current_letExp_counter = std::to_string(let_code_counter++);
 
-	string output = "// Start of Let Expression " + current_letExp_counter + ". Stack starting at SP: " + std::to_string(current_SP) +  "\n"
-                  + indent_math + "// Initializing " + dec_SP_s + " variable(s).\n"
-                  // Increment the SP counter
-                  + (dec_SP > 0 ? indent_math + "INC(SP, " + dec_SP_s + ")\n" : "")
+	string output = "// Start of Let Expression " + current_letExp_counter + "\n"
                   // Define the declared variables
                   + (_decs != 0 ? _decs->HERA_code() : "")
-                  + indent_math + "// Finished declaring variables in Let Expression " + current_letExp_counter + ". Stack now at SP: " + std::to_string(dec_SP + current_SP) + "\n"
+                  + indent_math + "// Finished declaring variables in Let Expression " + current_letExp_counter + "\n"
                   // Do the Body of the Let
                   + _body->HERA_code() 
                   // Move result to final reg if necessary
                   + (this->result_reg() != _body->result_reg() ? indent_math + "MOVE(" + this->result_reg_s() + ", " + _body->result_reg_s() + ")\n" : "")
-                  // Decrement the SP counter
-                  + (dec_SP > 0 ? indent_math + "DEC(SP, " + dec_SP_s + ")\n" : "")
                   + "// END of Let Expression " + current_letExp_counter + ".\n";
 	return output;
 }
 
 string A_decList_::HERA_code() {
-    EM_debug("Compiling decList");
-    string head_hera_code = _head->HERA_code();
-    string tail_hera_code = _tail == 0 ? "" : _tail->HERA_code();
-    return head_hera_code + tail_hera_code;
+    EM_DEBUG(EM_codegen, "Compiling decList");
+    string code;
+    for (A_dec dec : *this) {
+        code += dec->HERA_code();
+    }
+    return code;
 }
 
 string A_varDec_::HERA_code() {
-    EM_debug("Compiling varDec: " + Symbol_to_string(_var));
+    EM_DEBUG(EM_codegen, "Compiling varDec: " + Symbol_to_string(_var));
 
-    string my_sp_number = std::to_string(calculate_my_SP(this));
+    string my_sp_number = std::to_string(frame_slot);
     string variable_comment = Symbol_to_string(_var) + " at SP: " + my_sp_number + "\n";
+    if (OPT_is_dead_store(this)) {  // never read (see optimize.h)
+        return (OPT_is_dead(_init) ? "" : _init->HERA_code())
+               + indent_math + "// Not storing unused variable " + variable_comment;
+    }
 
 	// Add variable to stack
 	string output = _init->HERA_code()
@@ -450,15 +1073,23 @@ string A_varDec_::HERA_code() {
 	return output;
 }
 
+string A_typeDec_::HERA_code() {
+    EM_DEBUG(EM_codegen, "Compiling typeDec");
+	return "";  // types are only for the typechecker
+}
+
 string A_assignExp_::HERA_code() {
-    EM_debug("Compiling assignExp");
+    EM_DEBUG(EM_codegen, "Compiling assignExp");
 	// Run code for _exp
 	// Have _var store that in the ST
+	if (OPT_is_dead_store(this)) {  // the variable is never read (see optimize.h)
+		return OPT_is_dead(_exp) ? "" : _exp->HERA_code();
+	}
 	return _exp->HERA_code() + _var->HERA_code(); 
 }
 
 string A_functionDec_::HERA_code() {
-    EM_debug("Compiling functionDec");
+    EM_DEBUG(EM_codegen, "Compiling functionDec");
 	string output = ""; 
 	output = "// Start of Function Declarations\n" + 
              theFunctions->HERA_code() + 
@@ -469,12 +1100,13 @@ string A_functionDec_::HERA_code() {
 }
 
 string A_fundecList_::HERA_code() {
-    EM_debug("Compiling fundecList");
-	if (_tail == 0) {
-		return _head->HERA_code();
-	} else {
-		return _head->HERA_code() + _tail->HERA_code();
+    EM_DEBUG(EM_codegen, "Compiling fundecList");
+	string code;
+	for (A_fundec fundec : *this) {
+		if (OPT_is_dead(fundec)) continue;  // never called (see optimize.h)
+		code += fundec->HERA_code();
 	}
+	return code;
 }
 
 string A_fundec_::store_HERA_code(int reg_count_to_replace, int offset) {
@@ -502,7 +1134,67 @@ string A_fundec_::load_HERA_code(int reg_count_to_load, int offset) {
     return output;
 }
 
+int A_fundec_::static_link_slot() {
+	return 3 + (_params ? _params->length() : 0);
+}
+
+string A_fundec_::frame_pointer_HERA_code(int frames_out, string reg) {
+	// Start from the farthest frame we keep a pointer to (the static link is 1 out, the display has
+	//  2, 3, ...), then follow the static links of the frames in between the rest of the way
+	int from = std::min(frames_out, display_size + 1);
+	string output = indent_math + "LOAD(" + reg + ", " + std::to_string(static_link_slot() + from - 1) + ", FP)"
+	              + indent_math + "// Frame " + std::to_string(from) + " out\n";
+	A_fundec_ *f = this;
+	for (int out = 0; out < from; out++) {
+		f = f->enclosing_function;
+	}
+	for (int out = from; out < frames_out; out++) {
+		output += indent_math + "LOAD(" + reg + ", " + std::to_string(f->static_link_slot()) + ", " + reg + ")"
+		        + indent_math + "// Frame " + std::to_string(out + 1) + " out\n";
+		f = f->enclosing_function;
+	}
+	return output;
+}
+
 string A_fundec_::HERA_code() {
+    // Number the labels (and let expressions) from 0 in each function, with its name in the labels
+    //  (see HERA_label_scope), so its code is the same whatever comes before it
+    string outer_scope = HERA_label_scope;
+    int outer_if = if_counter, outer_comp = comp_counter, outer_loop = loop_counter, outer_let = let_code_counter;
+    HERA_label_scope = get_my_unique_function_name() + "_";
+    if_counter = comp_counter = loop_counter = let_code_counter = 0;
+    string code = cached_HERA_code();
+    HERA_label_scope = outer_scope;
+    if_counter = outer_if;
+    comp_counter = outer_comp;
+    loop_counter = outer_loop;
+    let_code_counter = outer_let;
+    return code;
+}
+
+string A_fundec_::cached_HERA_code() {
+    if (not HERA_cache_enabled() or EM_recorded_any_errors()) {
+        return compile_HERA_code();
+    }
+    FingerprintVisitor fingerprint_visitor;
+    StringContext fingerprint_ctx;
+    string key = HERA_cache_key(fingerprint_visitor.accept(this, fingerprint_ctx) + (OPT_enabled() ? " optimized" : ""));
+
+    HERA_cache_entry entry;
+    if (HERA_cache_lookup(key, entry)) {
+        EM_DEBUG(EM_codegen, "Reusing cached HERA code for " + get_my_unique_function_name());
+        func_HERA_code += entry.nested_code;
+        return entry.code;
+    }
+
+    size_t nested_start = func_HERA_code.length();
+    entry.code = compile_HERA_code();
+    entry.nested_code = func_HERA_code.substr(nested_start);
+    HERA_cache_store(key, entry);
+    return entry.code;
+}
+
+string A_fundec_::compile_HERA_code() {
 	/* To define a function to be called with these conventions, we use these steps, as needed:
 		• Increment SP to make space for local storage
             - local storage: how many registers the body of the function will use ??
@@ -518,29 +1210,69 @@ string A_fundec_::HERA_code() {
 		• RETURN from the function
 	*/
     //
-    EM_debug("Compiling fundec");
+    EM_DEBUG(EM_codegen, "Compiling fundec");
 
     string unique_func_name = get_my_unique_function_name();
-    string load_reg_str = load_HERA_code(_body->result_reg(), 3 + (_params ? _params->length() : 0));
-    string store_reg_str = store_HERA_code(_body->result_reg(), 3 + (_params ? _params->length() : 0));
+    string load_reg_str = load_HERA_code(_body->result_reg(), frame_header_size());
+    string store_reg_str = store_HERA_code(_body->result_reg(), frame_header_size());
     // Add params to ST and make available in body, make copy of vars
-    string regs_to_save = std::to_string(_body->result_reg() - 2);
+    // The caller made room for the header up to the static link; the rest of the frame (display,
+    //  saved registers and every local variable) is claimed here, once (see layout_frames.cc)
+    int frame_to_claim = frame_size - static_link_slot() - (static_link ? 1 : 0);
+
+    // Under -O, some functions take their first few arguments in registers, and store the ones
+    //  a nested function or a call might need in the frame (see optimize.h)
+    bool in_registers = OPT_uses_register_arguments(this);
+    string spill_str = "";
+    for (int param = 0; in_registers && param < OPT_argument_registers && param < (_params ? _params->length() : 0); param++) {
+        if (OPT_is_spilled_parameter(this, param)) {
+            spill_str += indent_math + "STORE(R" + std::to_string(OPT_first_argument_register + param) + ", "
+                       + std::to_string(3 + param) + ", FP)\n";
+        }
+    }
+    string result_str = in_registers
+        ? indent_math + "MOVE(R1, " + _body->result_reg_s() + ") \t// Result goes back in R1\n"
+        : indent_math + "STORE(" + _body->result_reg_s() + ", 3, FP) \t// Put result value over 1st parameter\n";
+
+    // Follow the static links once, for the frames we use often enough to keep in the display
+    string display_str = "";
+    if (display_size > 0) {
+        display_str = indent_math + "// Filling in the display\n"
+                    + indent_math + "LOAD(R1, " + std::to_string(static_link_slot()) + ", FP)\n";
+        A_fundec_ *f = enclosing_function;
+        for (int out = 2; out <= display_size + 1; out++) {
+            display_str += indent_math + "LOAD(R1, " + std::to_string(f->static_link_slot()) + ", R1)\n"
+                         + indent_math + "STORE(R1, " + std::to_string(static_link_slot() + out - 1) + ", FP)\n";
+            f = f->enclosing_function;
+        }
+    }
+    // The body's calls need to know whose frame they're in; nested functions are compiled from inside it
+    A_fundec_ *outer_function = current_function;
+    int outer_frame_size = current_frame_size;
+    current_function = this;
+    current_frame_size = frame_size;
+    string body_str = _body->HERA_code();
+    current_function = outer_function;
+    current_frame_size = outer_frame_size;
+
     string output;
     output  = "LABEL(" + unique_func_name + ")\n"
             + indent_math + "// Saving PC_ret, FP_alt\n"
-            + indent_math + "INC(SP, " + regs_to_save + ")\n"
+            + SP_HERA_code("INC", frame_to_claim)
             + indent_math + "STORE(PC_ret, 0, FP) // Return Address\n"
             + indent_math + "STORE(FP_alt, 1, FP) // Control Link\n"
             + indent_math + "// Saving registers\n"
             + store_reg_str
+            + spill_str
+            + display_str
             + indent_math + "// Body of Function\n"
-            + _body->HERA_code()
-            + indent_math + "STORE(" + _body->result_reg_s() + ", 3, FP) \t// Put result value over 1st parameter\n"
+            + body_str
+            + result_str
             + indent_math + "// Restore registers\n"
             + load_reg_str
             + indent_math + "LOAD(PC_ret, 0, FP)\n"
             + indent_math + "LOAD(FP_alt, 1, FP)\n"
-            + indent_math + "DEC(SP, " + regs_to_save + ")\n"
+            + SP_HERA_code("DEC", frame_to_claim)
             + indent_math + "RETURN(FP_alt, PC_ret)\n\n";
     return output;
 }
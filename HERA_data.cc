@@ -6,6 +6,10 @@
 
 const string indent_math = "    ";  // might want to use something different for, e.g., branches
 int string_counter = 0;
+string HERA_label_scope = "";
+static bool uses_records = false;  // then the code needs the heap pointers below
+bool HERA_uses_arrays = false;     // and the messages for a failed bounds check
+bool HERA_uses_fields = false;     // and for a field of nil
 
 string AST_node_::HERA_data()  // Default used during development; could be removed in final version 
 {
@@ -13,13 +17,27 @@ string AST_node_::HERA_data()  // Default used during development; could be remo
 }
 
 string A_root_::HERA_data() {
-	return  main_expr->HERA_data(); 
+	string output = main_expr->HERA_data();
+	if (uses_records) {
+		// Where the next record goes, and the end of the memory we've got from malloc for them
+		//  (see A_recordExp_::HERA_code)
+		output = output + "DLABEL(tiger_heap_next)\n" + indent_math + "INTEGER(0)\n"
+		                + "DLABEL(tiger_heap_limit)\n" + indent_math + "INTEGER(0)\n";
+	}
+	if (HERA_uses_arrays) {
+		output = output + "DLABEL(tiger_bad_subscript_message)\n" + indent_math + "LP_STRING(\"array subscript out of bounds\\n\")\n"
+		                + "DLABEL(tiger_bad_array_size_message)\n" + indent_math + "LP_STRING(\"negative array size\\n\")\n";
+	}
+	if (HERA_uses_fields) {
+		output = output + "DLABEL(tiger_nil_record_message)\n" + indent_math + "LP_STRING(\"field of nil record\\n\")\n";
+	}
+	return output;
 }
 
 string A_stringExp_::HERA_data() {
 	count = string_counter; 
 	string_counter++;
-	string this_str_label = "string_" + std::to_string(count);
+	string this_str_label = "string_" + HERA_label_scope + std::to_string(count);
 	string output = "DLABEL(" + this_str_label + ")\n" + 
 					indent_math + "LP_STRING(" + value + ")\n";
 	return output; 
@@ -30,11 +48,11 @@ string A_opExp_::HERA_data() {
 }
 
 string A_expList_::HERA_data() {
-	if (_tail == 0) {
-		return _head->HERA_data();
-	} else {
-		return _head->HERA_data() + _tail->HERA_data();
-	}	
+	string output = "";
+	for (A_exp e : *this) {
+		output = output + e->HERA_data();
+	}
+	return output;
 }
 
 string A_callExp_::HERA_data() {
@@ -73,6 +91,31 @@ string A_forExp_::HERA_data() {
 	return _lo->HERA_data() + _hi->HERA_data() + _body->HERA_data();	
 }
 
+string A_recordExp_::HERA_data() {
+	uses_records = true;
+	string output = "";
+	int count = _fields ? _fields->length() : 0;
+	for (int i = 0; i < count; i++) {
+		output = output + _fields->element(i)->get_exp()->HERA_data();
+	}
+	return output;
+}
+
+string A_fieldVar_::HERA_data() {
+	HERA_uses_fields = true;
+	return _var->HERA_data();
+}
+
+string A_arrayExp_::HERA_data() {
+	HERA_uses_arrays = true;
+	return _size->HERA_data() + _init->HERA_data();
+}
+
+string A_subscriptVar_::HERA_data() {
+	HERA_uses_arrays = true;
+	return _var->HERA_data() + _exp->HERA_data();
+}
+
 string A_varExp_::HERA_data() {
 	return _var->HERA_data();
 }
@@ -93,11 +136,11 @@ string A_letExp_::HERA_data() {
 }
 
 string A_decList_::HERA_data() {
-	if (_tail == 0) {
-		return _head->HERA_data();
-	} else {
-		return _head->HERA_data() + _tail->HERA_data();
+	string output = "";
+	for (A_dec dec : *this) {
+		output = output + dec->HERA_data();
 	}
+	return output;
 }
 
 
@@ -114,14 +157,22 @@ string A_functionDec_::HERA_data() {
 }
 
 string A_fundecList_::HERA_data() {
-	if (_tail == 0) {
-		return _head->HERA_data();
-	} else {
-		return _head->HERA_data() + _tail->HERA_data();
+	string output = "";
+	for (A_fundec fundec : *this) {
+		output = output + fundec->HERA_data();
 	}
+	return output;
 }
 
 string A_fundec_::HERA_data() {
-	return _body->HERA_data();
+	// as for the labels in its code (see A_fundec_::HERA_code)
+	string outer_scope = HERA_label_scope;
+	int outer_string_counter = string_counter;
+	HERA_label_scope = get_my_unique_function_name() + "_";
+	string_counter = 0;
+	string output = _body->HERA_data();
+	HERA_label_scope = outer_scope;
+	string_counter = outer_string_counter;
+	return output;
 }
 
@@ -0,0 +1,212 @@
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "AST.h"
+#include "HERA_select.h"
+
+// See HERA_select.h for the rules and their costs.
+
+static std::map<AST_node_ *, HERA_selection> selections;
+
+static bool is_arithmetic(AST_node_ *exp)
+{
+	if (exp->kind() == AST_kind_callExp) {
+		return HERA_is_division(static_cast<A_callExp_ *>(exp));
+	}
+	if (exp->kind() != AST_kind_opExp) {
+		return false;
+	}
+	A_oper op = static_cast<A_opExp_ *>(exp)->get_oper();
+	return op == A_plusOp || op == A_minusOp || op == A_timesOp;
+}
+
+static const HERA_selection &select(AST_node_ *exp)  // for an is_arithmetic exp
+{
+	return exp->kind() == AST_kind_callExp ? HERA_select(static_cast<A_callExp_ *>(exp)) : HERA_select(static_cast<A_opExp_ *>(exp));
+}
+
+bool HERA_is_division(A_callExp_ *call)
+{
+	// the function library is set up before anything asks for a result_reg (see tiger.cc)
+	ST<function_info> functions = call->get_local_function_library();
+	A_expList args = static_cast<A_expList>(call->get_args());
+	return args != 0 && args->length() == 2 && Symbols_are_equal(call->get_func(), to_Symbol("div")) && is_name_there(call->get_func(), functions)
+	       && lookup(call->get_func(), functions).tiger_function;
+}
+
+bool HERA_constant_value(AST_node_ *exp, int &value)
+{
+	if (exp->kind() == AST_kind_seqExp) {  // just parentheses, if there's one expression in it
+		A_expList seq = static_cast<A_expList>(static_cast<A_seqExp_ *>(exp)->get_seq());
+		return seq != 0 && seq->length() == 1 && HERA_constant_value(*seq->begin(), value);
+	}
+	if (exp->kind() == AST_kind_intExp) {
+		value = int16_t(static_cast<A_intExp_ *>(exp)->get_value());
+		return true;
+	}
+	if (is_arithmetic(exp)) {
+		const HERA_selection &selection = select(exp);
+		value = selection.value;
+		return selection.rule == HERA_rule_constant;
+	}
+	return false;
+}
+
+// The cost of getting an operand into a register; other kinds of expression cost the same
+//  whichever rule we pick, so they just count as one
+static int register_cost(AST_node_ *exp)
+{
+	if (!is_arithmetic(exp) || (exp->kind() == AST_kind_callExp && select(exp).rule == HERA_rule_registers)) {
+		return 1;
+	}
+	return select(exp).cost;
+}
+
+// Is this the variable of a for loop (in this function) that starts at a constant >= 0?
+//  It can't be assigned to, so it stays between that and the loop's upper bound.
+// This only looks at the tree, since result_reg (and so HERA_select) may be asked for before the
+//  variable libraries are set up: the loop is the nearest for around the use with that variable,
+//  as long as no let or function in between declares something with the same name.
+static bool is_nonnegative(AST_node_ *exp)
+{
+	if (exp->kind() != AST_kind_varExp || static_cast<A_varExp_ *>(exp)->get_var()->kind() != AST_kind_simpleVar) {
+		return false;
+	}
+	Symbol name = static_cast<A_simpleVar_ *>(static_cast<A_varExp_ *>(exp)->get_var())->get_sym();
+	for (AST_node_ *up = exp->parent(); up->kind() != AST_kind_root && up->kind() != AST_kind_fundec; up = up->parent()) {
+		if (up->kind() == AST_kind_letExp && static_cast<A_letExp_ *>(up)->get_decs() != 0) {
+			for (A_dec dec : *static_cast<A_decList_ *>(static_cast<A_letExp_ *>(up)->get_decs())) {
+				if (dec->kind() == AST_kind_varDec && Symbols_are_equal(static_cast<A_varDec_ *>(dec)->get_var(), name)) {
+					return false;
+				}
+			}
+		} else if (up->kind() == AST_kind_forExp && Symbols_are_equal(static_cast<A_forExp_ *>(up)->get_var(), name)) {
+			int lo;
+			return HERA_constant_value(static_cast<A_forExp_ *>(up)->get_lo(), lo) && lo >= 0;
+		}
+	}
+	return false;
+}
+
+static int power_of_two(int value)  // k if value is 2^k (for k >= 1), or 0
+{
+	for (int k = 1; k < 15; k++) {
+		if (value == (1 << k)) {
+			return k;
+		}
+	}
+	return 0;
+}
+
+static int16_t fold(A_oper op, int16_t left, int16_t right)
+{
+	switch (op) {
+	case A_plusOp:   return int16_t(left + right);
+	case A_minusOp:  return int16_t(left - right);
+	case A_timesOp:  return int16_t(left * right);
+	default:         return int16_t(int(left) / int(right));  // as the library's div does
+	}
+}
+
+static void consider(HERA_selection &best, HERA_rule rule, int cost, int value, AST_node_ *operand, bool constant_first = false)
+{
+	if (cost < best.cost) {
+		best.rule = rule;
+		best.cost = cost;
+		best.value = value;
+		best.operand = operand;
+		best.constant_first = constant_first;
+	}
+}
+
+// The rules for reg op con (or con op reg, if constant_first)
+static void consider_constant_operand(HERA_selection &best, A_oper op, AST_node_ *reg, int con, bool constant_first)
+{
+	int cost = register_cost(reg);
+	bool commutes = op == A_plusOp || op == A_timesOp;
+	if (constant_first && !commutes) {
+		if (op == A_minusOp && con == 0) {
+			consider(best, HERA_rule_negate, cost + 1, 0, reg);
+		}
+		if (op == A_divideOp) {
+			return;  // HERA has no DIV, so con / reg is still a call of div
+		}
+		consider(best, HERA_rule_constant_operand, cost + 2, con, reg, true);
+		return;
+	}
+	if (op == A_plusOp || op == A_minusOp) {
+		int added = op == A_plusOp ? con : -con;
+		if (added == 0) {
+			consider(best, HERA_rule_same, cost, 0, reg);
+		} else if (added >= 1 && added <= 64) {
+			consider(best, HERA_rule_increment, cost + 1, added, reg);
+		} else if (added >= -64 && added <= -1) {
+			consider(best, HERA_rule_decrement, cost + 1, -added, reg);
+		}
+	} else if (op == A_timesOp) {
+		if (con == 1) {
+			consider(best, HERA_rule_same, cost, 0, reg);
+		} else if (con == -1) {
+			consider(best, HERA_rule_negate, cost + 1, 0, reg);
+		} else if (power_of_two(con)) {
+			consider(best, HERA_rule_shift_left, cost + power_of_two(con), power_of_two(con), reg);
+		}
+	} else {
+		if (con == 1) {
+			consider(best, HERA_rule_same, cost, 0, reg);
+		} else if (power_of_two(con) && is_nonnegative(reg)) {
+			consider(best, HERA_rule_shift_right, cost + power_of_two(con), power_of_two(con), reg);
+		}
+		return;  // anything else is still a call of div
+	}
+	consider(best, HERA_rule_constant_operand, cost + 2, con, reg);
+}
+
+static const HERA_selection &label(AST_node_ *node, A_oper op, AST_node_ *left, AST_node_ *right)
+{
+	int left_value, right_value;
+	bool left_constant = HERA_constant_value(left, left_value);
+	bool right_constant = HERA_constant_value(right, right_value);
+
+	HERA_selection best;
+	best.cost = 1 << 30;
+	if (left_constant && right_constant && !(op == A_divideOp && right_value == 0)) {
+		consider(best, HERA_rule_constant, 1, fold(op, left_value, right_value), 0);
+	}
+	// the rules with a constant operand come first, so they win a tie: they use fewer registers
+	if (right_constant) {
+		consider_constant_operand(best, op, left, right_value, false);
+	}
+	if (left_constant) {
+		consider_constant_operand(best, op, right, left_value, true);
+	}
+	if (op == A_divideOp) {
+		// the call itself costs more than any of the rules, so it only needs to lose to them
+		consider(best, HERA_rule_registers, 1 << 20, 0, 0);
+	} else {
+		int left_reg = static_cast<A_exp_ *>(left)->result_reg(), right_reg = static_cast<A_exp_ *>(right)->result_reg();
+		consider(best, HERA_rule_registers, register_cost(left) + register_cost(right) + 1 + (left_reg == right_reg ? 1 : 0), 0, 0);
+	}
+
+	EM_DEBUG(EM_codegen, "Selected rule " + std::to_string(best.rule) + " at cost " + std::to_string(best.cost), node->pos());
+	return selections[node] = best;
+}
+
+const HERA_selection &HERA_select(A_opExp_ *node)
+{
+	auto found = selections.find(node);
+	return found != selections.end() ? found->second : label(node, node->get_oper(), node->get_left(), node->get_right());
+}
+
+const HERA_selection &HERA_select(A_callExp_ *node)
+{
+	auto found = selections.find(node);
+	if (found != selections.end()) {
+		return found->second;
+	}
+	std::vector<AST_node_ *> args;
+	for (A_exp arg : *static_cast<A_expList>(node->get_args())) {
+		args.push_back(arg);
+	}
+	return label(node, A_divideOp, args[0], args[1]);
+}
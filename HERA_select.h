@@ -0,0 +1,53 @@
+#if ! defined _HERA_SELECT_H
+#define _HERA_SELECT_H 1
+
+#include "util.h"
+
+class AST_node_;
+class A_opExp_;
+class A_callExp_;
+
+// Instruction selection for arithmetic (+, -, *, /), in the style of BURG: each rule covers an
+//  A_opExp_ (and maybe a constant operand) with a few HERA instructions, at a cost, and
+//  HERA_select labels each node with the cheapest rule, counting the cost of its operands.
+//  init_result_reg and HERA_code both follow the label. The parser turns / into a call of the
+//  library's div, so that's the A_callExp_ the rules cover, and "registers" there means the call.
+//
+//   rule                  covers                          code                     cost
+//   constant              con op con                      SET(Rd, value)           1
+//   registers             reg op reg                      ADD/SUB/MUL, or CALL     1 (+1 for a MOVE)
+//   same                  reg + 0, reg - 0, reg * 1, ...  nothing                  0
+//   increment, decrement  reg +- con, with con in 1..64   INC/DEC(Rd, con)         1
+//   negate                0 - reg, reg * -1               SUB(Rd, R0, Rd)          1
+//   shift_left            reg * 2^k                       k LSLs                   k
+//   shift_right           nonneg / 2^k                    k LSRs                   k
+//   constant_operand      reg op con, con op reg (not /)  SET(R1, con) and the op  2
+//
+// The costs are instructions, which is also cycles in HERA_sim's model. The rules with a constant
+//  operand never put it in one of the registers S-U numbering hands out, so they leave the result
+//  in the other operand's register. A "nonneg" is the variable of a for loop that starts at a
+//  constant >= 0 (where LSR and DIV agree); a constant is folded with HERA's 16-bit arithmetic,
+//  except for division by zero, which is left to fail when it runs.
+
+enum HERA_rule {
+	HERA_rule_constant, HERA_rule_registers, HERA_rule_same, HERA_rule_increment, HERA_rule_decrement,
+	HERA_rule_negate, HERA_rule_shift_left, HERA_rule_shift_right, HERA_rule_constant_operand
+};
+
+struct HERA_selection {
+	HERA_rule rule = HERA_rule_registers;
+	int cost = 0;               // of the whole subtree, in instructions
+	int value = 0;              // the folded constant, or the constant operand, or the shift count
+	AST_node_ *operand = 0;     // the operand in a register, for the rules with just one
+	bool constant_first = false;  // con op reg, for constant_operand (matters for - and /)
+};
+
+// The cheapest rule for an arithmetic A_opExp_, or a call of div (worked out once, and kept)
+const HERA_selection &HERA_select(A_opExp_ *node);
+const HERA_selection &HERA_select(A_callExp_ *node);
+// Is this a call of the library's div (rather than a function of the program's own called div)?
+bool HERA_is_division(A_callExp_ *call);
+// Is this expression a constant, after folding? If so, what
+bool HERA_constant_value(AST_node_ *exp, int &value);
+
+#endif
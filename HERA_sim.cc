@@ -0,0 +1,624 @@
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <vector>
+#include "errormsg.h"
+#include "HERA_sim.h"
+
+// See HERA_sim.h for what this does (and doesn't) simulate.
+
+enum HERA_sim_op {
+	op_SET, op_SETLO, op_SETHI, op_MOVE,
+	op_ADD, op_SUB, op_MUL, op_DIV, op_AND, op_OR, op_XOR,
+	op_INC, op_DEC, op_NEG, op_NOT, op_LSL, op_LSR, op_ASL, op_ASR,
+	op_LOAD, op_STORE, op_CMP,
+	op_CON, op_COFF, op_CBON, op_CCBOFF,
+	op_BR, op_BZ, op_BNZ, op_BL, op_BGE, op_BLE, op_BG, op_BULE, op_BUG,
+	op_BS, op_BNS, op_BC, op_BNC, op_BV, op_BNV,
+	op_CALL, op_RETURN, op_HALT, op_NOP
+};
+
+// Operand patterns: r = register, n = number, v = number or label, l = label (or register, for CALL)
+struct HERA_sim_op_info {
+	HERA_sim_op op;
+	string operands;
+};
+
+static const std::map<string, HERA_sim_op_info> HERA_sim_ops = {
+	{"SET", {op_SET, "rv"}}, {"SETLO", {op_SETLO, "rn"}}, {"SETHI", {op_SETHI, "rn"}}, {"MOVE", {op_MOVE, "rr"}},
+	{"ADD", {op_ADD, "rrr"}}, {"SUB", {op_SUB, "rrr"}}, {"MUL", {op_MUL, "rrr"}}, {"DIV", {op_DIV, "rrr"}},
+	{"AND", {op_AND, "rrr"}}, {"OR", {op_OR, "rrr"}}, {"XOR", {op_XOR, "rrr"}},
+	{"INC", {op_INC, "rn"}}, {"DEC", {op_DEC, "rn"}}, {"NEG", {op_NEG, "rr"}}, {"NOT", {op_NOT, "rr"}},
+	{"LSL", {op_LSL, "rr"}}, {"LSR", {op_LSR, "rr"}}, {"ASL", {op_ASL, "rr"}}, {"ASR", {op_ASR, "rr"}},
+	{"LOAD", {op_LOAD, "rnr"}}, {"STORE", {op_STORE, "rnr"}}, {"CMP", {op_CMP, "rr"}},
+	{"CON", {op_CON, ""}}, {"COFF", {op_COFF, ""}}, {"CBON", {op_CBON, ""}}, {"CCBOFF", {op_CCBOFF, ""}},
+	{"BR", {op_BR, "l"}}, {"BZ", {op_BZ, "l"}}, {"BNZ", {op_BNZ, "l"}}, {"BL", {op_BL, "l"}},
+	{"BGE", {op_BGE, "l"}}, {"BLE", {op_BLE, "l"}}, {"BG", {op_BG, "l"}}, {"BULE", {op_BULE, "l"}},
+	{"BUG", {op_BUG, "l"}}, {"BS", {op_BS, "l"}}, {"BNS", {op_BNS, "l"}}, {"BC", {op_BC, "l"}},
+	{"BNC", {op_BNC, "l"}}, {"BV", {op_BV, "l"}}, {"BNV", {op_BNV, "l"}},
+	{"CALL", {op_CALL, "rl"}}, {"RETURN", {op_RETURN, "rr"}}, {"HALT", {op_HALT, ""}}, {"NOP", {op_NOP, ""}},
+};
+
+static const std::map<string, int> HERA_sim_registers = {
+	{"Rt", 11}, {"FP_alt", 12}, {"PC_ret", 13}, {"FP", 14}, {"SP", 15},
+};
+const int Rt = 11, FP_alt = 12, PC_ret = 13, FP = 14, SP = 15;
+
+// The Tiger-stdlib routines we carry out in C++
+static const std::vector<string> HERA_sim_library = {
+	"print", "println", "printint", "printbool", "ord", "chr", "size", "substring", "concat", "tstrcmp",
+	"div", "mod", "getchar_ord", "putchar_ord", "flush", "getchar", "ungetchar", "getline", "getint",
+	"exit", "malloc", "free", "not",
+};
+
+struct HERA_sim_instruction {
+	HERA_sim_op op;
+	int a = 0, b = 0, c = 0;  // registers or numbers, in the order written
+	string label;             // for branches, CALL, and SET of a label; resolved into b (or a, for branches)
+	bool label_is_register = false;  // CALL(FP_alt, R13) rather than CALL(FP_alt, label)
+	int library = -1;         // for a CALL to a library routine, its index in HERA_sim_library
+	int line;                 // in the HERA code, for error messages
+	int size = 1;             // in words, once HERA-C has expanded it (see HERA_sim.h)
+};
+
+class HERA_simulator {
+public:
+	HERA_simulator(std::ostream &out, HERA_sim_stats &stats) : out(out), stats(stats), memory(0x10000, 0) {}
+	bool load(const string &code);
+	bool run(long max_instructions);
+	int program_size() { return program.size(); }
+
+private:
+	std::ostream &out;
+	HERA_sim_stats &stats;
+	std::vector<HERA_sim_instruction> program;
+	std::map<string, int> code_labels;  // instruction numbers
+	std::vector<int> addresses;         // of each instruction, and then of the end of the program
+	std::map<int, int> instruction_at;  // instruction numbers by address
+	std::map<string, int> data_labels;  // addresses
+	std::vector<uint16_t> memory;
+	uint16_t reg[16] = {0};
+	bool s = false, z = false, v = false, c = false, cb = false;  // flags, and carry-block
+	int data_end = HERA_sim_data_start;
+	int heap_end = HERA_sim_heap_start;
+	int last_char = -1;         // for ungetchar
+	int pushed_back_char = -2;  // -2 for none
+	std::map<int, string> function_names;  // code labels by instruction number, for CALL(FP_alt, R13)
+
+	// The instruction at a code address that came from a register (BR(R1), CALL(FP_alt, R13), RETURN), or -1
+	int instruction_number(uint16_t address) {
+		auto found = instruction_at.find(address);
+		return found == instruction_at.end() ? -1 : found->second;
+	}
+
+	bool fail(string message, int line = 0) {
+		EM_error("HERA simulator: " + (line > 0 ? "line " + std::to_string(line) + " of the HERA code: " : string("")) + message);
+		return false;
+	}
+	bool parse_line(const string &line, int line_number);
+	bool parse_operand(const string &text, char kind, HERA_sim_instruction &inst, int position, int line_number);
+	bool resolve_labels();
+
+	void set_reg(int r, int value) { if (r != 0) reg[r] = uint16_t(value); }
+	void set_sz(uint16_t result) { s = (result & 0x8000) != 0; z = result == 0; }
+	uint16_t add(uint16_t x, uint16_t y, int carry_in);
+	uint16_t load_word(int address) { stats.loads++; return memory[address & 0xffff]; }
+	void store_word(int address, int value) { stats.stores++; memory[address & 0xffff] = uint16_t(value); }
+
+	bool library_call(int routine, bool &halt, int line);
+	string get_string(int address);
+	int new_string(const string &s);
+	int read_char(std::istream &in);
+};
+
+static string trim(const string &s)
+{
+	size_t first = s.find_first_not_of(" \t\r");
+	if (first == string::npos) return "";
+	size_t last = s.find_last_not_of(" \t\r");
+	return s.substr(first, last - first + 1);
+}
+
+// Split "a, b, c" at the commas outside string literals
+static std::vector<string> split_operands(const string &text)
+{
+	std::vector<string> operands;
+	string current;
+	bool in_string = false;
+	for (size_t i = 0; i < text.length(); i++) {
+		char ch = text[i];
+		if (in_string && ch == '\\' && i + 1 < text.length()) {
+			current += ch;
+			current += text[++i];
+			continue;
+		}
+		if (ch == '"') in_string = !in_string;
+		if (ch == ',' && !in_string) {
+			operands.push_back(trim(current));
+			current = "";
+		} else {
+			current += ch;
+		}
+	}
+	if (trim(current) != "" || !operands.empty()) operands.push_back(trim(current));
+	return operands;
+}
+
+// The contents of a string literal, with \n, \t, \", \\ and octal \ddd escapes replaced
+static bool unquote(const string &literal, string &result)
+{
+	if (literal.length() < 2 || literal[0] != '"' || literal[literal.length()-1] != '"') return false;
+	result = "";
+	for (size_t i = 1; i + 1 < literal.length(); i++) {
+		char ch = literal[i];
+		if (ch != '\\') {
+			result += ch;
+			continue;
+		}
+		ch = literal[++i];
+		if (ch >= '0' && ch <= '7') {
+			int code = 0;
+			for (int digits = 0; digits < 3 && literal[i] >= '0' && literal[i] <= '7'; digits++, i++) {
+				code = code * 8 + (literal[i] - '0');
+			}
+			i--;
+			result += char(code);
+		} else if (ch == 'n') {
+			result += '\n';
+		} else if (ch == 't') {
+			result += '\t';
+		} else {
+			result += ch;  // \" and \\ and anything else we don't know
+		}
+	}
+	return true;
+}
+
+static bool parse_number(const string &text, int &value)
+{
+	if (text == "") return false;
+	char *end;
+	long n = strtol(text.c_str(), &end, 0);  // decimal, or 0x... hex
+	if (*end != '\0' || n < -32768 || n > 65535) return false;
+	value = int(n);
+	return true;
+}
+
+static bool parse_register(const string &text, int &r)
+{
+	auto named = HERA_sim_registers.find(text);
+	if (named != HERA_sim_registers.end()) {
+		r = named->second;
+		return true;
+	}
+	if (text.length() >= 2 && text[0] == 'R' && parse_number(text.substr(1), r) && r >= 0 && r <= 15) {
+		return true;
+	}
+	return false;
+}
+
+bool HERA_simulator::parse_operand(const string &text, char kind, HERA_sim_instruction &inst, int position, int line_number)
+{
+	int *field = position == 0 ? &inst.a : position == 1 ? &inst.b : &inst.c;
+	switch (kind) {
+	case 'r':
+		if (!parse_register(text, *field)) return fail("expected a register, not " + text, line_number);
+		return true;
+	case 'n':
+		if (!parse_number(text, *field)) return fail("expected a number, not " + text, line_number);
+		return true;
+	case 'v':
+		if (parse_number(text, *field)) return true;
+		inst.label = text;
+		return true;
+	case 'l':
+		if (parse_register(text, *field)) {
+			inst.label_is_register = true;
+			return true;
+		}
+		inst.label = text;
+		return true;
+	default:
+		return fail("bad operand pattern", line_number);
+	}
+}
+
+bool HERA_simulator::parse_line(const string &raw_line, int line_number)
+{
+	// drop comments, but not "//" inside a string
+	string line = raw_line;
+	bool in_string = false;
+	for (size_t i = 0; i + 1 < line.length(); i++) {
+		if (in_string && line[i] == '\\') {
+			i++;
+		} else if (line[i] == '"') {
+			in_string = !in_string;
+		} else if (!in_string && line[i] == '/' && line[i+1] == '/') {
+			line = line.substr(0, i);
+			break;
+		}
+	}
+	line = trim(line);
+	if (line == "" || line[0] == '#') return true;  // the #includes of the Tiger standard library
+
+	size_t open = line.find('(');
+	if (open == string::npos || line[line.length()-1] != ')') return fail("can't make sense of \"" + line + "\"", line_number);
+	string name = trim(line.substr(0, open));
+	std::vector<string> operands = split_operands(line.substr(open + 1, line.length() - open - 2));
+
+	// labels and data
+	if (name == "LABEL" || name == "DLABEL") {
+		if (operands.size() != 1) return fail(name + " needs one label", line_number);
+		if (name == "LABEL") code_labels[operands[0]] = program.size();
+		else data_labels[operands[0]] = data_end;
+		return true;
+	}
+	if (name == "LP_STRING") {
+		string contents;
+		if (operands.size() != 1 || !unquote(operands[0], contents)) return fail("LP_STRING needs one string", line_number);
+		memory[data_end++ & 0xffff] = contents.length();
+		for (unsigned char ch : contents) memory[data_end++ & 0xffff] = ch;
+		return true;
+	}
+	if (name == "INTEGER" || name == "DSKIP") {
+		int n;
+		if (operands.size() != 1 || !parse_number(operands[0], n)) return fail(name + " needs one number", line_number);
+		if (name == "INTEGER") memory[data_end++ & 0xffff] = uint16_t(n);
+		else data_end += n;
+		return true;
+	}
+
+	auto info = HERA_sim_ops.find(name);
+	if (info == HERA_sim_ops.end()) return fail("unknown instruction " + name, line_number);
+	const string &pattern = info->second.operands;
+	if (operands.size() != pattern.length()) {
+		return fail(name + " needs " + std::to_string(pattern.length()) + " operand(s)", line_number);
+	}
+	HERA_sim_instruction inst;
+	inst.op = info->second.op;
+	inst.line = line_number;
+	for (size_t i = 0; i < pattern.length(); i++) {
+		if (!parse_operand(operands[i], pattern[i], inst, i, line_number)) return false;
+	}
+	// SET is SETLO and SETHI; a branch or CALL to a label first SETs Rt to it, then goes to Rt
+	if (inst.op == op_SET) {
+		inst.size = 2;
+	} else if (pattern != "" && pattern.back() == 'l' && !inst.label_is_register) {
+		inst.size = 3;
+	}
+	program.push_back(inst);
+	return true;
+}
+
+bool HERA_simulator::resolve_labels()
+{
+	addresses.push_back(0);
+	for (size_t i = 0; i < program.size(); i++) {
+		instruction_at[addresses[i]] = i;
+		addresses.push_back(addresses[i] + program[i].size);
+	}
+	for (auto &label : code_labels) {
+		function_names[label.second] = label.first;
+	}
+	for (HERA_sim_instruction &inst : program) {
+		if (inst.label == "") continue;
+		int *field = (inst.op == op_SET || inst.op == op_CALL) ? &inst.b : &inst.a;
+		auto code = code_labels.find(inst.label);
+		auto data = data_labels.find(inst.label);
+		if (code != code_labels.end()) {
+			*field = inst.op == op_SET ? addresses[code->second] : code->second;  // the SET's register gets an address
+		} else if (data != data_labels.end() && inst.op == op_SET) {
+			*field = data->second;
+		} else if (inst.op == op_CALL) {
+			for (size_t i = 0; i < HERA_sim_library.size(); i++) {
+				if (HERA_sim_library[i] == inst.label) inst.library = i;
+			}
+			if (inst.library < 0) return fail("CALL of undefined function " + inst.label, inst.line);
+		} else {
+			return fail("undefined label " + inst.label, inst.line);
+		}
+	}
+	return true;
+}
+
+bool HERA_simulator::load(const string &code)
+{
+	int line_number = 0;
+	size_t start = 0;
+	while (start < code.length()) {
+		size_t end = code.find('\n', start);
+		if (end == string::npos) end = code.length();
+		if (!parse_line(code.substr(start, end - start), ++line_number)) return false;
+		start = end + 1;
+	}
+	return resolve_labels();
+}
+
+uint16_t HERA_simulator::add(uint16_t x, uint16_t y, int carry_in)
+{
+	uint32_t full = uint32_t(x) + uint32_t(y) + carry_in;
+	uint16_t result = uint16_t(full);
+	c = full > 0xffff;
+	v = ((x ^ result) & (y ^ result) & 0x8000) != 0;
+	set_sz(result);
+	return result;
+}
+
+string HERA_simulator::get_string(int address)
+{
+	string result;
+	int length = memory[address & 0xffff];
+	for (int i = 1; i <= length; i++) result += char(memory[(address + i) & 0xffff]);
+	return result;
+}
+
+int HERA_simulator::new_string(const string &contents)
+{
+	int address = heap_end;
+	memory[heap_end++ & 0xffff] = contents.length();
+	for (unsigned char ch : contents) memory[heap_end++ & 0xffff] = ch;
+	return address;
+}
+
+int HERA_simulator::read_char(std::istream &in)
+{
+	if (pushed_back_char != -2) {
+		int ch = pushed_back_char;
+		pushed_back_char = -2;
+		return ch;
+	}
+	int ch = in.get();
+	last_char = in ? ch : -1;
+	return last_char;
+}
+
+// Carry out a Tiger-stdlib routine; FP is already the routine's frame, with the arguments at FP+3...
+bool HERA_simulator::library_call(int routine, bool &halt, int line)
+{
+	const string &name = HERA_sim_library[routine];
+	auto arg = [this](int i) { return memory[(reg[FP] + 3 + i) & 0xffff]; };
+	auto signed_arg = [&arg](int i) { return int(int16_t(arg(i))); };
+	auto result = [this](int value) { memory[(reg[FP] + 3) & 0xffff] = uint16_t(value); };
+
+	if (name == "print" || name == "println") {
+		out << get_string(arg(0)) << (name == "println" ? "\n" : "");
+	} else if (name == "printint") {
+		out << signed_arg(0);
+	} else if (name == "printbool") {
+		out << (arg(0) ? "true" : "false");
+	} else if (name == "ord") {
+		string s = get_string(arg(0));
+		result(s == "" ? -1 : (unsigned char) s[0]);
+	} else if (name == "chr") {
+		result(new_string(string(1, char(arg(0)))));
+	} else if (name == "size") {
+		result(memory[arg(0)]);
+	} else if (name == "substring") {
+		string s = get_string(arg(0));
+		int first = signed_arg(1), n = signed_arg(2);
+		if (first < 0 || n < 0 || first + n > int(s.length())) return fail("substring out of range", line);
+		result(new_string(s.substr(first, n)));
+	} else if (name == "concat") {
+		result(new_string(get_string(arg(0)) + get_string(arg(1))));
+	} else if (name == "tstrcmp") {
+		int comparison = get_string(arg(0)).compare(get_string(arg(1)));
+		result(comparison < 0 ? -1 : comparison > 0 ? 1 : 0);
+	} else if (name == "div" || name == "mod") {
+		if (arg(1) == 0) return fail("division by zero", line);
+		result(name == "div" ? signed_arg(0) / signed_arg(1) : signed_arg(0) % signed_arg(1));
+	} else if (name == "getchar_ord") {
+		result(read_char(std::cin));
+	} else if (name == "putchar_ord") {
+		out << char(arg(0));
+	} else if (name == "flush") {
+		out << std::flush;
+	} else if (name == "getchar") {
+		int ch = read_char(std::cin);
+		result(new_string(ch < 0 ? "" : string(1, char(ch))));
+	} else if (name == "ungetchar") {
+		pushed_back_char = last_char;
+	} else if (name == "getline") {
+		string s;
+		int ch;
+		while ((ch = read_char(std::cin)) >= 0 && ch != '\n') s += char(ch);
+		result(new_string(s));
+	} else if (name == "getint") {
+		int n = 0;
+		std::cin >> n;
+		result(n);
+	} else if (name == "exit") {
+		stats.exit_status = signed_arg(0);
+		halt = true;
+	} else if (name == "malloc") {
+		int cells = arg(0);  // the result goes where the argument is
+		result(heap_end);
+		heap_end += cells;
+	} else if (name == "free") {
+		// nothing; the heap only grows
+	} else if (name == "not") {
+		result(arg(0) == 0);
+	}
+	if (heap_end > HERA_sim_data_start) return fail("out of heap memory", line);
+	return true;
+}
+
+bool HERA_simulator::run(long max_instructions)
+{
+	struct frame { string function; long entry_cycles; HERA_sim_function_stats *stats; };
+	std::vector<frame> call_stack = { {"main", 0, &stats.functions["main"]} };
+	std::map<string, int> depth = { {"main", 1} };
+	stats.functions["main"].calls = 1;
+
+	reg[FP] = reg[SP] = HERA_sim_stack_start;
+	heap_end = HERA_sim_heap_start;
+	int pc = 0;
+	bool halt = false;
+	while (!halt) {
+		if (pc < 0 || pc >= int(program.size())) {
+			return fail(pc < 0 ? "went to a code address that isn't the start of an instruction" : "ran off the end of the program (no HALT?)");
+		}
+		if (stats.instructions >= max_instructions) {
+			return fail("gave up after " + std::to_string(max_instructions) + " instructions");
+		}
+		const HERA_sim_instruction &inst = program[pc];
+		int next = pc + 1;
+		int cycles = 1;
+		string called;        // a (non-library) function we're entering
+		bool returning = false;
+		// the registers named by the operands (meaningless, but harmless, for operands that are numbers)
+		uint16_t A = reg[inst.a & 15], B = reg[inst.b & 15], C = reg[inst.c & 15];
+
+		switch (inst.op) {
+		case op_SET:    set_reg(inst.a, inst.b); break;
+		case op_SETLO:  set_reg(inst.a, int8_t(inst.b & 0xff)); break;
+		case op_SETHI:  set_reg(inst.a, (A & 0xff) | ((inst.b & 0xff) << 8)); break;
+		case op_MOVE:   set_reg(inst.a, B); break;
+		case op_ADD:    set_reg(inst.a, add(B, C, cb ? 0 : c)); break;
+		case op_SUB:    set_reg(inst.a, add(B, uint16_t(~C), cb ? 1 : c)); break;
+		case op_CMP:    add(A, uint16_t(~B), 1); break;
+		case op_MUL: {
+			int product = int(int16_t(B)) * int(int16_t(C));
+			uint16_t r = uint16_t(product);
+			set_sz(r);
+			v = product != int(int16_t(r));
+			c = false;
+			set_reg(inst.a, r);
+			break;
+		}
+		case op_DIV: {
+			if (C == 0) return fail("division by zero", inst.line);
+			uint16_t r = uint16_t(int(int16_t(B)) / int(int16_t(C)));
+			set_sz(r);
+			set_reg(inst.a, r);
+			break;
+		}
+		case op_AND:    set_reg(inst.a, B & C); set_sz(B & C); break;
+		case op_OR:     set_reg(inst.a, B | C); set_sz(B | C); break;
+		case op_XOR:    set_reg(inst.a, B ^ C); set_sz(B ^ C); break;
+		case op_INC:    set_reg(inst.a, add(A, uint16_t(inst.b), 0)); break;
+		case op_DEC:    set_reg(inst.a, add(A, uint16_t(~inst.b), 1)); break;
+		case op_NEG:    set_reg(inst.a, add(0, uint16_t(~B), 1)); break;
+		case op_NOT:    set_reg(inst.a, uint16_t(~B)); set_sz(uint16_t(~B)); break;
+		case op_LSL:    c = (B & 0x8000) != 0; set_reg(inst.a, uint16_t(B << 1)); set_sz(uint16_t(B << 1)); break;
+		case op_ASL:    c = (B & 0x8000) != 0; v = ((B ^ (B << 1)) & 0x8000) != 0;
+				set_reg(inst.a, uint16_t(B << 1)); set_sz(uint16_t(B << 1)); break;
+		case op_LSR:    c = B & 1; set_reg(inst.a, B >> 1); set_sz(B >> 1); break;
+		case op_ASR:    c = B & 1; set_reg(inst.a, uint16_t(int16_t(B) >> 1)); set_sz(uint16_t(int16_t(B) >> 1)); break;
+		case op_LOAD:   set_reg(inst.a, load_word(C + inst.b)); cycles++; break;
+		case op_STORE:  store_word(C + inst.b, A); cycles++; break;
+		case op_CON:    c = true; break;
+		case op_COFF:   c = false; break;
+		case op_CBON:   cb = true; break;
+		case op_CCBOFF: cb = false; c = false; break;
+		case op_HALT:   halt = true; break;
+		case op_NOP:    break;
+
+		case op_BR: case op_BZ: case op_BNZ: case op_BL: case op_BGE: case op_BLE: case op_BG:
+		case op_BULE: case op_BUG: case op_BS: case op_BNS: case op_BC: case op_BNC: case op_BV: case op_BNV: {
+			bool less = s != v;
+			bool taken =
+				inst.op == op_BR   ? true :
+				inst.op == op_BZ   ? z :
+				inst.op == op_BNZ  ? !z :
+				inst.op == op_BL   ? less :
+				inst.op == op_BGE  ? !less :
+				inst.op == op_BLE  ? less || z :
+				inst.op == op_BG   ? !(less || z) :
+				inst.op == op_BULE ? !c || z :
+				inst.op == op_BUG  ? c && !z :
+				inst.op == op_BS   ? s :
+				inst.op == op_BNS  ? !s :
+				inst.op == op_BC   ? c :
+				inst.op == op_BNC  ? !c :
+				inst.op == op_BV   ? v : !v;
+			if (taken) {
+				next = inst.label_is_register ? instruction_number(A) : inst.a;
+				stats.branches_taken++;
+				cycles++;
+			}
+			break;
+		}
+
+		case op_CALL:
+		case op_RETURN: {
+			// both swap FP with the first register, and jump to the second, leaving the return address in it
+			std::swap(reg[FP], reg[inst.a]);
+			if (inst.library >= 0) {  // run the routine, then come straight back as its RETURN would
+				stats.calls++;
+				stats.functions[HERA_sim_library[inst.library]].calls++;
+				stats.functions[HERA_sim_library[inst.library]].library = true;
+				if (!library_call(inst.library, halt, inst.line)) return false;
+				std::swap(reg[FP], reg[inst.a]);
+				set_reg(PC_ret, addresses[next]);
+			} else {
+				int target = (inst.op == op_RETURN || inst.label_is_register) ? instruction_number(B) : inst.b;
+				set_reg(inst.op == op_RETURN || inst.label_is_register ? inst.b : PC_ret, addresses[next]);
+				next = target;
+				if (inst.op == op_CALL) {
+					stats.calls++;
+					called = inst.label_is_register ? function_names[target] : inst.label;
+					if (called == "") called = "?";
+				} else {
+					returning = true;
+				}
+			}
+			cycles++;
+			break;
+		}
+		}
+
+		stats.instructions++;
+		stats.cycles += cycles;
+		HERA_sim_function_stats &current = *call_stack.back().stats;
+		current.instructions++;
+		current.self_cycles += cycles;
+
+		if (called != "") {
+			stats.functions[called].calls++;
+			call_stack.push_back({called, stats.cycles, &stats.functions[called]});
+			depth[called]++;
+		} else if (returning && call_stack.size() > 1) {
+			frame done = call_stack.back();
+			call_stack.pop_back();
+			if (--depth[done.function] == 0) {  // don't count recursive calls twice
+				stats.functions[done.function].total_cycles += stats.cycles - done.entry_cycles;
+			}
+		}
+		HERA_sim_function_stats &now_running = *call_stack.back().stats;
+		now_running.frame_size = std::max(now_running.frame_size, int(int16_t(reg[SP] - reg[FP])));
+		pc = next;
+	}
+
+	// whatever is still running (at least main) gets the cycles up to the end
+	for (frame &f : call_stack) {
+		if (--depth[f.function] == 0) stats.functions[f.function].total_cycles += stats.cycles - f.entry_cycles;
+	}
+	out << std::flush;
+	return true;
+}
+
+bool HERA_simulate(const string &code, std::ostream &program_output, HERA_sim_stats &stats, long max_instructions)
+{
+	HERA_simulator sim(program_output, stats);
+	if (!sim.load(code)) return false;
+	stats.static_instructions = sim.program_size();
+	return sim.run(max_instructions);
+}
+
+void HERA_sim_report(const HERA_sim_stats &stats, std::ostream &out)
+{
+	out << "HERA simulation: " << stats.static_instructions << " instructions in the program, "
+	    << stats.instructions << " executed, " << stats.cycles << " cycles, "
+	    << stats.loads << " loads, " << stats.stores << " stores, "
+	    << stats.branches_taken << " branches taken, " << stats.calls << " calls";
+	if (stats.exit_status != 0) out << ", exit status " << stats.exit_status;
+	out << "\n";
+	out << std::left << std::setw(24) << "function" << std::right << std::setw(10) << "calls"
+	    << std::setw(14) << "instructions" << std::setw(14) << "self cycles" << std::setw(14) << "total cycles" << std::setw(8) << "frame" << "\n";
+	for (auto &name_and_stats : stats.functions) {
+		const HERA_sim_function_stats &f = name_and_stats.second;
+		out << std::left << std::setw(24) << (name_and_stats.first + (f.library ? " (library)" : "")) << std::right
+		    << std::setw(10) << f.calls << std::setw(14) << f.instructions
+		    << std::setw(14) << f.self_cycles << std::setw(14) << f.total_cycles << std::setw(8) << f.frame_size << "\n";
+	}
+}
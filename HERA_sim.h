@@ -0,0 +1,66 @@
+#if ! defined _HERA_SIM_H
+#define _HERA_SIM_H 1
+
+#include <iostream>
+#include <map>
+#include "util.h"
+
+// A small HERA simulator (the -sim flag in tiger.cc), so we can run and measure the code
+//  we generate without the HERA-C toolchain.
+//
+// It handles the instructions and data directives that HERA_code.cc and HERA_data.cc emit
+//  (plus the rest of the common arithmetic, shift, flag and branch instructions), with 16-bit
+//  registers, flags and memory, and the HERA-C register names (Rt, FP_alt, PC_ret, FP, SP).
+// "#include" lines are skipped; instead, a CALL to a label the program doesn't define, but which
+//  names one of the routines in Tiger-stdlib-stack.hera (print, printint, concat, tstrcmp, ...),
+//  is carried out directly in C++, taking its arguments from and leaving its result in the
+//  callee's frame at FP+3, just as the library routines do.
+//
+// Code addresses, the ones a register holds (SET of a code label, the return address of a CALL)
+//  and a register branch goes to, count words as HERA-C lays the pseudo-ops out: SET is two
+//  (SETLO and SETHI), a branch or CALL to a label is three (SETLO and SETHI of Rt, then the
+//  branch or CALL through Rt), and everything else is one. So code that does arithmetic on a code
+//  address (such as a jump table; see switch_HERA_code) runs here as it would on a real HERA.
+//  The instruction counts below still count each pseudo-op as one instruction.
+//
+// Memory layout: the stack starts at HERA_sim_stack_start and grows up, malloc (and the library's
+//  new strings) take memory from HERA_sim_heap_start up, and DLABEL data starts at HERA_sim_data_start.
+//
+// Cycle counts come from a simple model rather than any particular HERA machine: every instruction
+//  takes one cycle, plus one more for a memory access (LOAD, STORE) or a change of control
+//  (a taken branch, CALL, RETURN).
+
+const int HERA_sim_stack_start = 0x4000;
+const int HERA_sim_heap_start  = 0x8000;
+const int HERA_sim_data_start  = 0xC000;
+
+struct HERA_sim_function_stats {
+	long calls = 0;
+	long instructions = 0;  // executed while this function was the innermost one
+	long self_cycles = 0;
+	long total_cycles = 0;  // including the functions it called
+	int frame_size = 0;     // the most stack it used at once (SP - FP), in words
+	bool library = false;   // a Tiger-stdlib routine, run in C++ (so no instructions of its own)
+};
+
+struct HERA_sim_stats {
+	long static_instructions = 0;  // in the program, whether or not they ran
+	long instructions = 0;
+	long cycles = 0;
+	long loads = 0;         // memory traffic, in words
+	long stores = 0;
+	long branches_taken = 0;
+	long calls = 0;
+	int exit_status = 0;    // from the program's call to exit, if any
+	std::map<string, HERA_sim_function_stats> functions;  // the main program is "main"
+};
+
+// Run HERA code (e.g. the output of A_root_::HERA_code) until HALT, exit, or max_instructions,
+//  sending what the program prints to program_output.
+// Returns false (after an EM_error) if the code can't be read or the program goes wrong.
+bool HERA_simulate(const string &code, std::ostream &program_output, HERA_sim_stats &stats,
+		   long max_instructions = 1000000000L);
+
+void HERA_sim_report(const HERA_sim_stats &stats, std::ostream &out);
+
+#endif
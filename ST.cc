@@ -13,10 +13,11 @@ Ty_ty type_info::my_type() {
 }
 
 // Variable Library
-var_info::var_info(Ty_ty the_type, int the_SP, bool writable) {
+var_info::var_info(Ty_ty the_type, int the_SP, bool writable, AST_node_ *declaration) {
 	_type = the_type;
 	_SP = the_SP;	
 	_writable = writable;
+	_declaration = declaration;
 };
 
 ST<var_info> empty_var_info() {
@@ -46,6 +47,10 @@ bool var_info::am_i_writable() {
 	return _writable;
 }
 
+AST_node_ *var_info::my_declaration() {
+	return _declaration;
+}
+
 // Type Standard library
 typedef ST<type_info> type_table;
 type_table type_library = FuseOneScope(
@@ -257,9 +262,9 @@ void ST_examples()
 
    ST_example avail_in_first_inner_let   = MergeAndShadow(first_inner_let_all_decs, avail_in_outer_let);
 
-   EM_debug("Symbols available in sum node in example:\n" + str(avail_in_first_inner_let));
-   EM_debug("Lookup of 'wombat' here produces: " + str(lookup(to_Symbol("wombat"), avail_in_first_inner_let)));
-   EM_debug("Lookup of 'arthropod' here produces: " + str(lookup(to_Symbol("arthropod"), avail_in_first_inner_let)));
+   EM_DEBUG(EM_general, "Symbols available in sum node in example:\n" + str(avail_in_first_inner_let));
+   EM_DEBUG(EM_general, "Lookup of 'wombat' here produces: " + str(lookup(to_Symbol("wombat"), avail_in_first_inner_let)));
+   EM_DEBUG(EM_general, "Lookup of 'arthropod' here produces: " + str(lookup(to_Symbol("arthropod"), avail_in_first_inner_let)));
 
 
    ST_example second_inner_let_dec       = ST_example(to_Symbol("arthropod"), example_sym_info(124, length("wombat")));
@@ -267,17 +272,17 @@ void ST_examples()
 
    ST_example avail_in_second_inner_let  = MergeAndShadow(second_inner_let_all_decs, avail_in_outer_let);
 
-   EM_debug("Symbols available in division node in example:\n" + str(avail_in_second_inner_let));
-   EM_debug("Lookup of 'wombat' here produces: " + str(lookup(to_Symbol("wombat"), avail_in_second_inner_let)));
-   EM_debug("Lookup of 'arthropod' here produces: " + str(lookup(to_Symbol("arthropod"), avail_in_second_inner_let)));
+   EM_DEBUG(EM_general, "Symbols available in division node in example:\n" + str(avail_in_second_inner_let));
+   EM_DEBUG(EM_general, "Lookup of 'wombat' here produces: " + str(lookup(to_Symbol("wombat"), avail_in_second_inner_let)));
+   EM_DEBUG(EM_general, "Lookup of 'arthropod' here produces: " + str(lookup(to_Symbol("arthropod"), avail_in_second_inner_let)));
 
    try {
-	   EM_debug("Looking up 'C. Elagans' in first table: ");
+	   EM_DEBUG(EM_general, "Looking up 'C. Elagans' in first table: ");
 	   lookup(to_Symbol("C. Elegans"), avail_in_first_inner_let);
-	   EM_debug("... that's strange, we should have thrown an exception!");
+	   EM_DEBUG(EM_general, "... that's strange, we should have thrown an exception!");
    }
    catch(ST_example::undefined_symbol missing) {
-	   EM_debug("... and sure enough, there was a problem with missing symbol named " + str(missing.name));
+	   EM_DEBUG(EM_general, "... and sure enough, there was a problem with missing symbol named " + str(missing.name));
    }
 }
 
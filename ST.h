@@ -144,17 +144,22 @@ ST<function_info> empty_function_info();
 extern ST<function_info> tiger_library;
 extern int function_count;
 
-// Struct to store type and SP information for variables
+class AST_node_;
+
+// Struct to store type and SP information for variables, and the node that declares each one
+//  (an A_varDec_, an A_forExp_ for its loop variable, or an A_field_ for a parameter)
 struct var_info {
 public:
-	var_info(Ty_ty the_type, int the_SP, bool writable);
+	var_info(Ty_ty the_type, int the_SP, bool writable, AST_node_ *declaration = 0);
 	Ty_ty _type;
 	int _SP;
 	bool _writable;
+	AST_node_ *_declaration;
 
 	Ty_ty my_type();
 	int my_SP();
 	bool am_i_writable();
+	AST_node_ *my_declaration();
 	string __repr__();
 	string __str__();
 };
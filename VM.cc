@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include "errormsg.h"
+#include "VM.h"
+
+// See VM.h for the instruction set and frame layout.
+
+struct VM_op_info {
+	const char *name;
+	const char *operands;
+};
+
+static const VM_op_info VM_ops[VM_number_of_opcodes] = {
+	{"LOADK", "rk"}, {"LOADS", "rs"}, {"MOVE", "rr"},
+	{"ADD", "rrr"}, {"SUB", "rrr"}, {"MUL", "rrr"}, {"DIV", "rrr"},
+	{"EQ", "rrr"}, {"NE", "rrr"}, {"LT", "rrr"}, {"LE", "rrr"}, {"GT", "rrr"}, {"GE", "rrr"},
+	{"STRCMP", "rrr"}, {"INCR", "r"},
+	{"JUMP", "l"}, {"JUMPF", "rl"}, {"JUMPGT", "rrl"},
+	{"FP", "r"}, {"LOADF", "rrk"}, {"STOREF", "rrk"},
+	{"NEWREC", "rk"}, {"NEWARRAY", "rrr"}, {"GETFIELD", "rrk"}, {"SETFIELD", "rrk"}, {"GETELEM", "rrr"}, {"SETELEM", "rrr"},
+	{"CALL", "frr"}, {"CALLLIB", "brr"}, {"RET", "r"}, {"HALT", ""},
+};
+
+const char *VM_operands(VM_opcode op)
+{
+	return VM_ops[op].operands;
+}
+
+enum VM_library {
+	VM_print, VM_println, VM_printint, VM_printbool, VM_ord, VM_chr, VM_size, VM_substring, VM_concat,
+	VM_tstrcmp, VM_div, VM_mod, VM_getchar_ord, VM_putchar_ord, VM_flush, VM_getchar, VM_ungetchar,
+	VM_getline, VM_getint, VM_exit, VM_number_of_library_functions
+};
+
+static const char *VM_library_names[VM_number_of_library_functions] = {
+	"print", "println", "printint", "printbool", "ord", "chr", "size", "substring", "concat",
+	"tstrcmp", "div", "mod", "getchar_ord", "putchar_ord", "flush", "getchar", "ungetchar",
+	"getline", "getint", "exit",
+};
+
+static const int VM_library_parameter_counts[VM_number_of_library_functions] = {
+	1, 1, 1, 1, 1, 1, 1, 3, 2,
+	2, 2, 2, 0, 1, 0, 0, 0,
+	0, 0, 1,
+};
+
+int VM_library_parameters(int function)
+{
+	return VM_library_parameter_counts[function];
+}
+
+int VM_library_function(const string &name)
+{
+	for (int i = 0; i < VM_number_of_library_functions; i++) {
+		if (name == VM_library_names[i]) {
+			return i;
+		}
+	}
+	return -1;  // e.g. malloc and free, since NEWREC and NEWARRAY take care of the heap
+}
+
+
+struct VM_runtime_error {};
+struct VM_exit_called { int status; };
+
+static void VM_error(const string &message)
+{
+	EM_error("Bytecode VM: run-time error: " + message);
+	throw VM_runtime_error();
+}
+
+static inline int VM_number(int n)
+{
+	return int16_t(n);  // as on HERA
+}
+
+// What a running program has besides its registers: strings, records and arrays, and input
+class VM_state {
+public:
+	VM_state(const VM_program &program, std::ostream &output) : strings(program.strings), heap(1), out(output) { }
+
+	int new_string(const string &s) {
+		strings.push_back(s);
+		return strings.size() - 1;
+	}
+	int compare(int s1, int s2) {
+		int comparison = strings[s1].compare(strings[s2]);
+		return comparison < 0 ? -1 : comparison > 0 ? 1 : 0;
+	}
+	int call_library(int function, const int *args);
+
+	int new_block(int words, int value) {  // never at 0, which is nil
+		heap.resize(heap.size() + std::max(words, 1), value);
+		return heap.size() - std::max(words, 1);
+	}
+	int new_array(int length, int value) {
+		int array = new_block(length + 1, value);
+		heap[array] = length;
+		return array;
+	}
+	int &field(int record, int offset, const VM_function *function) {
+		if (record == 0) {
+			VM_error("field of nil record in " + function->name);
+		}
+		return heap[record + offset];
+	}
+	int &element(int array, int index, const VM_function *function) {
+		if (index < 0 || index >= heap[array]) {
+			VM_error("subscript " + std::to_string(index) + " out of range in " + function->name);
+		}
+		return heap[array + 1 + index];
+	}
+
+private:
+	std::vector<string> strings;  // the literals, and then every string the program makes
+	std::vector<int> heap;        // every record and array
+	std::ostream &out;
+	int pushed_back_char = -2, last_char = -1;
+
+	int read_char() {
+		if (pushed_back_char != -2) {
+			int ch = pushed_back_char;
+			pushed_back_char = -2;
+			return ch;
+		}
+		int ch = std::cin.get();
+		last_char = std::cin ? ch : -1;
+		return last_char;
+	}
+};
+
+int VM_state::call_library(int function, const int *args)
+{
+	switch (function) {
+	case VM_print:
+		out << strings[args[0]];
+		return 0;
+	case VM_println:
+		out << strings[args[0]] << "\n";
+		return 0;
+	case VM_printint:
+		out << args[0];
+		return 0;
+	case VM_printbool:
+		out << (args[0] ? "true" : "false");
+		return 0;
+	case VM_ord:
+		return strings[args[0]] == "" ? -1 : (unsigned char) strings[args[0]][0];
+	case VM_chr:
+		return new_string(string(1, char(args[0])));
+	case VM_size:
+		return VM_number(strings[args[0]].length());
+	case VM_substring:
+		if (args[1] < 0 || args[2] < 0 || args[1] + args[2] > int(strings[args[0]].length())) {
+			VM_error("substring out of range");
+		}
+		return new_string(strings[args[0]].substr(args[1], args[2]));
+	case VM_concat:
+		return new_string(strings[args[0]] + strings[args[1]]);
+	case VM_tstrcmp:
+		return compare(args[0], args[1]);
+	case VM_div:
+	case VM_mod:
+		if (args[1] == 0) {
+			VM_error("division by zero");
+		}
+		return VM_number(function == VM_div ? args[0] / args[1] : args[0] % args[1]);
+	case VM_getchar_ord:
+		return read_char();
+	case VM_putchar_ord:
+		out << char(args[0]);
+		return 0;
+	case VM_flush:
+		out.flush();
+		return 0;
+	case VM_getchar: {
+		int ch = read_char();
+		return new_string(ch < 0 ? "" : string(1, char(ch)));
+	}
+	case VM_ungetchar:
+		pushed_back_char = last_char;
+		return 0;
+	case VM_getline: {
+		string s;
+		int ch;
+		while ((ch = read_char()) >= 0 && ch != '\n') s += char(ch);
+		return new_string(s);
+	}
+	case VM_getint: {
+		int n = 0;
+		std::cin >> n;
+		return VM_number(n);
+	}
+	case VM_exit:
+		throw VM_exit_called{args[0]};
+	}
+	VM_error("unknown library function " + std::to_string(function));
+	return 0;
+}
+
+
+struct VM_call {
+	const VM_function *function;
+	const VM_instruction *return_to;
+	int fp;
+	int result;  // register in the caller's frame, or -1
+};
+
+static const unsigned int VM_max_stack = 1 << 24;  // registers, in all frames together
+
+#if (defined __GNUC__ || defined __clang__) && ! defined VM_SWITCH_DISPATCH
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+#if VM_THREADED
+#define VM_OP(name) do_##name:
+#define VM_NEXT     do { inst = pc++; goto *handlers[inst->op]; } while (0)
+#else
+#define VM_OP(name) case VM_##name:
+#define VM_NEXT     goto next
+#endif
+
+bool VM_run(const VM_program &program, std::ostream &program_output, int &exit_status)
+{
+	VM_state state(program, program_output);
+	std::vector<int> stack(1 << 16);
+	std::vector<VM_call> calls;
+
+	const VM_function *function = &program.functions[0];
+	if (unsigned(function->frame_size) > stack.size()) {
+		stack.resize(function->frame_size);
+	}
+	int fp = 0;
+	int *R = stack.data();  // the registers of the function that's running
+	const VM_instruction *pc = function->code.data();
+	const VM_instruction *inst;
+
+	exit_status = 0;
+	try {
+#if VM_THREADED
+		static void *const handlers[] = {  // in the order of VM_opcode
+			&&do_LOADK, &&do_LOADS, &&do_MOVE,
+			&&do_ADD, &&do_SUB, &&do_MUL, &&do_DIV,
+			&&do_EQ, &&do_NE, &&do_LT, &&do_LE, &&do_GT, &&do_GE,
+			&&do_STRCMP, &&do_INCR,
+			&&do_JUMP, &&do_JUMPF, &&do_JUMPGT,
+			&&do_FP, &&do_LOADF, &&do_STOREF,
+			&&do_NEWREC, &&do_NEWARRAY, &&do_GETFIELD, &&do_SETFIELD, &&do_GETELEM, &&do_SETELEM,
+			&&do_CALL, &&do_CALLLIB, &&do_RET, &&do_HALT,
+		};
+		static_assert(sizeof(handlers) / sizeof(handlers[0]) == VM_number_of_opcodes, "one handler per opcode");
+		VM_NEXT;
+#else
+	next:
+		inst = pc++;
+		switch (inst->op) {
+#endif
+		VM_OP(LOADK)  R[inst->a] = inst->b;                              VM_NEXT;
+		VM_OP(LOADS)  R[inst->a] = inst->b;                              VM_NEXT;
+		VM_OP(MOVE)   R[inst->a] = R[inst->b];                           VM_NEXT;
+		VM_OP(ADD)    R[inst->a] = VM_number(R[inst->b] + R[inst->c]);   VM_NEXT;
+		VM_OP(SUB)    R[inst->a] = VM_number(R[inst->b] - R[inst->c]);   VM_NEXT;
+		VM_OP(MUL)    R[inst->a] = VM_number(R[inst->b] * R[inst->c]);   VM_NEXT;
+		VM_OP(DIV)
+			if (R[inst->c] == 0) {
+				VM_error("division by zero in " + function->name);
+			}
+			R[inst->a] = VM_number(R[inst->b] / R[inst->c]);
+			VM_NEXT;
+		VM_OP(EQ)     R[inst->a] = R[inst->b] == R[inst->c];             VM_NEXT;
+		VM_OP(NE)     R[inst->a] = R[inst->b] != R[inst->c];             VM_NEXT;
+		VM_OP(LT)     R[inst->a] = R[inst->b] <  R[inst->c];             VM_NEXT;
+		VM_OP(LE)     R[inst->a] = R[inst->b] <= R[inst->c];             VM_NEXT;
+		VM_OP(GT)     R[inst->a] = R[inst->b] >  R[inst->c];             VM_NEXT;
+		VM_OP(GE)     R[inst->a] = R[inst->b] >= R[inst->c];             VM_NEXT;
+		VM_OP(STRCMP) R[inst->a] = state.compare(R[inst->b], R[inst->c]); VM_NEXT;
+		VM_OP(INCR)   R[inst->a] = VM_number(R[inst->a] + 1);            VM_NEXT;
+		VM_OP(JUMP)   pc = function->code.data() + inst->a;              VM_NEXT;
+		VM_OP(JUMPF)
+			if (R[inst->a] == 0) pc = function->code.data() + inst->b;
+			VM_NEXT;
+		VM_OP(JUMPGT)
+			if (R[inst->a] > R[inst->b]) pc = function->code.data() + inst->c;
+			VM_NEXT;
+		VM_OP(FP)     R[inst->a] = fp;                                   VM_NEXT;
+		VM_OP(LOADF)  R[inst->a] = stack[R[inst->b] + inst->c];          VM_NEXT;
+		VM_OP(STOREF) stack[R[inst->b] + inst->c] = R[inst->a];          VM_NEXT;
+		VM_OP(NEWREC) R[inst->a] = state.new_block(inst->b, 0);          VM_NEXT;
+		VM_OP(NEWARRAY)
+			if (R[inst->b] < 0) {
+				VM_error("negative array size in " + function->name);
+			}
+			R[inst->a] = state.new_array(R[inst->b], R[inst->c]);
+			VM_NEXT;
+		VM_OP(GETFIELD) R[inst->a] = state.field(R[inst->b], inst->c, function);   VM_NEXT;
+		VM_OP(SETFIELD) state.field(R[inst->b], inst->c, function) = R[inst->a];   VM_NEXT;
+		VM_OP(GETELEM)  R[inst->a] = state.element(R[inst->b], R[inst->c], function); VM_NEXT;
+		VM_OP(SETELEM)  state.element(R[inst->b], R[inst->c], function) = R[inst->a]; VM_NEXT;
+		VM_OP(CALL) {
+			const VM_function *callee = &program.functions[inst->a];
+			int callee_fp = fp + function->frame_size;
+			if (unsigned(callee_fp + callee->frame_size) > stack.size()) {
+				if (stack.size() >= VM_max_stack) {
+					VM_error("stack overflow (too many nested calls) in " + callee->name);
+				}
+				stack.resize(2 * stack.size());
+				R = stack.data() + fp;
+			}
+			int *callee_R = stack.data() + callee_fp;
+			for (int i = 0; i < callee->parameters + callee->static_link; i++) {
+				callee_R[3 + i] = R[inst->b + i];
+			}
+			calls.push_back(VM_call{function, pc, fp, inst->c});
+			function = callee;
+			fp = callee_fp;
+			R = callee_R;
+			pc = callee->code.data();
+			VM_NEXT;
+		}
+		VM_OP(CALLLIB) {
+			int result = state.call_library(inst->a, R + inst->b);
+			if (inst->c >= 0) {
+				R[inst->c] = result;
+			}
+			VM_NEXT;
+		}
+		VM_OP(RET) {
+			int result = inst->a < 0 ? 0 : R[inst->a];
+			const VM_call &caller = calls.back();
+			function = caller.function;
+			pc = caller.return_to;
+			fp = caller.fp;
+			R = stack.data() + fp;
+			if (caller.result >= 0) {
+				R[caller.result] = result;
+			}
+			calls.pop_back();
+			VM_NEXT;
+		}
+		VM_OP(HALT)
+			program_output.flush();
+			return true;
+#if ! VM_THREADED
+		default:
+			VM_error("bad opcode " + std::to_string(inst->op));
+		}
+#endif
+	} catch (const VM_exit_called &exit) {
+		exit_status = exit.status;
+	} catch (const VM_runtime_error &) {
+		program_output.flush();
+		return false;
+	}
+	program_output.flush();
+	return true;
+}
+
+#undef VM_OP
+#undef VM_NEXT
+
+
+string VM_disassemble(const VM_program &program)
+{
+	std::ostringstream out;
+	for (const VM_function &function : program.functions) {
+		out << function.name << ":   // " << function.parameters << " parameters, "
+		    << function.frame_size << " registers\n";
+		for (unsigned int i = 0; i < function.code.size(); i++) {
+			const VM_instruction &inst = function.code[i];
+			const char *operands = VM_ops[inst.op].operands;
+			const int values[3] = {inst.a, inst.b, inst.c};
+			out << "  " << i << ":\t" << VM_ops[inst.op].name;
+			for (int o = 0; operands[o]; o++) {
+				out << (o == 0 ? " " : ", ");
+				switch (operands[o]) {
+				case 'r': out << (values[o] < 0 ? string("-") : "r" + std::to_string(values[o])); break;
+				case 'k': out << values[o]; break;
+				case 's': out << repr_for_std_string(program.strings[values[o]]); break;
+				case 'l': out << "@" << values[o]; break;
+				case 'f': out << program.functions[values[o]].name; break;
+				case 'b': out << VM_library_names[values[o]]; break;
+				}
+			}
+			out << "\n";
+		}
+	}
+	return out.str();
+}
@@ -0,0 +1,83 @@
+#if ! defined _VM_H
+#define _VM_H 1
+
+#include <iostream>
+#include <vector>
+#include "util.h"
+
+// A register-based bytecode for Tiger (the -vm flag in tiger.cc), for when we just want to run
+//  a program rather than get HERA code for it.  visitors/bytecode_visitor.h compiles the
+//  typechecked AST into a VM_program, and VM_run runs it.
+//
+// Each function has a flat frame of registers: first its variables, at the same offsets from
+//  FP that the HERA code uses (so parameters start at register 3, followed by the static link
+//  for a function that takes one), and then the temporaries for its expressions.  Values are
+//  16-bit integers (ints, bools and nil), or, for strings, indices into the program's table of
+//  strings, or, for records and arrays, addresses in the program's heap of words (0 is nil).
+//  A record's fields are at the offsets the HERA code uses; an array is its length and then
+//  its elements.  A static link is the frame's position in the VM's stack of registers, so
+//  LOADF and STOREF can get at the variables of the functions it's nested in.
+//
+// The dispatch loop uses computed goto ("labels as values") when compiled with gcc or clang,
+//  or a switch otherwise (or if VM_SWITCH_DISPATCH is defined).
+
+enum VM_opcode {
+	VM_LOADK,     // a = constant b
+	VM_LOADS,     // a = string literal b (which, like LOADK, just puts b in a)
+	VM_MOVE,      // a = b
+	VM_ADD, VM_SUB, VM_MUL, VM_DIV,          // a = b op c
+	VM_EQ, VM_NE, VM_LT, VM_LE, VM_GT, VM_GE,  // a = (b op c)
+	VM_STRCMP,    // a = -1, 0 or 1, comparing strings b and c
+	VM_INCR,      // a = a + 1
+	VM_JUMP,      // to instruction a
+	VM_JUMPF,     // to instruction b if a is false (0)
+	VM_JUMPGT,    // to instruction c if a > b
+	VM_FP,        // a = this frame's position, to pass as a static link
+	VM_LOADF,     // a = register c of the frame at position b
+	VM_STOREF,    // register c of the frame at position b = a
+	VM_NEWREC,    // a = a new record of b words, all 0
+	VM_NEWARRAY,  // a = a new array of b elements, all c
+	VM_GETFIELD,  // a = word c of record b
+	VM_SETFIELD,  // word c of record b = a
+	VM_GETELEM,   // a = element c of array b
+	VM_SETELEM,   // element c of array b = a
+	VM_CALL,      // function a, with arguments in b, b+1, ... (and then its static link, if it takes one), result in c
+	VM_CALLLIB,   // library function a, with arguments in b, b+1, ..., result in c
+	VM_RET,       // return a (or nothing, if a is -1)
+	VM_HALT,
+	VM_number_of_opcodes
+};
+
+struct VM_instruction {
+	VM_opcode op;
+	int a, b, c;
+};
+
+struct VM_function {
+	string name;            // the unique name, as in the HERA code; the main program is "main"
+	int parameters = 0;
+	bool static_link = false;  // in the register after the parameters
+	int frame_size = 0;     // registers, including temporaries
+	std::vector<VM_instruction> code;
+};
+
+struct VM_program {
+	std::vector<VM_function> functions;  // functions[0] is the main program
+	std::vector<string> strings;         // the string literals
+	std::vector<int> outer_registers;    // those that LOADF and STOREF reach in other frames, so a CALL might read them
+};
+
+// The Tiger library functions the VM does itself, or -1 if there's no such function
+int VM_library_function(const string &name);
+int VM_library_parameters(int function);
+
+// What the operands of op are: r = register, k = constant, s = string literal, l = instruction, f = function, b = library function
+const char *VM_operands(VM_opcode op);
+
+// Run the program, sending what it prints to program_output; the exit status is that of its call to exit, if any.
+// Returns false (after an EM_error) if the program goes wrong at run time.
+bool VM_run(const VM_program &program, std::ostream &program_output, int &exit_status);
+
+string VM_disassemble(const VM_program &program);
+
+#endif
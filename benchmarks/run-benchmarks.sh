@@ -0,0 +1,109 @@
+#!/bin/sh
+# Measure the code we generate for the Tiger programs in this directory, using "tiger -sim",
+#  both without and with -O, and compare the numbers with those in baseline.txt.
+#
+# Usage: benchmarks/run-benchmarks.sh [-update] [path-to-tiger]     (default: Debug/tiger)
+#
+# For each program and mode ("plain", or "-O"), we check that its output matches name.expected
+#  (from the bytecode VM, "tiger -vm", too), and record
+#   static    instructions in the HERA program
+#   executed  instructions run by the simulator
+#   cycles    simulated cycles (see HERA_sim.h)
+#   memory    words loaded and stored
+#   frame     the largest stack frame any one function used, in words
+# Fails (exit status 1) if a program's output is wrong, or any number is more than
+#  THRESHOLD percent (default 2) worse than the baseline.  "-update" writes the new numbers
+#  into baseline.txt instead, e.g. after a change that is supposed to alter them.
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+UPDATE=no
+if test "$1" = "-update"
+then
+	UPDATE=yes
+	shift
+fi
+TIGER=${1:-$HERE/../Debug/tiger}
+THRESHOLD=${THRESHOLD:-2}
+BASELINE=$HERE/baseline.txt
+RESULTS=$(mktemp)
+OUT=$(mktemp)
+STATS=$(mktemp)
+trap 'rm -f $RESULTS $OUT $STATS' EXIT
+
+if test ! -x "$TIGER"
+then
+	echo "No tiger compiler at $TIGER (build it with make, or give its path)"
+	exit 2
+fi
+
+status=0
+echo "# benchmark mode static executed cycles memory frame" > $RESULTS
+for program in $HERE/*.tig
+do
+	name=$(basename $program .tig)
+	for mode in plain -O
+	do
+		flags=$(test $mode = plain || echo $mode)
+		if ! "$TIGER" $flags -sim $program > $OUT 2> $STATS
+		then
+			echo "$name $mode: FAILED to compile or run"
+			cat $STATS
+			status=1
+			continue
+		fi
+		if ! cmp -s $OUT $HERE/$name.expected
+		then
+			echo "$name $mode: WRONG OUTPUT"
+			diff $HERE/$name.expected $OUT | head -10
+			status=1
+		fi
+		if ! "$TIGER" $flags -vm $program 2> /dev/null | cmp -s - $HERE/$name.expected
+		then
+			echo "$name $mode: WRONG OUTPUT from -vm"
+			status=1
+		fi
+		awk -v name=$name -v mode=$mode '
+			/^HERA simulation:/ { static = $3; executed = $8; cycles = $10; memory = $12 + $14 }
+			table && $NF > frame { frame = $NF }
+			/^function/ { table = 1 }
+			END { print name, mode, static, executed, cycles, memory, frame + 0 }
+		' $STATS >> $RESULTS
+	done
+done
+
+if test $UPDATE = yes
+then
+	cp $RESULTS $BASELINE
+	echo "Updated $BASELINE"
+	cat $BASELINE
+	exit $status
+fi
+
+# compare with the baseline, one line per benchmark and mode
+awk -v threshold=$THRESHOLD '
+	FNR == 1 { file++ }
+	/^#/ { next }
+	file == 1 { for (i = 3; i <= 7; i++) old[$1, $2, i] = $i; known[$1, $2] = 1; next }
+	{
+		line = sprintf("%-16s %-5s", $1, $2)
+		if (!known[$1, $2]) {
+			printf "%s new benchmark (not in the baseline)\n", line
+			next
+		}
+		split("static executed cycles memory frame", metric, " ")
+		for (i = 3; i <= 7; i++) {
+			was = old[$1, $2, i]; now = $i
+			change = was == 0 ? (now == 0 ? 0 : 100) : 100 * (now - was) / was
+			flag = ""
+			if (change > threshold) { flag = " WORSE"; worse = 1 }
+			else if (change < -threshold) flag = " better"
+			line = line sprintf("  %s %d (%+.1f%%%s)", metric[i-2], now, change, flag)
+		}
+		print line
+	}
+	END { exit worse }
+' $BASELINE $RESULTS || {
+	echo "Some numbers are more than $THRESHOLD% worse than $BASELINE"
+	status=1
+}
+exit $status
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include "errormsg.h"
+#include "call_graph.h"
+#include "visitors/call_graph_visitor.h"
+#include "visitors/writes_visitor.h"
+
+// See call_graph.h for what this computes.
+
+static CG_graph the_call_graph;
+
+static int library_effects(const string &name)
+{
+	if (name == "print" || name == "println" || name == "printint" || name == "printbool" ||
+	    name == "putchar_ord" || name == "flush") {
+		return CG_output;
+	} else if (name == "getchar" || name == "getline" || name == "getint" || name == "getchar_ord" || name == "ungetchar") {
+		return CG_input;
+	} else if (name == "exit") {
+		return CG_exit;
+	} else if (name == "div" || name == "mod" || name == "substring") {
+		return CG_may_fail;
+	} else if (name == "malloc" || name == "free") {
+		return CG_memory;
+	} else if (name == "ord" || name == "chr" || name == "size" || name == "concat" || name == "tstrcmp") {
+		return 0;
+	}
+	return CG_memory | CG_may_fail;  // a library function we don't know about
+}
+
+string CG_summary::describe_effects() const
+{
+	if (pure()) {
+		return "pure";
+	} else if (reads_only()) {
+		return "reads only";
+	}
+	std::vector<string> parts;
+	if (effects & CG_reads_outer)  parts.push_back("reads outer variables");
+	if (effects & CG_writes_outer) parts.push_back("writes outer variables");
+	if (effects & (CG_input | CG_output)) {
+		string via = "";
+		for (const string &f : io) {
+			via += (via == "" ? "" : "/") + f;
+		}
+		parts.push_back("does I/O via " + via);
+	}
+	if (effects & CG_exit)         parts.push_back("may exit");
+	if (effects & CG_may_fail)     parts.push_back("may fail");
+	if (effects & CG_memory)       parts.push_back("uses the heap");
+	if (effects & CG_may_loop)     parts.push_back("might not terminate");
+	string result = "";
+	for (const string &part : parts) {
+		result += (result == "" ? "" : ", ") + part;
+	}
+	return result;
+}
+
+const CG_summary *CG_graph::find(const string &name) const
+{
+	auto found = functions.find(name);
+	return found == functions.end() ? 0 : &found->second;
+}
+
+bool CG_writes::declares(AST_node_ *loop, AST_node_ *declaration) const
+{
+	auto found = declared.find(loop);
+	return found != declared.end() && found->second.count(declaration) > 0;
+}
+
+bool CG_writes::might_change(AST_node_ *loop, AST_node_ *declaration) const
+{
+	auto found = assigned.find(loop);
+	return (found != assigned.end() && found->second.count(declaration) > 0) ||
+	       (written_by_nested.count(declaration) > 0 && calls_writer.count(loop) > 0);
+}
+
+std::set<string> CG_graph::reachable_from_main() const
+{
+	std::set<string> reachable = {"main"};
+	std::vector<string> to_do = {"main"};
+	while (!to_do.empty()) {
+		const CG_summary *caller = find(to_do.back());
+		to_do.pop_back();
+		for (const string &callee : caller->callees) {
+			if (reachable.insert(callee).second) {
+				to_do.push_back(callee);
+			}
+		}
+	}
+	return reachable;
+}
+
+string CG_graph::dump() const
+{
+	std::ostringstream out;
+	out << "Call graph: " << functions.size() << " functions, " << sccs << " strongly connected components\n";
+	for (auto &entry : functions) {
+		const CG_summary &f = entry.second;
+		out << f.name << (f.library ? " (library)" : "") << ": scc " << f.scc
+		    << (f.recursive ? ", recursive" : "") << (f.leaf ? ", leaf" : "")
+		    << ", " << f.describe_effects() << "\n";
+		if (!f.callees.empty()) {
+			out << "    calls";
+			for (const string &callee : f.callees) {
+				out << " " << callee;
+			}
+			out << "\n";
+		}
+	}
+	return out.str();
+}
+
+
+// Tarjan's algorithm; it finishes each component after all the components it can reach,
+//  so "order" ends up with callees before their callers
+class CG_scc_finder {
+public:
+	CG_scc_finder(CG_graph &graph) : graph(graph) { }
+
+	std::vector<std::vector<string> > order;
+
+	void run() {
+		for (auto &entry : graph.functions) {
+			if (index.count(entry.first) == 0) {
+				visit(entry.first);
+			}
+		}
+	}
+private:
+	CG_graph &graph;
+	std::map<string, int> index, lowlink;
+	std::vector<string> stack;
+	std::set<string> on_stack;
+	int next_index = 0;
+
+	void visit(const string &f) {
+		index[f] = lowlink[f] = next_index++;
+		stack.push_back(f);
+		on_stack.insert(f);
+		for (const string &callee : graph.functions[f].callees) {
+			if (index.count(callee) == 0) {
+				visit(callee);
+				lowlink[f] = std::min(lowlink[f], lowlink[callee]);
+			} else if (on_stack.count(callee)) {
+				lowlink[f] = std::min(lowlink[f], index[callee]);
+			}
+		}
+		if (lowlink[f] == index[f]) {
+			std::vector<string> component;
+			string member;
+			do {
+				member = stack.back();
+				stack.pop_back();
+				on_stack.erase(member);
+				component.push_back(member);
+			} while (member != f);
+			order.push_back(component);
+		}
+	}
+};
+
+const CG_graph &CG_build(A_root_ *root)
+{
+	the_call_graph = CG_graph();
+	CG_graph &graph = the_call_graph;
+	CallGraphVisitor visitor(graph);
+	visitor.accept(root, VoidContext());
+
+	// the library functions that get called
+	std::vector<string> called;
+	for (auto &entry : graph.functions) {
+		for (const string &callee : entry.second.callees) {
+			called.push_back(callee);
+		}
+	}
+	for (const string &callee : called) {
+		if (graph.functions.count(callee) == 0) {
+			CG_summary &library = graph.functions[callee];
+			library.name = callee;
+			library.library = true;
+			library.own_effects = library_effects(callee);
+			if (library.own_effects & (CG_input | CG_output)) {
+				library.io.insert(callee);
+			}
+		}
+	}
+
+	CG_scc_finder sccs(graph);
+	sccs.run();
+	for (const std::vector<string> &component : sccs.order) {
+		int scc = graph.sccs++;
+		int effects = 0;
+		std::set<string> io;
+		bool recursive = component.size() > 1;
+		for (const string &name : component) {
+			CG_summary &f = graph.functions[name];
+			effects |= f.own_effects;
+			io.insert(f.io.begin(), f.io.end());
+			for (const string &callee : f.callees) {
+				const CG_summary &g = graph.functions[callee];
+				if (callee == name) {
+					recursive = true;
+				}
+				effects |= g.effects;  // 0 until we finish this component, for callees in it
+				io.insert(g.io.begin(), g.io.end());
+			}
+		}
+		if (recursive) {
+			effects |= CG_may_loop;
+		}
+		for (const string &name : component) {
+			CG_summary &f = graph.functions[name];
+			f.scc = scc;
+			f.recursive = recursive;
+			f.leaf = f.callees.empty();
+			f.effects = name == "main" ? effects & ~(CG_reads_outer | CG_writes_outer) : effects;  // nothing's outside main
+			f.io = io;
+		}
+	}
+
+	for (auto &entry : graph.functions) {
+		if (entry.second.fundec) {
+			entry.second.fundec->set_call_graph_summary(&entry.second);
+		}
+	}
+	for (A_callExp_ *call : visitor.call_sites) {
+		call->set_call_graph_summary(graph.find(call->get_my_unique_function_name()));
+	}
+
+	WritesVisitor writes_visitor(graph.writes);  // which needs the summaries of the calls
+	writes_visitor.accept(root, VoidContext());
+	EM_DEBUG(EM_general, "Built the call graph: " + std::to_string(graph.functions.size()) + " functions");
+	return graph;
+}
+
+AST_node_ *CG_declaration_of(A_simpleVar_ *var)
+{
+	ST<var_info> library = var->get_local_variable_library();
+	return is_name_there(var->get_sym(), library) ? lookup(var->get_sym(), library).my_declaration() : 0;
+}
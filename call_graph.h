@@ -0,0 +1,85 @@
+#if ! defined _CALL_GRAPH_H
+#define _CALL_GRAPH_H 1
+
+#include <map>
+#include <set>
+#include "util.h"
+
+class AST_node_;
+class A_root_;
+class A_fundec_;
+class A_simpleVar_;
+
+// The whole program's call graph (built by CG_build, with visitors/call_graph_visitor.h), with
+//  a summary for each function: what it calls, whether it's recursive, whether it's a leaf, and
+//  what side effects it (or anything it calls) can have.
+// Each A_fundec_ and A_callExp_ gets a pointer to its function's summary as an attribute
+//  (get_call_graph_summary); the -callgraph flag in tiger.cc prints the whole graph.
+// The graph also says which loops and functions assign to which variables (CG_writes, found with
+//  visitors/writes_visitor.h once the summaries are done), for the optimizations that need to know
+//  a variable keeps its value (see optimize.h).
+
+enum CG_effect {
+	CG_reads_outer  = 1,    // reads a variable declared outside the function
+	CG_writes_outer = 2,    // assigns to one
+	CG_input        = 4,    // getchar, getline, ...
+	CG_output       = 8,    // print, printint, ...
+	CG_exit         = 16,
+	CG_may_fail     = 32,   // division, div, mod or substring, which can stop the program with an error
+	CG_memory       = 64,   // malloc, free, records and arrays
+	CG_may_loop     = 128,  // has a while loop or is recursive, so might not terminate
+};
+
+struct CG_summary {
+	string name;              // the unique name; "main" for the main program, and plain names for library functions
+	A_fundec_ *fundec = 0;    // 0 for main and the library
+	bool library = false;
+	std::set<string> callees;
+	int scc = -1;             // functions in the same strongly connected component can call each other
+	bool recursive = false;   // can call itself, directly or not
+	bool leaf = true;         // calls nothing at all, not even the library
+	int own_effects = 0;      // CG_effects of its own code
+	int effects = 0;          // ... and of everything it calls
+	std::set<string> io;      // the library functions it does input or output with, itself or through its callees
+
+	bool pure() const { return effects == 0; }
+	bool reads_only() const { return effects == CG_reads_outer; }
+	string describe_effects() const;  // e.g. "pure", "reads only", or "does I/O via print/getchar, may fail"
+};
+
+// Variables are known by their declarations: an A_varDec_, an A_forExp_ for its loop variable, or
+//  an A_field_ for a parameter (see CG_declaration_of). A variable can only be changed behind a
+//  function's back by a nested function, through the static link, and so only by a call of
+//  something that has CG_writes_outer (there are no pointers to variables in Tiger).
+// Loops are A_whileExp_s and A_forExp_s, and only count what's in their own function.
+struct CG_writes {
+	std::map<AST_node_ *, A_fundec_ *> declared_in;            // declaration -> its function, 0 for main
+	std::map<AST_node_ *, std::set<AST_node_ *> > declared;    // loop -> the declarations inside it, and a for loop's variable
+	std::map<AST_node_ *, std::set<AST_node_ *> > assigned;    // loop -> the declarations of variables it assigns to
+	std::set<AST_node_ *> assigned_anywhere;                   // declarations of variables assigned at all
+	std::set<AST_node_ *> written_by_nested;                   // declarations of variables assigned by a nested function
+	std::set<AST_node_ *> calls_writer;                        // loops that call a function that writes outer variables
+
+	bool declares(AST_node_ *loop, AST_node_ *declaration) const;
+	bool might_change(AST_node_ *loop, AST_node_ *declaration) const;  // by assigning to it, or calling something that might
+};
+
+struct CG_graph {
+	std::map<string, CG_summary> functions;  // by name
+	int sccs = 0;
+	CG_writes writes;
+
+	const CG_summary *find(const string &name) const;
+	std::set<string> reachable_from_main() const;  // including "main"
+	string dump() const;
+};
+
+// Builds the call graph of a typechecked program, and attaches the summaries to its nodes.
+// The graph lasts until the next call of CG_build.
+const CG_graph &CG_build(A_root_ *root);
+
+// The declaration of a variable, from the var_info VariableLibraryVisitor gave it, or 0 if it has
+//  none (the typechecker will have complained).
+AST_node_ *CG_declaration_of(A_simpleVar_ *var);
+
+#endif
@@ -0,0 +1,503 @@
+#include <algorithm>
+#include <cassert>
+#include <set>
+#include <sstream>
+#include "errormsg.h"
+#include "dataflow.h"
+
+// See dataflow.h for what these do.
+
+void DF_bitset::set_all()
+{
+	std::fill(words.begin(), words.end(), ~uint64_t(0));
+	if (size % 64 != 0) {  // keep the unused bits clear, so == works
+		words.back() = (uint64_t(1) << (size % 64)) - 1;
+	}
+}
+
+int DF_bitset::count() const
+{
+	int n = 0;
+	for (uint64_t word : words) {
+		n += __builtin_popcountll(word);
+	}
+	return n;
+}
+
+void DF_bitset::union_with(const DF_bitset &other)
+{
+	for (unsigned int i = 0; i < words.size(); i++) {
+		words[i] |= other.words[i];
+	}
+}
+
+void DF_bitset::intersect_with(const DF_bitset &other)
+{
+	for (unsigned int i = 0; i < words.size(); i++) {
+		words[i] &= other.words[i];
+	}
+}
+
+void DF_bitset::subtract(const DF_bitset &other)
+{
+	for (unsigned int i = 0; i < words.size(); i++) {
+		words[i] &= ~other.words[i];
+	}
+}
+
+string DF_bitset::__repr__() const
+{
+	string result = "{";
+	for (int i = 0; i < size; i++) {
+		if (test(i)) {
+			result += (result == "{" ? "" : ", ") + std::to_string(i);
+		}
+	}
+	return result + "}";
+}
+
+
+void DF_graph::add_edge(int from, int to)
+{
+	blocks[from].successors.push_back(to);
+	blocks[to].predecessors.push_back(from);
+}
+
+std::vector<int> DF_graph::reverse_postorder(bool backward) const
+{
+	int n = blocks.size();
+	std::vector<int> postorder;
+	std::vector<bool> visited(n, false);
+	std::vector<std::pair<int, unsigned int> > stack;  // block, and how many of its edges we've followed
+
+	// forward, start from the entry; backward, from the exits; then anything we missed (unreachable, or an endless loop)
+	std::vector<int> starts;
+	for (int b = 0; b < n; b++) {
+		if (backward ? blocks[b].successors.empty() : b == 0) {
+			starts.push_back(b);
+		}
+	}
+	for (int b = 0; b < n; b++) {
+		starts.push_back(b);
+	}
+
+	for (int start : starts) {
+		if (visited[start]) {
+			continue;
+		}
+		visited[start] = true;
+		stack.push_back(std::make_pair(start, 0));
+		while (!stack.empty()) {
+			int b = stack.back().first;
+			const std::vector<int> &next = backward ? blocks[b].predecessors : blocks[b].successors;
+			if (stack.back().second < next.size()) {
+				int n = next[stack.back().second++];
+				if (!visited[n]) {
+					visited[n] = true;
+					stack.push_back(std::make_pair(n, 0));
+				}
+			} else {
+				postorder.push_back(b);
+				stack.pop_back();
+			}
+		}
+	}
+	std::reverse(postorder.begin(), postorder.end());
+	return postorder;
+}
+
+
+DF_bitset DF_problem::transfer(int block, const DF_bitset &input) const
+{
+	DF_bitset output = input;
+	output.subtract(kill[block]);
+	output.union_with(gen[block]);
+	return output;
+}
+
+DF_result DF_solve(const DF_graph &graph, const DF_problem &problem)
+{
+	bool backward = problem.direction == DF_backward;
+	int n = graph.blocks.size();
+	std::vector<int> order = graph.reverse_postorder(backward);
+	std::vector<int> position(n);
+	for (int i = 0; i < n; i++) {
+		position[order[i]] = i;
+	}
+
+	// "before" is what flows into a block (its in, forward, or its out, backward), "after" what flows out
+	DF_bitset boundary = problem.boundary.length() == problem.facts ? problem.boundary : DF_bitset(problem.facts);
+	DF_bitset top(problem.facts);
+	if (problem.meet == DF_intersection) {
+		top.set_all();
+	}
+	std::vector<DF_bitset> before(n, DF_bitset(problem.facts)), after(n, top);
+
+	std::set<int> worklist;  // positions in order, so we take blocks in (reverse) postorder
+	for (int i = 0; i < n; i++) {
+		worklist.insert(i);
+	}
+	int steps = 0;
+	while (!worklist.empty()) {
+		int b = order[*worklist.begin()];
+		worklist.erase(worklist.begin());
+		steps++;
+
+		const DF_block &block = graph.blocks[b];
+		const std::vector<int> &sources = backward ? block.successors : block.predecessors;
+		bool at_boundary = backward ? block.successors.empty() : b == 0;
+		DF_bitset input = at_boundary || sources.empty() ? boundary : after[sources[0]];
+		for (int source : sources) {
+			if (problem.meet == DF_union) {
+				input.union_with(after[source]);
+			} else {
+				input.intersect_with(after[source]);
+			}
+		}
+		before[b] = input;
+
+		DF_bitset output = problem.transfer(b, input);
+		if (output != after[b]) {
+			after[b] = output;
+			for (int next : backward ? block.predecessors : block.successors) {
+				worklist.insert(position[next]);
+			}
+		}
+	}
+
+	DF_result result;
+	result.in = backward ? after : before;
+	result.out = backward ? before : after;
+	result.steps = steps;
+	return result;
+}
+
+
+DF_graph VM_flow_graph(const VM_function &function)
+{
+	int n = function.code.size();
+	std::vector<bool> leader(n + 1, false);
+	leader[0] = true;
+	for (int i = 0; i < n; i++) {
+		const VM_instruction &inst = function.code[i];
+		switch (inst.op) {
+		case VM_JUMP:   leader[inst.a] = true; leader[i + 1] = true; break;
+		case VM_JUMPF:  leader[inst.b] = true; leader[i + 1] = true; break;
+		case VM_JUMPGT: leader[inst.c] = true; leader[i + 1] = true; break;
+		case VM_RET:
+		case VM_HALT:   leader[i + 1] = true; break;
+		default: break;
+		}
+	}
+
+	DF_graph graph;
+	std::vector<int> block_of(n + 1, -1);
+	for (int i = 0; i < n; i++) {
+		if (leader[i]) {
+			if (!graph.blocks.empty()) {
+				graph.blocks.back().last = i;
+			}
+			graph.blocks.push_back(DF_block());
+			graph.blocks.back().first = i;
+		}
+		block_of[i] = graph.blocks.size() - 1;
+	}
+	if (!graph.blocks.empty()) {
+		graph.blocks.back().last = n;
+	}
+
+	for (unsigned int b = 0; b < graph.blocks.size(); b++) {
+		const VM_instruction &last = function.code[graph.blocks[b].last - 1];
+		bool falls_through = last.op != VM_JUMP && last.op != VM_RET && last.op != VM_HALT;
+		if (last.op == VM_JUMP)   graph.add_edge(b, block_of[last.a]);
+		if (last.op == VM_JUMPF)  graph.add_edge(b, block_of[last.b]);
+		if (last.op == VM_JUMPGT) graph.add_edge(b, block_of[last.c]);
+		if (falls_through && b + 1 < graph.blocks.size()) {
+			graph.add_edge(b, b + 1);
+		}
+	}
+	return graph;
+}
+
+void VM_uses_and_defs(const VM_program &program, const VM_instruction &inst, std::vector<int> &uses, std::vector<int> &defs)
+{
+	uses.clear();
+	defs.clear();
+	switch (inst.op) {
+	case VM_LOADK:
+	case VM_LOADS:
+		defs.push_back(inst.a);
+		break;
+	case VM_MOVE:
+		uses.push_back(inst.b);
+		defs.push_back(inst.a);
+		break;
+	case VM_INCR:
+		uses.push_back(inst.a);
+		defs.push_back(inst.a);
+		break;
+	case VM_JUMPF:
+		uses.push_back(inst.a);
+		break;
+	case VM_JUMPGT:
+		uses.push_back(inst.a);
+		uses.push_back(inst.b);
+		break;
+	case VM_FP:
+	case VM_NEWREC:
+		defs.push_back(inst.a);
+		break;
+	case VM_LOADF:
+	case VM_GETFIELD:
+		uses.push_back(inst.b);
+		defs.push_back(inst.a);
+		break;
+	case VM_STOREF:
+	case VM_SETFIELD:
+		uses.push_back(inst.a);
+		uses.push_back(inst.b);
+		break;
+	case VM_SETELEM:
+		uses.push_back(inst.a);
+		uses.push_back(inst.b);
+		uses.push_back(inst.c);
+		break;
+	case VM_CALL:
+	case VM_CALLLIB: {
+		int n = inst.op == VM_CALL ? program.functions[inst.a].parameters + program.functions[inst.a].static_link
+		                           : VM_library_parameters(inst.a);
+		for (int i = 0; i < n; i++) {
+			uses.push_back(inst.b + i);
+		}
+		if (inst.op == VM_CALL) {
+			uses.insert(uses.end(), program.outer_registers.begin(), program.outer_registers.end());
+		}
+		if (inst.c >= 0) {
+			defs.push_back(inst.c);
+		}
+		break;
+	}
+	case VM_RET:
+		if (inst.a >= 0) {
+			uses.push_back(inst.a);
+		}
+		break;
+	case VM_JUMP:
+	case VM_HALT:
+	case VM_number_of_opcodes:
+		break;
+	default:  // a = b op c
+		uses.push_back(inst.b);
+		uses.push_back(inst.c);
+		defs.push_back(inst.a);
+		break;
+	}
+}
+
+DF_result VM_liveness(const VM_program &program, const VM_function &function, const DF_graph &graph)
+{
+	DF_problem liveness(DF_backward, DF_union, function.frame_size);
+	std::vector<int> uses, defs;
+	for (const DF_block &block : graph.blocks) {
+		DF_bitset gen(function.frame_size), kill(function.frame_size);  // used before being set, and set
+		for (int i = block.last - 1; i >= block.first; i--) {
+			VM_uses_and_defs(program, function.code[i], uses, defs);
+			for (int d : defs) {
+				gen.reset(d);
+				kill.set(d);
+			}
+			for (int u : uses) {
+				if (u < function.frame_size) {  // not one of outer_registers that this frame doesn't have
+					gen.set(u);
+				}
+			}
+		}
+		liveness.gen.push_back(gen);
+		liveness.kill.push_back(kill);
+	}
+	return DF_solve(graph, liveness);
+}
+
+DF_result VM_reaching_definitions(const VM_program &program, const VM_function &function, const DF_graph &graph)
+{
+	int n = function.code.size();
+	std::vector<int> uses, defs;
+	std::vector<DF_bitset> defs_of(function.frame_size, DF_bitset(n));  // for each register, the instructions that set it
+	for (int i = 0; i < n; i++) {
+		VM_uses_and_defs(program, function.code[i], uses, defs);
+		for (int d : defs) {
+			defs_of[d].set(i);
+		}
+	}
+
+	DF_problem reaching(DF_forward, DF_union, n);
+	for (const DF_block &block : graph.blocks) {
+		DF_bitset gen(n), kill(n);
+		for (int i = block.first; i < block.last; i++) {
+			VM_uses_and_defs(program, function.code[i], uses, defs);
+			for (int d : defs) {
+				gen.subtract(defs_of[d]);
+				gen.set(i);
+				kill.union_with(defs_of[d]);
+			}
+		}
+		reaching.gen.push_back(gen);
+		reaching.kill.push_back(kill);
+	}
+	return DF_solve(graph, reaching);
+}
+
+// Does the instruction do nothing but put a value in a register?  (DIV, GETFIELD and so on can stop the program)
+static bool VM_only_computes(const VM_instruction &inst)
+{
+	switch (inst.op) {
+	case VM_LOADK: case VM_LOADS: case VM_MOVE: case VM_ADD: case VM_SUB: case VM_MUL:
+	case VM_EQ: case VM_NE: case VM_LT: case VM_LE: case VM_GT: case VM_GE: case VM_STRCMP:
+	case VM_INCR: case VM_FP: case VM_LOADF: case VM_NEWREC:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// One pass over a function; returns how many instructions it left out
+static int VM_remove_dead_stores(const VM_program &program, VM_function &function)
+{
+	DF_graph graph = VM_flow_graph(function);
+	DF_result live = VM_liveness(program, function, graph);
+	int n = function.code.size();
+	std::vector<bool> dead(n, false);
+	std::vector<int> uses, defs;
+	for (unsigned int b = 0; b < graph.blocks.size(); b++) {
+		DF_bitset now = live.out[b];  // live after instruction i, going backward through the block
+		for (int i = graph.blocks[b].last - 1; i >= graph.blocks[b].first; i--) {
+			VM_uses_and_defs(program, function.code[i], uses, defs);
+			if (VM_only_computes(function.code[i]) && !now.test(defs[0])) {
+				dead[i] = true;
+				continue;
+			}
+			for (int d : defs) {
+				now.reset(d);
+			}
+			for (int u : uses) {
+				if (u < function.frame_size) {
+					now.set(u);
+				}
+			}
+		}
+	}
+
+	// an instruction's new number is how many we keep ahead of it, which is also where a jump to it should now go
+	std::vector<int> new_number(n + 1, 0);
+	std::vector<VM_instruction> kept;
+	for (int i = 0; i < n; i++) {
+		new_number[i] = kept.size();
+		if (!dead[i]) {
+			kept.push_back(function.code[i]);
+		}
+	}
+	new_number[n] = kept.size();
+	for (VM_instruction &inst : kept) {
+		if (inst.op == VM_JUMP)   inst.a = new_number[inst.a];
+		if (inst.op == VM_JUMPF)  inst.b = new_number[inst.b];
+		if (inst.op == VM_JUMPGT) inst.c = new_number[inst.c];
+	}
+	int removed = n - kept.size();
+	function.code = kept;
+	return removed;
+}
+
+int VM_remove_dead_stores(VM_program &program, std::ostream *report)
+{
+	int total = 0;
+	for (VM_function &function : program.functions) {
+		int removed = 0, more;
+		while ((more = VM_remove_dead_stores(program, function)) > 0) {  // again, for what fed only those
+			removed += more;
+		}
+		if (removed > 0 && report) {
+			*report << "bytecode for " << function.name << ": removed " << removed << " instruction(s) whose values are never used\n";
+		}
+		total += removed;
+	}
+	return total;
+}
+
+string VM_dataflow_report(const VM_program &program)
+{
+	std::ostringstream out;
+	for (const VM_function &function : program.functions) {
+		DF_graph graph = VM_flow_graph(function);
+		DF_result live = VM_liveness(program, function, graph);
+		DF_result reaching = VM_reaching_definitions(program, function, graph);
+		out << function.name << ": " << graph.blocks.size() << " blocks (liveness took " << live.steps
+		    << " steps, reaching definitions " << reaching.steps << ")\n";
+		for (unsigned int b = 0; b < graph.blocks.size(); b++) {
+			const DF_block &block = graph.blocks[b];
+			out << "  block " << b << ", instructions " << block.first << "-" << block.last - 1 << ", to";
+			for (int s : block.successors) {
+				out << " " << s;
+			}
+			out << "\n    live in " << repr(live.in[b]) << ", live out " << repr(live.out[b])
+			    << "\n    definitions reaching it " << repr(reaching.in[b]) << "\n";
+		}
+	}
+	return out.str();
+}
+
+
+void DF_test()
+{
+	// i := 0; n := 10; while i < n do i := i + 1; printint(i), in bytecode
+	VM_program program;
+	program.functions.push_back(VM_function());
+	VM_function &main = program.functions[0];
+	main.name = "main";
+	main.frame_size = 3;
+	int printint = VM_library_function("printint");
+	main.code = {
+		{VM_LOADK, 0, 0, -1}, {VM_LOADK, 1, 10, -1},      // block 0
+		{VM_LT, 2, 0, 1}, {VM_JUMPF, 2, 6, -1},          // block 1
+		{VM_INCR, 0, -1, -1}, {VM_JUMP, 2, -1, -1},      // block 2
+		{VM_CALLLIB, printint, 0, -1}, {VM_HALT, -1, -1, -1},  // block 3
+	};
+
+	DF_graph graph = VM_flow_graph(main);
+	assert(graph.blocks.size() == 4);
+	assert(graph.blocks[1].first == 2 && graph.blocks[1].last == 4);
+	assert(graph.blocks[1].successors.size() == 2 && graph.blocks[1].predecessors.size() == 2);
+	assert(graph.blocks[3].successors.empty());
+	std::vector<int> order = graph.reverse_postorder(false);
+	assert(order[0] == 0 && order[1] == 1);
+
+	DF_result live = VM_liveness(program, main, graph);
+	assert(repr(live.in[0]) == "{}" && repr(live.out[0]) == "{0, 1}");
+	assert(repr(live.in[1]) == "{0, 1}" && repr(live.out[1]) == "{0, 1}");
+	assert(repr(live.in[2]) == "{0, 1}");
+	assert(repr(live.in[3]) == "{0}" && repr(live.out[3]) == "{}");
+
+	DF_result reaching = VM_reaching_definitions(program, main, graph);
+	assert(repr(reaching.in[0]) == "{}");
+	assert(repr(reaching.in[1]) == "{0, 1, 2, 4}");
+	assert(repr(reaching.out[2]) == "{1, 2, 4}");
+	assert(repr(reaching.in[3]) == "{0, 1, 2, 4}");
+
+	// dominators, to try an intersection problem: block b dominates itself and whatever dominates all its predecessors
+	DF_problem dominators(DF_forward, DF_intersection, 4);
+	for (int b = 0; b < 4; b++) {
+		dominators.gen.push_back(DF_bitset(4));
+		dominators.gen[b].set(b);
+		dominators.kill.push_back(DF_bitset(4));
+	}
+	DF_result dominated = DF_solve(graph, dominators);
+	assert(repr(dominated.out[2]) == "{0, 1, 2}");
+	assert(repr(dominated.out[3]) == "{0, 1, 3}");
+
+	DF_bitset big(1000);
+	big.set_all();
+	assert(big.count() == 1000);
+	big.reset(999);
+	assert(big.count() == 999 && !big.test(999) && big.test(998));
+
+	EM_DEBUG(EM_general, "DF_test passed");
+}
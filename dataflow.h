@@ -0,0 +1,105 @@
+#if ! defined _DATAFLOW_H
+#define _DATAFLOW_H 1
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "util.h"
+#include "VM.h"
+
+// A framework for dataflow analysis over basic blocks, and two analyses built on it for the
+//  bytecode of VM.h: liveness of registers, and reaching definitions.
+//
+// A problem says which way information flows, how to combine it where paths meet, and how each
+//  block transforms it; DF_solve then iterates to the fixed point with a worklist, taking blocks
+//  in reverse postorder (of the flow graph for forward problems, of the reversed graph for
+//  backward ones), so that most blocks see their predecessors' final values first.
+// The facts are dense bitsets, so each step is a few word operations per 64 facts.
+
+class DF_bitset {
+public:
+	DF_bitset(int size = 0) : size(size), words((size + 63) / 64, 0) { }
+
+	int length() const { return size; }
+	bool test(int i) const { return (words[i / 64] >> (i % 64)) & 1; }
+	void set(int i)    { words[i / 64] |= uint64_t(1) << (i % 64); }
+	void reset(int i)  { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+	void set_all();
+	int count() const;
+
+	void union_with(const DF_bitset &other);
+	void intersect_with(const DF_bitset &other);
+	void subtract(const DF_bitset &other);
+	bool operator==(const DF_bitset &other) const { return words == other.words; }
+	bool operator!=(const DF_bitset &other) const { return words != other.words; }
+
+	string __repr__() const;  // e.g. "{1, 4, 5}"
+private:
+	int size;
+	std::vector<uint64_t> words;
+};
+
+struct DF_block {
+	int first, last;  // instructions first ... last-1, for graphs that come from code
+	std::vector<int> successors, predecessors;
+};
+
+struct DF_graph {
+	std::vector<DF_block> blocks;  // blocks[0] is the entry
+	void add_edge(int from, int to);
+	std::vector<int> reverse_postorder(bool backward) const;  // backward: of the reversed graph, from the exits
+};
+
+enum DF_direction { DF_forward, DF_backward };
+enum DF_meet { DF_union, DF_intersection };
+
+// A gen/kill problem: out = gen + (in - kill) for a forward problem (in = gen + (out - kill) for a
+//  backward one); anything fancier can override transfer.
+class DF_problem {
+public:
+	DF_problem(DF_direction direction, DF_meet meet, int facts) : direction(direction), meet(meet), facts(facts) { }
+	virtual ~DF_problem() { }
+
+	DF_direction direction;
+	DF_meet meet;
+	int facts;                   // bits in each set
+	std::vector<DF_bitset> gen, kill;  // per block
+	DF_bitset boundary;          // what holds on entry to the graph (forward) or exit from it (backward); empty by default
+
+	virtual DF_bitset transfer(int block, const DF_bitset &input) const;
+};
+
+struct DF_result {
+	std::vector<DF_bitset> in, out;  // per block: at its start and at its end, whichever way the problem flows
+	int steps = 0;                   // blocks taken off the worklist
+};
+
+DF_result DF_solve(const DF_graph &graph, const DF_problem &problem);
+
+
+// The bytecode's flow graph: a block starts at each jump target and after each jump or return
+DF_graph VM_flow_graph(const VM_function &function);
+
+// The registers an instruction reads and writes (a CALL reads all its arguments and the static link, and
+//  the caller's registers that a nested function might reach through it, from program.outer_registers)
+void VM_uses_and_defs(const VM_program &program, const VM_instruction &inst, std::vector<int> &uses, std::vector<int> &defs);
+
+// Which registers are live (one bit per register) at the start and end of each block
+DF_result VM_liveness(const VM_program &program, const VM_function &function, const DF_graph &graph);
+
+// Which definitions reach each block (one bit per instruction, set for those that write a register)
+DF_result VM_reaching_definitions(const VM_program &program, const VM_function &function, const DF_graph &graph);
+
+// For -O with -vm: leave out the instructions that just compute a value that is never read (by
+//  liveness), e.g. a store to a variable nothing uses, and then any that fed only those; returns how many
+//  went, and says which functions they came from on report (if it isn't 0)
+int VM_remove_dead_stores(VM_program &program, std::ostream *report);
+
+// For -d=codegen: each function's blocks, with what's live and which definitions reach them
+string VM_dataflow_report(const VM_program &program);
+
+// Internal consistency check, like ST_test: liveness and reaching definitions on small graphs we can work out by hand
+//  (tiger -test-dataflow, from tests/run-tests.sh)
+void DF_test();
+
+#endif
@@ -5,6 +5,7 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 using namespace std;
 #include "util.h"
 #include "errormsg.h"
@@ -15,6 +16,11 @@ static int EM_maxErrs;
 static bool EM_showingDebug;
 static bool EM_crashOnFatal;
 
+bool EM_debug_channel_on[EM_number_of_channels];
+static const char *EM_channel_names[EM_number_of_channels] = { "general", "parse", "visitors", "typecheck", "codegen", "cache" };
+static bool EM_channel_selected[EM_number_of_channels];
+static bool EM_any_channel_selected = false;
+
 static string fileName;
 static int lineNum;
 
@@ -40,6 +46,9 @@ void EM_reset(string fname, int max_errors, bool show_debug, bool crash_compiler
 	EM_maxErrs  = max_errors;
 	EM_showingDebug = show_debug;
 	EM_crashOnFatal = crash_compiler_on_fatal_error;
+	for (int c = 0; c < EM_number_of_channels; c++) {
+		EM_debug_channel_on[c] = show_debug && LOG_LEVEL <= 1 && (!EM_any_channel_selected || EM_channel_selected[c]);
+	}
 	//	EM_tokPos = 1;  not needed with location.hh, I hope...
 	fileName=fname;
 	lineNum=1;
@@ -99,13 +108,81 @@ static string EM_intpos_to_string(int position, const string &divider)
 }
 #endif
 
-static void EM_core(string message, Position pos, string level)
+// Messages wait here until EM_flush writes them all out at once
+struct EM_diagnostic {
+	string text;          // the whole line, as printed in the text format
+	string severity;      // "error", "warning", or "debug"
+	string phase;         // see EM_set_phase
+	string message;
+	Position position;
+};
+static std::vector<EM_diagnostic> EM_buffered;
+static EM_output_format EM_format = EM_text;
+static string EM_phase = "driver";
+
+void EM_set_output_format(EM_output_format format)
+{
+	EM_format = format;
+}
+
+void EM_set_phase(string phase)
+{
+	EM_phase = phase;
+}
+
+static string EM_json_string(const string &s)
+{
+	string result = "\"";
+	for (unsigned char c : s) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (c == '\n') {
+			result += "\\n";
+		} else if (c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof escaped, "\\u%04x", c);
+			result += escaped;
+		} else {
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+void EM_flush()
+{
+	if (EM_buffered.empty()) return;
+	string out;
+	for (EM_diagnostic &d : EM_buffered) {
+		if (EM_format == EM_json) {  // one object per line ("JSON lines"), since we may flush more than once
+			out += "{\"file\": " + EM_json_string(fileName) +
+			       ", \"line\": " + std::to_string(d.position.begin_line()) +
+			       ", \"column\": " + std::to_string(d.position.begin_column()) +
+			       ", \"end_line\": " + std::to_string(d.position.end_line()) +
+			       ", \"end_column\": " + std::to_string(d.position.end_column()) +
+			       ", \"severity\": " + EM_json_string(d.severity) +
+			       ", \"phase\": " + EM_json_string(d.phase) +
+			       ", \"message\": " + EM_json_string(d.message) + "}\n";
+		} else {
+			out += d.text + "\n";
+		}
+	}
+	EM_buffered.clear();
+	cerr << out << std::flush;
+}
+
+static void EM_core(string message, Position pos, string level, string severity)
 {
 #if USING_LOCATION_FROM_BISON
-	cerr << str(pos) << ": " << level << ": " << message << endl;
+	string text = str(pos) + ": " + level + ": " + message;
 #else
-	cerr << fileName << " " << str(pos) << ": " << level << ": " << message << endl;
+	string text = fileName + " " + str(pos) + ": " + level + ": " + message;
 #endif
+	EM_buffered.push_back(EM_diagnostic{text, severity, EM_phase, message, pos});
+	if (EM_showingDebug) {
+		EM_flush();  // when debugging the compiler, don't lose the messages leading up to a crash
+	}
 }
 
 void EM_error(string message, bool fatal, Position position, string level)
@@ -114,10 +191,18 @@ void EM_error(string message, bool fatal, Position position, string level)
 	//		position = EM_tokPos;
 	EM_errCount++;
 	if (LOG_LEVEL <= 3) {
-	    EM_core(message, position, level);
+	    EM_core(message, position, level, "error");
 	}
 	if (fatal || (EM_maxErrs > 0 && EM_errCount >= EM_maxErrs)) {
-		fprintf(stderr, "Giving up due to fatal error or too many errors\n");
+		string giving_up = "Giving up due to fatal error or too many errors";
+		if (EM_format == EM_json) {  // keep to one JSON object per line, from the driver
+			EM_phase = "driver";
+			EM_core(giving_up, position, level, "error");
+			EM_flush();
+		} else {
+			EM_flush();
+			fprintf(stderr, "%s\n", giving_up.c_str());
+		}
 		if (fatal && EM_crashOnFatal)
 			abort(); // get into the debugger, I hope
 		else
@@ -130,14 +215,34 @@ void EM_warning(string message, Position pos, string level)
 	//	if (position < 0)
 	//		position = EM_tokPos;
 	if (LOG_LEVEL <= 2) {
-        EM_core(message, pos, level);
+        EM_core(message, pos, level, "warning");
     }
 }
 
+bool EM_select_debug_channels(string channel_names)
+{
+	bool all_known = true;
+	size_t start = 0;
+	while (start <= channel_names.length()) {
+		size_t comma = channel_names.find(',', start);
+		if (comma == string::npos) comma = channel_names.length();
+		string name = channel_names.substr(start, comma - start);
+		int c = 0;
+		while (c < EM_number_of_channels && name != EM_channel_names[c]) c++;
+		if (c < EM_number_of_channels) {
+			EM_channel_selected[c] = EM_any_channel_selected = true;
+		} else {
+			all_known = false;
+		}
+		start = comma + 1;
+	}
+	return all_known;
+}
+
 void EM_debug(string message, Position pos, string level)
 {
 	if (EM_showingDebug && LOG_LEVEL <= 1) {
-		EM_core(message, pos, level);
+		EM_core(message, pos, level, "debug");
 	}
 }
 
@@ -157,21 +262,54 @@ Position Position::fromLex(ScannerPosition posAttributeInLex) {
 		it.l.end.filename   = &fileName; // @TODO: figure out why flex doesn't give this
 		static bool whinedAlready = false;
 		if (!whinedAlready) {
-			EM_debug("Huh, had to build Position from flex info that lacked file name, by using hack", it);
+			EM_DEBUG(EM_parse, "Huh, had to build Position from flex info that lacked file name, by using hack", it);
 			whinedAlready=true;
 		}
 	} else if (it.l.end.filename == 0) {
 		it.l.end.filename   = it.l.begin.filename;
-		EM_debug("Curiouser and curiouser ...  had to build Position from flex info that lacked file name BUT ONLY IN THE END", it);
+		EM_DEBUG(EM_parse, "Curiouser and curiouser ...  had to build Position from flex info that lacked file name BUT ONLY IN THE END", it);
 	} else if (it.l.begin.filename == 0) {
 		it.l.begin.filename = it.l.end.filename; 
-		EM_debug("Curiouser and curiouser! ... had to build Position from flex info that lacked file name BUT ONLY IN THE BEGIN", it);
+		EM_DEBUG(EM_parse, "Curiouser and curiouser! ... had to build Position from flex info that lacked file name BUT ONLY IN THE BEGIN", it);
 	}
 	return it;
 }
 Position Position::undefined() {
 	return Position();
 }
+Position Position::fromLinesAndColumns(int begin_line, int begin_column, int end_line, int end_column) {
+#if USING_LOCATION_FROM_BISON
+	Position it;
+	it.undef=false;
+	it.l.begin.filename = it.l.end.filename = &fileName;
+	it.l.begin.line = begin_line;
+	it.l.begin.column = begin_column;
+	it.l.end.line = end_line;
+	it.l.end.column = end_column;
+	return it;
+#else
+	return Position::range(Position::fromLex(begin_column), Position::fromLex(end_column));
+#endif
+}
+
+bool Position::is_undefined() const {
+#if USING_LOCATION_FROM_BISON
+	return undef;
+#else
+	return s < 0;
+#endif
+}
+#if USING_LOCATION_FROM_BISON
+int Position::begin_line() const   { return undef ? 0 : l.begin.line; }
+int Position::begin_column() const { return undef ? 0 : l.begin.column; }
+int Position::end_line() const     { return undef ? 0 : l.end.line; }
+int Position::end_column() const   { return undef ? 0 : l.end.column; }
+#else
+int Position::begin_line() const   { return 0; }
+int Position::begin_column() const { return s; }
+int Position::end_line() const     { return 0; }
+int Position::end_column() const   { return e; }
+#endif
 
 Position::Position()
 {
@@ -24,6 +24,14 @@ public:
 	static Position range(const Position &start, const Position &end); // range from one positino to another
 	static Position fromLex(ScannerPosition posAttributeInLex);        // convert from a "lex" token position
 	static Position undefined();                                       // what if there isn't one, e.g. AST_example()
+	static Position fromLinesAndColumns(int begin_line, int begin_column, int end_line, int end_column); // e.g. for AST-binary.cc
+
+	// the pieces of a position, e.g. for saving it (each is 0 for an undefined position)
+	bool is_undefined() const;
+	int begin_line() const;
+	int begin_column() const;
+	int end_line() const;
+	int end_column() const;
 
 	string __repr__();
 	string __str__();
@@ -47,13 +55,47 @@ void EM_error  (string message, bool fatal=false, Position position = Position::
 void EM_warning(string message, Position position = Position::undefined(), string level="__WARNING__");
 void EM_debug  (string message, Position position = Position::undefined(), string level="DEBUG");
 
+// Debugging output is split into channels, which -d=parse,codegen etc. turn on separately (plain -d turns on all of them).
+// Use EM_DEBUG(channel, message ...) rather than calling EM_debug directly: it only builds the message
+//  (all that string concatenation) if the channel is on, and a build with -DEM_DEBUG_COMPILED_IN=0
+//  (e.g. "make RELEASE=1") drops debugging output, and the work of formatting it, altogether.
+// Inside an AST node's methods, EM_DEBUG still calls the node's own EM_debug, which adds its position.
+enum EM_channel {
+	EM_general,    // the driver, symbol tables, AST examples, loading/saving
+	EM_parse,      // the parser (and Position fix-ups from the scanner)
+	EM_visitors,   // the tree walks in visitors/
+	EM_typecheck,
+	EM_codegen,    // HERA_code and HERA_data
+	EM_cache,      // the incremental-compilation cache (-i)
+	EM_number_of_channels
+};
+
+#if ! defined EM_DEBUG_COMPILED_IN
+#define EM_DEBUG_COMPILED_IN 1
+#endif
+
+extern bool EM_debug_channel_on[EM_number_of_channels];  // set by EM_reset; use EM_debugging to check
+inline bool EM_debugging(EM_channel channel) { return EM_DEBUG_COMPILED_IN && EM_debug_channel_on[channel]; }
+bool EM_select_debug_channels(string channel_names);  // comma-separated names, as for -d=...; false if one is unknown
+
+#define EM_DEBUG(channel, ...) do { if (EM_debugging(channel)) EM_debug(__VA_ARGS__); } while (0)
+
+// Errors, warnings and debugging output are kept in a buffer, and written to cerr all at once by EM_flush
+//  (at the end of the compilation, when giving up after an error, or right away if debugging output is on).
+// They can be written as text ("file:line.column: level: message") or as JSON, one object per line,
+//  with the file, line, column, end_line, end_column, severity, phase, and message.
+enum EM_output_format { EM_text, EM_json };
+void EM_set_output_format(EM_output_format format);
+void EM_set_phase(string phase);  // e.g. "parse" or "typecheck", for the JSON output
+void EM_flush();
+
 // In the end, did we record any errors?
 bool EM_recorded_any_errors();
 
 
 // Reset to start parsing a new file, count lines from 1
 //  max_errors is max # of errors to allow (or negative for never give up)
-//  show_debug controls printing of EM_debug messages
+//  show_debug controls printing of EM_debug messages (on the channels picked by EM_select_debug_channels, if any)
 //  crash_compiler_on_fatal_error can be turned on to cause fatal errors to call "abort", hopefully triggering debugger at that point
 
 void EM_reset(string filename, int max_errors=-1, bool show_debug=false, bool crash_compiler_on_fatal_error=false);
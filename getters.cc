@@ -82,30 +82,12 @@ AST_node_* A_subscriptVar_::get_exp() const {
     return _exp;
 }
 
-AST_node_* A_expList_::get_head() const {
-    return _head;
-}
-AST_node_* A_expList_::get_tail() const {
-    return _tail;
-}
 
 AST_node_* A_efield_::get_exp() const {
     return _exp;
 }
 
-AST_node_* A_efieldList_::get_head() const {
-    return _head;
-}
-AST_node_* A_efieldList_::get_tail() const {
-    return _tail;
-}
 
-AST_node_* A_decList_::get_head() const {
-    return _head;
-}
-AST_node_* A_decList_::get_tail() const {
-    return _tail;
-}
 
 // A_varDec_
 AST_node_* A_varDec_::get_init() const {
@@ -121,12 +103,6 @@ AST_node_* A_functionDec_::get_theFunctions() const {
     return theFunctions;
 }
 
-AST_node_* A_fundecList_::get_head() const {
-    return _head;
-}
-AST_node_* A_fundecList_::get_tail() const {
-    return _tail;
-}
 
 AST_node_* A_fundec_::get_params() const {
     return _params;
@@ -142,26 +118,8 @@ AST_node_* A_namety_::get_ty() const {
     return _ty;
 }
 
-AST_node_* A_nametyList_::get_head() const {
-    return _head;
-}
-AST_node_* A_nametyList_::get_tail() const {
-    return _tail;
-}
 
-AST_node_* A_fieldList_::get_head() const {
-    return _head;
-}
-AST_node_* A_fieldList_::get_tail() const {
-    return _tail;
-}
 
-A_field_* A_fieldList_::cast_head() const {
-    return _head;
-}
-A_fieldList_* A_fieldList_::cast_tail() const {
-    return _tail;
-}
 
 AST_node_* A_recordty_::get_record() const {
     return _record;
@@ -1,7 +1,12 @@
 #include "AST.h"
+#include "visitors/frame_layout_visitor.h"
 
+// Sets up the frames: after the static links (which change the size of a function's header),
+//  and before the variable library, which records where each variable went.
+// See visitors/frame_layout_visitor.h for how slots are shared.
 void layout_frames(AST_node_ *root)
 {
-	// do what it takes to set up frames
+	FrameLayoutVisitor frame_layout_visitor;
+	root->accept(frame_layout_visitor, VoidContext());
+	EM_DEBUG(EM_visitors, "Laid out the frames");
 }
-
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include "errormsg.h"
+#include "optimize.h"
+#include "call_graph.h"
+#include "visitors/dead_code_visitor.h"
+#include "visitors/bounds_check_visitor.h"
+#include "visitors/register_call_visitor.h"
+#include "visitors/loop_invariant_visitor.h"
+#include "visitors/value_number_visitor.h"
+#include "visitors/loop_unroll_visitor.h"
+#include "visitors/switch_visitor.h"
+
+// See optimize.h for what we optimize.
+
+static bool optimizing = false;
+static std::set<AST_node_*> dead_code, dead_stores;
+static std::set<AST_node_*> safe_subscripts;
+static std::map<AST_node_*, AST_node_*> hoisted_checks;
+static std::map<AST_node_*, std::vector<AST_node_*> > loop_arrays;
+static std::set<AST_node_*> register_functions;
+static std::map<AST_node_*, std::set<int> > spilled_parameters, held_arguments;
+static std::map<AST_node_*, int> hoisted_slots;
+static std::map<AST_node_*, std::vector<AST_node_*> > hoisted_expressions;
+static std::map<AST_node_*, int> kept_slots, reused_slots;
+static std::set<AST_node_*> frames_with_values;
+static std::map<AST_node_*, int> loop_trips;
+static std::map<AST_node_*, OPT_switch> switches;
+
+void OPT_optimize(A_root_ *root, std::ostream *report)
+{
+	optimizing = true;
+
+	const CG_graph &graph = CG_build(root);  // which functions have side effects, and which code writes which variables
+	DeadCodeVisitor dead_code_visitor;
+	dead_code_visitor.find(root, graph);
+	dead_code = dead_code_visitor.dead;
+	dead_stores = dead_code_visitor.dead_stores;
+	EM_DEBUG(EM_codegen, "Found " + std::to_string(dead_code.size() + dead_stores.size()) + " pieces of dead code");
+
+	BoundsCheckVisitor bounds_check_visitor;
+	bounds_check_visitor.find(root, graph);
+	safe_subscripts = bounds_check_visitor.safe;
+	hoisted_checks = bounds_check_visitor.hoisted;
+	loop_arrays = bounds_check_visitor.loop_arrays;
+	EM_DEBUG(EM_codegen, "Removed " + std::to_string(safe_subscripts.size()) + " bounds checks, and moved " +
+	                     std::to_string(hoisted_checks.size()) + " out of loops");
+
+	RegisterCallVisitor register_call_visitor;
+	register_call_visitor.find(root, graph);
+	register_functions = register_call_visitor.functions;
+	spilled_parameters = register_call_visitor.spilled;
+	held_arguments = register_call_visitor.held;
+	EM_DEBUG(EM_codegen, std::to_string(register_functions.size()) + " function(s) take arguments in registers");
+
+	LoopInvariantVisitor loop_invariant_visitor;  // after dead code, so it leaves out what isn't generated
+	loop_invariant_visitor.find(root, graph);
+	hoisted_slots = loop_invariant_visitor.slots;
+	hoisted_expressions = loop_invariant_visitor.hoisted;
+	frames_with_values.insert(loop_invariant_visitor.frames.begin(), loop_invariant_visitor.frames.end());
+	EM_DEBUG(EM_codegen, "Moved " + std::to_string(hoisted_slots.size()) + " loop-invariant expression(s) out of " +
+	                     std::to_string(hoisted_expressions.size()) + " loop(s)");
+
+	ValueNumberVisitor value_number_visitor;  // after the loops, so it leaves their hoisted expressions alone
+	value_number_visitor.find(root, graph);
+	kept_slots = value_number_visitor.kept;
+	reused_slots = value_number_visitor.reused;
+	frames_with_values.insert(value_number_visitor.frames.begin(), value_number_visitor.frames.end());
+	EM_DEBUG(EM_codegen, std::to_string(reused_slots.size()) + " expression(s) reuse the values of " +
+	                     std::to_string(kept_slots.size()) + " earlier one(s)");
+
+	LoopUnrollVisitor loop_unroll_visitor;
+	loop_unroll_visitor.find(root);
+	loop_trips = loop_unroll_visitor.trips;
+	EM_DEBUG(EM_codegen, std::to_string(loop_trips.size()) + " loop(s) run a constant number of times");
+
+	SwitchVisitor switch_visitor;  // after value numbering, so it knows which tests it keeps
+	switch_visitor.find(root);
+	switches = switch_visitor.switches;
+	EM_DEBUG(EM_codegen, std::to_string(switches.size()) + " chain(s) of ifs look at their variable once");
+
+	if (report) {
+		for (const string &line : dead_code_visitor.report) {
+			*report << line << "\n";
+		}
+		for (const string &line : bounds_check_visitor.report) {
+			*report << line << "\n";
+		}
+		for (const string &line : register_call_visitor.report) {
+			*report << line << "\n";
+		}
+		for (const string &line : loop_invariant_visitor.report) {
+			*report << line << "\n";
+		}
+		for (const string &line : value_number_visitor.report) {
+			*report << line << "\n";
+		}
+		for (const string &line : switch_visitor.report) {
+			*report << line << "\n";
+		}
+	}
+}
+
+bool OPT_enabled()
+{
+	return optimizing;
+}
+
+bool OPT_is_dead(AST_node_ *node)
+{
+	return optimizing && dead_code.count(node) > 0;
+}
+
+bool OPT_is_dead_store(AST_node_ *node)
+{
+	return optimizing && dead_stores.count(node) > 0;
+}
+
+bool OPT_is_safe_subscript(AST_node_ *node)
+{
+	return optimizing && safe_subscripts.count(node) > 0;
+}
+
+AST_node_ *OPT_bounds_checked_by(AST_node_ *node)
+{
+	auto found = hoisted_checks.find(node);
+	return optimizing && found != hoisted_checks.end() ? found->second : 0;
+}
+
+const std::vector<AST_node_*> &OPT_arrays_checked_by(AST_node_ *loop)
+{
+	static const std::vector<AST_node_*> none;
+	auto found = loop_arrays.find(loop);
+	return optimizing && found != loop_arrays.end() ? found->second : none;
+}
+
+bool OPT_uses_register_arguments(AST_node_ *fundec)
+{
+	return optimizing && register_functions.count(fundec) > 0;
+}
+
+bool OPT_is_spilled_parameter(AST_node_ *fundec, int param)
+{
+	auto found = spilled_parameters.find(fundec);
+	return optimizing && found != spilled_parameters.end() && found->second.count(param) > 0;
+}
+
+bool OPT_is_held_argument(AST_node_ *call, int arg)
+{
+	auto found = held_arguments.find(call);
+	return optimizing && found != held_arguments.end() && found->second.count(arg) > 0;
+}
+
+int OPT_hoisted_slot(AST_node_ *exp)
+{
+	auto found = hoisted_slots.find(exp);
+	return optimizing && found != hoisted_slots.end() ? found->second : -1;
+}
+
+const std::vector<AST_node_*> &OPT_hoisted_by(AST_node_ *loop)
+{
+	static const std::vector<AST_node_*> none;
+	auto found = hoisted_expressions.find(loop);
+	return optimizing && found != hoisted_expressions.end() ? found->second : none;
+}
+
+int OPT_kept_slot(AST_node_ *exp)
+{
+	auto found = kept_slots.find(exp);
+	return optimizing && found != kept_slots.end() ? found->second : -1;
+}
+
+int OPT_reused_slot(AST_node_ *exp)
+{
+	auto found = reused_slots.find(exp);
+	return optimizing && found != reused_slots.end() ? found->second : -1;
+}
+
+bool OPT_keeps_values_in_frame(AST_node_ *function)
+{
+	return optimizing && frames_with_values.count(function) > 0;
+}
+
+int OPT_trip_count(AST_node_ *loop)
+{
+	auto found = loop_trips.find(loop);
+	return optimizing && found != loop_trips.end() ? found->second : -1;
+}
+
+int OPT_unroll_factor(AST_node_ *loop, int body_instructions)
+{
+	int trips = OPT_trip_count(loop);
+	if (trips < 2) {
+		return 1;
+	}
+	if (trips * std::max(body_instructions, 1) <= OPT_unroll_budget) {
+		return trips;
+	}
+	// otherwise the most copies (a power of 2, up to 8) that fit, as long as it goes around at least twice
+	int factor = 8;
+	while (factor > 1 && (factor * body_instructions > OPT_unroll_budget || 2 * factor > trips)) {
+		factor /= 2;
+	}
+	return factor;
+}
+
+const OPT_switch *OPT_switch_at(AST_node_ *if_exp)
+{
+	auto found = switches.find(if_exp);
+	return optimizing && found != switches.end() ? &found->second : 0;
+}
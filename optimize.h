@@ -0,0 +1,95 @@
+#if ! defined _OPTIMIZE_H
+#define _OPTIMIZE_H 1
+
+#include <iostream>
+#include <vector>
+#include "util.h"
+
+class AST_node_;
+class A_root_;
+
+// Optimizations of the HERA code, turned on by the -O flag in tiger.cc.
+//
+// OPT_optimize runs after typechecking and before code generation, and leaves notes that the
+//  HERA_code methods check, rather than changing the tree itself:
+//   - dead code (visitors/dead_code_visitor.h): functions that are never called aren't generated,
+//     a store to a variable that's never read is left out (along with the value, if computing it
+//     has no side effects), and so is an expression with no side effects whose value a sequence
+//     throws away. That includes calls of functions that the call graph (call_graph.h) says
+//     have no side effects.
+//   - array bounds checks (visitors/bounds_check_visitor.h): a subscript by the variable of a for
+//     loop that runs from 0 to the array's size-1 isn't checked at all, and in an innermost for
+//     loop the bounds can be checked once before the loop starts, which then runs a copy of its
+//     body without the checks if they pass (or the usual one if they don't).
+//   - register arguments (visitors/register_call_visitor.h): a function whose callers never use
+//     R8-R10 for anything else takes its first three arguments in those registers, and returns
+//     its result in R1, rather than in its frame. It only stores a parameter in the frame when a
+//     nested function uses it, or it's needed after a call to one of our functions.
+//   - loop-invariant code (visitors/loop_invariant_visitor.h): arithmetic, pure calls (by the call
+//     graph) and variables of enclosing functions that come out the same every time around a loop
+//     are computed once before the loop, into a slot at the top of the frame, and loaded from there.
+//   - common subexpressions (visitors/value_number_visitor.h): an expression that computes a value
+//     the function has already computed, on every way of getting there, and that can't have
+//     changed since, loads it from a slot at the top of the frame, where the first one stored it.
+//   - loop unrolling (visitors/loop_unroll_visitor.h): a for loop with constant bounds runs copies
+//     of its body one after another, with no test or branch between them, setting the variable
+//     before each. If all the copies fit in OPT_unroll_budget instructions, that's the whole loop;
+//     otherwise the loop goes around fewer times, running a few copies each time, after the copies
+//     left over (so what's left is a multiple of them). HERA_code counts the body's instructions.
+//   - if chains (visitors/switch_visitor.h): if x = 1 then ... else if x = 2 then ... else ..., with
+//     enough constants, looks at x once, then goes to the right then through a jump table (if the
+//     constants are close together) or a binary search of them, rather than testing each in turn.
+
+// A chain of ifs that compare one variable with constants, as SwitchVisitor finds them
+struct OPT_switch {
+	AST_node_ *var;  // the A_varExp_ in the first test, the only one that's computed
+	std::vector<std::pair<int, AST_node_*> > cases;  // each constant, and the then it runs, in order of the constants
+	AST_node_ *default_or_null;  // what runs if x is none of them: the else after the last test we use
+	bool jump_table;  // or a binary search
+};
+
+// the registers that carry arguments: R8, R9 and R10, just below Rt
+const int OPT_argument_registers = 3;
+const int OPT_first_argument_register = 11 - OPT_argument_registers;
+// how many instructions of copies of a loop's body unrolling may make
+const int OPT_unroll_budget = 64;
+
+void OPT_optimize(A_root_ *root, std::ostream *report);  // report: where to say what we did, or 0
+bool OPT_enabled();
+
+// HERA_code should leave this out entirely
+bool OPT_is_dead(AST_node_ *node);
+// This A_varDec_ or A_assignExp_ should just compute its value (if that isn't dead too), not store it
+bool OPT_is_dead_store(AST_node_ *node);
+// This A_subscriptVar_ can't be out of bounds
+bool OPT_is_safe_subscript(AST_node_ *node);
+// The A_forExp_ that checks this A_subscriptVar_'s bounds before it starts, or 0
+AST_node_ *OPT_bounds_checked_by(AST_node_ *node);
+// The arrays (as A_simpleVar_s) this A_forExp_ checks before it starts; none for most loops
+const std::vector<AST_node_*> &OPT_arrays_checked_by(AST_node_ *loop);
+// This A_fundec_ takes arguments in registers and returns its result in R1
+bool OPT_uses_register_arguments(AST_node_ *fundec);
+// ... but keeps this one of its register parameters (0 for the first) in its frame
+bool OPT_is_spilled_parameter(AST_node_ *fundec, int param);
+// This A_callExp_ computes this register argument into the new frame, and loads it just before the call
+bool OPT_is_held_argument(AST_node_ *call, int arg);
+// The frame slot this expression is computed into before a loop around it starts, or -1
+int OPT_hoisted_slot(AST_node_ *exp);
+// The expressions this A_forExp_ or A_whileExp_ computes before it starts, in order; none for most loops
+const std::vector<AST_node_*> &OPT_hoisted_by(AST_node_ *loop);
+// The frame slot this expression stores its value in as soon as it's computed, for a later one to use, or -1
+int OPT_kept_slot(AST_node_ *exp);
+// The frame slot this expression loads its value from, rather than computing it again, or -1
+int OPT_reused_slot(AST_node_ *exp);
+// This A_fundec_ (or main, for 0) keeps values in slots at the top of its frame, which a call
+//  mustn't put its callee's frame over
+bool OPT_keeps_values_in_frame(AST_node_ *function);
+// How many copies of this A_forExp_'s body to run each time around, given how many instructions
+//  one copy takes: 1 leaves it alone, and how many times it runs unrolls it all the way
+int OPT_unroll_factor(AST_node_ *loop, int body_instructions);
+// How many times this A_forExp_ runs, if its bounds are constants (and it could be unrolled), or -1
+int OPT_trip_count(AST_node_ *loop);
+// The chain of ifs that starts at this A_ifExp_, if it looks at its variable only once; 0 for most ifs
+const OPT_switch *OPT_switch_at(AST_node_ *if_exp);
+
+#endif
@@ -1,4 +1,5 @@
 #include "AST.h"
+#include "HERA_select.h"
 
 /*
  * methods for working with "result_reg" attribute
@@ -20,8 +21,25 @@ int A_exp_::init_result_reg() {
 	return -1;
 }
 
+// A constant, or an operand and a constant, need no more than the operand does (see HERA_select.h);
+//  -1 for reg op reg, which is up to the node
+static int selected_result_reg(const HERA_selection &selection) {
+	if (selection.rule == HERA_rule_constant) {
+		return min_reg;
+	} else if (selection.rule != HERA_rule_registers) {
+		return static_cast<A_exp_ *>(selection.operand)->result_reg();
+	}
+	return -1;
+}
+
 int A_opExp_::init_result_reg() {
 	/* Have _left, _right children */
+	if (_oper == A_plusOp || _oper == A_minusOp || _oper == A_timesOp || _oper == A_divideOp) {
+		int reg = selected_result_reg(HERA_select(this));
+		if (reg >= 0) {
+			return reg;
+		}
+	}
 	int left_reg = _left->result_reg();
 	int right_reg = _right->result_reg();
 	if (left_reg == right_reg) {
@@ -32,28 +50,32 @@ int A_opExp_::init_result_reg() {
 }
 
 int A_expList_::init_result_reg() {
-    int curr_value;
-	if (_tail == 0) {
-		curr_value = _head->result_reg();
-	} else {
-		curr_value = _tail->result_reg();
-	}
-	return curr_value;
+	// the value of the list is that of its last expression
+	return last()->result_reg();
 }
 
 int A_expList_::init_reg_usage() {
-    int curr_value;
-    int head_reg = _head ? _head->result_reg() : min_reg;
-	if (_tail == 0) {
-		curr_value = head_reg;
-	} else {
-		curr_value = std::max(head_reg, _tail->result_reg());
+	// where a seqExp or letExp puts the value of the list: the highest register any of the expressions
+	//  uses, so a function that saves the registers up to its body's result_reg saves all of them
+	int reg = min_reg;
+	for (A_exp e : *this) {
+		reg = std::max(reg, e->result_reg());
 	}
-	return std::max(curr_value, min_reg);
+	return reg;
 }
 
 int A_callExp_::init_result_reg() {
-	return _args ? _args->result_reg() : min_reg;
+	if (HERA_is_division(this) && selected_result_reg(HERA_select(this)) >= 0) {
+		return selected_result_reg(HERA_select(this));
+	}
+	// each argument is stored as soon as it's computed, but they may need different registers to compute
+	int reg = min_reg;
+	if (_args) {
+		for (A_exp arg : *_args) {
+			reg = std::max(reg, arg->result_reg());
+		}
+	}
+	return reg;
 }
 
 int A_ifExp_::init_result_reg() {
@@ -87,7 +109,23 @@ int A_forExp_::init_result_reg() {
 }
 
 int A_varExp_::init_result_reg() {
-	return min_reg;
+	return _var->result_reg();
+}
+
+int A_var_::init_result_reg() {
+	return min_reg;  // see A_simpleVar_::HERA_code
+}
+
+int A_fieldVar_::init_result_reg() {
+	return _var->result_reg();  // the field replaces the record's address
+}
+
+int A_subscriptVar_::init_result_reg() {
+	if (constant_index() >= 0) {
+		return _var->result_reg();  // the subscript goes in the LOAD or STORE (see A_subscriptVar_::HERA_code)
+	}
+	// the array's address has to stay put while the subscript is computed
+	return std::max(_var->result_reg(), _exp->result_reg() + 1);
 }
 
 
@@ -98,14 +136,11 @@ int A_dec_::init_result_reg() {
 
 
 int A_decList_::init_result_reg() {
-    int curr_value;
-    int head_reg = _head ? _head->result_reg() : min_reg;
-	if (_tail == 0) {
-		curr_value = head_reg;
-	} else {
-		curr_value = std::max(head_reg, _tail->result_reg());
+	int curr_value = min_reg;
+	for (A_dec dec : *this) {
+		curr_value = std::max(curr_value, dec->result_reg());
 	}
-	return std::max(curr_value, min_reg);
+	return curr_value;
 }
 
 int A_letExp_::init_result_reg() {
@@ -125,9 +160,30 @@ int A_varDec_::init_result_reg() {
 }
 
 int A_assignExp_::init_result_reg() {
-	return _exp->result_reg();	
+	return std::max(_exp->result_reg(), _var->result_reg());  // finding an element or field can take more
 }
 
 int A_functionDec_::init_result_reg() {
 	return min_reg;
 }
+
+int A_arrayExp_::init_result_reg() {
+	// the array's address goes above what computing the initial value uses, as for records
+	return std::max(_size->result_reg(), _init->result_reg()) + 1;
+}
+
+int A_typeDec_::init_result_reg() {
+	return min_reg;
+}
+
+int A_recordExp_::init_result_reg() {
+	// the record's address goes above the registers that any of the fields' values use,
+	//  so it survives while they're computed
+	int fields_reg = min_reg - 1;
+	if (_fields != 0) {
+		for (A_efield field : *_fields) {
+			fields_reg = std::max(fields_reg, static_cast<A_exp_ *>(field->get_exp())->result_reg());
+		}
+	}
+	return fields_reg + 1;
+}
@@ -0,0 +1,240 @@
+/*
+ * tiger_runtime.c: main() and the Tiger standard library, for programs compiled with
+ *  "tiger -target=x86-64" (see visitors/x86_64_visitor.h), e.g.
+ *      tiger -target=x86-64 prog.tig > prog.s && cc prog.s runtime/tiger_runtime.c -o prog
+ *
+ * These do what the routines in Tiger-stdlib-stack.hera do.  Integers are 16 bits, as on HERA,
+ *  but passed as 64-bit longs; strings are NUL-terminated, and never freed.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern void tiger_main(void);
+
+static long tiger_16_bits(long n)
+{
+	return (int16_t) n;
+}
+
+static char *tiger_new_string(size_t length)
+{
+	char *s = malloc(length + 1);
+	if (s == 0) {
+		fprintf(stderr, "Tiger run-time error: out of memory\n");
+		exit(3);
+	}
+	s[length] = 0;
+	return s;
+}
+
+void tiger_division_by_zero(void)
+{
+	fflush(stdout);
+	fprintf(stderr, "Tiger run-time error: division by zero\n");
+	exit(3);
+}
+
+long tiger_lib_ord(const char *s)
+{
+	return s[0] == 0 ? -1 : (unsigned char) s[0];
+}
+
+void tiger_nil_record(void)
+{
+	fflush(stdout);
+	fprintf(stderr, "Tiger run-time error: field of nil record\n");
+	exit(3);
+}
+
+void tiger_bad_subscript(void)
+{
+	fflush(stdout);
+	fprintf(stderr, "Tiger run-time error: array subscript out of bounds\n");
+	exit(3);
+}
+
+long *tiger_new_record(long words)
+{
+	long *record = calloc(words > 0 ? words : 1, sizeof(long));  /* never 0, which is nil */
+	if (record == 0) {
+		fprintf(stderr, "Tiger run-time error: out of memory\n");
+		exit(3);
+	}
+	return record;
+}
+
+/* An array is its length followed by its elements, as in the HERA code */
+long *tiger_new_array(long length, long value)
+{
+	if (length < 0) {
+		fflush(stdout);
+		fprintf(stderr, "Tiger run-time error: negative array size\n");
+		exit(3);
+	}
+	long *array = tiger_new_record(length + 1);
+	array[0] = length;
+	for (long i = 1; i <= length; i++) {
+		array[i] = value;
+	}
+	return array;
+}
+
+const char *tiger_lib_chr(long i)
+{
+	char *s = tiger_new_string(1);
+	s[0] = (char) i;
+	return s;
+}
+
+long tiger_lib_size(const char *s)
+{
+	return tiger_16_bits(strlen(s));
+}
+
+const char *tiger_lib_substring(const char *s, long first, long n)
+{
+	if (first < 0 || n < 0 || first + n > (long) strlen(s)) {
+		fflush(stdout);
+		fprintf(stderr, "Tiger run-time error: substring out of range\n");
+		exit(3);
+	}
+	char *result = tiger_new_string(n);
+	memcpy(result, s + first, n);
+	return result;
+}
+
+const char *tiger_lib_concat(const char *s1, const char *s2)
+{
+	size_t n1 = strlen(s1), n2 = strlen(s2);
+	char *result = tiger_new_string(n1 + n2);
+	memcpy(result, s1, n1);
+	memcpy(result + n1, s2, n2);
+	return result;
+}
+
+long tiger_lib_tstrcmp(const char *s1, const char *s2)
+{
+	int comparison = strcmp(s1, s2);
+	return comparison < 0 ? -1 : comparison > 0 ? 1 : 0;
+}
+
+long tiger_lib_div(long num, long den)
+{
+	if (den == 0) {
+		tiger_division_by_zero();
+	}
+	return tiger_16_bits(num / den);
+}
+
+long tiger_lib_mod(long num, long den)
+{
+	if (den == 0) {
+		tiger_division_by_zero();
+	}
+	return tiger_16_bits(num % den);
+}
+
+static int last_char = EOF;
+
+long tiger_lib_getchar_ord(void)
+{
+	last_char = getchar();
+	return last_char;
+}
+
+void tiger_lib_putchar_ord(long i)
+{
+	putchar((int) i);
+}
+
+void tiger_lib_flush(void)
+{
+	fflush(stdout);
+}
+
+void tiger_lib_printint(long i)
+{
+	printf("%ld", i);
+}
+
+void tiger_lib_printbool(long b)
+{
+	fputs(b ? "true" : "false", stdout);
+}
+
+void tiger_lib_print(const char *s)
+{
+	fputs(s, stdout);
+}
+
+void tiger_lib_println(const char *s)
+{
+	puts(s);
+}
+
+const char *tiger_lib_getchar(void)
+{
+	last_char = getchar();
+	if (last_char == EOF) {
+		return "";
+	}
+	char *s = tiger_new_string(1);
+	s[0] = (char) last_char;
+	return s;
+}
+
+void tiger_lib_ungetchar(void)
+{
+	if (last_char != EOF) {
+		ungetc(last_char, stdin);
+	}
+}
+
+const char *tiger_lib_getline(void)
+{
+	size_t length = 0, capacity = 16;
+	char *s = tiger_new_string(capacity);
+	int c;
+	while ((c = getchar()) != EOF && c != '\n') {
+		if (length == capacity) {
+			capacity *= 2;
+			s = realloc(s, capacity + 1);
+		}
+		s[length++] = (char) c;
+	}
+	s[length] = 0;
+	return s;
+}
+
+long tiger_lib_getint(void)
+{
+	long n = 0;
+	if (scanf("%ld", &n) != 1) {
+		n = 0;
+	}
+	return tiger_16_bits(n);
+}
+
+void tiger_lib_exit(long status)
+{
+	exit((int) status);
+}
+
+long tiger_lib_malloc(long words)
+{
+	return (long) malloc(8 * words);
+}
+
+void tiger_lib_free(long p)
+{
+	free((void *) p);
+}
+
+int main(void)
+{
+	tiger_main();
+	return 0;
+}
@@ -0,0 +1,101 @@
+#!/bin/sh
+# Regression tests for bugs that the benchmarks wouldn't catch.
+#
+# Usage: tests/run-tests.sh [path-to-tiger]     (default: Debug/tiger)
+#
+# Each test runs the compiler on name.tig in a scratch directory, in the way given below, and
+#  checks that what it prints on standard output matches name.expected.  Fails (exit status 1)
+#  if any of them don't.
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+TIGER=${1:-$HERE/../Debug/tiger}
+case $TIGER in /*) ;; *) TIGER=$(pwd)/$TIGER ;; esac
+SCRATCH=$(mktemp -d)
+trap 'rm -rf $SCRATCH' EXIT
+
+if test ! -x "$TIGER"
+then
+	echo "No tiger compiler at $TIGER (build it with make, or give its path)"
+	exit 2
+fi
+
+status=0
+# check name command...: run the command (on $name.tig, in $SCRATCH), and compare its output
+check()
+{
+	name=$1
+	shift
+	cp $HERE/$name.tig $SCRATCH/
+	if ! (cd $SCRATCH && "$@") > $SCRATCH/$name.out 2> $SCRATCH/$name.err
+	then
+		echo "$name: FAILED"
+		head -10 $SCRATCH/$name.err
+		status=1
+	elif ! cmp -s $SCRATCH/$name.out $HERE/$name.expected
+	then
+		echo "$name: WRONG OUTPUT"
+		diff $HERE/$name.expected $SCRATCH/$name.out | head -10
+		status=1
+	else
+		echo "$name: ok"
+	fi
+}
+
+# with -json, even giving up is reported as a JSON object, so every line of standard error is one
+check json_giving_up sh -c "'$TIGER' -json json_giving_up.tig 2>&1 > /dev/null | grep -v '^{\"file\": '; true"
+
+# a program's call of exit sets the compiler's exit status, whichever way it's run
+check exit_status sh -c "for way in -run -vm -sim; do '$TIGER' \$way exit_status.tig 2> /dev/null; echo status \$?; done"
+
+# a tree saved with its attributes isn't typechecked again, so it must keep the fields' offsets
+check reload_record sh -c "'$TIGER' -s reload_record.tig > /dev/null && '$TIGER' -sim reload_record.tast"
+
+# a damaged .tast file is an error, not a crash (or an attempt to allocate a huge string table)
+check bad_tast sh -c "'$TIGER' -s bad_tast.tig > /dev/null && head -c 80 bad_tast.tast > short.tast; printf 'TAST\\002\\000\\377\\377\\377\\377\\177' > big.tast; printf 'TAST\\002\\000\\377\\377\\377\\377\\017' > many.tast; for file in short.tast big.tast many.tast; do '$TIGER' \$file 2>&1 | head -1; done"
+
+# -run is the reference for what the HERA code should print, so it has to handle records too
+check run_records "$TIGER" -run run_records.tig
+
+# ... and arrays, stopping with the same status as the HERA code when a subscript is out of bounds
+check run_arrays sh -c "'$TIGER' -run run_arrays.tig 2> /dev/null; echo status \$?"
+
+# a field of nil stops the HERA code with the same status as -run, rather than using the memory at address 0
+check nil_field sh -c "for way in -run -vm -sim; do '$TIGER' \$way nil_field.tig 2> /dev/null; echo status \$?; done"
+
+# variables of enclosing functions, through one or more static links, in records and arrays, in each way of running a program
+check static_links sh -c "for way in -run -vm -sim; do '$TIGER' \$way static_links.tig 2> /dev/null; done"
+
+# ... and compiled for x86-64, where we can
+if test "$(uname -m)" = x86_64 && command -v cc > /dev/null
+then
+	check x86_64 sh -c "'$TIGER' -target=x86-64 x86_64.tig > x86_64.s && cc x86_64.s '$HERE/../runtime/tiger_runtime.c' -o x86_64 && ./x86_64"
+fi
+
+# the dataflow framework's own checks, and the liveness analysis removing stores to x and y but not
+#  to z, which show reads through its static link
+check dead_stores sh -c "'$TIGER' -test-dataflow && '$TIGER' -Ov -vm dead_stores.tig 2> report && cat report"
+
+# HERA has no DIV instruction, so con / x (like x / con, unless it's a shift) calls div
+check constant_divided sh -c "'$TIGER' constant_divided.tig | grep -c 'CALL(FP_alt, div)'; '$TIGER' constant_divided.tig | grep -c 'DIV('; '$TIGER' -sim constant_divided.tig"
+
+# a division that might fail stays in its loop, where the if guarding it keeps it from running
+check guarded_division sh -c "'$TIGER' -O -sim guarded_division.tig 2> /dev/null; echo ' status' \$?"
+
+# each entry of a jump table is a BR to a label, which takes three words once HERA-C expands it
+check jump_table sh -c "'$TIGER' -O jump_table.tig | grep -c 'jump_table_'; '$TIGER' -O -sim jump_table.tig"
+
+# with -i, adding an if to one function leaves the others' code (and its labels) as it was, to be reused
+check cache_reuse sh -c "'$TIGER' -i cache_reuse.tig > /dev/null && sed 's/= x + 1/= if x > 5 then x else x + 1/' cache_reuse.tig > edited.tig && mv edited.tig cache_reuse.tig && '$TIGER' -i -d=cache cache_reuse.tig > cached.hera 2> cache.log; grep -o 'reused .*' cache.log; '$TIGER' cache_reuse.tig | cmp - cached.hera && echo same code"
+
+# with -O, the first three arguments go in registers, including calls in other calls' arguments and the
+#  parameters a nested function or a later call needs, which are stored in the frame too
+check register_arguments sh -c "'$TIGER' -Ov -sim register_arguments.tig 2> report && grep 'in registers' report && '$TIGER' -sim register_arguments.tig"
+
+# a value computed already isn't reused after an assignment to one of its variables, or a call of a
+#  function that might assign to one, but is after a call of a function that only reads them
+check value_numbers sh -c "'$TIGER' -Ov -sim value_numbers.tig 2> report && grep 'reusing' report"
+
+# a break in an unrolled loop, in each copy of its body, leaves the loop however much of it was unrolled
+check unroll_break sh -c "'$TIGER' -O unroll_break.tig | grep -c 'Break in LOOP'; '$TIGER' unroll_break.tig | grep -c 'Break in LOOP'; '$TIGER' -O -sim unroll_break.tig 2> /dev/null"
+
+exit $status
@@ -45,6 +45,7 @@ class tigerParseDriver;
 
 /* precedence (stickiness) ... put the stickiest stuff at the bottom of the list */
 /* https://stackoverflow.com/questions/12731922/reforming-the-grammar-to-remove-shift-reduce-conflict-in-if-then-else Precence for THEN ELSE */ 
+%nonassoc OF
 %left ASSIGN
 %left OR
 %left AND
@@ -58,7 +59,7 @@ class tigerParseDriver;
 /* Attributes types for nonterminals are next, e.g. struct's from tigerParseDriver.h */
 %type <expAttrs>  exp
 %type <decAttrs>  dec
-%type <lvalueAttrs> lvalue
+%type <lvalueAttrs> lvalue lvalue_not_id
 %type <expListAttrs> expList
 %type <seqExpAttrs> seqExp
 %type <decListAttrs> decList
@@ -67,6 +68,9 @@ class tigerParseDriver;
 %type <fundecAttrs> fundec
 %type <tyfieldAttrs> tyfields
 %type <typeidAttrs> typeid
+%type <efieldsAttrs> efields
+%type <decAttrs> tydec
+%type <tyAttrs> ty
 
 
 // The line below means our grammar must not have conflicts
@@ -79,7 +83,7 @@ class tigerParseDriver;
 %%
 
 %start program;
-program: exp[main]	{ EM_debug("Got the main expression of our tiger program.", $main.AST->pos());
+program: exp[main]	{ EM_DEBUG(EM_parse, "Got the main expression of our tiger program.", $main.AST->pos());
 		 			  // driver.AST = new A_root_($main.AST);
 					  driver.AST = A_RootExp($main.AST);
 		 			}
@@ -87,16 +91,29 @@ program: exp[main]	{ EM_debug("Got the main expression of our tiger program.", $
 
 exp:  INT[i]					{ // LITERALS
 								  $$.AST = A_IntExp(Position::fromLex(@i), $i);
-								  EM_debug("Got int " + str($i), $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got int " + str($i), $$.AST->pos());
 								}
 	| STRING[str1]				{ $$.AST = A_StringExp(Position::fromLex(@str1), $str1);
-								  EM_debug("Got string: " + $str1, $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got string: " + $str1, $$.AST->pos());
 								}
 	| TRUE[t]					{ $$.AST = A_BoolExp(Position::fromLex(@t), true);
-								  EM_debug("Got true boolean expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got true boolean expression", $$.AST->pos());
 								}
 	| FALSE[f]					{ $$.AST = A_BoolExp(Position::fromLex(@f), false);
-								  EM_debug("Got false boolean expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got false boolean expression", $$.AST->pos());
+								}
+	| NIL[n]					{ $$.AST = A_NilExp(Position::fromLex(@n));
+								  EM_DEBUG(EM_parse, "Got nil expression", $$.AST->pos());
+								}
+	| ID[id] L_CURLY_BRACE efields[fields] R_CURLY_BRACE[rb] {
+								  // RECORD CREATION
+								  $$.AST = A_RecordExp(Position::range(Position::fromLex(@id), Position::fromLex(@rb)), to_Symbol($id), $fields.AST);
+								  EM_DEBUG(EM_parse, "Got record expression for type " + $id, $$.AST->pos());
+								}
+	| ID[id] L_SQUARE_BRACKET exp[size] R_SQUARE_BRACKET OF exp[init] {
+								  // ARRAY CREATION
+								  $$.AST = A_ArrayExp(Position::range(Position::fromLex(@id), $init.AST->pos()), to_Symbol($id), $size.AST, $init.AST);
+								  EM_DEBUG(EM_parse, "Got array expression for type " + $id, $$.AST->pos());
 								}
 	| lvalue[lv]				{ // VARIABLES, FIELD, ELEMENTS OF AN ARRAY
 								  $$.AST = A_VarExp(Position::fromLex(@lv), $lv.AST);
@@ -104,100 +121,100 @@ exp:  INT[i]					{ // LITERALS
 	| ID[id1] LPAREN expList[list1] RPAREN[a] { 
 								  // FUNCTION CALL
 								  $$.AST = A_CallExp(Position::range(Position::fromLex(@id1), Position::fromLex(@a)), to_Symbol($id1), $list1.AST);
-								  EM_debug("Got function call for function " + $id1, $$.AST->pos()); 
+								  EM_DEBUG(EM_parse, "Got function call for function " + $id1, $$.AST->pos()); 
 								}
 	| MINUS exp[exp1] %prec UMINUS	{ 
 								  // OPERATIONS: UNARY, ARITHMETIC, BOOLEAN, PARENTHESIS
 								  $$.AST = A_OpExp($exp1.AST->pos(), A_timesOp, A_IntExp(Position::fromLex(@exp1), -1), $exp1.AST); 
-								  EM_debug("Got Unary Negation expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got Unary Negation expression.", $$.AST->pos());
 								}
 	| exp[exp1] PLUS exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_plusOp,  $exp1.AST,$exp2.AST);
-								  EM_debug("Got plus expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got plus expression.", $$.AST->pos());
 								}
 	| exp[exp1] MINUS exp[exp2] { $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_minusOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got minus expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got minus expression.", $$.AST->pos());
 								}
 	| exp[exp1] TIMES exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_timesOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got times expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got times expression.", $$.AST->pos());
 								}
 	| exp[exp1] DIVIDE exp[exp2]{ $$.AST = A_CallExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()), to_Symbol("div"), A_ExpList($exp1.AST, A_ExpList($exp2.AST, 0)));
 
-								  EM_debug("Got divide expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got divide expression.", $$.AST->pos());
 								}
 	| exp[exp1] LT exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_ltOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got less than expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got less than expression.", $$.AST->pos());
 								}
 	| exp[exp1] LE exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_leOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got less than or equal to expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got less than or equal to expression", $$.AST->pos());
 								}
 	| exp[exp1] GT exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_gtOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got greater than expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got greater than expression.", $$.AST->pos());
 								}
 	| exp[exp1] GE exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_geOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got greater than or equal to expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got greater than or equal to expression", $$.AST->pos());
 								}
 	| exp[exp1] EQ exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_eqOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got equal to expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got equal to expression.", $$.AST->pos());
 								}
 	| exp[exp1] NEQ exp[exp2]	{ $$.AST = A_OpExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()),
 												   A_neqOp, $exp1.AST, $exp2.AST);
-								  EM_debug("Got not equal to expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got not equal to expression", $$.AST->pos());
 								}
 	| exp[exp1] AND exp[exp2]	{ $$.AST = A_IfExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()), $exp1.AST,  $exp2.AST, A_BoolExp($exp2.AST->pos(), false));
 								  // if e1 then e2 else 0
-								  EM_debug("Got AND expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got AND expression", $$.AST->pos());
 								}
 	| exp[exp1] OR exp[exp2]	{ $$.AST = A_IfExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()), $exp1.AST, A_BoolExp($exp2.AST->pos(), true), $exp2.AST);
 								  // if e1 then 1 else e2
-								  EM_debug("Got OR expression.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got OR expression.", $$.AST->pos());
 								}
 	| NOT exp[exp1]	%prec NEGATION	{ 
 								  $$.AST = A_IfExp($exp1.AST->pos(), $exp1.AST, A_BoolExp($exp1.AST->pos(), false), A_BoolExp($exp1.AST->pos(), true));
-								  EM_debug("Got NOT expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got NOT expression", $$.AST->pos());
 								}
 	| LPAREN[lp] seqExp[seqExp1] RPAREN[rp]	  { 
 								  $$.AST = A_SeqExp(Position::range(Position::fromLex(@lp), Position::fromLex(@rp)), $seqExp1.AST); 
-							      EM_debug("Got sequence expression", $$.AST->pos());
+							      EM_DEBUG(EM_parse, "Got sequence expression", $$.AST->pos());
 								}
 	| lvalue[lv] ASSIGN exp[exp1]{// ASSIGNMENT
 								  $$.AST = A_AssignExp(Position::range($lv.AST->pos(), $exp1.AST->pos()), $lv.AST, $exp1.AST);
-								  EM_debug("Got Assignment expression", $$.AST->pos());  
+								  EM_DEBUG(EM_parse, "Got Assignment expression", $$.AST->pos());  
 								}
 	| IF[if] exp[exp1] THEN exp[exp2] ELSE exp[exp3] {
 								  // CONTROL STRUCTURES: IF, WHILE, FOR, BREAK, LET	
 								  $$.AST = A_IfExp(Position::range(Position::fromLex(@if), $exp3.AST->pos()), $exp1.AST, $exp2.AST, $exp3.AST);
-								  EM_debug("Got if/then/else expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got if/then/else expression", $$.AST->pos());
 								}
 	| IF[if] exp[exp1] THEN exp[exp2] {
 								  $$.AST = A_IfExp(Position::range(Position::fromLex(@if), $exp2.AST->pos()), $exp1.AST, $exp2.AST, 0);
-								  EM_debug("Got if/then/ expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got if/then/ expression", $$.AST->pos());
 								}
 	| WHILE exp[exp1] DO exp[exp2]	{ 
 								  $$.AST = A_WhileExp(Position::range($exp1.AST->pos(), $exp2.AST->pos()), $exp1.AST, $exp2.AST);
-								  EM_debug("Got while expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got while expression", $$.AST->pos());
 								} 
 	| FOR ID[id] ASSIGN exp[exp1] TO exp[exp2] DO exp[exp3] {
 								  $$.AST = A_ForExp(Position::range($exp1.AST->pos(), $exp3.AST->pos()), to_Symbol($id), $exp1.AST, $exp2.AST, $exp3.AST);
-								  EM_debug("Got FOR expression", $$.AST->pos()); 
+								  EM_DEBUG(EM_parse, "Got FOR expression", $$.AST->pos()); 
 								}
 	| BREAK[br]					{ $$.AST = A_BreakExp(Position::fromLex(@br));
-								  EM_debug("Got break expression", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got break expression", $$.AST->pos());
 								}
 	| LET decList[decs] IN seqExp[seqExp1] END_LET {
 								  $$.AST = A_LetExp(Position::range($decs.AST->pos(), $seqExp1.AST->pos()), $decs.AST, $seqExp1.AST);
-								  EM_debug("Got LET expression", $$.AST->pos());							
+								  EM_DEBUG(EM_parse, "Got LET expression", $$.AST->pos());							
 								}
 	| LET IN seqExp[seqExp1] END_LET {
 								  $$.AST = A_LetExp($seqExp1.AST->pos(), 0, $seqExp1.AST);
-								  EM_debug("Got LET expression without declarations", $$.AST->pos());							
+								  EM_DEBUG(EM_parse, "Got LET expression without declarations", $$.AST->pos());							
 //
 // Note: In older compiler tools, instead of writing $exp1 and $exp2, we'd write $1 and $3,
 //        to refer to the first and third elements on the right-hand-side of the production.
@@ -210,99 +227,140 @@ exp:  INT[i]					{ // LITERALS
 //
 			  					}
 lvalue: ID[id]					{ $$.AST = A_SimpleVar(Position::fromLex(@id), to_Symbol($id));
-								EM_debug("Got Var " + $id, $$.AST->pos());
+								EM_DEBUG(EM_parse, "Got Var " + $id, $$.AST->pos());
 								}
-	| lvalue[lv] DOT ID[id]		{
+	| lvalue_not_id[lv]			{ $$.AST = $lv.AST;
+								}
+	;
+// Kept apart from a plain ID, so that after "a [ n ]" bison can still wait to see if "of" follows
+lvalue_not_id: lvalue[lv] DOT ID[id] {
+								  $$.AST = A_FieldVar(Position::range($lv.AST->pos(), Position::fromLex(@id)), $lv.AST, to_Symbol($id));
+								  EM_DEBUG(EM_parse, "Got field " + $id, $$.AST->pos());
 								}
-	| lvalue L_SQUARE_BRACKET exp[exp1] R_SQUARE_BRACKET {
+	| ID[id] L_SQUARE_BRACKET exp[exp1] R_SQUARE_BRACKET[rb] {
+								  $$.AST = A_SubscriptVar(Position::range(Position::fromLex(@id), Position::fromLex(@rb)), A_SimpleVar(Position::fromLex(@id), to_Symbol($id)), $exp1.AST);
+								  EM_DEBUG(EM_parse, "Got element of array " + $id, $$.AST->pos());
+								}
+	| lvalue_not_id[lv] L_SQUARE_BRACKET exp[exp1] R_SQUARE_BRACKET[rb] {
+								  $$.AST = A_SubscriptVar(Position::range($lv.AST->pos(), Position::fromLex(@rb)), $lv.AST, $exp1.AST);
+								  EM_DEBUG(EM_parse, "Got element of array", $$.AST->pos());
 								}
 	;
 expList: exp[exp1]				{ $$.AST = A_ExpList($exp1.AST, 0);
-								  EM_debug("Got exp at end of expList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got exp at end of expList", $$.AST->pos());
 								}
 	| exp[exp1] COMMA expList[list1] { 
 								  $$.AST = A_ExpList($exp1.AST, $list1.AST); 
-								  EM_debug("Got exp with more entries in expList.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got exp with more entries in expList.", $$.AST->pos());
 								} 
 	|							{ $$.AST = 0;
-								  EM_debug("Got empty expList expression", Position::undefined());
+								  EM_DEBUG(EM_parse, "Got empty expList expression", Position::undefined());
+								}
+	;
+efields: ID[id] EQ exp[exp1]		{ $$.AST = A_EfieldList(A_Efield(to_Symbol($id), $exp1.AST), 0);
+								  EM_DEBUG(EM_parse, "Got field " + $id + " at end of record expression", $$.AST->pos());
+								}
+	| ID[id] EQ exp[exp1] COMMA efields[fields] {
+								  $$.AST = A_EfieldList(A_Efield(to_Symbol($id), $exp1.AST), $fields.AST);
+								  EM_DEBUG(EM_parse, "Got field " + $id + " with more fields in record expression", $$.AST->pos());
+								}
+	|							{ $$.AST = 0;
+								  EM_DEBUG(EM_parse, "Got empty record expression", Position::undefined());
 								}
 	;
 seqExp: exp[exp1]				{ $$.AST = A_ExpList($exp1.AST, 0);
-								  EM_debug("Got exp at end of seqExp", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got exp at end of seqExp", $$.AST->pos());
 								}
 	| exp[exp1] SEMICOLON seqExp[list1]	{ 
 								  $$.AST = A_ExpList($exp1.AST, $list1.AST); 
-								  EM_debug("Got exp with more entries in seqExp.", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got exp with more entries in seqExp.", $$.AST->pos());
 								} 
 	|							{ $$.AST = 0;
-								  EM_debug("Got empty seqExp expression", Position::undefined());
+								  EM_DEBUG(EM_parse, "Got empty seqExp expression", Position::undefined());
 								}
 	;
 decList: dec[dec1] decList[dl]	{ $$.AST = A_DecList($dec1.AST, $dl.AST); 
-								  EM_debug("Got dec with more decs in decList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got dec with more decs in decList", $$.AST->pos());
 								}
 	| dec[dec1]					{ $$.AST = A_DecList($dec1.AST, 0);
-								  EM_debug("Got dec at end of decList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got dec at end of decList", $$.AST->pos());
 								}
 	| fundecList[fdl] dec[dec1] decList[dL]	{
 								  $$.AST = A_DecList(A_FunctionDec($fdl.AST->pos(), $fdl.AST), A_DecList($dec1.AST, $dL.AST));
-								  EM_debug("Got fundecList with more decs in decList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got fundecList with more decs in decList", $$.AST->pos());
 								}
 	| fundecList[fdl] dec[dec1] {
 								  $$.AST = A_DecList(A_FunctionDec($fdl.AST->pos(), $fdl.AST), A_DecList($dec1.AST, 0));
-								  EM_debug("Got fundecList with another dec at end of decList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got fundecList with another dec at end of decList", $$.AST->pos());
 								}
 	| fundecList[fdl]			{ $$.AST = A_DecList(A_FunctionDec($fdl.AST->pos(), $fdl.AST), 0);
-								  EM_debug("Got fundecList at end of decList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got fundecList at end of decList", $$.AST->pos());
 								}
 	;
 fundecList: fundec[dec1]		{ $$.AST = A_FundecList($dec1.AST, 0);
-								  EM_debug("Got fundec at end of fundecList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got fundec at end of fundecList", $$.AST->pos());
 								}
 	| fundec[dec1] fundecList[dL]	{
 								  $$.AST = A_FundecList($dec1.AST, $dL.AST);
-								  EM_debug("Got fundec with more function defintions in fundecList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got fundec with more function defintions in fundecList", $$.AST->pos());
 								}
 	; 
 dec: vardec[vd]					{ // VARIABLE DECLARATION
 								  $$.AST = $vd.AST;
 								}
+	| tydec[td]					{ // TYPE DECLARATION
+								  $$.AST = $td.AST;
+								}
+   ;
+tydec: TYPE[t] ID[id1] EQ ty[ty1] {
+								  $$.AST = A_TypeDec(Position::range(Position::fromLex(@t), $ty1.AST->pos()), A_NametyList(A_Namety(to_Symbol($id1), $ty1.AST), 0));
+								  EM_DEBUG(EM_parse, "Got Type declaration: " + $id1, $$.AST->pos());
+								}
    ;
+ty: typeid[type]				{ $$.AST = A_NameTy(Position::fromLex(@type), $type.id);
+								}
+	| L_CURLY_BRACE[lb] tyfields[tf] R_CURLY_BRACE[rb] {
+								  $$.AST = A_RecordTy(Position::range(Position::fromLex(@lb), Position::fromLex(@rb)), $tf.AST);
+								  EM_DEBUG(EM_parse, "Got record type", $$.AST->pos());
+								}
+	| ARRAY[a] OF typeid[type]	{ $$.AST = A_ArrayTy(Position::range(Position::fromLex(@a), Position::fromLex(@type)), $type.id);
+								  EM_DEBUG(EM_parse, "Got array type", $$.AST->pos());
+								}
+	;
 vardec:  VAR ID[id1] COLON typeid[type] ASSIGN exp[exp1] {
 								  $$.AST = A_VarDec(Position::range(Position::fromLex(@id1), $exp1.AST->pos()), to_Symbol($id1), $type.id, $exp1.AST); 
-								  EM_debug("Got Variable declaration: " + $id1 + " with type " + Symbol_to_string($type.id), $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got Variable declaration: " + $id1 + " with type " + Symbol_to_string($type.id), $$.AST->pos());
 								}
 	| VAR ID[id1] ASSIGN exp[exp1] {
 								  $$.AST = A_VarDec(Position::range(Position::fromLex(@id1), $exp1.AST->pos()), to_Symbol($id1), to_Symbol("NA"), $exp1.AST); 
-								  EM_debug("Got Variable declaration: " + $id1 + " with implicit-type declaration", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got Variable declaration: " + $id1 + " with implicit-type declaration", $$.AST->pos());
 								}
    ;
 fundec: FUNCTION ID[id1] LPAREN tyfields[tf] RPAREN COLON typeid[type] EQ exp[exp1] {
 								  // FUNCTION DECLARATION
 								  $$.AST = A_Fundec(Position::range(Position::fromLex(@id1), $exp1.AST->pos()), to_Symbol($id1), $tf.AST, $type.id, $exp1.AST); 
-								  EM_debug("Got Function declaration for function: " + $id1, $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got Function declaration for function: " + $id1, $$.AST->pos());
 								}
 	| FUNCTION ID[id1] LPAREN tyfields[tf] RPAREN EQ exp[exp1] {
 								  $$.AST = A_Fundec(Position::range(Position::fromLex(@id1), $exp1.AST->pos()), to_Symbol($id1), $tf.AST, to_Symbol("Procedure"), $exp1.AST); 
-								  EM_debug("Got Procedure declaration for function: " + $id1, $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got Procedure declaration for function: " + $id1, $$.AST->pos());
 								} 
 	;
 tyfields: ID[id1] COLON typeid[type] {
 								  $$.AST = A_FieldList(A_Field(Position::range(Position::fromLex(@id1), Position::fromLex(@type)), to_Symbol($id1), $type.id), 0);	
-								  EM_debug("Got TyField", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got TyField", $$.AST->pos());
 								}
 	| ID[id1] COLON typeid[type] COMMA tyfields[tf] {
 								  $$.AST = A_FieldList(A_Field(Position::range(Position::fromLex(@id1), Position::fromLex(@type)), to_Symbol($id1), $type.id), $tf.AST);	
-								  EM_debug("Got TyField with TyFieldList", $$.AST->pos());
+								  EM_DEBUG(EM_parse, "Got TyField with TyFieldList", $$.AST->pos());
 								}
 	|							{ $$.AST = 0;
-								  EM_debug("Got empty TyField", Position::undefined());
+								  EM_DEBUG(EM_parse, "Got empty TyField", Position::undefined());
 								}
 	;
 
 typeid: ID[id1]					{ $$.id = to_Symbol($id1);
-							      EM_debug("Got type-id: " + $id1, Position::fromLex(@id1));	
+							      EM_DEBUG(EM_parse, "Got type-id: " + $id1, Position::fromLex(@id1));	
 								}
 	;
 
@@ -313,6 +371,6 @@ void
 yy::tigerParser::error(const location_type& l,
           	       const std::string& m)
   {
-	  EM_debug("In yy::tigerParser::error");
+	  EM_DEBUG(EM_parse, "In yy::tigerParser::error");
 	  EM_error(m, true, Position::fromLex(l));
   }
@@ -195,6 +195,11 @@ c_comment \/\*([^*]|\*\**[^*\/])*\*\**\/
 "var"				{ loc.step(); return yy::tigerParser::make_VAR(loc);			}
 ":"					{ loc.step(); return yy::tigerParser::make_COLON(loc);			}
 "function"			{ loc.step(); return yy::tigerParser::make_FUNCTION(loc);		}
+"type"				{ loc.step(); return yy::tigerParser::make_TYPE(loc);			}
+"array"				{ loc.step(); return yy::tigerParser::make_ARRAY(loc);			}
+"of"				{ loc.step(); return yy::tigerParser::make_OF(loc);				}
+"{"					{ loc.step(); return yy::tigerParser::make_L_CURLY_BRACE(loc);	}
+"}"					{ loc.step(); return yy::tigerParser::make_R_CURLY_BRACE(loc);	}
 {identifier}		{ loc.step(); return yy::tigerParser::make_ID(yytext, loc);		}
 {integer}			{ loc.step(); return yy::tigerParser::make_INT(textToInt(yytext), loc);
    /* textToInt is defined above */
@@ -1,5 +1,6 @@
 #include "visitors/visitor.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <iostream>
 using std::cout;
 using std::cerr;
@@ -8,10 +9,21 @@ using std::endl;
 #include "errormsg.h"
 #include "AST.h"
 #include "ST.h"  /* to run ST_test */
+#include "AST_binary.h"
+#include "HERA_cache.h"
+#include "HERA_sim.h"
+#include "optimize.h"
+#include "call_graph.h"
+#include "dataflow.h"  /* to run DF_test, and for -O with -vm */
+#include "VM.h"
 #include "tigerParseDriver.h"
+#include "visitors/bytecode_visitor.h"
 #include "visitors/function_library_visitor.h"
+#include "visitors/interpreter_visitor.h"
 #include "visitors/parent_pointer_visitor.h"
+#include "visitors/static_link_visitor.h"
 #include "visitors/variable_library_visitor.h"
+#include "visitors/x86_64_visitor.h"
 
 int LOG_LEVEL = 1;
 
@@ -108,31 +120,83 @@ void lex_test()
 }
 #endif
 
+// After the diagnostics already buffered, and in the same format (so it's still JSON under -json)
+static int compiler_exception(string message, int status)
+{
+	EM_set_phase("driver");
+	EM_error(message);
+	EM_flush();
+	return status;
+}
+
 int main(int argc, char **argv)
 {
+  atexit(EM_flush);  // write out the buffered errors and warnings however we finish
   try {
-	bool debug = false, show_ast = false, crash_on_fatal;
+	bool debug = false, show_ast = false, crash_on_fatal = false;
+	bool incremental = false, save_binary_AST = false, simulate = false, interpret = false, run_bytecode = false, optimize = false, report_optimizations = false, show_call_graph = false;
+	string target = "hera";
 #if defined COMPILE_LEX_TEST
 	bool just_do_lex_and_then_stop = false;
 #endif
 	String filename;
 	int arg_consumed = 0;
 
-	if (argc>arg_consumed+1 && string(argv[1]).length()>= 2 && (argv[1][0] == '-' && argv[1][1] == 'd')) { // Debug option
+	// Options come before the file name
+	while (argc>arg_consumed+1 && string(argv[arg_consumed+1]).length()>= 2 && argv[arg_consumed+1][0] == '-') {
 		arg_consumed++;
-		debug = true;
-		if (string(argv[1]).length()>= 3 && argv[1][2] == 'a')
-			show_ast = true;
-		else if (string(argv[1]).length()>= 3 && argv[1][2] == 'A')
-			print_ASTs_with_attributes = show_ast = true;
-		else if (string(argv[1]).length()>= 3 && argv[1][2] == 'c')
-			crash_on_fatal = true;
-		else if (string(argv[1]).length()>= 3 && (argv[1][2] == '1' || argv[1][2] == '2' || argv[1][2] == '3'))
-			LOG_LEVEL = argv[1][2] - '0';
+		string option = argv[arg_consumed];
+		if (option[1] == 'd') { // Debug option
+			debug = true;
+			if (option.length()>= 3 && option[2] == 'a')
+				show_ast = true;
+			else if (option.length()>= 3 && option[2] == 'A')
+				print_ASTs_with_attributes = show_ast = true;
+			else if (option.length()>= 3 && option[2] == 'c')
+				crash_on_fatal = true;
+			else if (option.length()>= 3 && (option[2] == '1' || option[2] == '2' || option[2] == '3'))
+				LOG_LEVEL = option[2] - '0';
+			else if (option.length()>= 3 && option[2] == '=') {  // just some channels, e.g. -d=parse,typecheck
+				if (!EM_select_debug_channels(option.substr(3))) {
+					cerr << "Unknown debugging channel in " << option << endl;
+					return 1;
+				}
+			}
 #if defined COMPILE_LEX_TEST
-		else if (string(argv[1]).length()>= 3 && argv[1][2] == 'l')
-			just_do_lex_and_then_stop = true;
+			else if (option.length()>= 3 && option[2] == 'l')
+				just_do_lex_and_then_stop = true;
 #endif
+		} else if (option == "-i") { // Incremental: reuse HERA code for functions that haven't changed
+			incremental = true;
+		} else if (option == "-s") { // Save the AST, in binary form, in a .tast file
+			save_binary_AST = true;
+		} else if (option == "-sim") { // Run the HERA code in our simulator, rather than printing it
+			simulate = true;
+		} else if (option == "-run") { // Interpret the typechecked AST directly, without generating code
+			interpret = true;
+		} else if (option == "-vm") { // Compile to bytecode and run it in our VM, without generating HERA code
+			run_bytecode = true;
+		} else if (option.substr(0, 8) == "-target=") { // What to generate code for: hera (the default) or x86-64
+			target = option.substr(8);
+			if (target != "hera" && target != "x86-64") {
+				cerr << "Unknown target in " << option << " (we have hera and x86-64)" << endl;
+				return 1;
+			}
+		} else if (option == "-O" || option == "-Ov") { // Optimize the HERA code (or the bytecode, with -vm); -Ov also says what it did
+			optimize = true;
+			report_optimizations = option == "-Ov";
+		} else if (option == "-callgraph") { // Print the call graph, with a summary of each function, then carry on
+			show_call_graph = true;
+		} else if (option == "-json") { // Errors and warnings as JSON, for other programs to read
+			EM_set_output_format(EM_json);
+		} else if (option == "-test-dataflow") { // Check the dataflow framework on examples worked out by hand, and stop
+			DF_test();
+			cout << "DF_test passed" << endl;
+			return 0;
+		} else {
+			cerr << "Unknown option " << option << endl;
+			return 1;
+		}
 	}
 
 	if (argc>arg_consumed+1)
@@ -154,7 +218,11 @@ int main(int argc, char **argv)
 	// with compiler debugging ON if the "-d" flag was used when we started
 	EM_reset(filename, 8, debug, crash_on_fatal);
 
-	ST_test();  // internal consistency check
+	ST_test();  // internal consistency checks
+
+	if (incremental) {
+		HERA_cache_open((filename == "" || filename == "-" ? string("tiger") : filename) + ".hcache");
+	}
 
 #if defined COMPILE_LEX_TEST
 	if (just_do_lex_and_then_stop) {
@@ -164,14 +232,24 @@ int main(int argc, char **argv)
 #endif
 	{
 		tigerParseDriver driver;
-		int result = driver.parse(filename);
-		if (!EM_recorded_any_errors()) {
-			if (result != 0) {
+		bool from_binary = filename != "-" && AST_is_binary_file(filename);
+		if (from_binary) {  // a .tast file saved by -s; no need to parse
+			EM_set_phase("load");
+			string source_file_name;
+			driver.AST = AST_load_binary(filename, source_file_name);
+			if (driver.AST) {
+				EM_reset(source_file_name, 8, debug, crash_on_fatal);  // so messages refer to the original source
+			}
+		} else {
+			EM_set_phase("parse");
+			int result = driver.parse(filename);
+			if (!EM_recorded_any_errors() && result != 0) {
 				EM_error("Strange result in tiger.cc: parser failed but EM module reported no errors",
 					 true, Position::undefined()); // true = fatal error
 			}
-
-			EM_debug("Parsing Successful\n", driver.AST->pos());
+		}
+		if (!EM_recorded_any_errors()) {
+			EM_DEBUG(EM_general, from_binary ? "Loading Successful\n" : "Parsing Successful\n", driver.AST->pos());
 
 
 			// Could do static checks, e.g. type checking, here if we want to do them all before any code generation
@@ -179,6 +257,7 @@ int main(int argc, char **argv)
 			if (show_ast) cerr << "Printing AST due to -da or -dA flag:" << endl << repr(driver.AST) << endl;
 
 			if (! EM_recorded_any_errors()) {
+                EM_set_phase("scope");
                 ParentPointerVisitor parent_visitor;
                 VoidContext parent_ctx;
                 driver.AST->accept(parent_visitor, parent_ctx);
@@ -187,38 +266,105 @@ int main(int argc, char **argv)
                 VoidContext function_library_ctx;
                 driver.AST->accept(local_func_lib_visitor, function_library_ctx);
 
+                // before the variable library, since it changes where variables go in a function's frame
+                StaticLinkVisitor static_link_visitor;
+                VoidContext static_link_ctx;
+                driver.AST->accept(static_link_visitor, static_link_ctx);
+
+                // and so does this, which decides where everything else goes
+                layout_frames(driver.AST);
+
                 VariableLibraryVisitor local_var_lib_visitor;
                 VoidContext variable_library_ctx;
                 driver.AST->accept(local_var_lib_visitor, variable_library_ctx);
 
 				// Typecheck first
-				EM_debug("Starting Typechecking", driver.AST->pos());
+				EM_set_phase("typecheck");
+				EM_DEBUG(EM_general, "Starting Typechecking", driver.AST->pos());
 				Ty_ty final_type = driver.AST->typecheck();
-				EM_debug("Finished Typechecking and got final type: " + to_String(final_type)  + "\n", driver.AST->pos());
-				String code = "#include <Tiger-stdlib-stack-data.hera>\n\n";
-				code = code + driver.AST->HERA_data();
-				EM_debug("Finished compiling HERA_data\n", driver.AST->pos());
-				code = code + driver.AST->HERA_code();
-				EM_debug("Finished compiling HERA_code\n", driver.AST->pos());
-				code = code + "\n#include <Tiger-stdlib-stack.hera>\n";
-				if (! EM_recorded_any_errors()) {
-					cout << code;
-					return 0; // no errors
+				EM_DEBUG(EM_general, "Finished Typechecking and got final type: " + to_String(final_type)  + "\n", driver.AST->pos());
+				if (save_binary_AST && !from_binary) {
+					// attributes are only worth saving if typechecking went through
+					string tast_file = (filename.length() > 4 && filename.substr(filename.length()-4) == ".tig" ?
+							    filename.substr(0, filename.length()-4) : filename) + ".tast";
+					AST_save_binary(driver.AST, tast_file, filename, !EM_recorded_any_errors());
+				}
+				if (show_call_graph && !EM_recorded_any_errors()) {
+					EM_set_phase("callgraph");
+					cerr << CG_build(driver.AST).dump();
+				}
+				if (interpret || run_bytecode || target != "hera") {
+					if (EM_recorded_any_errors()) {
+						// nothing to run or compile
+					} else if (interpret) {
+						EM_set_phase("run");
+						InterpreterVisitor interpreter;
+						bool ran = interpreter.run(driver.AST);
+						HERA_cache_close();
+						return ran ? interpreter.exit_status : 3;
+					} else if (run_bytecode) {
+						EM_set_phase("codegen");
+						BytecodeVisitor bytecode;
+						if (bytecode.compile(driver.AST)) {
+							if (optimize) {
+								EM_set_phase("optimize");
+								VM_remove_dead_stores(bytecode.program, report_optimizations ? &cerr : 0);
+							}
+							EM_DEBUG(EM_codegen, "Bytecode:\n" + VM_disassemble(bytecode.program));
+							EM_DEBUG(EM_codegen, "Dataflow:\n" + VM_dataflow_report(bytecode.program));
+							EM_set_phase("run");
+							int status;
+							bool ran = VM_run(bytecode.program, cout, status);
+							HERA_cache_close();
+							return ran ? status : 3;
+						}
+					} else if (target == "x86-64") {
+						EM_set_phase("codegen");
+						X86_64Visitor x86_64;
+						string assembly = x86_64.assembly(driver.AST);
+						if (! EM_recorded_any_errors()) {
+							HERA_cache_close();
+							cout << assembly;
+							return 0; // no errors
+						}
+					}
+				} else {
+					if (optimize && !EM_recorded_any_errors()) {
+						EM_set_phase("optimize");
+						OPT_optimize(driver.AST, report_optimizations ? &cerr : 0);
+					}
+					EM_set_phase("codegen");
+					String code = "#include <Tiger-stdlib-stack-data.hera>\n\n";
+					code = code + driver.AST->HERA_data();
+					EM_DEBUG(EM_general, "Finished compiling HERA_data\n", driver.AST->pos());
+					code = code + driver.AST->HERA_code();
+					EM_DEBUG(EM_general, "Finished compiling HERA_code\n", driver.AST->pos());
+					code = code + "\n#include <Tiger-stdlib-stack.hera>\n";
+					if (! EM_recorded_any_errors()) {
+						HERA_cache_close();
+						if (simulate) {
+							EM_set_phase("simulate");
+							HERA_sim_stats stats;
+							bool ran = HERA_simulate(code, cout, stats);
+							HERA_sim_report(stats, cerr);
+							return ran ? stats.exit_status : 3;  // the program's own status, as for -run and -vm
+						}
+						cout << code;
+						return 0; // no errors
+					}
 				}
 			}
 		}
-		EM_warning("Not generating HERA code due to above errors.");
+		EM_set_phase("driver");
+		EM_warning("Not generating code due to above errors.");
 		return EM_recorded_any_errors(); // got errors somewhere, or would have returned 0 above
 	}
 
   } catch (const char *message) {
-	  cerr << "Compiler exception (this should not happen): " << message << endl;
-	  return 4;
+	  return compiler_exception(string("Compiler exception (this should not happen): ") + message, 4);
   } catch (std::string message) {
-	  cerr << "Compiler exception (this should not happen): " << message << endl;
-	  return 4;
+	  return compiler_exception("Compiler exception (this should not happen): " + message, 4);
   } catch (...) {
-	  cerr << "Yikes! Uncaught compiler exception (this REALLY should not happen)" << endl;
-	  return 66;
+	  return compiler_exception("Yikes! Uncaught compiler exception (this REALLY should not happen)", 66);
   }
 }
@@ -47,6 +47,14 @@ struct typeidAttrs {
 		Symbol id;
 };
 
+struct efieldsAttrs {
+		A_efieldList AST;
+};
+
+struct tyAttrs {
+		A_ty AST;
+};
+
 #include "tiger-grammar.tab.hh"
 
 
@@ -22,26 +22,83 @@ Ty_ty AST_node_::init_typecheck() {
 }
 
 Ty_ty A_root_::init_typecheck() {
-    EM_debug("typechecking for A_root_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_root_");
 	Ty_ty result = main_expr->typecheck();
 	return result;
 }
 
 Ty_ty A_intExp_::init_typecheck() {
-    EM_debug("typechecking for A_intExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_intExp_");
 	return Ty_Int();
 }
 
 Ty_ty A_boolExp_::init_typecheck() {
-    EM_debug("typechecking for A_boolExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_boolExp_");
 	return Ty_Bool();
 }
 
 Ty_ty A_stringExp_::init_typecheck() {
-    EM_debug("typechecking for A_stringExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_stringExp_");
 	return Ty_String();
 }
 
+Ty_ty A_nilExp_::init_typecheck() {
+    EM_DEBUG(EM_typecheck, "typechecking for A_nilExp_");
+	return Ty_Nil();
+}
+
+Ty_ty A_recordExp_::init_typecheck() {
+    EM_DEBUG(EM_typecheck, "typechecking for A_recordExp_ " + Symbol_to_string(_typ));
+	Ty_ty record_type = lookup_type(_typ);
+	if (record_type == 0 || Ty_actual(record_type)->kind != Ty_record) {
+		EM_error("Type " + Symbol_to_string(_typ) + " is not a record type");
+		return Ty_Error();
+	}
+	// the fields must be given in the order they were declared
+	Ty_fieldList expected = Ty_actual(record_type)->u.record;
+	int count = _fields ? _fields->length() : 0;
+	for (int i = 0; i < count; i++) {
+		A_efield field = _fields->element(i);
+		Ty_ty field_type = field->get_exp()->typecheck();
+		if (expected == 0 || !Symbols_are_equal(expected->head->name, field->get_name())) {
+			EM_error("Record of type " + Symbol_to_string(_typ) + " has field " + Symbol_to_string(field->get_name()) +
+			         (expected ? " where field " + Symbol_to_string(expected->head->name) + " was expected" : " which it doesn't declare"));
+			return Ty_Error();
+		}
+		if (!Ty_assignable(expected->head->ty, field_type)) {
+			EM_error("Field " + Symbol_to_string(field->get_name()) + " of record type " + Symbol_to_string(_typ) +
+			         " needs " + to_String(expected->head->ty) + " but got " + to_String(field_type));
+			return Ty_Error();
+		}
+		expected = expected->tail;
+	}
+	if (expected != 0) {
+		EM_error("Record of type " + Symbol_to_string(_typ) + " is missing field " + Symbol_to_string(expected->head->name));
+		return Ty_Error();
+	}
+	return record_type;
+}
+
+Ty_ty A_arrayExp_::init_typecheck() {
+    EM_DEBUG(EM_typecheck, "typechecking for A_arrayExp_ " + Symbol_to_string(_typ));
+	Ty_ty array_type = lookup_type(_typ);
+	if (array_type == 0 || Ty_actual(array_type)->kind != Ty_array) {
+		EM_error("Type " + Symbol_to_string(_typ) + " is not an array type");
+		return Ty_Error();
+	}
+	if (_size->typecheck() != Ty_Int()) {
+		EM_error("Size of array of type " + Symbol_to_string(_typ) + " should be an int, not " + to_String(_size->typecheck()));
+		return Ty_Error();
+	}
+	Ty_ty element_type = Ty_actual(array_type)->u.array;
+	if (!Ty_assignable(element_type, _init->typecheck())) {
+		EM_error("Array of type " + Symbol_to_string(_typ) + " needs elements of type " + to_String(element_type) +
+		         " but the initial value is " + to_String(_init->typecheck()));
+		return Ty_Error();
+	}
+	return array_type;
+}
+
 static Ty_ty check_return_type(A_oper op) {
 	if (op == A_plusOp || op == A_minusOp || op == A_timesOp) {
 		return Ty_Int();
@@ -54,7 +111,7 @@ static Ty_ty check_return_type(A_oper op) {
 }
 
 Ty_ty A_opExp_::init_typecheck() {
-    EM_debug("typechecking for A_opExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_opExp_");
 	Ty_ty left_type = _left->typecheck();
 	Ty_ty right_type = _right->typecheck();
 	Ty_ty return_type = check_return_type(_oper);
@@ -62,7 +119,7 @@ Ty_ty A_opExp_::init_typecheck() {
 	// Otherwise, type is Ty_Int (arithmetic op), make sure left/right are type int ( maybe Ty_bool?)
 
 	if (return_type == Ty_Bool()) {
-		if (left_type == right_type) {
+		if (left_type == right_type || Ty_assignable(left_type, right_type) || Ty_assignable(right_type, left_type)) {
 			return return_type;
 		} else {
 			EM_error("Comparison operator does not have left and right being the same type");
@@ -99,7 +156,7 @@ Ty_ty A_opExp_::init_typecheck() {
 }
 
 Ty_ty A_callExp_::init_typecheck() {	
-    EM_debug("typechecking for A_callExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_callExp_");
 	// have name _func and args _args
 	// Look up name in ST function_library to get args as Ty_fieldList and iterate
 	// through to check if all are correct type
@@ -127,7 +184,7 @@ Ty_ty A_callExp_::init_typecheck() {
         return Ty_Error();
     }
 
-    Ty_ty args_typecheck = _args->compare_types(_func, 1, arg_types);
+    Ty_ty args_typecheck = _args->compare_types(_func, arg_types);
     if (args_typecheck == Ty_Error()) {
         return Ty_Error();
     }
@@ -136,28 +193,25 @@ Ty_ty A_callExp_::init_typecheck() {
 	return return_type;
 }
 
-Ty_ty A_expList_::compare_types(Symbol _func, int arg_counter, Ty_fieldList expected_types) {
-    if (expected_types == 0) {
-        EM_error("Function " + str(_func) + " has extra arguments. Please Check");
-        return Ty_Error(); 
-    }
-
-    Ty_ty head_type = _head->typecheck();
-    Ty_ty expected_type = expected_types->head->ty;
-    if (head_type != expected_type) {
-        EM_error("Typechecking callExp: Arg " + std::to_string(arg_counter) + " type does not match in function "
-           + "call " + str(_func) + ". Got " + to_String(head_type) + " but expected " + to_String(expected_type));
-        return Ty_Error();
-    } 
+Ty_ty A_expList_::compare_types(Symbol _func, Ty_fieldList expected_types) {
+    int arg_counter = 1;
+    for (A_exp arg : *this) {
+        if (expected_types == 0) {
+            EM_error("Function " + str(_func) + " has extra arguments. Please Check");
+            return Ty_Error(); 
+        }
 
-    if (expected_types) {
+        Ty_ty arg_type = arg->typecheck();
+        Ty_ty expected_type = expected_types->head->ty;
+        if (!Ty_assignable(expected_type, arg_type)) {
+            EM_error("Typechecking callExp: Arg " + std::to_string(arg_counter) + " type does not match in function "
+               + "call " + str(_func) + ". Got " + to_String(arg_type) + " but expected " + to_String(expected_type));
+            return Ty_Error();
+        } 
         expected_types = expected_types->tail;
+        arg_counter++;
     }
-    
-    if (_tail) {
-        return _tail->compare_types(_func, arg_counter + 1, expected_types);
-    }
-    if (_tail == 0 && expected_types != 0) {
+    if (expected_types != 0) {
         EM_error("Function " + str(_func) + " has too few arguments.");
         return Ty_Error();
     }
@@ -165,7 +219,7 @@ Ty_ty A_expList_::compare_types(Symbol _func, int arg_counter, Ty_fieldList expe
 }
 
 Ty_ty A_ifExp_::init_typecheck() {
-    EM_debug("typechecking for A_ifExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_ifExp_");
 	// exp1 is typed as an integer, exp2 and exp3 must have the same type which will be the type of the entire structure. The resulting type cannot be that of nil. 
 	// if Test is type bool that is also allowed, since it evaluates to nonzero or zero
 	// First check if the test is type int
@@ -181,6 +235,10 @@ Ty_ty A_ifExp_::init_typecheck() {
 	    // 	and return that type
 		if (_then->typecheck() == _else_or_null->typecheck()) {
 			return _then->typecheck();
+		} else if (Ty_assignable(_then->typecheck(), _else_or_null->typecheck())) {  // e.g. a record and nil
+			return _then->typecheck();
+		} else if (Ty_assignable(_else_or_null->typecheck(), _then->typecheck())) {
+			return _else_or_null->typecheck();
 		} else {
 			EM_error("Type of then and else statement must be the same");
 			return Ty_Error();
@@ -197,7 +255,7 @@ Ty_ty A_ifExp_::init_typecheck() {
 }
 
 Ty_ty A_seqExp_::init_typecheck() {
-    EM_debug("typechecking for A_seqExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_seqExp_");
 	// return Ty_Void if _seq is 0, else return type of last item
 	Ty_ty return_type = Ty_Void();
 	A_expList seq = _seq;
@@ -209,7 +267,7 @@ Ty_ty A_seqExp_::init_typecheck() {
 }
 
 Ty_ty A_whileExp_::init_typecheck() {
-    EM_debug("typechecking for A_whileExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_whileExp_");
 	// _test must be type int
 	// _body must be type void
 	if (_test->typecheck() == Ty_Int() || _test->typecheck() == Ty_Bool()) {
@@ -226,12 +284,12 @@ Ty_ty A_whileExp_::init_typecheck() {
 }
 
 Ty_ty A_breakExp_::init_typecheck() {
-    EM_debug("typechecking for A_breakExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_breakExp_");
 	return Ty_Void();
 }
 
 Ty_ty A_forExp_::init_typecheck() {
-    EM_debug("typechecking for A_forExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_forExp_");
 	// _lo, _hi must be Ty_Int()
 	// _body must return Ty_Void()
 	Ty_ty _body_type = _body->typecheck();
@@ -249,12 +307,12 @@ Ty_ty A_forExp_::init_typecheck() {
 }
 
 Ty_ty A_varExp_::init_typecheck() {
-    EM_debug("typechecking for A_varExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_varExp_");
 	return _var->typecheck();
 }
 
 Ty_ty A_simpleVar_::init_typecheck() {
-    EM_debug("typechecking for A_simpleVar: " + Symbol_to_string(_sym));
+    EM_DEBUG(EM_typecheck, "typechecking for A_simpleVar: " + Symbol_to_string(_sym));
 
     ST<var_info> my_variable_library = local_variable_library;
 	// Lookup in symbol type what the stored type is
@@ -268,20 +326,53 @@ Ty_ty A_simpleVar_::init_typecheck() {
 	}
 }
 
+Ty_ty A_fieldVar_::init_typecheck() {
+    EM_DEBUG(EM_typecheck, "typechecking for A_fieldVar: " + Symbol_to_string(_sym));
+	Ty_ty record_type = _var->typecheck();
+	if (record_type == Ty_Error()) {
+		return Ty_Error();
+	}
+	Ty_ty field_type = Ty_field_type(record_type, _sym);
+	if (Ty_actual(record_type)->kind != Ty_record || field_type == 0) {
+		EM_error("Typecheck fieldVar: " + to_String(record_type) + " has no field " + Symbol_to_string(_sym));
+		return Ty_Error();
+	}
+	offset = Ty_field_offset(record_type, _sym);
+	return field_type;
+}
+
+Ty_ty A_subscriptVar_::init_typecheck() {
+    EM_DEBUG(EM_typecheck, "typechecking for A_subscriptVar");
+	Ty_ty array_type = _var->typecheck();
+	Ty_ty subscript_type = _exp->typecheck();
+	if (array_type == Ty_Error() || subscript_type == Ty_Error()) {
+		return Ty_Error();
+	}
+	if (Ty_actual(array_type)->kind != Ty_array) {
+		EM_error("Typecheck subscriptVar: " + to_String(array_type) + " is not an array type");
+		return Ty_Error();
+	}
+	if (subscript_type != Ty_Int()) {
+		EM_error("Typecheck subscriptVar: subscript should be an int, not " + to_String(subscript_type));
+		return Ty_Error();
+	}
+	return Ty_actual(array_type)->u.array;
+}
+
 Ty_ty A_expList_::init_typecheck() {
-    EM_debug("typechecking for A_expList_");
-	Ty_ty head_type = _head->typecheck();
-	if (_tail == 0) {
-		return head_type;
-	} else {
-		return _tail->typecheck();
+    EM_DEBUG(EM_typecheck, "typechecking for A_expList_");
+	// check them all; the type of the list is that of the last one
+	Ty_ty last_type = Ty_Void();
+	for (A_exp e : *this) {
+		last_type = e->typecheck();
 	}
+	return last_type;
 }
 
 int let_counter = 0;
 
 Ty_ty A_letExp_::init_typecheck() {
-    EM_debug("typechecking for A_letExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_letExp_");
     // TODO Move this to a function call
     if (this->my_let_number < 0) {
         this->my_let_number = let_counter;
@@ -289,10 +380,10 @@ Ty_ty A_letExp_::init_typecheck() {
     }
 
     Ty_ty return_type;
-    EM_debug("Typechecking letExp #" + get_my_let_number_s() + " declarations");
+    EM_DEBUG(EM_typecheck, "Typechecking letExp #" + get_my_let_number_s() + " declarations");
     Ty_ty dec_type = _decs ? _decs->typecheck() : Ty_Void();
     if (dec_type != Ty_Error()) {
-        EM_debug("Typechecking letExp #" + get_my_let_number_s() + " body");
+        EM_DEBUG(EM_typecheck, "Typechecking letExp #" + get_my_let_number_s() + " body");
         return_type = _body ? _body->typecheck() : Ty_Void();
     } else {
         EM_warning("Typechecking error in letExp #" + get_my_let_number_s() + " declarations");
@@ -303,31 +394,33 @@ Ty_ty A_letExp_::init_typecheck() {
 }
 
 Ty_ty A_decList_::init_typecheck() {
-    EM_debug("typechecking for A_decList_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_decList_");
 
-	Ty_ty head_type = _head->typecheck();
-	if (_tail != 0) {
-	    EM_debug("Typechecking decList tail");
-		return _tail->typecheck();
+	Ty_ty last_type = Ty_Void();
+	for (A_dec dec : *this) {
+		last_type = dec->typecheck();
 	}
-	return head_type;
+	return last_type;
 }
 
 
 Ty_ty A_varDec_::init_typecheck() {
-    EM_debug("typechecking for A_varDec " + Symbol_to_string(_var));
+    EM_DEBUG(EM_typecheck, "typechecking for A_varDec " + Symbol_to_string(_var));
 
 	// If no _typ available, return type of _init
 	Ty_ty implicit_type = _init->typecheck();
 
 	if (Symbols_are_equal(_typ, to_Symbol("NA"))) {
+		if (implicit_type == Ty_Nil()) {
+			EM_error("Var " + Symbol_to_string(_var) + " is initialized to nil, so it needs a declared record type");
+			return Ty_Error();
+		}
 		return implicit_type;
 	} else {
-		// Lookup declared type in type_library
-		if (is_name_there(_typ, type_library)) {
-			type_info type_struct = lookup(_typ, type_library);
-			Ty_ty return_type = type_struct.my_type();
-			if (return_type != implicit_type) {
+		// Lookup declared type in the types around us
+		Ty_ty return_type = lookup_type(_typ);
+		if (return_type != 0) {
+			if (!Ty_assignable(return_type, implicit_type)) {
 				EM_error("Var " + Symbol_to_string(_var) + " declared type does not match the initialization type, got: " + repr(implicit_type) +
 				         "Not adding to Variable Symbol Table.");
 				return Ty_Error();
@@ -343,10 +436,11 @@ Ty_ty A_varDec_::init_typecheck() {
 }
 
 Ty_ty A_assignExp_::init_typecheck() {
-    EM_debug("typechecking for A_assignExp_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_assignExp_");
 	// Make sure type of _exp matches type initially stored in ST?
 	// Or can type info be overwritten?
-	if (_exp->typecheck() != _var->typecheck()) {
+	if (!Ty_assignable(_var->typecheck(), _exp->typecheck())) {
+		EM_error("Typechecking assignExp: can't assign " + to_String(_exp->typecheck()) + " to a variable of type " + to_String(_var->typecheck()));
 		return Ty_Error();
 	} else {
 		return Ty_Void();
@@ -354,22 +448,22 @@ Ty_ty A_assignExp_::init_typecheck() {
 }
 
 Ty_ty A_functionDec_::init_typecheck() {
-    EM_debug("typechecking for A_functionDec_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_functionDec_");
     return theFunctions->typecheck();
 }
 
 Ty_ty A_fundecList_::init_typecheck() {
-    EM_debug("typechecking for A_fundecList_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_fundecList_");
 	// Go through each fundec
-	_head->typecheck();
-	if (_tail != 0) {
-		return _tail->typecheck();
+	Ty_ty last_type = Ty_Void();
+	for (A_fundec fundec : *this) {
+		last_type = fundec->typecheck();
 	}
-	return _head->typecheck();
+	return last_type;
 }
 
 Ty_ty A_fundec_::init_typecheck() {
-    EM_debug("typechecking for A_fundec_ '" + Symbol_to_string(_name) + "' params");
+    EM_DEBUG(EM_typecheck, "typechecking for A_fundec_ '" + Symbol_to_string(_name) + "' params");
     if (_params) {
         Ty_ty param_type = _params->typecheck();
         if (param_type == Ty_Error()) {
@@ -377,20 +471,17 @@ Ty_ty A_fundec_::init_typecheck() {
         }
     }
     
-    EM_debug("Typechecking fundec '" + Symbol_to_string(_name) + "' return type matches body of fundec");
+    EM_DEBUG(EM_typecheck, "Typechecking fundec '" + Symbol_to_string(_name) + "' return type matches body of fundec");
     // Assert that the body of the function matches the return type stored in the function library
-    Ty_ty my_return_type_expected = Ty_Void();
-    if (is_name_there(_result, type_library)) {
-        type_info type_struct = lookup(_result, type_library);
-        Ty_ty this_type = type_struct.my_type();
-        my_return_type_expected = this_type;
-    } else {
+    Ty_ty my_return_type_expected = lookup_type(_result);
+    if (my_return_type_expected == 0) {
+        my_return_type_expected = Ty_Void();
         EM_error("Var " + Symbol_to_string(_name) + " in function declaration does not have type in type library.");
     }
     Ty_ty my_return_type_actual = _body->typecheck();
 
-    if (my_return_type_actual == my_return_type_expected) {
-        return my_return_type_actual;
+    if (Ty_assignable(my_return_type_expected, my_return_type_actual)) {
+        return my_return_type_expected;
     } else {
         EM_error("Typechecking fundec '" + Symbol_to_string(_name) + "' return type given does not match actual return type");
         return Ty_Error();
@@ -399,24 +490,23 @@ Ty_ty A_fundec_::init_typecheck() {
 
 
 Ty_ty A_fieldList_::init_typecheck() {
-    EM_debug("typechecking for A_fieldList_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_fieldList_");
 	// Go through each field
-	Ty_ty curr_type = _head->typecheck();
-	if (_tail != 0) {
-		return _tail->typecheck();
-	} 
+	Ty_ty curr_type = Ty_Void();
+	for (A_field field : *this) {
+		curr_type = field->typecheck();
+	}
 	return curr_type;
 }
 
 Ty_ty A_field_::init_typecheck() {
-    EM_debug("typechecking for A_field_");
+    EM_DEBUG(EM_typecheck, "typechecking for A_field_");
 	// Have to be added to Symbol Table on First Pass but not on second
 	if (firstPass) {
 		firstPass = false;
 		// Check if type _typ is in allowed or declared types
-		if (is_name_there(_typ, type_library)) { 
-			type_info type_struct = lookup(_typ, type_library);
-			Ty_ty this_type = type_struct.my_type();
+		Ty_ty this_type = lookup_type(_typ);
+		if (this_type != 0) {
 			return this_type;
 		} else {
 			EM_error("Var " + Symbol_to_string(_name) + " in function declaration does not have type in type library.");
@@ -426,3 +516,68 @@ Ty_ty A_field_::init_typecheck() {
 		return Ty_Void();
 	}
 }
+
+Ty_ty A_typeDec_::init_typecheck() {
+    EM_DEBUG(EM_typecheck, "typechecking for A_typeDec_");
+	// build each type now, so any errors in the declarations turn up even if the types aren't used
+	for (A_namety namety : *theTypes) {
+		if (namety->declared_type() == Ty_Error()) {
+			return Ty_Error();
+		}
+	}
+	return Ty_Void();
+}
+
+Ty_ty A_namety_::declared_type() {
+	if (stored_declared_type == 0) {
+		// a placeholder first, so a record type can have fields of its own type (see Ty_examples)
+		stored_declared_type = Ty_Name(_name, Ty_Error());
+		Ty_ty described = _ty->resolve_type();
+		stored_declared_type->u.name.ty = described;
+		Ty_ty actual = Ty_actual(stored_declared_type);
+		if (actual == Ty_Error() || (actual->kind != Ty_record && actual->kind != Ty_array)) {
+			stored_declared_type = actual;  // just another name for int, string or bool
+		}
+		EM_DEBUG(EM_typecheck, "Type " + Symbol_to_string(_name) + " is " + to_String(stored_declared_type));
+	}
+	return stored_declared_type;
+}
+
+Ty_ty A_nameTy_::resolve_type() {
+	Ty_ty named = lookup_type(_name);
+	if (named == 0) {
+		EM_error("Type " + Symbol_to_string(_name) + " has not been declared");
+		return Ty_Error();
+	}
+	return named;
+}
+
+Ty_ty A_recordty_::resolve_type() {
+	Ty_fieldList fields = 0;
+	int count = _record ? _record->length() : 0;
+	for (int i = count - 1; i >= 0; i--) {
+		A_field field = _record->element(i);
+		for (int j = 0; j < i; j++) {
+			if (Symbols_are_equal(_record->element(j)->get_name(), field->get_name())) {
+				EM_error("Record type has two fields called " + Symbol_to_string(field->get_name()));
+				return Ty_Error();
+			}
+		}
+		Ty_ty field_type = lookup_type(field->get_typ());
+		if (field_type == 0) {
+			EM_error("Type " + Symbol_to_string(field->get_typ()) + " of field " + Symbol_to_string(field->get_name()) + " has not been declared");
+			return Ty_Error();
+		}
+		fields = Ty_FieldList(Ty_Field(field->get_name(), field_type), fields);
+	}
+	return Ty_Record(fields);
+}
+
+Ty_ty A_arrayty_::resolve_type() {
+	Ty_ty element_type = lookup_type(_array);
+	if (element_type == 0) {
+		EM_error("Type " + Symbol_to_string(_array) + " of array elements has not been declared");
+		return Ty_Error();
+	}
+	return Ty_Array(element_type);
+}
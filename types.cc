@@ -6,6 +6,8 @@
  */
 
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 using namespace std;
 #include <hc_list.h>  // Haverford "list" class
 #include <hc_list_helpers.h>  // and associated extra functionality
@@ -51,7 +53,7 @@ void Ty_examples()  // examples
 					 Ty_FieldList(Ty_Field(0, Ty_Int()), // b
 						      Ty_FieldList(Ty_Field(0, Ty_Int()), // e
 								   0))))
-	   ? "Yes ... Dave is surprised" : "No ... if we want to compare more interesting types, we'll need a better function") <<
+	   ? "Yes, since function types are interned (parameter names don't matter)" : "No ... the interning table in types.cc is broken") <<
 	  endl;
 
 // 		function is_prime(i: int) : bool ....
@@ -84,6 +86,11 @@ void Ty_examples()  // examples
 																  0)));
 
 	cout << "type of list is: " << to_String(type_of_list) << endl;
+	cout << "is the record inside list the same as one built again from its fields? " <<
+	  ((Ty_actual(type_of_list) == Ty_Record(Ty_FieldList(Ty_Field(to_Symbol("head"), Ty_Int()),
+	                                                      Ty_FieldList(Ty_Field(to_Symbol("rest"), type_of_list), 0))))
+	   ? "yes" : "no --- bother!") << endl;
+	cout << "is list the same as complex? " << ((type_of_list == type_of_complex) ? "yes --- bother!" : "no") << endl;
 
 	cout << endl;
 }
@@ -109,34 +116,116 @@ Ty_ty Ty_Void() {return &tyvoid;}
 static struct Ty_ty_ tystring = {Ty_string};
 Ty_ty Ty_String() {return &tystring;}
 
-Ty_ty Ty_Record(Ty_fieldList fields)
+/*
+ * The interning table for function, record, and array types.
+ *
+ * A type is identified by its kind, the (already canonical) types it is built from, and,
+ *  for records, its field names; since the component types are canonical, comparing their
+ *  addresses is enough, so neither hashing nor lookup ever has to walk deeper than one level
+ *  (which also means recursive types, which always go through a Ty_Name, can't cause a loop).
+ */
+struct Ty_intern_key {
+	Ty_ty_kind kind;
+	std::vector<Ty_ty> types;    // array element, or function return type then parameters, or record fields
+	std::vector<string> names;   // record field names (parameter names aren't part of a function's type)
+
+	bool operator==(const Ty_intern_key &other) const {
+		return kind == other.kind && types == other.types && names == other.names;
+	}
+};
+struct Ty_intern_key_hash {
+	size_t operator()(const Ty_intern_key &key) const {
+		size_t h = std::hash<int>()(key.kind);
+		for (Ty_ty t : key.types) h = h * 31 + std::hash<Ty_ty>()(t);
+		for (const string &n : key.names) h = h * 31 + std::hash<string>()(n);
+		return h;
+	}
+};
+static std::unordered_map<Ty_intern_key, Ty_ty, Ty_intern_key_hash> &interned_types()
 {
-	Ty_ty p = new Ty_ty_;
-	p->kind=Ty_record;
-	p->u.record=fields;
+	static std::unordered_map<Ty_intern_key, Ty_ty, Ty_intern_key_hash> table;  // built on first use
+	return table;
+}
+
+// find the canonical type for key, or use "fresh" (a new Ty_ty_ with its fields filled in) as the canonical one
+static Ty_ty intern(const Ty_intern_key &key, Ty_ty (*fresh)(const Ty_intern_key &))
+{
+	auto found = interned_types().find(key);
+	if (found != interned_types().end()) {
+		return found->second;
+	}
+	Ty_ty p = fresh(key);
+	interned_types()[key] = p;
 	return p;
 }
 
+static Ty_fieldList fields_from(const Ty_intern_key &key, unsigned int first)
+{
+	Ty_fieldList result = 0;
+	for (unsigned int i = key.types.size(); i > first; i--) {
+		result = Ty_FieldList(Ty_Field(key.names.empty() ? 0 : to_Symbol(key.names[i-1]), key.types[i-1]), result);
+	}
+	return result;
+}
+
+// field name -> offset, for each record type (see Ty_record_size)
+static std::unordered_map<Ty_ty, std::unordered_map<string, int> > &record_layouts()
+{
+	static std::unordered_map<Ty_ty, std::unordered_map<string, int> > table;
+	return table;
+}
+
+Ty_ty Ty_Record(Ty_fieldList fields)
+{
+	Ty_intern_key key = {Ty_record};
+	for (Ty_fieldList f = fields; f != 0; f = f->tail) {
+		key.types.push_back(f->head->ty);
+		key.names.push_back(f->head->name ? Symbol_to_string(f->head->name) : "");
+	}
+	return intern(key, [](const Ty_intern_key &key) {
+		Ty_ty p = new Ty_ty_;
+		p->kind=Ty_record;
+		p->u.record=fields_from(key, 0);
+		std::unordered_map<string, int> &offsets = record_layouts()[p];
+		for (unsigned int i = 0; i < key.names.size(); i++) {
+			offsets.insert({key.names[i], i});  // the first, if a name is repeated (which typechecking reports)
+		}
+		return p;
+	});
+}
+
 Ty_ty Ty_Array(Ty_ty ty)
 {
-	Ty_ty p = new Ty_ty_;
-	p->kind=Ty_array;
-	p->u.array=ty;
-	return p;
+	Ty_intern_key key = {Ty_array, {ty}};
+	return intern(key, [](const Ty_intern_key &key) {
+		Ty_ty p = new Ty_ty_;
+		p->kind=Ty_array;
+		p->u.array=key.types[0];
+		return p;
+	});
 }
 
 
 Ty_ty Ty_Function(Ty_ty the_return_type, Ty_fieldList the_parameters)
 {
-	Ty_ty p = new Ty_ty_;
-	p->kind=Ty_function;
-	p->u.function.return_type = the_return_type;
-	p->u.function.parameter_types = the_parameters;
-	return p;
+	Ty_intern_key key = {Ty_function, {the_return_type}};
+	for (Ty_fieldList f = the_parameters; f != 0; f = f->tail) {
+		key.types.push_back(f->head->ty);
+	}
+	return intern(key, [](const Ty_intern_key &key) {
+		Ty_ty p = new Ty_ty_;
+		p->kind=Ty_function;
+		p->u.function.return_type = key.types[0];
+		p->u.function.parameter_types = fields_from(key, 1);
+		return p;
+	});
 }
 
-Ty_ty Ty_Name(Symbol sym, Ty_ty ty)
+static unsigned int name_count = 0;  // how many Ty_Name's exist, for Ty_actual
+
+Ty_ty Ty_Name(Symbol sym, Ty_ty ty)  // not interned: each type declaration makes a new type
 {
+	name_count++;
 	Ty_ty p = new Ty_ty_;
 	p->kind=Ty_name;
 	p->u.name.sym=sym;
@@ -144,6 +233,67 @@ Ty_ty Ty_Name(Symbol sym, Ty_ty ty)
 	return p;
 }
 
+Ty_ty Ty_actual(Ty_ty t)
+{
+	// a chain longer than the number of names must be a cycle, e.g. type a = b  type b = a
+	unsigned int steps = 0;
+	while (t != 0 && t->kind == Ty_name) {
+		if (++steps > name_count) {
+			EM_error("Type " + str(t->u.name.sym) + " is defined only in terms of itself");
+			return Ty_Error();
+		}
+		t = t->u.name.ty;
+	}
+	return t;
+}
+
+// skip past the names that only rename another named type, to the one that was actually declared
+static Ty_ty Ty_declared(Ty_ty t)
+{
+	unsigned int steps = 0;
+	while (t != 0 && t->kind == Ty_name && t->u.name.ty != 0 && t->u.name.ty->kind == Ty_name && ++steps <= name_count) {
+		t = t->u.name.ty;
+	}
+	return t;
+}
+
+bool Ty_assignable(Ty_ty wanted, Ty_ty value)
+{
+	if (Ty_declared(wanted) == Ty_declared(value)) {
+		return true;
+	}
+	return value == Ty_Nil() && Ty_actual(wanted) != 0 && Ty_actual(wanted)->kind == Ty_record;
+}
+
+int Ty_record_size(Ty_ty record)
+{
+	auto layout = record_layouts().find(Ty_actual(record));
+	return layout == record_layouts().end() ? 0 : layout->second.size();
+}
+
+int Ty_field_offset(Ty_ty record, Symbol field)
+{
+	auto layout = record_layouts().find(Ty_actual(record));
+	if (layout == record_layouts().end()) {
+		return -1;
+	}
+	auto offset = layout->second.find(Symbol_to_string(field));
+	return offset == layout->second.end() ? -1 : offset->second;
+}
+
+Ty_ty Ty_field_type(Ty_ty record, Symbol field)
+{
+	int offset = Ty_field_offset(record, field);
+	if (offset < 0) {
+		return 0;
+	}
+	Ty_fieldList fields = Ty_actual(record)->u.record;
+	for (int i = 0; i < offset; i++) {
+		fields = fields->tail;
+	}
+	return fields->head->ty;
+}
+
 
 Ty_tyList Ty_TyList(Ty_ty head, Ty_tyList tail)
 {
@@ -35,12 +35,39 @@ Ty_ty Ty_Placeholder(); // Used for keeping track if typecheck has already been
 /*
  * There are four "extending" constructors for types, for functions, records, arrays,
  *  and named types, which count as a kind of type in the tiger compiler:
+ *
+ * Function, record, and array types are "interned", like the primitives: building the same
+ *  type twice gives the same object, so two of these types are equal exactly when their
+ *  pointers are (parameter names aren't part of a function's type, but record field names
+ *  are part of a record's).  Since a type is only looked up by its immediate parts,
+ *  the parts must already be canonical, i.e. come from these functions.
+ * Named types are not interned, since each type declaration makes a new type (as in Tiger,
+ *  where "type a = {x: int}" and "type b = {x: int}" are different types), and since the name
+ *  is created first and filled in later for recursive types (see Ty_examples).
+ *  So compare named types by pointer as well, and use Ty_actual to look through them.
  */
 
 Ty_ty Ty_Function(Ty_ty the_return_type, Ty_fieldList the_parameters);
 Ty_ty Ty_Record(Ty_fieldList fields);
 Ty_ty Ty_Array(Ty_ty ty);
 Ty_ty Ty_Name(Symbol sym, Ty_ty ty);
+Ty_ty Ty_actual(Ty_ty t);  // skip past any Ty_Name's to the underlying type
+
+/*
+ * Can a value of type "value" go where "wanted" is needed (in an assignment, as an argument, etc.)?
+ *  Yes if they're the same type, or one is just another name for the other (type b = a),
+ *  or the value is nil and a record is wanted.
+ */
+bool Ty_assignable(Ty_ty wanted, Ty_ty value);
+
+/*
+ * The layout of a record in memory: one cell per field, in the order they were declared.
+ *  Ty_Record works out the offset of each field when it first builds a record type, i.e. when
+ *  the type is declared, so code generation just looks them up (these also accept a Ty_Name).
+ */
+int Ty_record_size(Ty_ty record);
+int Ty_field_offset(Ty_ty record, Symbol field);  // -1 if there's no such field
+Ty_ty Ty_field_type(Ty_ty record, Symbol field);  // 0 if there's no such field
 
 /*
  * The above rely on things like fields and lists, so here are their constructors:
@@ -49,6 +49,27 @@ string repr_for_std_string(const string  &s)
 	return rep;
 }
 
+static bool is_octal_digit(char c) { return '0' <= c && c <= '7'; }
+
+// Undo repr_for_std_string: drop the quotes and turn the \ooo escapes back into characters
+string unrepr_for_std_string(const string &rep)
+{
+	string s = "";
+	unsigned int begin = (rep.length() >= 2 && rep[0] == '\"') ? 1 : 0;
+	unsigned int end = begin == 1 ? rep.length()-1 : rep.length();
+	for (unsigned int i=begin; i<end; i++) {
+		if (rep[i] == '\\' && i+3 < end && is_octal_digit(rep[i+1]) && is_octal_digit(rep[i+2]) && is_octal_digit(rep[i+3])) {
+			s.append(1, char(((rep[i+1]-'0') * 8 + (rep[i+2]-'0')) * 8 + (rep[i+3]-'0')));
+			i += 3;
+		} else if (rep[i] == '\\' && i+1 < end) {
+			s.append(1, rep[++i]);
+		} else {
+			s.append(1, rep[i]);
+		}
+	}
+	return s;
+}
+
 
 // useful for testing/demonstrating repr vs. plain strings
 string util_example_string_chars_1_through_7f()
@@ -13,6 +13,7 @@ typedef std::string String;  // for compatibility with some old code
 
 
 string repr_for_std_string(const string &s);  // non-trivial; in util.cc (changes non-printing characters into \x##)
+string unrepr_for_std_string(const string &rep);  // the other way, e.g. for the (repr'd) value of an A_stringExp_
 template<class T> string repr(T *p)   { return p->__repr__(); }
 template<class T> string repr(T &x)   { return x.__repr__(); }
 // template<>        string repr(string &s) { return repr_for_std_string(s); }
@@ -0,0 +1,295 @@
+#ifndef BINARY_WRITER_VISITOR_H
+#define BINARY_WRITER_VISITOR_H
+#include <map>
+#include <vector>
+#include "../AST.h"
+#include "../AST_binary.h"
+#include "visitor.h"
+
+// Writes the nodes of a tree in the format described in AST_binary.h.
+// The nodes go into "nodes"; the strings they refer to are collected in "strings",
+//  which AST_save_binary writes out ahead of the nodes.
+struct BinaryWriterVisitor : Visitor<BinaryWriterVisitor, void, VoidContext> {
+    bool with_attributes = false;
+    string nodes;
+    std::vector<string> strings;
+    std::map<string, int> string_index;
+
+    void accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            put_uint(AST_kind_unknown);  // no node
+            return;
+        }
+        node->accept(*this, ctx);
+        if (with_attributes) {
+            put_attributes(node);
+        }
+    }
+
+    void put_uint(unsigned int n) {
+        while (n >= 0x80) {
+            nodes += char((n & 0x7f) | 0x80);
+            n >>= 7;
+        }
+        nodes += char(n);
+    }
+    void put_int(int n) {  // zig-zag, so small negative numbers stay small too
+        put_uint(((unsigned int) n << 1) ^ (unsigned int) (n >> 31));
+    }
+    unsigned int string_number(const string &s) {
+        auto found = string_index.find(s);
+        if (found == string_index.end()) {
+            found = string_index.insert(std::make_pair(s, (int) strings.size())).first;
+            strings.push_back(s);
+        }
+        return found->second;
+    }
+    void put_string(const string &s) {
+        put_uint(string_number(s));
+    }
+    void put_symbol(Symbol sym) {  // allows a null symbol (as 0), e.g. for a field declared without a type
+        put_uint(sym == 0 ? 0 : string_number(Symbol_to_string(sym)) + 1);
+    }
+    void put_pos(A_pos pos) {
+        if (pos.is_undefined()) {
+            put_uint(0);
+            return;
+        }
+        put_uint(pos.begin_line());
+        put_uint(pos.begin_column());
+        put_int(pos.end_line() - pos.begin_line());
+        put_uint(pos.end_column());
+    }
+    void put_node(AST_node_* node) {
+        put_uint(node->kind());
+        put_pos(node->pos());
+    }
+    template<typename List>
+    void put_list(List* node, VoidContext ctx) {
+        put_uint(node->kind());
+        put_uint(node->length());
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+    }
+    void put_attributes(AST_node_* node) {
+        // only the primitive types are saved; anything else is worked out again after loading
+        Ty_ty type = node->typecheck_done() ? node->typecheck() : Ty_Placeholder();
+        bool primitive = type->kind == Ty_error || type->kind == Ty_nil || type->kind == Ty_int
+                      || type->kind == Ty_bool || type->kind == Ty_void || type->kind == Ty_string;
+        put_uint(primitive ? type->kind + 1 : 0);
+        A_exp_* exp = dynamic_cast<A_exp_*>(node);
+        if (exp != 0) {
+            put_int(exp->result_reg());
+        }
+        A_letExp_* let = dynamic_cast<A_letExp_*>(node);
+        if (let != 0) {
+            put_int(let->get_my_let_number());
+        }
+        A_fieldVar_* field = dynamic_cast<A_fieldVar_*>(node);
+        if (field != 0) {
+            put_int(field->get_offset());
+        }
+    }
+
+    void visitAST_node(AST_node_* node, VoidContext ctx) {
+         EM_error("Not implemented");
+    }
+    void visitRoot(A_root_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_root_");
+        put_uint(AST_kind_root);
+        accept(node->get_main_expr(), ctx);
+    }
+    void visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_nilExp_");
+        put_node(node);
+    }
+    void visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_boolExp_");
+        put_node(node);
+        put_uint(node->get_value());
+    }
+    void visitIntExp(A_intExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_intExp_");
+        put_node(node);
+        put_int(node->get_value());
+    }
+    void visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_stringExp_");
+        put_node(node);
+        put_string(node->get_value());
+    }
+    void visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_recordExp_");
+        put_node(node);
+        put_symbol(node->get_typ());
+        accept(node->get_fields(), ctx);
+    }
+    void visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_arrayExp_");
+        put_node(node);
+        put_symbol(node->get_typ());
+        accept(node->get_size(), ctx);
+        accept(node->get_init(), ctx);
+    }
+    void visitVarExp(A_varExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_varExp_");
+        put_node(node);
+        accept(node->get_var(), ctx);
+    }
+    void visitOpExp(A_opExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_opExp_");
+        put_node(node);
+        put_uint(node->get_oper());
+        accept(node->get_left(), ctx);
+        accept(node->get_right(), ctx);
+    }
+    void visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_assignExp_");
+        put_node(node);
+        accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
+    }
+    void visitLetExp(A_letExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_letExp_");
+        put_node(node);
+        accept(node->get_decs(), ctx);
+        accept(node->get_body(), ctx);
+    }
+    void visitCallExp(A_callExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_callExp_");
+        put_node(node);
+        put_symbol(node->get_func());
+        accept(node->get_args(), ctx);
+    }
+    void visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_ifExp_");
+        put_node(node);
+        accept(node->get_test(), ctx);
+        accept(node->get_then(), ctx);
+        accept(node->get_else_or_null(), ctx);
+    }
+    void visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_whileExp_");
+        put_node(node);
+        accept(node->get_test(), ctx);
+        accept(node->get_body(), ctx);
+    }
+    void visitForExp(A_forExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_forExp_");
+        put_node(node);
+        put_symbol(node->get_var());
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        accept(node->get_body(), ctx);
+    }
+    void visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_breakExp_");
+        put_node(node);
+    }
+    void visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_seqExp_");
+        put_node(node);
+        accept(node->get_seq(), ctx);
+    }
+    void visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_simpleVar_");
+        put_node(node);
+        put_symbol(node->get_sym());
+    }
+    void visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_fieldVar_");
+        put_node(node);
+        accept(node->get_var(), ctx);
+        put_symbol(node->get_sym());
+    }
+    void visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_subscriptVar_");
+        put_node(node);
+        accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
+    }
+    void visitExpList(A_expList_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_expList_");
+        put_list(node, ctx);
+    }
+    void visitEfield(A_efield_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_efield_");
+        put_uint(AST_kind_efield);
+        put_symbol(node->get_name());
+        accept(node->get_exp(), ctx);
+    }
+    void visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_efieldList_");
+        put_list(node, ctx);
+    }
+    void visitDecList(A_decList_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_decList_");
+        put_list(node, ctx);
+    }
+    void visitVarDec(A_varDec_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_varDec_");
+        put_node(node);
+        put_symbol(node->get_var());
+        put_symbol(node->get_typ());
+        accept(node->get_init(), ctx);
+    }
+    void visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_typeDec_");
+        put_node(node);
+        accept(node->get_theTypes(), ctx);
+    }
+    void visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_functionDec_");
+        put_node(node);
+        accept(node->get_theFunctions(), ctx);
+    }
+    void visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_fundecList_");
+        put_list(node, ctx);
+    }
+    void visitFundec(A_fundec_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_fundec_");
+        put_node(node);
+        put_symbol(node->get_name());
+        accept(node->get_params(), ctx);
+        put_symbol(node->get_result());
+        accept(node->get_body(), ctx);
+    }
+    void visitNamety(A_namety_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_namety_");
+        put_node(node);
+        put_symbol(node->get_name());
+        accept(node->get_ty(), ctx);
+    }
+    void visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_nametyList_");
+        put_list(node, ctx);
+    }
+    void visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_fieldList_");
+        put_list(node, ctx);
+    }
+    void visitField(A_field_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_field_");
+        put_node(node);
+        put_symbol(node->get_name());
+        put_symbol(node->get_typ());
+    }
+    void visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_nameTy_");
+        put_node(node);
+        put_symbol(node->get_name());
+    }
+    void visitRecordty(A_recordty_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_recordty_");
+        put_node(node);
+        accept(node->get_record(), ctx);
+    }
+    void visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        EM_DEBUG(EM_visitors, "writing A_arrayty_");
+        put_node(node);
+        put_symbol(node->get_array());
+    }
+};
+#endif
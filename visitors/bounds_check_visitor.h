@@ -0,0 +1,296 @@
+#ifndef BOUNDS_CHECK_VISITOR_H
+#define BOUNDS_CHECK_VISITOR_H
+#include <map>
+#include <set>
+#include <vector>
+#include "../AST.h"
+#include "../call_graph.h"
+#include "visitor.h"
+
+// Finds the array subscripts whose bounds checks can go (see optimize.h). Only a[i] with "a" a
+//  variable and "i" the variable of a for loop around it, in the same function, is considered:
+//   - if "a" was created as T[n] of ..., and the loop runs from a non-negative constant to n-1
+//     (or to a constant below a constant size), a[i] can't be out of bounds;
+//   - otherwise, if the loop has no loops or function declarations inside it, the loop can check
+//     lo >= 0 and hi < the length of "a" once before it starts, and run a copy of its body
+//     without the check when that holds.
+//  Either way, neither "a" nor "n" may be assigned anywhere, so they mean the same thing
+//  throughout the loop.
+// Each visit returns true if the code has a loop or a function declaration in it, since a loop
+//  like that isn't worth making two copies of (or can't be, for the function).
+// Variables are matched to their declarations with CG_declaration_of, and which ones are assigned
+//  (or declared inside a loop) comes from the call graph (CG_writes).
+struct BoundsCheckVisitor : Visitor<BoundsCheckVisitor, bool, VoidContext> {
+    std::set<AST_node_*> safe;                                  // A_subscriptVar_s that need no check
+    std::map<AST_node_*, AST_node_*> hoisted;                   // A_subscriptVar_ -> the A_forExp_ that checks it
+    std::map<AST_node_*, std::vector<AST_node_*> > loop_arrays; // A_forExp_ -> an A_simpleVar_ for each array to check
+    std::vector<string> report;
+
+    void find(A_root_* root, const CG_graph &graph) {
+        writes = &graph.writes;
+        accept(root, VoidContext());
+
+        std::map<AST_node_*, std::set<AST_node_*> > checked;  // the arrays each loop checks already
+        for (Access &access : accesses) {
+            string where = "line " + std::to_string(access.node->pos().begin_line()) + ": ";
+            if (writes->assigned_anywhere.count(access.array)) {
+                continue;
+            }
+            if (access.in_bounds && (access.size == 0 || !writes->assigned_anywhere.count(access.size))) {
+                safe.insert(access.node);
+                report.push_back(where + "removed bounds check on " + Symbol_to_string(access.array_var->get_sym()) +
+                                 " (the loop stays within its size)");
+            } else if (repeatable[access.loop]) {
+                hoisted[access.node] = access.loop;
+                if (checked[access.loop].insert(access.array).second) {
+                    loop_arrays[access.loop].push_back(access.array_var);
+                }
+                report.push_back(where + "moved bounds check on " + Symbol_to_string(access.array_var->get_sym()) +
+                                 " before the loop at line " + std::to_string(access.loop->pos().begin_line()));
+            }
+        }
+    }
+
+    bool accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return false;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    bool visitAST_node(AST_node_* node, VoidContext ctx) {
+        return true;
+    }
+    bool visitRoot(A_root_* node, VoidContext ctx) {
+        return accept(node->get_main_expr(), ctx);
+    }
+    bool visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return accept(node->get_fields(), ctx);
+    }
+    bool visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        bool size = accept(node->get_size(), ctx);
+        return accept(node->get_init(), ctx) || size;
+    }
+    bool visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    bool visitOpExp(A_opExp_* node, VoidContext ctx) {
+        bool left = accept(node->get_left(), ctx);
+        return accept(node->get_right(), ctx) || left;
+    }
+    bool visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        bool exp = accept(node->get_exp(), ctx);
+        return accept(node->get_var(), ctx) || exp;
+    }
+    bool visitLetExp(A_letExp_* node, VoidContext ctx) {
+        bool decs = accept(node->get_decs(), ctx);
+        bool body = accept(node->get_body(), ctx);
+        return decs || body;
+    }
+    bool visitCallExp(A_callExp_* node, VoidContext ctx) {
+        return accept(node->get_args(), ctx);
+    }
+    bool visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        bool test = accept(node->get_test(), ctx);
+        bool then = accept(node->get_then(), ctx);
+        return accept(node->get_else_or_null(), ctx) || test || then;
+    }
+    bool visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        accept(node->get_body(), ctx);
+        return true;
+    }
+    bool visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        Loop loop = {node, function, false, 0, 0, false, 0};
+        A_intExp_* lo = dynamic_cast<A_intExp_*>(node->get_lo());
+        loop.lo_ok = lo != 0 && lo->get_value() >= 0;
+        A_intExp_* hi = dynamic_cast<A_intExp_*>(node->get_hi());
+        A_opExp_* hi_op = dynamic_cast<A_opExp_*>(node->get_hi());
+        if (hi != 0) {
+            loop.hi_is_constant = true;
+            loop.hi_constant = hi->get_value();
+        } else if (hi_op != 0 && hi_op->get_oper() == A_minusOp) {  // n-c
+            A_simpleVar_* n = simple_var(hi_op->get_left());
+            A_intExp_* c = dynamic_cast<A_intExp_*>(hi_op->get_right());
+            if (n != 0 && c != 0 && c->get_value() >= 1) {
+                loop.hi_size = CG_declaration_of(n);
+                loop.hi_minus = c->get_value();
+            }
+        }
+        loops.push_back(loop);
+        repeatable[node] = !accept(node->get_body(), ctx);
+        loops.pop_back();
+        return true;
+    }
+    bool visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    bool visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    bool visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        bool var = accept(node->get_var(), ctx);
+        bool exp = accept(node->get_exp(), ctx);
+        A_simpleVar_* array = dynamic_cast<A_simpleVar_*>(node->get_var());
+        A_simpleVar_* index = simple_var(node->get_exp());
+        if (array == 0 || index == 0) {
+            return var || exp;
+        }
+        AST_node_* index_declaration = CG_declaration_of(index);
+        for (auto loop = loops.rbegin(); loop != loops.rend(); loop++) {
+            if (loop->node != index_declaration) {
+                continue;
+            }
+            AST_node_* array_declaration = CG_declaration_of(array);
+            if (loop->function != function || array_declaration == 0 || writes->declares(loop->node, array_declaration)) {
+                break;  // another function's loop, or the array is declared inside the loop
+            }
+            Access access = {node, array, array_declaration, loop->node, 0, false};
+            auto size = sizes.find(access.array);
+            if (loop->lo_ok && size != sizes.end()) {
+                access.size = size->second.variable;
+                access.in_bounds = size->second.variable != 0 ?
+                                   size->second.variable == loop->hi_size :
+                                   loop->hi_is_constant && loop->hi_constant < size->second.constant;
+            }
+            accesses.push_back(access);
+            break;
+        }
+        return var || exp;
+    }
+    bool visitExpList(A_expList_* node, VoidContext ctx) {
+        bool found = false;
+        for (AST_node_* element : *node) {
+            found = accept(element, ctx) || found;
+        }
+        return found;
+    }
+    bool visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    bool visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        bool found = false;
+        for (AST_node_* element : *node) {
+            found = accept(element, ctx) || found;
+        }
+        return found;
+    }
+    bool visitDecList(A_decList_* node, VoidContext ctx) {
+        bool found = false;
+        for (AST_node_* element : *node) {
+            found = accept(element, ctx) || found;
+        }
+        return found;
+    }
+    bool visitVarDec(A_varDec_* node, VoidContext ctx) {
+        bool found = accept(node->get_init(), ctx);
+        A_arrayExp_* init = dynamic_cast<A_arrayExp_*>(node->get_init());
+        if (init != 0) {
+            A_intExp_* constant = dynamic_cast<A_intExp_*>(init->get_size());
+            A_simpleVar_* variable = simple_var(init->get_size());
+            if (constant != 0) {
+                sizes[node] = Size{constant->get_value(), 0};
+            } else if (variable != 0) {
+                sizes[node] = Size{0, CG_declaration_of(variable)};
+            }
+        }
+        return found;
+    }
+    bool visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        accept(node->get_theFunctions(), ctx);
+        return true;
+    }
+    bool visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return true;
+    }
+    bool visitFundec(A_fundec_* node, VoidContext ctx) {
+        string outer_function = function;
+        function = node->get_my_unique_function_name();
+        accept(node->get_body(), ctx);
+        function = outer_function;
+        return true;
+    }
+    bool visitNamety(A_namety_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitField(A_field_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return false;
+    }
+
+private:
+    struct Loop {
+        AST_node_* node;
+        string function;
+        bool lo_ok;               // starts at a constant >= 0
+        AST_node_* hi_size;       // ends at hi_size - hi_minus, for a variable hi_size ...
+        int hi_minus;
+        bool hi_is_constant;      // ... or else at a constant
+        int hi_constant;
+    };
+    struct Size {                 // of an array created by T[size] of ..., in a var declaration
+        int constant;
+        AST_node_* variable;      // the declaration of the size variable, or 0 for a constant
+    };
+    struct Access {
+        A_subscriptVar_* node;
+        A_simpleVar_* array_var;
+        AST_node_* array;         // the array variable's declaration
+        AST_node_* loop;          // the A_forExp_ whose variable is the subscript
+        AST_node_* size;          // the declaration of the array's size variable, if in_bounds needs it
+        bool in_bounds;
+    };
+
+    const CG_writes* writes = 0;
+    std::vector<Loop> loops;                             // innermost last
+    std::map<AST_node_*, Size> sizes;                    // by array variable declaration
+    std::map<AST_node_*, bool> repeatable;               // loops with no loops or functions inside
+    std::vector<Access> accesses;
+    string function = "";
+
+    A_simpleVar_* simple_var(AST_node_* exp) {
+        A_varExp_* var_exp = dynamic_cast<A_varExp_*>(exp);
+        return var_exp == 0 ? 0 : dynamic_cast<A_simpleVar_*>(var_exp->get_var());
+    }
+};
+#endif
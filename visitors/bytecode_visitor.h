@@ -0,0 +1,507 @@
+#ifndef BYTECODE_VISITOR_H
+#define BYTECODE_VISITOR_H
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "../AST.h"
+#include "../VM.h"
+#include "visitor.h"
+
+// Compiles a typechecked tree into the register bytecode of VM.h (the -vm flag in tiger.cc).
+// Each visit returns the register that holds the expression's value (-1 if it has none); a
+//  variable's value is just its own register, at the SP offset from its var_info, so using one
+//  costs nothing.  Temporaries are handed out like a stack and numbered from temp_base until the
+//  end of the function, when we know how many registers its variables need and can put the
+//  temporaries just above them.
+// A variable of an enclosing function is reached with LOADF and STOREF, through the static links
+//  that visitors/static_link_visitor.h worked out for the HERA code.
+struct BytecodeVisitor : Visitor<BytecodeVisitor, int, VoidContext> {
+    VM_program program;
+
+    // Returns false (after an EM_error) if the program uses something the VM can't do yet
+    bool compile(A_root_* root) {
+        accept(root, VoidContext());
+        return !EM_recorded_any_errors();
+    }
+
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return -1;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        EM_error("The bytecode VM can't handle this kind of expression yet", false, node->pos());
+        return -1;
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        start_function("main", 0);
+        accept(node->get_main_expr(), ctx);
+        emit(VM_HALT);
+        finish_function();
+        return -1;
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return emit_value(VM_LOADK, new_temp(), 0);
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return emit_value(VM_LOADK, new_temp(), node->get_value());
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return emit_value(VM_LOADK, new_temp(), int16_t(node->get_value()));
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        string value = unrepr_for_std_string(node->get_value());
+        auto found = string_numbers.find(value);
+        if (found == string_numbers.end()) {
+            found = string_numbers.insert(std::make_pair(value, int(program.strings.size()))).first;
+            program.strings.push_back(value);
+        }
+        return emit_value(VM_LOADS, new_temp(), found->second);
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        Ty_ty record_type = node->typecheck();
+        int record = emit_value(VM_NEWREC, new_temp(), Ty_record_size(record_type));
+        int saved = next_temp;
+        A_efieldList_* fields = static_cast<A_efieldList_*>(node->get_fields());
+        int count = fields ? fields->length() : 0;
+        for (int i = 0; i < count; i++) {
+            A_efield_* field = fields->element(i);
+            emit(VM_SETFIELD, accept(field->get_exp(), ctx), record, Ty_field_offset(record_type, field->get_name()));
+            next_temp = saved;
+        }
+        return record;
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        int saved = next_temp;
+        int size = accept(node->get_size(), ctx);
+        if (!is_temp(size) && !is_leaf(node->get_init())) {
+            size = move(new_temp(), size);  // the initial value might assign to this variable
+        }
+        int init = accept(node->get_init(), ctx);
+        next_temp = saved;
+        return emit_value(VM_NEWARRAY, new_temp(), size, init);
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        int saved = next_temp;
+        int left = accept(node->get_left(), ctx);
+        if (!is_temp(left) && !is_leaf(node->get_right())) {
+            left = move(new_temp(), left);  // the right side might assign to this variable
+        }
+        int right = accept(node->get_right(), ctx);
+        next_temp = saved;
+        int result = new_temp();
+        if (node->get_left()->typecheck() == Ty_String()) {  // compare -1/0/1 from STRCMP with 0
+            emit(VM_STRCMP, result, left, right);
+            right = emit_value(VM_LOADK, new_temp(), 0);
+            left = result;
+            next_temp = saved + 1;
+        }
+        switch (node->get_oper()) {
+        case A_plusOp:   return emit_value(VM_ADD, result, left, right);
+        case A_minusOp:  return emit_value(VM_SUB, result, left, right);
+        case A_timesOp:  return emit_value(VM_MUL, result, left, right);
+        case A_divideOp: return emit_value(VM_DIV, result, left, right);
+        case A_eqOp:     return emit_value(VM_EQ, result, left, right);
+        case A_neqOp:    return emit_value(VM_NE, result, left, right);
+        case A_ltOp:     return emit_value(VM_LT, result, left, right);
+        case A_leOp:     return emit_value(VM_LE, result, left, right);
+        case A_gtOp:     return emit_value(VM_GT, result, left, right);
+        case A_geOp:     return emit_value(VM_GE, result, left, right);
+        }
+        return visitAST_node(node, ctx);
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        // as in -run, the value first, and then where it goes
+        int saved = next_temp;
+        AST_node_* var = node->get_var();
+        if (var->kind() == AST_kind_simpleVar && static_cast<A_simpleVar_*>(var)->get_frames_out() == 0) {
+            move(variable_register(static_cast<A_simpleVar_*>(var)), accept(node->get_exp(), ctx));
+            next_temp = saved;
+            return -1;
+        }
+        int value = accept(node->get_exp(), ctx);
+        if (!is_temp(value)) {
+            value = move(new_temp(), value);  // finding the place might change the variable
+        }
+        if (var->kind() == AST_kind_simpleVar) {
+            A_simpleVar_* outer = static_cast<A_simpleVar_*>(var);
+            emit(VM_STOREF, value, frame_pointer(outer->get_frames_out()), outer_register(outer));
+        } else if (var->kind() == AST_kind_fieldVar) {
+            A_fieldVar_* field = static_cast<A_fieldVar_*>(var);
+            emit(VM_SETFIELD, value, accept(field->get_var(), ctx), field->get_offset());
+        } else {
+            A_subscriptVar_* element = static_cast<A_subscriptVar_*>(var);
+            int array = accept(element->get_var(), ctx);
+            if (!is_temp(array) && !is_leaf(element->get_exp())) {
+                array = move(new_temp(), array);
+            }
+            emit(VM_SETELEM, value, array, accept(element->get_exp(), ctx));
+        }
+        next_temp = saved;
+        return -1;
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        accept(node->get_decs(), ctx);
+        return accept(node->get_body(), ctx);
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        function_info callee = lookup(node->get_func(), node->get_local_function_library());
+        int library = -1, function = -1;
+        if (callee.tiger_function) {
+            library = VM_library_function(Symbol_to_string(node->get_func()));
+            if (library < 0) {
+                EM_error("The bytecode VM doesn't have the library function " + Symbol_to_string(node->get_func()),
+                         false, node->pos());
+                return -1;
+            }
+        } else {
+            function = function_number(node->get_my_unique_function_name());
+        }
+
+        // the arguments go in consecutive registers, starting at the one that will get the result,
+        //  and then the static link, if the callee takes one
+        int saved = next_temp;
+        A_expList_* args = static_cast<A_expList_*>(node->get_args());
+        int n = args ? args->length() : 0;
+        bool link = library < 0 && node->get_static_link() >= 0;
+        int first = temp_base + next_temp;
+        next_temp += n + link;
+        for (int i = 0; i < n; i++) {
+            int before_arg = next_temp;
+            move(first + i, accept(args->element(i), ctx));
+            next_temp = before_arg;
+        }
+        if (link) {
+            move(first + n, frame_pointer(node->get_static_link()));
+        }
+        next_temp = saved;
+        int result = node->typecheck() == Ty_Void() ? -1 : new_temp();
+        if (library >= 0) {
+            emit_value(VM_CALLLIB, library, first, result);
+        } else {
+            emit_value(VM_CALL, function, first, result);
+        }
+        return result;
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        int saved = next_temp;
+        int test = accept(node->get_test(), ctx);
+        next_temp = saved;
+        int to_else = emit(VM_JUMPF, test, -1);
+        int result = node->typecheck() == Ty_Void() ? -1 : new_temp();
+        branch(result, node->get_then(), ctx);
+        if (node->get_else_or_null() == 0) {
+            patch(to_else, here());
+        } else {
+            int to_end = emit(VM_JUMP, -1);
+            patch(to_else, here());
+            branch(result, node->get_else_or_null(), ctx);
+            patch(to_end, here());
+        }
+        return result;
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        int saved = next_temp;
+        breaks.push_back(std::vector<int>());
+        int top = here();
+        int test = accept(node->get_test(), ctx);
+        next_temp = saved;
+        int to_end = emit(VM_JUMPF, test, -1);
+        accept(node->get_body(), ctx);
+        next_temp = saved;
+        emit(VM_JUMP, top);
+        patch(to_end, here());
+        patch_breaks();
+        return -1;
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        int saved = next_temp;
+        int var = declaration_register(node), hi = var + 1;  // as in the HERA code, hi is kept just above the variable
+        use_register(hi);
+        move(var, accept(node->get_lo(), ctx));
+        next_temp = saved;
+        move(hi, accept(node->get_hi(), ctx));
+        next_temp = saved;
+
+        breaks.push_back(std::vector<int>());
+        int top = here();
+        int to_end = emit(VM_JUMPGT, var, hi, -1);
+        accept(node->get_body(), ctx);
+        next_temp = saved;
+        emit(VM_INCR, var);
+        emit(VM_JUMP, top);
+        patch(to_end, here());
+        patch_breaks();
+        return -1;
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        breaks.back().push_back(emit(VM_JUMP, -1));
+        return -1;
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        if (node->get_frames_out() > 0) {
+            int saved = next_temp;
+            int frame = frame_pointer(node->get_frames_out());
+            next_temp = saved;
+            return emit_value(VM_LOADF, new_temp(), frame, outer_register(node));
+        }
+        return variable_register(node);
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        int saved = next_temp;
+        int record = accept(node->get_var(), ctx);
+        next_temp = saved;
+        return emit_value(VM_GETFIELD, new_temp(), record, node->get_offset());
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        int saved = next_temp;
+        int array = accept(node->get_var(), ctx);
+        if (!is_temp(array) && !is_leaf(node->get_exp())) {
+            array = move(new_temp(), array);  // the subscript might assign to this variable
+        }
+        int index = accept(node->get_exp(), ctx);
+        next_temp = saved;
+        return emit_value(VM_GETELEM, new_temp(), array, index);
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        int saved = next_temp;
+        int last = -1;
+        for (AST_node_* element : *node) {
+            next_temp = saved;
+            last = accept(element, ctx);
+        }
+        return last;
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        return visitAST_node(node, ctx);  // visitRecordExp does the fields itself
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        return visitAST_node(node, ctx);
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return -1;
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        int saved = next_temp;
+        move(declaration_register(node), accept(node->get_init(), ctx));
+        next_temp = saved;
+        return -1;
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return -1;
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return -1;
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        Function_state outer = state;  // the function we were in the middle of
+        A_fieldList_* params = node->cast_params();
+        start_function(node->get_my_unique_function_name(), params ? params->length() : 0, node);
+        int result = accept(node->get_body(), ctx);
+        emit(VM_RET, result);
+        finish_function();
+        state = outer;
+        return -1;
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return -1;
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return -1;
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return -1;
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return -1;
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return -1;
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return -1;
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return -1;
+    }
+
+private:
+    static const int temp_base = 1 << 20;  // temporaries are numbered from here until finish_function
+
+    struct Function_state {
+        int function = -1;           // in program.functions
+        A_fundec_* fundec = 0;       // 0 for main
+        int next_temp = 0, max_temps = 0;
+        int variable_registers = 3;  // as in HERA, 0-2 are the return address, caller's FP and static link/result
+        int value_instruction = -1;  // the last instruction, if it just put a value in a temporary (see move)
+        std::vector<std::vector<int> > breaks;  // to patch, for each loop we're in
+    };
+    Function_state state;
+    int &next_temp = state.next_temp;
+    std::vector<std::vector<int> > &breaks = state.breaks;
+
+    std::map<string, int> function_numbers;  // by unique name
+    std::map<string, int> string_numbers;
+
+    std::vector<VM_instruction> &code() {
+        return program.functions[state.function].code;
+    }
+    int emit(VM_opcode op, int a = -1, int b = -1, int c = -1) {
+        code().push_back(VM_instruction{op, a, b, c});
+        state.value_instruction = -1;
+        return code().size() - 1;
+    }
+    int emit_value(VM_opcode op, int a, int b = -1, int c = -1) {  // an instruction that puts a value in a temporary
+        emit(op, a, b, c);
+        state.value_instruction = code().size() - 1;
+        return *destination(code().back());
+    }
+    static int *destination(VM_instruction &inst) {  // the register an instruction changes
+        return inst.op == VM_CALL || inst.op == VM_CALLLIB ? &inst.c : &inst.a;
+    }
+    int here() {  // the next instruction, about to be a jump target, so it mustn't be changed by move
+        state.value_instruction = -1;
+        return code().size();
+    }
+    void patch(int jump, int target) {
+        VM_instruction &inst = code()[jump];
+        if (inst.op == VM_JUMP) {
+            inst.a = target;
+        } else if (inst.op == VM_JUMPF) {
+            inst.b = target;
+        } else {
+            inst.c = target;
+        }
+    }
+    void patch_breaks() {
+        for (int jump : breaks.back()) {
+            patch(jump, here());
+        }
+        breaks.pop_back();
+    }
+
+    // Puts register from into register to; if from is the temporary the last instruction just computed, that
+    //  instruction can put its value straight into to instead
+    int move(int to, int from) {
+        if (from < 0 || from == to) {
+            return to;
+        }
+        if (is_temp(from) && state.value_instruction >= 0 && *destination(code()[state.value_instruction]) == from) {
+            *destination(code()[state.value_instruction]) = to;
+        } else {
+            emit(VM_MOVE, to, from);
+        }
+        return to;
+    }
+    // Gives the value of a branch of an if to result
+    void branch(int result, AST_node_* exp, VoidContext ctx) {
+        int saved = next_temp;
+        int value = accept(exp, ctx);
+        if (result >= 0) {
+            move(result, value);
+        }
+        next_temp = saved;
+    }
+
+    int new_temp() {
+        int temp = next_temp++;
+        state.max_temps = std::max(state.max_temps, next_temp);
+        return temp_base + temp;
+    }
+    static bool is_temp(int reg) {
+        return reg >= temp_base;
+    }
+    static bool is_leaf(AST_node_* exp) {  // can't change any variable
+        AST_node_kind kind = exp->kind();
+        return kind == AST_kind_intExp || kind == AST_kind_boolExp || kind == AST_kind_stringExp ||
+               kind == AST_kind_nilExp || kind == AST_kind_varExp;
+    }
+    void use_register(int reg) {
+        state.variable_registers = std::max(state.variable_registers, reg + 1);
+    }
+    int variable_register(A_simpleVar_* var) {
+        int reg = lookup(var->get_sym(), var->get_local_variable_library()).my_SP();
+        use_register(reg);
+        return reg;
+    }
+    int outer_register(A_simpleVar_* var) {  // in the frame of the function it's declared in
+        int reg = lookup(var->get_sym(), var->get_local_variable_library()).my_SP();
+        if (std::find(program.outer_registers.begin(), program.outer_registers.end(), reg) == program.outer_registers.end()) {
+            program.outer_registers.push_back(reg);
+        }
+        return reg;
+    }
+    // The position of the frame that many out (0 for this one), following the static links as
+    //  A_fundec_::frame_pointer_HERA_code does
+    int frame_pointer(int frames_out) {
+        if (frames_out == 0) {
+            return emit_value(VM_FP, new_temp());
+        }
+        int frame = state.fundec->static_link_slot();
+        A_fundec_* f = state.fundec->get_enclosing_function();
+        for (int out = 1; out < frames_out; out++) {
+            frame = emit_value(VM_LOADF, is_temp(frame) ? frame : new_temp(), frame, f->static_link_slot());
+            f = f->get_enclosing_function();
+        }
+        return frame;
+    }
+    template <class Declaration>
+    int declaration_register(Declaration* dec) {  // for an A_varDec_ or A_forExp_
+        int reg = dec->get_frame_slot();
+        use_register(reg);
+        return reg;
+    }
+
+    int function_number(const string &name) {
+        auto found = function_numbers.find(name);
+        if (found == function_numbers.end()) {
+            found = function_numbers.insert(std::make_pair(name, int(program.functions.size()))).first;
+            program.functions.push_back(VM_function());
+            program.functions.back().name = name;
+        }
+        return found->second;
+    }
+    void start_function(const string &name, int parameters, A_fundec_* fundec = 0) {
+        state = Function_state();
+        state.function = function_number(name);
+        state.fundec = fundec;
+        program.functions[state.function].parameters = parameters;
+        program.functions[state.function].static_link = fundec != 0 && fundec->has_static_link();
+        use_register(3 + parameters - (program.functions[state.function].static_link ? 0 : 1));
+    }
+    // Now that we know how many registers the variables need, put the temporaries above them
+    void finish_function() {
+        VM_function &function = program.functions[state.function];
+        for (VM_instruction &inst : function.code) {
+            const char *operands = VM_operands(inst.op);
+            int *values[3] = {&inst.a, &inst.b, &inst.c};
+            for (int o = 0; operands[o]; o++) {
+                if (operands[o] == 'r' && is_temp(*values[o])) {
+                    *values[o] += state.variable_registers - temp_base;
+                }
+            }
+        }
+        function.frame_size = state.variable_registers + state.max_temps;
+        EM_DEBUG(EM_codegen, "Compiled " + function.name + " to bytecode, with " + std::to_string(function.code.size()) +
+                             " instructions and " + std::to_string(function.frame_size) + " registers");
+    }
+};
+#endif
@@ -0,0 +1,175 @@
+#ifndef CALL_GRAPH_VISITOR_H
+#define CALL_GRAPH_VISITOR_H
+#include <vector>
+#include "../AST.h"
+#include "../call_graph.h"
+#include "visitor.h"
+
+// Collects the calls and the side effects of each function's own code for CG_build (call_graph.cc).
+// Each visit returns the CG_effects of the expression, not counting what the functions it calls
+//  do (CG_build adds those once it has the whole graph), nor anything in nested function
+//  declarations, which are functions of their own.
+// A variable is declared outside the function that uses it if it's some frames out (see
+//  StaticLinkVisitor).
+struct CallGraphVisitor : Visitor<CallGraphVisitor, int, VoidContext> {
+    CG_graph &graph;
+    std::vector<A_callExp_*> call_sites;  // to give their summaries to, once the graph is done
+
+    CallGraphVisitor(CG_graph &graph) : graph(graph) { }
+
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return 0;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        function = "main";
+        graph.functions[function].name = function;
+        graph.functions[function].own_effects = accept(node->get_main_expr(), ctx);
+        return 0;
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return CG_memory | accept(node->get_fields(), ctx);
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        return CG_memory | accept(node->get_size(), ctx) | accept(node->get_init(), ctx);
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        int effects = accept(node->get_left(), ctx) | accept(node->get_right(), ctx);
+        return node->get_oper() == A_divideOp ? effects | CG_may_fail : effects;
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        int effects = accept(node->get_exp(), ctx);
+        A_simpleVar_* var = dynamic_cast<A_simpleVar_*>(node->get_var());
+        if (var == 0) {  // a field or element
+            return effects | CG_memory | accept(node->get_var(), ctx);
+        }
+        return var->get_frames_out() > 0 ? effects | CG_writes_outer : effects;
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        return accept(node->get_decs(), ctx) | accept(node->get_body(), ctx);
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        graph.functions[function].callees.insert(node->get_my_unique_function_name());
+        call_sites.push_back(node);
+        return accept(node->get_args(), ctx);
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        return accept(node->get_test(), ctx) | accept(node->get_then(), ctx) | accept(node->get_else_or_null(), ctx);
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        return CG_may_loop | accept(node->get_test(), ctx) | accept(node->get_body(), ctx);
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        return accept(node->get_lo(), ctx) | accept(node->get_hi(), ctx) | accept(node->get_body(), ctx);
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return node->get_frames_out() > 0 ? CG_reads_outer : 0;
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return CG_may_fail | accept(node->get_var(), ctx);  // nil has no fields
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        return CG_may_fail | accept(node->get_var(), ctx) | accept(node->get_exp(), ctx);  // out of bounds
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        int effects = 0;
+        for (AST_node_* element : *node) {
+            effects |= accept(element, ctx);
+        }
+        return effects;
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        int effects = 0;
+        for (AST_node_* element : *node) {
+            effects |= accept(element, ctx);
+        }
+        return effects;
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        int effects = 0;
+        for (AST_node_* element : *node) {
+            effects |= accept(element, ctx);
+        }
+        return effects;
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        return accept(node->get_init(), ctx);
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;  // declaring a function does nothing; calling it is another matter
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        string outer_function = function;
+        function = node->get_my_unique_function_name();
+        CG_summary &summary = graph.functions[function];
+        summary.name = function;
+        summary.fundec = node;
+        summary.own_effects = accept(node->get_body(), ctx);
+        function = outer_function;
+        return 0;
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return 0;
+    }
+
+private:
+    string function;  // whose code we're in
+};
+#endif
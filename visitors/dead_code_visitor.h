@@ -0,0 +1,253 @@
+#ifndef DEAD_CODE_VISITOR_H
+#define DEAD_CODE_VISITOR_H
+#include <map>
+#include <set>
+#include <vector>
+#include "../AST.h"
+#include "../call_graph.h"
+#include "visitor.h"
+
+// Finds code that the HERA code can leave out (see optimize.h): functions that are never
+//  called (directly or indirectly) from the main program, stores to variables that are
+//  never read, and computations whose values are never used and that have no side effects,
+//  such as all but the last expression of "(x; 1+2; f())" apart from f().
+// Which functions are called, and which calls have no side effects, come from the call graph
+//  (see call_graph.h).
+// Each visit returns true if the expression is side-effect free (and can't fail at run time),
+//  so it can go if its value isn't needed.
+// Variables are matched to their declarations with CG_declaration_of, so a variable that's
+//  only ever assigned counts as unread, but any use of its value anywhere counts as a read.
+struct DeadCodeVisitor : Visitor<DeadCodeVisitor, bool, VoidContext> {
+    std::set<AST_node_*> dead;         // what HERA_code should leave out
+    std::set<AST_node_*> dead_stores;  // A_varDec_s and A_assignExp_s that needn't store their values
+    std::vector<string> report;    // what we left out, and why
+
+    void find(A_root_* root, const CG_graph &graph) {
+        accept(root, VoidContext());
+
+        // every function that main, or something main calls, calls
+        std::set<string> reachable = graph.reachable_from_main();
+        for (auto &function : graph.functions) {
+            if (function.second.fundec != 0 && !reachable.count(function.first)) {
+                kill(function.second.fundec, "function " + function.first + " (it's never called)");
+            }
+        }
+        for (Candidate &store : stores) {
+            if (!read.count(store.declaration) && reachable.count(store.function)) {
+                dead_stores.insert(store.node);
+                note(store.node, "store to " + Symbol_to_string(store.variable) + " (it's never read)");
+                if (store.pure_value) {
+                    dead.insert(store.value);
+                }
+            }
+        }
+        for (Candidate &computation : unused) {
+            if (reachable.count(computation.function)) {
+                kill(computation.node, "unused computation with no side effects");
+            }
+        }
+    }
+
+    bool accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return true;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    bool visitAST_node(AST_node_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRoot(A_root_* node, VoidContext ctx) {
+        accept(node->get_main_expr(), ctx);
+        return false;
+    }
+    bool visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return true;
+    }
+    bool visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return true;
+    }
+    bool visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return true;
+    }
+    bool visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return true;
+    }
+    bool visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        accept(node->get_fields(), ctx);
+        return false;
+    }
+    bool visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        accept(node->get_size(), ctx);
+        accept(node->get_init(), ctx);
+        return false;
+    }
+    bool visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    bool visitOpExp(A_opExp_* node, VoidContext ctx) {
+        bool left = accept(node->get_left(), ctx);
+        bool right = accept(node->get_right(), ctx);
+        return left && right && node->get_oper() != A_divideOp;  // division by zero has an effect
+    }
+    bool visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        A_simpleVar_* var = dynamic_cast<A_simpleVar_*>(node->get_var());
+        bool pure_value = accept(node->get_exp(), ctx);
+        if (var == 0) {
+            accept(node->get_var(), ctx);
+        } else {
+            stores.push_back(Candidate{node, CG_declaration_of(var), var->get_sym(), node->get_exp(), pure_value, function});
+        }
+        return false;
+    }
+    bool visitLetExp(A_letExp_* node, VoidContext ctx) {
+        accept(node->get_decs(), ctx);
+        accept(node->get_body(), ctx);
+        return false;  // the declarations might do anything; not worth sorting out
+    }
+    bool visitCallExp(A_callExp_* node, VoidContext ctx) {
+        bool pure_args = accept(node->get_args(), ctx);
+        const CG_summary* summary = node->get_call_graph_summary();
+        return pure_args && summary != 0 && (summary->pure() || summary->reads_only());
+    }
+    bool visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        bool test = accept(node->get_test(), ctx);
+        bool then = accept(node->get_then(), ctx);
+        bool otherwise = accept(node->get_else_or_null(), ctx);
+        return test && then && otherwise;
+    }
+    bool visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        accept(node->get_body(), ctx);
+        return false;  // might not stop
+    }
+    bool visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        accept(node->get_body(), ctx);
+        return false;
+    }
+    bool visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        A_expList_* list = static_cast<A_expList_*>(node->get_seq());
+        if (list == 0) {
+            return true;
+        }
+        bool pure = true;
+        for (int i = 0; i < list->length(); i++) {
+            bool this_pure = accept(list->element(i), ctx);
+            if (this_pure && i < list->length() - 1) {  // its value is thrown away
+                unused.push_back(Candidate{list->element(i), 0, 0, 0, true, function});
+            }
+            pure = pure && this_pure;
+        }
+        return pure;
+    }
+    bool visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        read.insert(CG_declaration_of(node));
+        return true;
+    }
+    bool visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return false;
+    }
+    bool visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
+        return false;
+    }
+    bool visitExpList(A_expList_* node, VoidContext ctx) {
+        bool pure = true;
+        for (AST_node_* element : *node) {
+            pure = accept(element, ctx) && pure;
+        }
+        return pure;
+    }
+    bool visitEfield(A_efield_* node, VoidContext ctx) {
+        accept(node->get_exp(), ctx);
+        return false;
+    }
+    bool visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return false;
+    }
+    bool visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return false;
+    }
+    bool visitVarDec(A_varDec_* node, VoidContext ctx) {
+        bool pure_value = accept(node->get_init(), ctx);
+        stores.push_back(Candidate{node, node, node->get_var(), node->get_init(), pure_value, function});
+        return false;
+    }
+    bool visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    bool visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return false;
+    }
+    bool visitFundec(A_fundec_* node, VoidContext ctx) {
+        string outer_function = function;
+        function = node->get_my_unique_function_name();
+        accept(node->get_body(), ctx);
+        function = outer_function;
+        return false;
+    }
+    bool visitNamety(A_namety_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitField(A_field_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return false;
+    }
+
+private:
+    struct Candidate {
+        AST_node_* node;
+        AST_node_* declaration;  // for a store: of the variable
+        Symbol variable;
+        AST_node_* value;        // for a store: what's stored
+        bool pure_value;
+        string function;         // the unique name of the function it's in, or "main" (as in the call graph)
+    };
+
+    std::set<AST_node_*> read;                // declarations of variables whose values we use
+    std::vector<Candidate> stores, unused;
+    string function = "main";
+
+    void kill(AST_node_* node, const string &what) {
+        dead.insert(node);
+        note(node, what);
+    }
+    void note(AST_node_* node, const string &what) {
+        report.push_back("line " + std::to_string(node->pos().begin_line()) + ": removed " + what);
+    }
+};
+#endif
@@ -0,0 +1,248 @@
+#ifndef FINGERPRINT_VISITOR_H
+#define FINGERPRINT_VISITOR_H
+#include "../AST.h"
+#include "../call_graph.h"
+#include "../optimize.h"
+#include "visitor.h"
+
+// Produces a canonical description of a subtree, for the per-function HERA cache (see HERA_cache.h).
+// Unlike print_rep, this includes everything code generation reads from *outside* the subtree:
+//  the unique names and return types of called functions, the SP and writability of each
+//  variable that is used, and the string labels assigned by HERA_data (numbered within the function,
+//  like its other labels; see HERA_label_scope).
+// Positions are left out, since they never change the generated code.
+struct FingerprintVisitor : Visitor<FingerprintVisitor, string, StringContext> {
+    string accept(AST_node_* node, StringContext ctx) {
+        if (node == 0) {
+            return "0";
+        }
+        return node->accept(*this, ctx);
+    }
+
+    string visitAST_node(AST_node_* node, StringContext ctx) {
+         EM_error("Not implemented");
+        return "";
+    }
+    string visitRoot(A_root_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_root_");
+        return "root(" + accept(node->get_main_expr(), ctx) + ")";
+    }
+    string visitNilExp(A_nilExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_nilExp_");
+        return "nil";
+    }
+    string visitBoolExp(A_boolExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_boolExp_");
+        return node->get_value() ? "true" : "false";
+    }
+    string visitIntExp(A_intExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_intExp_");
+        return "int(" + std::to_string(node->get_value()) + ")";
+    }
+    string visitStringExp(A_stringExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_stringExp_");
+        return "string_" + std::to_string(node->get_count()) + "(" + repr(node->get_value()) + ")";
+    }
+    string visitRecordExp(A_recordExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_recordExp_");
+        return "record(" + Symbol_to_string(node->get_typ()) + ", " + accept(node->get_fields(), ctx) + ")" + top(node);
+    }
+    string visitArrayExp(A_arrayExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_arrayExp_");
+        return "array(" + Symbol_to_string(node->get_typ()) + ", " + accept(node->get_size(), ctx) + ", " + accept(node->get_init(), ctx) + ")" + top(node);
+    }
+    string visitVarExp(A_varExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_varExp_");
+        return "varExp(" + accept(node->get_var(), ctx) + ")" + in_frame(node);
+    }
+    string visitOpExp(A_opExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_opExp_");
+        // the operand type picks between CMP and a call to tstrcmp
+        return "op" + std::to_string(node->get_oper()) + "<" + to_String(node->get_left()->typecheck()) + ">("
+               + accept(node->get_left(), ctx) + ", " + accept(node->get_right(), ctx) + ")" + top(node) + in_frame(node);
+    }
+    string visitAssignExp(A_assignExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_assignExp_");
+        return "assign(" + accept(node->get_var(), ctx) + ", " + accept(node->get_exp(), ctx) + ")";
+    }
+    string visitLetExp(A_letExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_letExp_");
+        return "let(" + accept(node->get_decs(), ctx) + " in " + accept(node->get_body(), ctx) + ")";
+    }
+    string visitCallExp(A_callExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_callExp_");
+        ST<function_info> function_library = node->get_local_function_library();
+        string callee_return_type = is_name_there(node->get_func(), function_library) ?
+                                    to_String(lookup(node->get_func(), function_library).my_return_type()) : "?";
+        // whether (and which) static link to pass depends on the callee, which may be outside the function being fingerprinted
+        // and so does whether its arguments go in registers (see optimize.h)
+        const CG_summary *callee = node->get_call_graph_summary();
+        string registers = "";
+        if (callee != 0 && callee->fundec != 0 && OPT_uses_register_arguments(callee->fundec)) {
+            registers = " registers";
+            for (int arg = 0; arg < OPT_argument_registers; arg++) {
+                registers += OPT_is_held_argument(node, arg) ? " held " + std::to_string(arg) : "";
+            }
+        }
+        return "call " + node->get_my_unique_function_name() + ":" + callee_return_type + "(" + accept(node->get_args(), ctx) + ")"
+               + (node->get_static_link() >= 0 ? " link " + std::to_string(node->get_static_link()) : "") + registers
+               + top(node) + in_frame(node);
+    }
+    string visitIfExp(A_ifExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_ifExp_");
+        return "if(" + accept(node->get_test(), ctx) + ", " + accept(node->get_then(), ctx) + ", " + accept(node->get_else_or_null(), ctx) + ")";
+    }
+    string visitWhileExp(A_whileExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_whileExp_");
+        return "while(" + accept(node->get_test(), ctx) + ", " + accept(node->get_body(), ctx) + ")";
+    }
+    string visitForExp(A_forExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_forExp_");
+        return "for " + Symbol_to_string(node->get_var()) + "@" + std::to_string(node->get_frame_slot()) + "(" + accept(node->get_lo(), ctx) + ", " + accept(node->get_hi(), ctx) + ", " + accept(node->get_body(), ctx) + ")";
+    }
+    string visitBreakExp(A_breakExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_breakExp_");
+        return "break";
+    }
+    string visitSeqExp(A_seqExp_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_seqExp_");
+        return "seq(" + accept(node->get_seq(), ctx) + ")";
+    }
+    string visitSimpleVar(A_simpleVar_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_simpleVar_");
+        ST<var_info> variable_library = node->get_local_variable_library();
+        string where = "?";
+        if (is_name_there(node->get_sym(), variable_library)) {
+            var_info var_struct = lookup(node->get_sym(), variable_library);
+            where = std::to_string(var_struct.my_SP()) + (var_struct.am_i_writable() ? "w" : "r");
+        }
+        return "var " + Symbol_to_string(node->get_sym()) + "@" + where + (node->get_frames_out() > 0 ? "^" + std::to_string(node->get_frames_out()) : "");
+    }
+    string visitFieldVar(A_fieldVar_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_fieldVar_");
+        // the offset comes from a type that may be declared outside the function being fingerprinted
+        return "field(" + accept(node->get_var(), ctx) + "." + Symbol_to_string(node->get_sym()) + "@" + std::to_string(node->get_offset()) + ")";
+    }
+    string visitSubscriptVar(A_subscriptVar_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_subscriptVar_");
+        // whether it's checked depends on how the array and its size are used elsewhere (see optimize.h)
+        string check = OPT_is_safe_subscript(node) ? " safe" : OPT_bounds_checked_by(node) != 0 ? " checked by loop" : "";
+        return "subscript(" + accept(node->get_var(), ctx) + ", " + accept(node->get_exp(), ctx) + check + ")";
+    }
+    string visitExpList(A_expList_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_expList_");
+        string fingerprint;
+        for (AST_node_* element : *node) {
+            fingerprint += accept(element, ctx) + "; ";
+        }
+        return fingerprint;
+    }
+    string visitEfield(A_efield_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_efield_");
+        return Symbol_to_string(node->get_name()) + "=" + accept(node->get_exp(), ctx);
+    }
+    string visitEfieldList(A_efieldList_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_efieldList_");
+        string fingerprint;
+        for (AST_node_* element : *node) {
+            fingerprint += accept(element, ctx) + ", ";
+        }
+        return fingerprint;
+    }
+    string visitDecList(A_decList_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_decList_");
+        string fingerprint;
+        for (AST_node_* element : *node) {
+            fingerprint += accept(element, ctx) + "; ";
+        }
+        return fingerprint;
+    }
+    string visitVarDec(A_varDec_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_varDec_");
+        return "var " + Symbol_to_string(node->get_var()) + ":" + Symbol_to_string(node->get_typ()) + "@" + std::to_string(node->get_frame_slot())
+               + " := " + accept(node->get_init(), ctx);
+    }
+    string visitTypeDec(A_typeDec_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_typeDec_");
+        return "types(" + accept(node->get_theTypes(), ctx) + ")";
+    }
+    string visitFunctionDec(A_functionDec_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_functionDec_");
+        return "functions(" + accept(node->get_theFunctions(), ctx) + ")";
+    }
+    string visitFundecList(A_fundecList_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_fundecList_");
+        string fingerprint;
+        for (AST_node_* element : *node) {
+            fingerprint += accept(element, ctx) + "; ";
+        }
+        return fingerprint;
+    }
+    string visitFundec(A_fundec_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_fundec_");
+        ST<function_info> function_library = node->get_local_function_library();
+        string signature = is_name_there(node->get_name(), function_library) ?
+                           to_String(lookup(node->get_name(), function_library).type_of_function) : "?";
+        string registers = "";
+        if (OPT_uses_register_arguments(node)) {
+            registers = " registers";
+            for (int param = 0; param < OPT_argument_registers; param++) {
+                registers += OPT_is_spilled_parameter(node, param) ? " spilled " + std::to_string(param) : "";
+            }
+        }
+        return "function " + node->get_my_unique_function_name() + ":" + signature
+               + "(" + accept(node->get_params(), ctx) + ")" + (node->has_static_link() ? " linked" : "") + registers
+               + " display " + std::to_string(node->frame_header_size() - node->static_link_slot())
+               + " frame " + std::to_string(node->get_frame_size()) + " = " + accept(node->get_body(), ctx);
+    }
+    string visitNamety(A_namety_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_namety_");
+        return "namety(" + accept(node->get_ty(), ctx) + ")";
+    }
+    string visitNametyList(A_nametyList_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_nametyList_");
+        string fingerprint;
+        for (AST_node_* element : *node) {
+            fingerprint += accept(element, ctx) + "; ";
+        }
+        return fingerprint;
+    }
+    string visitFieldList(A_fieldList_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_fieldList_");
+        string fingerprint;
+        for (AST_node_* element : *node) {
+            fingerprint += accept(element, ctx) + ", ";
+        }
+        return fingerprint;
+    }
+    string visitField(A_field_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_field_");
+        return Symbol_to_string(node->get_name()) + ":" + Symbol_to_string(node->get_typ());
+    }
+    string visitNameTy(A_nameTy_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_nameTy_");
+        return "nameTy " + Symbol_to_string(node->get_name());
+    }
+    string visitRecordty(A_recordty_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_recordty_");
+        return "recordty(" + accept(node->get_record(), ctx) + ")";
+    }
+    string visitArrayty(A_arrayty_* node, StringContext ctx) {
+        EM_DEBUG(EM_visitors, "fingerprinting A_arrayty_");
+        return "arrayty " + Symbol_to_string(node->get_array());
+    }
+
+private:
+    // where the frame of the function it calls goes (see visitors/frame_layout_visitor.h)
+    string top(A_exp_* node) {
+        return " top " + std::to_string(node->get_frame_top());
+    }
+    // whether an expression is computed before its loop, or reuses or keeps a value, depends on the
+    //  callees' effects (see optimize.h)
+    string in_frame(AST_node_* node) {
+        int hoisted = OPT_hoisted_slot(node), kept = OPT_kept_slot(node), reused = OPT_reused_slot(node);
+        return (hoisted >= 0 ? " hoisted@" + std::to_string(hoisted) : "") + (kept >= 0 ? " kept@" + std::to_string(kept) : "")
+               + (reused >= 0 ? " reuses@" + std::to_string(reused) : "");
+    }
+};
+#endif
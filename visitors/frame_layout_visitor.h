@@ -0,0 +1,215 @@
+#ifndef FRAME_LAYOUT_VISITOR_H
+#define FRAME_LAYOUT_VISITOR_H
+#include <algorithm>
+#include "../AST.h"
+#include "visitor.h"
+
+// Lays out the frame of each function (and of main) once, for layout_frames.cc:
+//   - each A_varDec_ gets a slot, and each A_forExp_ two (its variable, then its upper bound),
+//     above the function's header and saved registers
+//   - a let's variables, or a loop's two slots, are only live until it ends, so whatever comes
+//     after it (the next let in a sequence, say) reuses the same slots; and the slot of a
+//     variable is free while its own initial value is computed, since it's only stored after that
+//   - each function is told how big its whole frame is, so its code can move SP once when it
+//     starts and once when it returns, rather than around each let and loop
+//   - each call (and record, array or string comparison, which call malloc or tstrcmp) is told
+//     how much of the frame is in use when it's made, so the callee's frame can go just above
+//     that rather than above the whole frame, and the stack is no deeper than it was when each
+//     let moved SP; but a call in another call's arguments goes at SP, above the frame that call
+//     is filling in
+// Slots are counted up from FP, like the rest of the frame (see A_fundec_::frame_header_size).
+struct FrameLayoutVisitor : Visitor<FrameLayoutVisitor, int, VoidContext> {
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return 0;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        next = high = 0;  // main has no header, and saves no registers
+        accept(node->get_main_expr(), ctx);
+        node->set_frame_size(high);
+        return 0;
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return calling(node, [&]() { accept(node->get_fields(), ctx); });
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        return calling(node, [&]() {
+            accept(node->get_size(), ctx);
+            accept(node->get_init(), ctx);
+        });
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        return calling(node, [&]() {  // only a comparison of strings calls anything, but we can't tell yet
+            accept(node->get_left(), ctx);
+            accept(node->get_right(), ctx);
+        });
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx);
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        int outer_next = next;
+        accept(node->get_decs(), ctx);
+        accept(node->get_body(), ctx);
+        next = outer_next;
+        return 0;
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        return calling(node, [&]() {
+            in_arguments++;
+            accept(node->get_args(), ctx);
+            in_arguments--;
+        });
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        accept(node->get_then(), ctx);
+        return accept(node->get_else_or_null(), ctx);
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        return accept(node->get_body(), ctx);
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        int outer_next = next;
+        node->set_frame_slot(allocate(2));
+        accept(node->get_body(), ctx);
+        next = outer_next;
+        return 0;
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx);
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        accept(node->get_init(), ctx);  // its lets and loops can use this variable's slot, too
+        node->set_frame_slot(allocate(1));
+        return 0;
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        int outer_next = next, outer_high = high, outer_in_arguments = in_arguments;
+        in_arguments = 0;
+        // the locals go above the header and the registers the function saves (R3 up to its body's result_reg)
+        next = high = node->frame_header_size() + static_cast<A_exp_*>(node->get_body())->result_reg() - 2;
+        accept(node->get_body(), ctx);
+        node->set_frame_size(high);
+        next = outer_next;
+        high = outer_high;
+        in_arguments = outer_in_arguments;
+        return 0;
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return 0;
+    }
+
+private:
+    int next = 0;  // the first free slot in the frame we're laying out
+    int high = 0;  // and the highest it has been, which is how big the frame must be
+    int in_arguments = 0;  // how many calls' arguments we're in, in this function
+
+    int allocate(int slots) {
+        int first = next;
+        next += slots;
+        high = std::max(high, next);
+        return first;
+    }
+    // Lay out the parts of an expression that calls a function, and tell it how much of the frame
+    //  is in use by then, counting the slots of any lets in those parts
+    template <class Parts> int calling(A_exp_* node, Parts parts) {
+        int outer_high = high;
+        high = next;
+        parts();
+        node->set_frame_top(in_arguments > 0 ? -1 : high);
+        high = std::max(outer_high, high);
+        return 0;
+    }
+};
+
+#endif
@@ -19,7 +19,7 @@
  * this time entering the parameters as varDecs in the value environment.
 */
 
-struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
+struct FunctionLibraryVisitor : Visitor<FunctionLibraryVisitor, ST<function_info>, VoidContext> {
     ST<function_info> accept(AST_node_* node, VoidContext ctx) {
         if (node == 0) {
             return ST<function_info>();
@@ -32,7 +32,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitRoot(A_root_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_root_");
+        EM_DEBUG(EM_visitors, "setting function library for A_root_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -41,35 +41,35 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitNilExp(A_nilExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_nilExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_nilExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return ST<function_info>();
     }
     ST<function_info> visitBoolExp(A_boolExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_boolExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_boolExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return ST<function_info>();
     }
     ST<function_info> visitIntExp(A_intExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_intExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_intExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return ST<function_info>();
     }
     ST<function_info> visitStringExp(A_stringExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_stringExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_stringExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return ST<function_info>();
     }
     ST<function_info> visitRecordExp(A_recordExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_recordExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_recordExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -78,7 +78,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_arrayExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_arrayExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -88,14 +88,14 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitVarExp(A_varExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_varExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_varExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return accept(node->get_var(), ctx);
     }
     ST<function_info> visitOpExp(A_opExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_opExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_opExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -105,7 +105,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitAssignExp(A_assignExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_assignExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_assignExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -115,7 +115,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitLetExp(A_letExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_letExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_letExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -129,7 +129,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitCallExp(A_callExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_callExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_callExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -138,7 +138,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitIfExp(A_ifExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_ifExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_ifExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -149,7 +149,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitWhileExp(A_whileExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_whileExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_whileExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -159,14 +159,14 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitForExp(A_forExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_forExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_forExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         accept(node->get_lo(), ctx);
         accept(node->get_hi(), ctx);
 
-        int this_SP_counter = node->calculate_my_SP(node);
+        int this_SP_counter = node->get_frame_slot();
         ST<function_info> for_func_lib = ST<function_info>(node->get_var(), function_info(Ty_Int(), this_SP_counter, false));
         ST<function_info> new_local_func_lib = MergeAndShadow(for_func_lib, local_func_lib);
         ctx.local_function_library = new_local_func_lib;
@@ -177,14 +177,14 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitBreakExp(A_breakExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_breakExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_breakExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return ST<function_info>();
     }
     ST<function_info> visitSeqExp(A_seqExp_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_seqExp_");
+        EM_DEBUG(EM_visitors, "setting function library for A_seqExp_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -193,14 +193,14 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_simpleVar_");
+        EM_DEBUG(EM_visitors, "setting function library for A_simpleVar_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return ST<function_info>();
     }
     ST<function_info> visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_fieldVar_");
+        EM_DEBUG(EM_visitors, "setting function library for A_fieldVar_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -209,26 +209,28 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_subscriptVar_");
+        EM_DEBUG(EM_visitors, "setting function library for A_subscriptVar_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
 
         return ST<function_info>();
     }
     ST<function_info> visitExpList(A_expList_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_expList_");
+        EM_DEBUG(EM_visitors, "setting function library for A_expList_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
 
         return ST<function_info>();
     }
     ST<function_info> visitEfield(A_efield_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_efield_");
+        EM_DEBUG(EM_visitors, "setting function library for A_efield_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -237,32 +239,33 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitEfieldList(A_efieldList_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_efieldList_");
+        EM_DEBUG(EM_visitors, "setting function library for A_efieldList_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
 
         return ST<function_info>();
     }
     ST<function_info> visitDecList(A_decList_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_decList_");
+        EM_DEBUG(EM_visitors, "setting function library for A_decList_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
-        ST<function_info> head_func_lib = accept(node->get_head(), ctx);
-
-        ST<function_info> new_local_func_lib = MergeAndShadow(head_func_lib, local_func_lib);
-        ctx.local_function_library = new_local_func_lib;
-        ST<function_info> tail_func_lib = accept(node->get_tail(), ctx);
+        // each dec sees the ones before it, which shadow the enclosing scope
+        ST<function_info> declist_func_lib = ST<function_info>();
+        for (AST_node_* element : *node) {
+            ctx.local_function_library = MergeAndShadow(declist_func_lib, local_func_lib);
+            declist_func_lib = MergeAndShadow(accept(element, ctx), declist_func_lib);
+        }
 
         // Return the decs that were declared 
-        ST<function_info> declist_func_lib = MergeAndShadow(tail_func_lib, head_func_lib);
         return declist_func_lib;
     }
     ST<function_info> visitVarDec(A_varDec_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_varDec_");
+        EM_DEBUG(EM_visitors, "setting function library for A_varDec_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -271,7 +274,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_functionDec_");
+        EM_DEBUG(EM_visitors, "setting function library for A_functionDec_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -290,33 +293,30 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
     ST<function_info> visitFundecList(A_fundecList_* node, VoidContext ctx) {
         string msg = "setting function library for A_fundecList_ ";
         msg = msg + (ctx.curr_pass == 0 ? "First Pass" : "Second Pass");
-        EM_debug(msg);
+        EM_DEBUG(EM_visitors, msg);
 
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
-        ST<function_info> head_func_lib = accept(node->get_head(), ctx);
-
-        ST<function_info> new_local_func_lib;
-        if (ctx.curr_pass == FirstPass) {
-            new_local_func_lib = MergeAndShadow(head_func_lib, local_func_lib);
-        } else {
-            new_local_func_lib = local_func_lib;
+        // in the first pass, each fundec sees the ones before it; the second pass
+        //  already has all of them in the local library (see visitFunctionDec)
+        ST<function_info> fundeclist_func_lib = ST<function_info>();
+        for (AST_node_* element : *node) {
+            if (ctx.curr_pass == FirstPass) {
+                ctx.local_function_library = MergeAndShadow(fundeclist_func_lib, local_func_lib);
+                fundeclist_func_lib = MergeAndShadow(accept(element, ctx), fundeclist_func_lib);
+            } else {
+                accept(element, ctx);
+            }
         }
-        ctx.local_function_library = new_local_func_lib;
-        ST<function_info> tail_func_lib = accept(node->get_tail(), ctx);
 
         // Return the decs that were declared 
-        ST<function_info> fundeclist_func_lib;
-        if (ctx.curr_pass == FirstPass) {
-            fundeclist_func_lib = MergeAndShadow(tail_func_lib, head_func_lib);
-        }
         return fundeclist_func_lib;
     }
     ST<function_info> visitFundec(A_fundec_* node, VoidContext ctx) {
         string msg = "setting function library for A_fundec_ ";
         msg = msg + (ctx.curr_pass == 0 ? "First Pass" : "Second Pass");
-        EM_debug(msg);
+        EM_DEBUG(EM_visitors, msg);
         ST<function_info> local_func_lib = ctx.local_function_library;
 
         accept(node->get_params(), ctx);
@@ -326,11 +326,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
             return ST<function_info>();
         }
 
-        Ty_ty my_return_type = 0;
-        if (is_name_there(node->get_result(), type_library)) {
-            type_info type_struct = lookup(node->get_result(), type_library);
-            my_return_type = type_struct.my_type();
-        }
+        Ty_ty my_return_type = node->lookup_type(node->get_result());
 
         Ty_fieldList param_types = get_ty_fieldlist(node->cast_params());
         function_count++;
@@ -357,16 +353,16 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         if (params == 0) {
             return 0;
         }
-        Ty_field head_field = get_ty_field(params->cast_head());
-        Ty_fieldList tail_fields = get_ty_fieldlist(params->cast_tail());
-
-		return Ty_FieldList(head_field, tail_fields);	
+        Ty_fieldList fields = 0;
+        for (int i = params->length() - 1; i >= 0; i--) {
+            fields = Ty_FieldList(get_ty_field(params->element(i)), fields);
+        }
+        return fields;
     }
 
     Ty_field get_ty_field(A_field_* param) {
-        if (is_name_there(param->get_typ(), type_library)) { 
-            type_info type_struct = lookup(param->get_typ(), type_library);
-            Ty_ty this_type = type_struct.my_type();
+        Ty_ty this_type = param->lookup_type(param->get_typ());
+        if (this_type != 0) {
             return Ty_Field(param->get_name(), this_type);
         } else {
             EM_warning("Init_Ty_field: Var " + Symbol_to_string(param->get_name()) + " in function declaration does not have type in" +
@@ -376,7 +372,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
     }
 
     ST<function_info> visitTypeDec(A_typeDec_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_typeDec_");
+        EM_DEBUG(EM_visitors, "setting function library for A_typeDec_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -385,17 +381,18 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitNametyList(A_nametyList_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_nametyList_");
+        EM_DEBUG(EM_visitors, "setting function library for A_nametyList_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
 
         return ST<function_info>();
     }
     ST<function_info> visitNamety(A_namety_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_namety_");
+        EM_DEBUG(EM_visitors, "setting function library for A_namety_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -404,30 +401,31 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitFieldList(A_fieldList_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_fieldList_");
+        EM_DEBUG(EM_visitors, "setting function library for A_fieldList_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
-        ST<function_info> head_func_lib = accept(node->get_head(), ctx);
-
-        ST<function_info> new_local_func_lib = MergeAndShadow(head_func_lib, local_func_lib);
-        ctx.local_function_library = new_local_func_lib;
-        ctx.field_index++;
-        ST<function_info> tail_func_lib = accept(node->get_tail(), ctx);
+        ST<function_info> fieldlist_func_lib = ST<function_info>();
+        for (AST_node_* element : *node) {
+            ctx.local_function_library = MergeAndShadow(fieldlist_func_lib, local_func_lib);
+            fieldlist_func_lib = MergeAndShadow(accept(element, ctx), fieldlist_func_lib);
+            ctx.field_index++;
+        }
 
         // Return the decs that were declared 
-        ST<function_info> fieldlist_func_lib = MergeAndShadow(tail_func_lib, head_func_lib);
         return fieldlist_func_lib;
     }
     ST<function_info> visitField(A_field_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_field_");
+        EM_DEBUG(EM_visitors, "setting function library for A_field_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         int SP_OFFSET = 3;
         int field_index = ctx.field_index + SP_OFFSET; 
-        type_info type_struct = lookup(node->get_typ(), type_library);
-        Ty_ty field_type = type_struct.my_type();
+        Ty_ty field_type = node->lookup_type(node->get_typ());
+        if (field_type == 0) {
+            field_type = Ty_Error();
+        }
         ST<function_info> field_func_lib = ST<function_info>(
             node->get_name(),
             function_info(field_type,
@@ -439,14 +437,14 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return field_func_lib;
     }
     ST<function_info> visitNameTy(A_nameTy_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_nameTy_");
+        EM_DEBUG(EM_visitors, "setting function library for A_nameTy_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
         return ST<function_info>();
     }
     ST<function_info> visitRecordty(A_recordty_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_recordty_");
+        EM_DEBUG(EM_visitors, "setting function library for A_recordty_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
@@ -455,7 +453,7 @@ struct FunctionLibraryVisitor : Visitor<ST<function_info>, VoidContext> {
         return ST<function_info>();
     }
     ST<function_info> visitArrayty(A_arrayty_* node, VoidContext ctx) {
-        EM_debug("setting function library for A_arrayty_");
+        EM_DEBUG(EM_visitors, "setting function library for A_arrayty_");
         ST<function_info> local_func_lib = ctx.local_function_library;
         node->set_local_function_library(local_func_lib);
 
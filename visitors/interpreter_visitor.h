@@ -0,0 +1,447 @@
+#ifndef INTERPRETER_VISITOR_H
+#define INTERPRETER_VISITOR_H
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "../AST.h"
+#include "visitor.h"
+
+// A Tiger value while interpreting: ints and bools are in number, strings are in str, and
+//  records and arrays in block (a record's fields, at the offsets from Ty_field_offset, or an
+//  array's elements; 0 for nil)
+struct Tiger_value {
+    int number = 0;
+    const string *str = 0;
+    std::vector<Tiger_value> *block = 0;
+};
+
+// Runs a typechecked tree directly (the -run flag in tiger.cc), as a reference for what the
+//  generated HERA code should do.
+// It uses the attributes the other passes leave on the tree: variables live in a frame per call,
+//  at the SP offsets from their var_info (so parameters start at 3, as in HERA), variables of
+//  enclosing functions are found through the same static links as in HERA, calls go to the
+//  A_fundec_ with the callee's unique name from its function_info, and tiger_library functions
+//  are done here in C++.
+// Integers are 16 bits, wrapping around just as they do on HERA.
+struct InterpreterVisitor : Visitor<InterpreterVisitor, Tiger_value, VoidContext> {
+    std::ostream *out = &std::cout;
+    int exit_status = 0;
+
+    // Runs the program; false (after an EM_error) if it failed at run time
+    bool run(A_root_* root) {
+        std::vector<Tiger_value> main_frame;
+        frame = &main_frame;
+        try {
+            accept(root, VoidContext());
+        } catch (const Tiger_exit &exit) {
+            exit_status = exit.status;
+        } catch (const Tiger_runtime_error &) {
+            out->flush();
+            return false;
+        }
+        out->flush();
+        return true;
+    }
+
+    Tiger_value accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return Tiger_value();
+        }
+        return node->accept(*this, ctx);
+    }
+
+    Tiger_value visitAST_node(AST_node_* node, VoidContext ctx) {
+        return runtime_error(node, "can't run this kind of node yet");
+    }
+    Tiger_value visitRoot(A_root_* node, VoidContext ctx) {
+        return accept(node->get_main_expr(), ctx);
+    }
+    Tiger_value visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return number(node->get_value());
+    }
+    Tiger_value visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return number(node->get_value());
+    }
+    Tiger_value visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        auto found = literals.find(node);
+        if (found == literals.end()) {
+            found = literals.insert(std::make_pair(node, new_string(unrepr_for_std_string(node->get_value())))).first;
+        }
+        Tiger_value result;
+        result.str = found->second;
+        return result;
+    }
+    Tiger_value visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        Ty_ty record_type = node->typecheck();
+        Tiger_value result;
+        result.block = new_block(Ty_record_size(record_type));
+        A_efieldList_* fields = static_cast<A_efieldList_*>(node->get_fields());
+        if (fields != 0) {
+            for (AST_node_* element : *fields) {  // in the order they're written
+                A_efield_* field = static_cast<A_efield_*>(element);
+                (*result.block)[Ty_field_offset(record_type, field->get_name())] = accept(field->get_exp(), ctx);
+            }
+        }
+        return result;
+    }
+    Tiger_value visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        int size = accept(node->get_size(), ctx).number;
+        if (size < 0) {
+            return runtime_error(node, "negative array size");
+        }
+        Tiger_value init = accept(node->get_init(), ctx);
+        Tiger_value result;
+        result.block = new_block(size);
+        std::fill(result.block->begin(), result.block->end(), init);
+        return result;
+    }
+    Tiger_value visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    Tiger_value visitOpExp(A_opExp_* node, VoidContext ctx) {
+        Tiger_value left = accept(node->get_left(), ctx);
+        Tiger_value right = accept(node->get_right(), ctx);
+        if (left.str != 0 || right.str != 0) {  // string comparison, as tstrcmp does it
+            int comparison = string_of(left).compare(string_of(right));
+            left.number = comparison < 0 ? -1 : comparison > 0 ? 1 : 0;
+            right.number = 0;
+        } else if (left.block != 0 || right.block != 0) {  // records and arrays are only equal if they're the same one
+            left.number = left.block != right.block;
+            right.number = 0;
+        }
+        switch (node->get_oper()) {
+        case A_plusOp:   return number(left.number + right.number);
+        case A_minusOp:  return number(left.number - right.number);
+        case A_timesOp:  return number(left.number * right.number);
+        case A_divideOp:
+            if (right.number == 0) return runtime_error(node, "division by zero");
+            return number(left.number / right.number);
+        case A_eqOp:     return number(left.number == right.number);
+        case A_neqOp:    return number(left.number != right.number);
+        case A_ltOp:     return number(left.number < right.number);
+        case A_leOp:     return number(left.number <= right.number);
+        case A_gtOp:     return number(left.number > right.number);
+        case A_geOp:     return number(left.number >= right.number);
+        }
+        return runtime_error(node, "unknown operator");
+    }
+    Tiger_value visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        Tiger_value value = accept(node->get_exp(), ctx);
+        location(node->get_var(), ctx) = value;
+        return Tiger_value();
+    }
+    Tiger_value visitLetExp(A_letExp_* node, VoidContext ctx) {
+        accept(node->get_decs(), ctx);
+        return accept(node->get_body(), ctx);
+    }
+    Tiger_value visitCallExp(A_callExp_* node, VoidContext ctx) {
+        std::vector<Tiger_value> args;
+        A_expList_* arg_list = static_cast<A_expList_*>(node->get_args());
+        if (arg_list != 0) {
+            for (AST_node_* arg : *arg_list) {
+                args.push_back(accept(arg, ctx));
+            }
+        }
+
+        function_info callee = lookup(node->get_func(), node->get_local_function_library());
+        if (callee.tiger_function) {
+            return call_library(node, Symbol_to_string(node->get_func()), args);
+        }
+        auto fundec = functions.find(node->get_my_unique_function_name());
+        if (fundec == functions.end()) {
+            return runtime_error(node, "no body for function " + Symbol_to_string(node->get_func()));
+        }
+        EM_DEBUG(EM_visitors, "interpreting call to " + fundec->first);
+
+        std::vector<Tiger_value> callee_frame(3 + args.size());  // as in HERA, the parameters start at 3
+        for (unsigned int i = 0; i < args.size(); i++) {
+            callee_frame[3 + i] = args[i];
+        }
+        if (node->get_static_link() >= 0) {
+            static_links[&callee_frame] = frame_out(node->get_static_link());
+        }
+        std::vector<Tiger_value> *caller_frame = frame;
+        frame = &callee_frame;
+        Tiger_value result = accept(fundec->second->get_body(), ctx);
+        frame = caller_frame;
+        static_links.erase(&callee_frame);
+        return result;
+    }
+    Tiger_value visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        if (accept(node->get_test(), ctx).number != 0) {
+            return accept(node->get_then(), ctx);
+        } else {
+            return accept(node->get_else_or_null(), ctx);
+        }
+    }
+    Tiger_value visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        try {
+            while (accept(node->get_test(), ctx).number != 0) {
+                accept(node->get_body(), ctx);
+            }
+        } catch (const Tiger_break &) {
+        }
+        return Tiger_value();
+    }
+    Tiger_value visitForExp(A_forExp_* node, VoidContext ctx) {
+        int index = declaration_slot(node);
+        int lo = accept(node->get_lo(), ctx).number;
+        int hi = accept(node->get_hi(), ctx).number;
+        try {
+            for (int i = lo; i <= hi; i++) {
+                slot(index) = number(i);
+                accept(node->get_body(), ctx);
+            }
+        } catch (const Tiger_break &) {
+        }
+        return Tiger_value();
+    }
+    Tiger_value visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        throw Tiger_break();
+    }
+    Tiger_value visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    Tiger_value visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return variable(node);
+    }
+    Tiger_value visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return location(node, ctx);
+    }
+    Tiger_value visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        return location(node, ctx);
+    }
+    Tiger_value visitExpList(A_expList_* node, VoidContext ctx) {
+        Tiger_value last;
+        for (AST_node_* element : *node) {
+            last = accept(element, ctx);
+        }
+        return last;
+    }
+    Tiger_value visitEfield(A_efield_* node, VoidContext ctx) {
+        return visitAST_node(node, ctx);
+    }
+    Tiger_value visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        return visitAST_node(node, ctx);
+    }
+    Tiger_value visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return Tiger_value();
+    }
+    Tiger_value visitVarDec(A_varDec_* node, VoidContext ctx) {
+        Tiger_value value = accept(node->get_init(), ctx);
+        slot(declaration_slot(node)) = value;
+        return Tiger_value();
+    }
+    Tiger_value visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    Tiger_value visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return Tiger_value();
+    }
+    Tiger_value visitFundec(A_fundec_* node, VoidContext ctx) {
+        functions[node->get_my_unique_function_name()] = node;  // the body runs when it's called
+        return Tiger_value();
+    }
+    Tiger_value visitNamety(A_namety_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitField(A_field_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+    Tiger_value visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return Tiger_value();
+    }
+
+private:
+    struct Tiger_break {};
+    struct Tiger_exit { int status; };
+    struct Tiger_runtime_error {};
+
+    std::vector<Tiger_value> *frame = 0;             // the variables of the function that's running
+    std::unordered_map<string, A_fundec_*> functions;  // by unique name
+    std::unordered_map<AST_node_*, int> slots;       // where each variable use or declaration lives in its frame
+    // for each running call that has one, the frame of the function its function was declared in
+    //  (see visitors/static_link_visitor.h)
+    std::unordered_map<std::vector<Tiger_value>*, std::vector<Tiger_value>*> static_links;
+    std::unordered_map<AST_node_*, const string*> literals;
+    std::deque<string> strings;                      // every string the program makes (a deque, so they don't move)
+    std::deque<std::vector<Tiger_value> > blocks;    // and every record and array
+    int pushed_back_char = -2, last_char = -1;       // for ungetchar
+
+    Tiger_value runtime_error(AST_node_* node, string message) {
+        EM_error("Run-time error: " + message, false, node->pos());
+        throw Tiger_runtime_error();
+    }
+    static Tiger_value number(int n) {
+        Tiger_value result;
+        result.number = int16_t(n);
+        return result;
+    }
+    const string *new_string(const string &s) {
+        strings.push_back(s);
+        return &strings.back();
+    }
+    Tiger_value string_value(const string &s) {
+        Tiger_value result;
+        result.str = new_string(s);
+        return result;
+    }
+    std::vector<Tiger_value> *new_block(int size) {
+        blocks.push_back(std::vector<Tiger_value>(size));
+        return &blocks.back();
+    }
+    static string string_of(Tiger_value v) {
+        return v.str == 0 ? "" : *v.str;
+    }
+
+    Tiger_value &slot(int index, std::vector<Tiger_value> *in_frame) {
+        if (index >= int(in_frame->size())) {
+            in_frame->resize(index + 1);
+        }
+        return (*in_frame)[index];
+    }
+    Tiger_value &slot(int index) {
+        return slot(index, frame);
+    }
+    std::vector<Tiger_value> *frame_out(int frames_out) {  // the frame of the function that many out from the running one
+        std::vector<Tiger_value> *f = frame;
+        for (int out = 0; out < frames_out; out++) {
+            f = static_links[f];
+        }
+        return f;
+    }
+    Tiger_value &variable(AST_node_* var) {  // for an A_simpleVar_, which may be in an enclosing function's frame
+        return slot(variable_slot(var), frame_out(static_cast<A_simpleVar_*>(var)->get_frames_out()));
+    }
+    Tiger_value &location(AST_node_* var, VoidContext ctx) {  // where any kind of A_var_ is, to read or assign it
+        if (var->kind() == AST_kind_subscriptVar) {
+            A_subscriptVar_* element = static_cast<A_subscriptVar_*>(var);
+            Tiger_value array = accept(element->get_var(), ctx);
+            int index = accept(element->get_exp(), ctx).number;
+            if (index < 0 || index >= int(array.block->size())) {
+                runtime_error(var, "subscript " + std::to_string(index) + " out of range");
+            }
+            return (*array.block)[index];
+        }
+        if (var->kind() != AST_kind_fieldVar) {
+            return variable(var);
+        }
+        A_fieldVar_* field = static_cast<A_fieldVar_*>(var);
+        Tiger_value record = accept(field->get_var(), ctx);
+        if (record.block == 0) {
+            runtime_error(var, "field " + Symbol_to_string(field->get_sym()) + " of nil");
+        }
+        return (*record.block)[field->get_offset()];
+    }
+    int variable_slot(AST_node_* var) {  // for an A_simpleVar_
+        auto found = slots.find(var);
+        if (found == slots.end()) {
+            Symbol name = static_cast<A_simpleVar_*>(var)->get_sym();
+            found = slots.insert(std::make_pair(var, lookup(name, var->get_local_variable_library()).my_SP())).first;
+        }
+        return found->second;
+    }
+    template <class Declaration>
+    int declaration_slot(Declaration* dec) {  // for an A_varDec_ or A_forExp_, where layout_frames put it
+        auto found = slots.find(dec);
+        if (found == slots.end()) {
+            found = slots.insert(std::make_pair(dec, dec->get_frame_slot())).first;
+        }
+        return found->second;
+    }
+
+    int read_char() {
+        if (pushed_back_char != -2) {
+            int ch = pushed_back_char;
+            pushed_back_char = -2;
+            return ch;
+        }
+        int ch = std::cin.get();
+        last_char = std::cin ? ch : -1;
+        return last_char;
+    }
+
+    Tiger_value call_library(AST_node_* node, const string &name, std::vector<Tiger_value> &args) {
+        if (name == "print" || name == "println") {
+            *out << string_of(args[0]) << (name == "println" ? "\n" : "");
+        } else if (name == "printint") {
+            *out << args[0].number;
+        } else if (name == "printbool") {
+            *out << (args[0].number ? "true" : "false");
+        } else if (name == "ord") {
+            string s = string_of(args[0]);
+            return number(s == "" ? -1 : (unsigned char) s[0]);
+        } else if (name == "chr") {
+            return string_value(string(1, char(args[0].number)));
+        } else if (name == "size") {
+            return number(string_of(args[0]).length());
+        } else if (name == "substring") {
+            string s = string_of(args[0]);
+            int first = args[1].number, n = args[2].number;
+            if (first < 0 || n < 0 || first + n > int(s.length())) return runtime_error(node, "substring out of range");
+            return string_value(s.substr(first, n));
+        } else if (name == "concat") {
+            return string_value(string_of(args[0]) + string_of(args[1]));
+        } else if (name == "tstrcmp") {
+            int comparison = string_of(args[0]).compare(string_of(args[1]));
+            return number(comparison < 0 ? -1 : comparison > 0 ? 1 : 0);
+        } else if (name == "div" || name == "mod") {
+            if (args[1].number == 0) return runtime_error(node, "division by zero");
+            return number(name == "div" ? args[0].number / args[1].number : args[0].number % args[1].number);
+        } else if (name == "getchar_ord") {
+            return number(read_char());
+        } else if (name == "putchar_ord") {
+            *out << char(args[0].number);
+        } else if (name == "flush") {
+            out->flush();
+        } else if (name == "getchar") {
+            int ch = read_char();
+            return string_value(ch < 0 ? "" : string(1, char(ch)));
+        } else if (name == "ungetchar") {
+            pushed_back_char = last_char;
+        } else if (name == "getline") {
+            string s;
+            int ch;
+            while ((ch = read_char()) >= 0 && ch != '\n') s += char(ch);
+            return string_value(s);
+        } else if (name == "getint") {
+            int n = 0;
+            std::cin >> n;
+            return number(n);
+        } else if (name == "exit") {
+            throw Tiger_exit{args[0].number};
+        } else if (name == "malloc" || name == "free") {
+            return runtime_error(node, name + " isn't available when interpreting");
+        } else {
+            return runtime_error(node, "unknown library function " + name);
+        }
+        return Tiger_value();
+    }
+};
+#endif
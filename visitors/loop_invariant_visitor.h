@@ -0,0 +1,342 @@
+#ifndef LOOP_INVARIANT_VISITOR_H
+#define LOOP_INVARIANT_VISITOR_H
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include "../AST.h"
+#include "../HERA_select.h"
+#include "../call_graph.h"
+#include "../optimize.h"
+#include "visitor.h"
+
+// Finds the expressions in a loop that come out the same every time around it, and that are
+//  worth computing once, before the loop starts (see optimize.h). An expression is invariant in a
+//  loop (a for loop's body, or a while loop's test and body) if it's
+//   - a constant;
+//   - a variable declared outside the loop, that the loop doesn't assign to, and that no function
+//     the loop calls can assign to either: a variable can only be changed behind our back by a
+//     nested function, through the static link, and the call graph says which functions write
+//     their outer variables (there are no pointers to variables in Tiger);
+//   - arithmetic or a comparison of invariant operands, or a call of a function that the call
+//     graph says is pure (which means it can't fail, loop forever or read a variable) with
+//     invariant arguments, or a division of an invariant by a nonzero constant (any other
+//     division calls div, which can fail).
+//  Records and arrays are left alone, since a field or element can be changed through any other
+//  name for the same record or array. Since what's hoisted can't fail or have side effects,
+//  running it before a loop whose body never runs (or in a branch that isn't taken) is harmless.
+// It's only worth keeping the value in the frame if it's cheaper to load it from there than to
+//  compute it: not for a constant, or a variable of this function, so it's arithmetic that isn't
+//  folded away, calls, and variables of enclosing functions (which take a walk up the static links).
+// Each expression is computed before the outermost loop of its function that it's invariant in,
+//  in a new slot at the top of that function's frame, as a whole: its parts only get their own
+//  slots if they can go further out than it can.
+// Which variables each loop declares or might change comes from the call graph (CG_writes); each
+//  visit returns the place in "loops" of the outermost loop the expression is invariant in, or
+//  loops.size() if it isn't invariant in any.
+struct LoopInvariantVisitor : Visitor<LoopInvariantVisitor, int, VoidContext> {
+    std::map<AST_node_*, int> slots;                            // hoisted expression -> its frame slot
+    std::map<AST_node_*, std::vector<AST_node_*> > hoisted;     // A_forExp_ or A_whileExp_ -> what it computes first
+    std::set<AST_node_*> frames;                                // the A_fundec_s (0 for main) that got slots
+    std::vector<string> report;
+
+    void find(A_root_* root, const CG_graph &graph) {
+        writes = &graph.writes;
+        accept(root, VoidContext());
+
+        std::map<A_fundec_*, int> frame_sizes;  // 0 for main
+        frame_sizes[0] = root->get_frame_size();
+        for (Proposal &proposal : proposals) {
+            if (frame_sizes.count(proposal.function) == 0) {
+                frame_sizes[proposal.function] = proposal.function->get_frame_size();
+            }
+            int slot = frame_sizes[proposal.function];
+            if (slot > 31) {
+                continue;  // too far up the frame for a LOAD or STORE to reach
+            }
+            frame_sizes[proposal.function] = slot + 1;
+            frames.insert(proposal.function);
+            slots[proposal.node] = slot;
+            hoisted[proposal.loop].push_back(proposal.node);
+            report.push_back("line " + std::to_string(proposal.node->pos().begin_line()) + ": computing " + proposal.what +
+                             " once, before the loop at line " + std::to_string(proposal.loop->pos().begin_line()));
+        }
+        root->set_frame_size(frame_sizes[0]);
+        for (auto &entry : frame_sizes) {
+            if (entry.first != 0) {
+                entry.first->set_frame_size(entry.second);
+            }
+        }
+    }
+
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return 0;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        accept(node->get_main_expr(), ctx);
+        return variant();
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        accept(node->get_fields(), ctx);
+        return variant();
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        accept(node->get_size(), ctx);
+        accept(node->get_init(), ctx);
+        return variant();
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        A_simpleVar_* var = dynamic_cast<A_simpleVar_*>(node->get_var());
+        if (var == 0) {
+            accept(node->get_var(), ctx);
+            return variant();
+        }
+        int outermost = invariant_from(var);
+        // a variable of this function is a LOAD already (or in a register)
+        propose(node, outermost, proposals.size(), var->get_frames_out() > 0, "the variable " + Symbol_to_string(var->get_sym()));
+        return outermost;
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        size_t mark = proposals.size();
+        int left = accept(node->get_left(), ctx);
+        int right = accept(node->get_right(), ctx);
+        int outermost = std::max(left, right);
+        bool folded = node->get_oper() != A_eqOp && node->get_oper() != A_neqOp && node->get_oper() != A_ltOp &&
+                      node->get_oper() != A_leOp && node->get_oper() != A_gtOp && node->get_oper() != A_geOp &&
+                      HERA_select(node).rule == HERA_rule_constant;
+        propose(node, outermost, mark, !folded, "an expression");
+        return outermost;
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        if (!OPT_is_dead_store(node)) {  // a dead store's value may not be computed at all
+            accept(node->get_exp(), ctx);
+        }
+        accept(node->get_var(), ctx);
+        return variant();
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        accept(node->get_decs(), ctx);
+        accept(node->get_body(), ctx);
+        return variant();
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        size_t mark = proposals.size();
+        int outermost = 0;
+        A_expList_* args = static_cast<A_expList_*>(node->get_args());
+        if (args != 0) {
+            for (A_exp arg : *args) {
+                outermost = std::max(outermost, accept(arg, ctx));
+            }
+        }
+        const CG_summary* callee = node->get_call_graph_summary();
+        // a division by a nonzero constant that became shifts (or nothing) can't fail, even though
+        //  div can (see HERA_select.h); any other division stays put, since the loop might never run
+        //  it (the body, or the branch it's in, might not run), and hoisting it could then fail
+        bool shifted = HERA_is_division(node) && cannot_fail(node, args);
+        if ((callee == 0 || !callee->pure()) && !shifted) {
+            return variant();
+        }
+        propose(node, outermost, mark, !shifted || HERA_select(node).rule != HERA_rule_constant,
+                "the call of " + Symbol_to_string(node->get_func()));
+        return outermost;
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        accept(node->get_then(), ctx);
+        accept(node->get_else_or_null(), ctx);
+        return variant();
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        loops.push_back(node);
+        accept(node->get_test(), ctx);
+        accept(node->get_body(), ctx);
+        loops.pop_back();
+        return variant();
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        loops.push_back(node);  // its variable is declared inside it, since it changes every time around
+        accept(node->get_body(), ctx);
+        loops.pop_back();
+        return variant();
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        A_expList_* seq = static_cast<A_expList_*>(node->get_seq());
+        int outermost = accept(seq, ctx);
+        return seq != 0 && seq->length() == 1 ? outermost : variant();  // just parentheses
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return variant();
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
+        return variant();
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        int outermost = variant();
+        for (AST_node_* element : *node) {
+            if (OPT_is_dead(element)) {
+                continue;  // it isn't generated (see optimize.h)
+            }
+            outermost = accept(element, ctx);
+        }
+        return outermost;  // the last one's, for a seqExp
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        accept(node->get_exp(), ctx);
+        return variant();
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return variant();
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return variant();
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        if (!OPT_is_dead_store(node)) {
+            accept(node->get_init(), ctx);
+        }
+        return variant();
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        accept(node->get_theFunctions(), ctx);
+        return variant();
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return variant();
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        if (OPT_is_dead(node)) {
+            return variant();
+        }
+        A_fundec_* outer_function = function;
+        std::vector<AST_node_*> outer_loops;
+        outer_loops.swap(loops);  // nothing can be hoisted out of the function
+        function = node;
+        accept(node->get_body(), ctx);
+        loops.swap(outer_loops);
+        function = outer_function;
+        return variant();
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return variant();
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return variant();
+    }
+
+private:
+    struct Proposal {
+        AST_node_* node;
+        AST_node_* loop;          // to compute it before
+        A_fundec_* function;      // whose frame keeps it; 0 for main
+        string what;              // for the report
+    };
+
+    const CG_writes* writes = 0;
+    std::vector<AST_node_*> loops;                       // in the current function, innermost last
+    A_fundec_* function = 0;
+    std::vector<Proposal> proposals;                     // in the order we find them
+
+    int variant() {
+        return int(loops.size());
+    }
+    // The place in "loops" of the outermost loop this variable is invariant in, counting out
+    //  from the innermost (it must be invariant in all of the loops in between, too)
+    int invariant_from(A_simpleVar_* var) {
+        AST_node_* declaration = CG_declaration_of(var);
+        if (declaration == 0) {
+            return variant();
+        }
+        int outermost = variant();
+        for (int loop = int(loops.size()) - 1; loop >= 0; loop--) {
+            if (writes->declares(loops[loop], declaration) || writes->might_change(loops[loop], declaration)) {
+                break;
+            }
+            outermost = loop;
+        }
+        return outermost;
+    }
+    // Hoist this expression, if it's invariant in some loop and worth it; then the parts of it found
+    //  since "mark" that would go before the same loop go with it, rather than by themselves
+    void propose(AST_node_* node, int outermost, size_t mark, bool worth_it, string what) {
+        if (outermost >= variant() || !worth_it) {
+            return;
+        }
+        AST_node_* loop = loops[outermost];
+        size_t kept = mark;
+        for (size_t i = mark; i < proposals.size(); i++) {
+            if (proposals[i].loop != loop) {
+                proposals[kept++] = proposals[i];
+            }
+        }
+        proposals.resize(kept);
+        proposals.push_back(Proposal{node, loop, function, what});
+    }
+    // A division whose code divides by a nonzero constant, as x / 4 shifted right, x / 1 or 12 / 4
+    static bool cannot_fail(A_callExp_* node, A_expList_* args) {
+        HERA_rule rule = HERA_select(node).rule;
+        if (rule == HERA_rule_shift_right || rule == HERA_rule_same) {
+            return true;
+        }
+        std::vector<AST_node_*> operands(args->begin(), args->end());
+        int divisor;
+        return rule == HERA_rule_constant && HERA_constant_value(operands[1], divisor) && divisor != 0;
+    }
+};
+#endif
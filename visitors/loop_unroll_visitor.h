@@ -0,0 +1,173 @@
+#ifndef LOOP_UNROLL_VISITOR_H
+#define LOOP_UNROLL_VISITOR_H
+#include <map>
+#include "../AST.h"
+#include "../HERA_select.h"
+#include "visitor.h"
+
+// Finds the for loops that could be unrolled (see optimize.h): those whose bounds are constants
+//  (after folding, as HERA_select does it), so we know how many times they run, and whose bodies
+//  have no function declarations in them, since each copy of the body generates its code again
+//  (a function would be generated once per copy). Whether it's worth it depends on how big the
+//  body's code is, so HERA_code decides that, with OPT_unroll_factor.
+// Each visit returns true if the code has a function declaration in it.
+struct LoopUnrollVisitor : Visitor<LoopUnrollVisitor, bool, VoidContext> {
+    std::map<AST_node_*, int> trips;  // A_forExp_ -> how many times it runs, for the ones we could unroll
+
+    void find(A_root_* root) {
+        accept(root, VoidContext());
+    }
+
+    bool accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return false;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    bool visitAST_node(AST_node_* node, VoidContext ctx) {
+        return true;
+    }
+    bool visitRoot(A_root_* node, VoidContext ctx) {
+        return accept(node->get_main_expr(), ctx);
+    }
+    bool visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return accept(node->get_fields(), ctx);
+    }
+    bool visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        bool size = accept(node->get_size(), ctx);
+        return accept(node->get_init(), ctx) || size;
+    }
+    bool visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    bool visitOpExp(A_opExp_* node, VoidContext ctx) {
+        bool left = accept(node->get_left(), ctx);
+        return accept(node->get_right(), ctx) || left;
+    }
+    bool visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        bool var = accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx) || var;
+    }
+    bool visitLetExp(A_letExp_* node, VoidContext ctx) {
+        bool decs = accept(node->get_decs(), ctx);
+        return accept(node->get_body(), ctx) || decs;
+    }
+    bool visitCallExp(A_callExp_* node, VoidContext ctx) {
+        return accept(node->get_args(), ctx);
+    }
+    bool visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        bool test = accept(node->get_test(), ctx);
+        bool then = accept(node->get_then(), ctx);
+        return accept(node->get_else_or_null(), ctx) || test || then;
+    }
+    bool visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        bool test = accept(node->get_test(), ctx);
+        return accept(node->get_body(), ctx) || test;
+    }
+    bool visitForExp(A_forExp_* node, VoidContext ctx) {
+        bool bounds = accept(node->get_lo(), ctx);
+        bounds = accept(node->get_hi(), ctx) || bounds;
+        bool body = accept(node->get_body(), ctx);
+        int lo, hi;
+        if (!body && HERA_constant_value(node->get_lo(), lo) && HERA_constant_value(node->get_hi(), hi) && hi >= lo) {
+            trips[node] = hi - lo + 1;
+        }
+        return bounds || body;
+    }
+    bool visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    bool visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    bool visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        bool var = accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx) || var;
+    }
+    bool visitExpList(A_expList_* node, VoidContext ctx) {
+        bool any = false;
+        for (AST_node_* element : *node) {
+            any = accept(element, ctx) || any;
+        }
+        return any;
+    }
+    bool visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    bool visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        bool any = false;
+        for (AST_node_* element : *node) {
+            any = accept(element, ctx) || any;
+        }
+        return any;
+    }
+    bool visitDecList(A_decList_* node, VoidContext ctx) {
+        bool any = false;
+        for (AST_node_* element : *node) {
+            any = accept(element, ctx) || any;
+        }
+        return any;
+    }
+    bool visitVarDec(A_varDec_* node, VoidContext ctx) {
+        return accept(node->get_init(), ctx);
+    }
+    bool visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        accept(node->get_theFunctions(), ctx);  // for the loops in the functions
+        return true;
+    }
+    bool visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return true;
+    }
+    bool visitFundec(A_fundec_* node, VoidContext ctx) {
+        accept(node->get_body(), ctx);
+        return true;
+    }
+    bool visitNamety(A_namety_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitField(A_field_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return false;
+    }
+};
+
+#endif
@@ -3,7 +3,7 @@
 #include "../AST.h"
 #include "visitor.h"
 
-struct ParentPointerVisitor : Visitor<void, VoidContext> {
+struct ParentPointerVisitor : Visitor<ParentPointerVisitor, void, VoidContext> {
     void accept(AST_node_* node, VoidContext ctx) {
         if (node == 0) {
             return;
@@ -15,7 +15,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
          EM_error("Not implemented");
     }
     void visitRoot(A_root_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_root_");
+        EM_DEBUG(EM_visitors, "setting parent for A_root_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -23,27 +23,27 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_main_expr(), ctx);
     }
     void visitNilExp(A_nilExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_nilExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_nilExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitBoolExp(A_boolExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_boolExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_boolExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitIntExp(A_intExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_intExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_intExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitStringExp(A_stringExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_stringExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_stringExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitRecordExp(A_recordExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_recordExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_recordExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -51,7 +51,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_fields(), ctx);
     }
     void visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_arrayExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_arrayExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -60,7 +60,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_init(), ctx);
     }
     void visitVarExp(A_varExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_varExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_varExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -68,7 +68,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_var(), ctx);
     }
     void visitOpExp(A_opExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_opExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_opExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -77,7 +77,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_right(), ctx);
     }
     void visitAssignExp(A_assignExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_assignExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_assignExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -86,7 +86,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_exp(), ctx);
     }
     void visitLetExp(A_letExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_letExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_letExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -95,7 +95,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_body(), ctx);
     }
     void visitCallExp(A_callExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_callExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_callExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -103,7 +103,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_args(), ctx);
     }
     void visitIfExp(A_ifExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_ifExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_ifExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -113,7 +113,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_else_or_null(), ctx);
     }
     void visitWhileExp(A_whileExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_whileExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_whileExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -122,7 +122,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_body(), ctx);
     }
     void visitForExp(A_forExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_forExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_forExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -132,12 +132,12 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_body(), ctx);
     }
     void visitBreakExp(A_breakExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_breakExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_breakExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitSeqExp(A_seqExp_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_seqExp_");
+        EM_DEBUG(EM_visitors, "setting parent for A_seqExp_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -145,12 +145,12 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_seq(), ctx);
     }
     void visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_simpleVar_");
+        EM_DEBUG(EM_visitors, "setting parent for A_simpleVar_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_fieldVar_");
+        EM_DEBUG(EM_visitors, "setting parent for A_fieldVar_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -158,24 +158,26 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_var(), ctx);
     }
     void visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_subscriptVar_");
+        EM_DEBUG(EM_visitors, "setting parent for A_subscriptVar_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
         ctx.parent = node;
         accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
     }
     void visitExpList(A_expList_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_expList_");
+        EM_DEBUG(EM_visitors, "setting parent for A_expList_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
         ctx.parent = node;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
     }
     void visitEfield(A_efield_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_efield_");
+        EM_DEBUG(EM_visitors, "setting parent for A_efield_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -183,24 +185,27 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_exp(), ctx);
     }
     void visitEfieldList(A_efieldList_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_efieldList_");
+        EM_DEBUG(EM_visitors, "setting parent for A_efieldList_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        ctx.parent = node;
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
     }
     void visitDecList(A_decList_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_decList_");
+        EM_DEBUG(EM_visitors, "setting parent for A_decList_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
         ctx.parent = node;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
     }
     void visitVarDec(A_varDec_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_varDec_");
+        EM_DEBUG(EM_visitors, "setting parent for A_varDec_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -208,7 +213,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_init(), ctx);
     }
     void visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_functionDec_");
+        EM_DEBUG(EM_visitors, "setting parent for A_functionDec_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -216,16 +221,17 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_theFunctions(), ctx);
     }
     void visitFundecList(A_fundecList_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_fundecList_");
+        EM_DEBUG(EM_visitors, "setting parent for A_fundecList_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
         ctx.parent = node;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
     }
     void visitFundec(A_fundec_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_fundec_");
+        EM_DEBUG(EM_visitors, "setting parent for A_fundec_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -234,7 +240,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_body(), ctx);
     }
     void visitTypeDec(A_typeDec_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_typeDec_");
+        EM_DEBUG(EM_visitors, "setting parent for A_typeDec_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -242,16 +248,17 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_theTypes(), ctx);
     }
     void visitNametyList(A_nametyList_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_nametyList_");
+        EM_DEBUG(EM_visitors, "setting parent for A_nametyList_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
         ctx.parent = node;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
     }
     void visitNamety(A_namety_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_namety_");
+        EM_DEBUG(EM_visitors, "setting parent for A_namety_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -259,26 +266,27 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_ty(), ctx);
     }
     void visitFieldList(A_fieldList_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_fieldList_");
+        EM_DEBUG(EM_visitors, "setting parent for A_fieldList_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
         ctx.parent = node;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
     }
     void visitField(A_field_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_field_");
+        EM_DEBUG(EM_visitors, "setting parent for A_field_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitNameTy(A_nameTy_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_nameTy_");
+        EM_DEBUG(EM_visitors, "setting parent for A_nameTy_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
     void visitRecordty(A_recordty_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_recordty_");
+        EM_DEBUG(EM_visitors, "setting parent for A_recordty_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
 
@@ -286,7 +294,7 @@ struct ParentPointerVisitor : Visitor<void, VoidContext> {
         accept(node->get_record(), ctx);
     }
     void visitArrayty(A_arrayty_* node, VoidContext ctx) {
-        EM_debug("setting parent for A_arrayty_");
+        EM_DEBUG(EM_visitors, "setting parent for A_arrayty_");
         AST_node_* parent = ctx.parent;
         node->set_stored_parent(parent);
     }
@@ -0,0 +1,343 @@
+#ifndef REGISTER_CALL_VISITOR_H
+#define REGISTER_CALL_VISITOR_H
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include "../AST.h"
+#include "../call_graph.h"
+#include "../optimize.h"
+#include "visitor.h"
+
+// Decides which functions take their first few arguments in registers and return their result in
+//  R1 (see optimize.h), and what that means for their code and for the calls of them:
+//   - a function can only do so if neither it nor anything that might be running when it's called
+//     (any function that calls it, directly or not, or main) uses the argument registers for
+//     anything else, since nobody saves those registers
+//   - such a function keeps each register parameter in its register, unless a nested function
+//     uses it (through the static link, from the frame) or it's read after a call to one of our
+//     functions might have put something else there; then the function stores it in its usual
+//     place in the frame as soon as it starts, and uses it from there ("spills" it)
+//   - a call computes each register argument in the usual register and moves it to the argument
+//     register, unless a later argument calls one of our functions or reads one of the caller's
+//     register parameters; then it goes in its usual place in the new frame until just before the call
+// Each visit returns true if the code calls one of our functions, or reads a parameter that is
+//  in a register. "called" says whether one of our functions may have been called since the
+//  current function started, along the way we got here, which is how we find the parameters that
+//  must be spilled: we go through the code in the order HERA_code generates it.
+struct RegisterCallVisitor : Visitor<RegisterCallVisitor, bool, VoidContext> {
+    std::set<AST_node_*> functions;                       // the A_fundec_s that take arguments in registers
+    std::map<AST_node_*, std::set<int> > spilled;         // A_fundec_ -> its register parameters that go in the frame
+    std::map<AST_node_*, std::set<int> > held;            // A_callExp_ -> its register arguments that wait in the frame
+    std::vector<string> report;
+
+    void find(A_root_* root, const CG_graph &graph) {
+        // Who might be running when each function is called: the functions that reach it in the call graph
+        std::map<string, std::set<string> > callers;
+        for (auto &entry : graph.functions) {
+            for (const string &callee : entry.second.callees) {
+                callers[callee].insert(entry.first);
+            }
+        }
+        std::set<string> too_big;  // functions whose code uses the argument registers
+        for (auto &entry : graph.functions) {
+            const CG_summary &f = entry.second;
+            int highest = f.name == "main" ? static_cast<A_exp_*>(root->get_main_expr())->result_reg()
+                        : f.fundec != 0 ? static_cast<A_exp_*>(f.fundec->get_body())->result_reg() : 0;
+            if (highest >= OPT_first_argument_register) {
+                too_big.insert(f.name);
+            }
+        }
+        for (auto &entry : graph.functions) {
+            const CG_summary &f = entry.second;
+            if (f.library || f.fundec == 0 || too_big.count(f.name)) {
+                continue;
+            }
+            std::set<string> reached = {f.name};
+            std::vector<string> to_do = {f.name};
+            bool ok = true;
+            while (ok && !to_do.empty()) {
+                string g = to_do.back();
+                to_do.pop_back();
+                for (const string &caller : callers[g]) {
+                    if (too_big.count(caller)) {
+                        ok = false;
+                    } else if (reached.insert(caller).second) {
+                        to_do.push_back(caller);
+                    }
+                }
+            }
+            if (ok) {
+                functions.insert(f.fundec);
+            }
+        }
+
+        accept(root, VoidContext());
+
+        std::vector<A_fundec_*> in_order;  // as they are in the program, for the report
+        for (AST_node_* f : functions) {
+            in_order.push_back(static_cast<A_fundec_*>(f));
+        }
+        std::sort(in_order.begin(), in_order.end(), [](A_fundec_* a, A_fundec_* b) {
+            return a->pos().begin_line() < b->pos().begin_line();
+        });
+        for (A_fundec_* fundec : in_order) {
+            AST_node_* f = fundec;
+            int in_registers = register_parameters(fundec);
+            string where = "line " + std::to_string(fundec->pos().begin_line()) + ": ";
+            string spills = "";
+            for (int param : spilled[f]) {
+                spills += (spills == "" ? "" : ", ") + std::to_string(param + 1);
+            }
+            report.push_back(where + Symbol_to_string(fundec->get_name())
+                             + (in_registers > 0 ? " takes " + std::to_string(in_registers) + " argument(s) in registers and" : "")
+                             + " returns its result in R1"
+                             + (spills == "" ? "" : " (stores parameter(s) " + spills + " in its frame)"));
+        }
+    }
+
+    bool accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return false;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    bool visitAST_node(AST_node_* node, VoidContext ctx) {
+        return true;
+    }
+    bool visitRoot(A_root_* node, VoidContext ctx) {
+        return accept(node->get_main_expr(), ctx);
+    }
+    bool visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return accept(node->get_fields(), ctx);
+    }
+    bool visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        bool size = accept(node->get_size(), ctx);
+        return accept(node->get_init(), ctx) || size;
+    }
+    bool visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    bool visitOpExp(A_opExp_* node, VoidContext ctx) {
+        // in the same order as A_opExp_::HERA_code: the operand that needs more registers first
+        A_exp_* left = static_cast<A_exp_*>(node->get_left());
+        A_exp_* right = static_cast<A_exp_*>(node->get_right());
+        if (right->result_reg() > left->result_reg()) {
+            bool first = accept(right, ctx);
+            return accept(left, ctx) || first;
+        }
+        bool first = accept(left, ctx);
+        return accept(right, ctx) || first;
+    }
+    bool visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        bool value = accept(node->get_exp(), ctx);
+        if (node->get_var()->kind() != AST_kind_simpleVar) {
+            return accept(node->get_var(), ctx) || value;
+        }
+        // a store, not a read, but it still puts something in the register
+        A_simpleVar_* var = static_cast<A_simpleVar_*>(node->get_var());
+        A_fundec_* owner;
+        if (register_parameter(var, owner) < 0) {
+            return value;
+        }
+        if (var->get_frames_out() > 0) {
+            spilled[owner].insert(register_parameter(var, owner));
+        }
+        return value || var->get_frames_out() == 0;
+    }
+    bool visitLetExp(A_letExp_* node, VoidContext ctx) {
+        bool decs = accept(node->get_decs(), ctx);
+        return accept(node->get_body(), ctx) || decs;
+    }
+    bool visitCallExp(A_callExp_* node, VoidContext ctx) {
+        std::vector<bool> disturbs;  // does each argument call one of our functions or read a register parameter?
+        A_expList_* args = static_cast<A_expList_*>(node->get_args());
+        if (args != 0) {
+            for (AST_node_* arg : *args) {
+                disturbs.push_back(accept(arg, ctx));
+            }
+        }
+        const CG_summary *callee = node->get_call_graph_summary();
+        if (callee == 0 || callee->fundec == 0) {  // a library function
+            bool result = false;
+            for (bool arg : disturbs) {
+                result = result || arg;
+            }
+            return result;
+        }
+        if (functions.count(callee->fundec)) {
+            int in_registers = register_parameters(callee->fundec);
+            bool later = false;
+            for (int arg = int(disturbs.size()) - 1; arg >= 0; arg--) {
+                if (later && arg < in_registers) {
+                    held[node].insert(arg);
+                }
+                later = later || disturbs[arg];
+            }
+        }
+        called = true;
+        return true;
+    }
+    bool visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        bool test = accept(node->get_test(), ctx);
+        bool before = called;
+        bool then = accept(node->get_then(), ctx);
+        bool after_then = called;
+        called = before;
+        bool otherwise = accept(node->get_else_or_null(), ctx);
+        called = called || after_then;
+        return test || then || otherwise;
+    }
+    bool visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        bool before = called;
+        bool result = accept(node->get_test(), ctx);
+        result = accept(node->get_body(), ctx) || result;
+        if (called && !before) {  // the next time around, too
+            accept(node->get_test(), ctx);
+            accept(node->get_body(), ctx);
+        }
+        return result;
+    }
+    bool visitForExp(A_forExp_* node, VoidContext ctx) {
+        bool result = accept(node->get_lo(), ctx);
+        result = accept(node->get_hi(), ctx) || result;
+        bool before = called;
+        result = accept(node->get_body(), ctx) || result;
+        if (called && !before) {
+            accept(node->get_body(), ctx);
+        }
+        return result;
+    }
+    bool visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    bool visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        A_fundec_* owner;
+        int param = register_parameter(node, owner);
+        if (param < 0) {
+            return false;
+        }
+        if (node->get_frames_out() > 0 || called) {
+            spilled[owner].insert(param);
+        }
+        return node->get_frames_out() == 0;
+    }
+    bool visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    bool visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        bool array = accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx) || array;
+    }
+    bool visitExpList(A_expList_* node, VoidContext ctx) {
+        bool result = false;
+        for (AST_node_* element : *node) {
+            result = accept(element, ctx) || result;
+        }
+        return result;
+    }
+    bool visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    bool visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        bool result = false;
+        for (AST_node_* element : *node) {
+            result = accept(element, ctx) || result;
+        }
+        return result;
+    }
+    bool visitDecList(A_decList_* node, VoidContext ctx) {
+        bool result = false;
+        for (AST_node_* element : *node) {
+            result = accept(element, ctx) || result;
+        }
+        return result;
+    }
+    bool visitVarDec(A_varDec_* node, VoidContext ctx) {
+        return accept(node->get_init(), ctx);
+    }
+    bool visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        accept(node->get_theFunctions(), ctx);
+        return false;  // declaring a function runs none of its code
+    }
+    bool visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return false;
+    }
+    bool visitFundec(A_fundec_* node, VoidContext ctx) {
+        bool outer_called = called;
+        called = false;
+        accept(node->get_body(), ctx);
+        called = outer_called;
+        return false;
+    }
+    bool visitNamety(A_namety_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitField(A_field_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return false;
+    }
+    bool visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return false;
+    }
+
+private:
+    bool called = false;  // might one of our functions have been called since this function started?
+
+    static int register_parameters(A_fundec_* f) {
+        A_fieldList_* params = f->cast_params();
+        return std::min(params ? params->length() : 0, OPT_argument_registers);
+    }
+    // Which of the register parameters of one of our functions (owner) this is, or -1.
+    //  A parameter's place in the frame is 3 + its position, and nothing else goes there.
+    int register_parameter(A_simpleVar_* var, A_fundec_* &owner) {
+        ST<var_info> variable_library = var->get_local_variable_library();
+        if (!is_name_there(var->get_sym(), variable_library)) {
+            return -1;
+        }
+        owner = var->get_function();
+        for (int out = 0; out < var->get_frames_out() && owner != 0; out++) {
+            owner = owner->get_enclosing_function();
+        }
+        int param = lookup(var->get_sym(), variable_library).my_SP() - 3;
+        if (owner == 0 || !functions.count(owner) || param < 0 || param >= register_parameters(owner)) {
+            return -1;
+        }
+        return param;
+    }
+};
+
+#endif
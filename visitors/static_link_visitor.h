@@ -0,0 +1,305 @@
+#ifndef STATIC_LINK_VISITOR_H
+#define STATIC_LINK_VISITOR_H
+#include <map>
+#include <vector>
+#include "../AST.h"
+#include "visitor.h"
+
+// Works out how the code of each function gets at variables declared in the functions it's nested
+//  in, for HERA_code:
+//   - each A_simpleVar_ is told how many frames out its variable is (0 if it's in its own function)
+//   - a function gets a static link, the frame pointer of the function it's declared in (or of
+//     main), if it uses a variable from out there, calls something that needs such a link from it,
+//     or has a nested function whose links go through it; functions that don't need one aren't passed one
+//   - each A_callExp_ is told which frame to pass as the callee's static link, if it takes one
+//   - a function that uses a frame two or more levels out from a loop, or several times, follows
+//     the links to it once, when it starts, and keeps the frame pointers in its own frame (a
+//     "display"), so getting at a variable there costs two LOADs however far out it is
+// This runs before layout_frames, since the static link and display go in each function's
+//  frame before the space for its variables (see A_fundec_::frame_header_size).
+struct StaticLinkVisitor : Visitor<StaticLinkVisitor, int, VoidContext> {
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return 0;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        accept(node->get_main_expr(), ctx);
+        link_functions();
+        return 0;
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return accept(node->get_fields(), ctx);
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        accept(node->get_size(), ctx);
+        return accept(node->get_init(), ctx);
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        accept(node->get_left(), ctx);
+        return accept(node->get_right(), ctx);
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx);
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        size_t outer_scope = scope.size();
+        accept(node->get_decs(), ctx);
+        accept(node->get_body(), ctx);
+        scope.resize(outer_scope);
+        return 0;
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        if (is_name_there(node->get_func(), node->get_local_function_library())) {
+            calls.push_back(Call{node, function, loops});
+        }
+        return accept(node->get_args(), ctx);
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        accept(node->get_then(), ctx);
+        return accept(node->get_else_or_null(), ctx);
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        loops++;
+        accept(node->get_test(), ctx);
+        accept(node->get_body(), ctx);
+        loops--;
+        return 0;
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        size_t outer_scope = scope.size();
+        scope.push_back(std::make_pair(node->get_var(), function));
+        loops++;
+        accept(node->get_body(), ctx);
+        loops--;
+        scope.resize(outer_scope);
+        return 0;
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        int frames_out = 0;
+        for (auto binding = scope.rbegin(); binding != scope.rend(); binding++) {
+            if (Symbols_are_equal(binding->first, node->get_sym())) {
+                frames_out = depth(function) - depth(binding->second);
+                break;
+            }
+        }
+        node->set_frames_out(function, frames_out);
+        use(function, frames_out);
+        return 0;
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx);
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        accept(node->get_init(), ctx);  // before the new variable is in scope
+        scope.push_back(std::make_pair(node->get_var(), function));
+        return 0;
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        A_fundec_* outer_function = function;
+        int outer_loops = loops;
+        size_t outer_scope = scope.size();
+        enclosing[node] = function;
+        depths[node] = depth(function) + 1;
+        if (is_name_there(node->get_name(), node->get_local_function_library())) {
+            by_name[node->get_my_unique_function_name()] = node;
+        }
+        function = node;
+        loops = 0;
+        A_fieldList_* params = node->cast_params();
+        if (params != 0) {
+            for (A_field_* param : *params) {
+                scope.push_back(std::make_pair(param->get_name(), function));
+            }
+        }
+        accept(node->get_body(), ctx);
+        scope.resize(outer_scope);
+        function = outer_function;
+        loops = outer_loops;
+        return 0;
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return 0;
+    }
+
+private:
+    static const int in_loop_weight = 10;  // a use in a loop counts as this many uses elsewhere
+    static const int display_weight = 3;   // enough uses of a frame to keep a pointer to it (costs a LOAD and a STORE per level)
+
+    struct Call {
+        A_callExp_* call;
+        A_fundec_* caller;  // 0 for main
+        int loops;          // how many loops (in the caller) it's in
+    };
+
+    A_fundec_* function = 0;  // whose code we're in; 0 for main
+    int loops = 0;            // how many loops (in this function) we're in
+    std::vector<std::pair<Symbol, A_fundec_*> > scope;  // each variable, and the function it belongs to; innermost last
+    std::map<A_fundec_*, A_fundec_*> enclosing;         // the function each one is declared in
+    std::map<A_fundec_*, int> depths;                   // how deeply each is nested; main's depth is 0
+    std::map<string, A_fundec_*> by_name;               // by unique name, to find what a call calls
+    std::vector<Call> calls;
+    std::map<A_fundec_*, int> reach;                    // how many frames out each function needs to get to
+    std::map<A_fundec_*, std::map<int, int> > uses;     // weighted uses of the frames 2 or more out, by how far out
+
+    int depth(A_fundec_* f) {
+        return f == 0 ? 0 : depths[f];
+    }
+    void use(A_fundec_* f, int frames_out) {
+        if (f == 0 || frames_out == 0) {
+            return;
+        }
+        reach[f] = std::max(reach[f], frames_out);
+        if (frames_out >= 2) {
+            uses[f][frames_out] += loops > 0 ? in_loop_weight : 1;
+        }
+    }
+    A_fundec_* callee(const Call &c) {  // 0 for a library function
+        auto found = by_name.find(c.call->get_my_unique_function_name());
+        return found == by_name.end() ? 0 : found->second;
+    }
+    // Which frame (counting out from the caller's) a call passes as the callee's static link:
+    //  the one the callee was declared in
+    int link_frames_out(const Call &c, A_fundec_* g) {
+        return depth(c.caller) - (depth(g) - 1);
+    }
+
+    void link_functions() {
+        // A function needs a link if it reaches out itself, or calls something whose link is a
+        //  frame out from it, or a function declared in it reaches out further than it; going
+        //  around until nothing changes takes care of recursion
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const Call &c : calls) {
+                A_fundec_* g = callee(c);
+                if (g != 0 && c.caller != 0 && reach[g] > 0 && link_frames_out(c, g) > reach[c.caller]) {
+                    reach[c.caller] = link_frames_out(c, g);
+                    changed = true;
+                }
+            }
+            for (auto &entry : enclosing) {
+                A_fundec_* f = entry.second;
+                if (f != 0 && reach[entry.first] - 1 > reach[f]) {
+                    reach[f] = reach[entry.first] - 1;
+                    changed = true;
+                }
+            }
+        }
+
+        for (const Call &c : calls) {
+            A_fundec_* g = callee(c);
+            if (g != 0 && reach[g] > 0) {
+                int frames_out = link_frames_out(c, g);
+                c.call->set_static_link(c.caller, frames_out);
+                if (frames_out >= 2) {
+                    uses[c.caller][frames_out] += c.loops > 0 ? in_loop_weight : 1;
+                }
+            } else {
+                c.call->set_static_link(c.caller, -1);
+            }
+        }
+
+        for (auto &entry : enclosing) {
+            A_fundec_* f = entry.first;
+            int display_to = 1;
+            for (auto &frame : uses[f]) {
+                if (frame.second >= display_weight) {
+                    display_to = frame.first;
+                }
+            }
+            f->set_static_link(entry.second, reach[f] > 0, display_to - 1);
+            if (reach[f] > 0) {
+                EM_DEBUG(EM_visitors, f->get_my_unique_function_name() + " gets a static link, reaching " + std::to_string(reach[f])
+                         + " frame(s) out" + (display_to > 1 ? ", with a display of " + std::to_string(display_to - 1) : ""));
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef SWITCH_VISITOR_H
+#define SWITCH_VISITOR_H
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include "../AST.h"
+#include "../HERA_select.h"
+#include "../optimize.h"
+#include "visitor.h"
+
+// Finds the chains of ifs that compare one variable with constants (see optimize.h), such as
+//   if x = 1 then a else if x = 2 then b else if x = 3 then c ... else d
+//  each else being the next if (maybe in parentheses). Each test must be x = con (or con = x),
+//  with x the same simple variable throughout and con a constant after folding, as HERA_select
+//  sees it. Since none of the tests has a side effect, the chain can look at x once and go
+//  straight to the right then; a test whose value numbering keeps it for later (see
+//  visitors/value_number_visitor.h) has to be computed, though, so the chain stops before it.
+//  A constant tested again can never be true the second time, so its then is left out.
+// With at least min_cases constants, the chain becomes a jump table if there'd be no more than
+//  three entries in the table for each constant; otherwise, a binary search of the constants.
+struct SwitchVisitor : Visitor<SwitchVisitor, int, VoidContext> {
+    std::map<AST_node_*, OPT_switch> switches;  // the first A_ifExp_ of each chain -> its tests
+    std::vector<string> report;
+
+    static const int min_cases = 4;
+
+    void find(A_root_* root) {
+        accept(root, VoidContext());
+    }
+
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return 0;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        return accept(node->get_main_expr(), ctx);
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return accept(node->get_fields(), ctx);
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        accept(node->get_size(), ctx);
+        return accept(node->get_init(), ctx);
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        accept(node->get_left(), ctx);
+        return accept(node->get_right(), ctx);
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx);
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        accept(node->get_decs(), ctx);
+        return accept(node->get_body(), ctx);
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        return accept(node->get_args(), ctx);
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        if (!in_chain.count(node)) {
+            chain(node);
+        }
+        accept(node->get_test(), ctx);
+        accept(node->get_then(), ctx);
+        return accept(node->get_else_or_null(), ctx);
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        return accept(node->get_body(), ctx);
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        return accept(node->get_body(), ctx);
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx);
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        return accept(node->get_init(), ctx);
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        return accept(node->get_body(), ctx);
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return 0;
+    }
+
+private:
+    std::set<AST_node_*> in_chain;  // the ifs after the first in each chain we found
+
+    // The if this expression is, maybe in parentheses, or 0
+    static A_ifExp_* if_in(AST_node_* exp) {
+        while (exp != 0 && exp->kind() == AST_kind_seqExp) {
+            A_expList seq = static_cast<A_expList>(static_cast<A_seqExp_*>(exp)->get_seq());
+            exp = seq != 0 && seq->length() == 1 ? *seq->begin() : 0;
+        }
+        return dynamic_cast<A_ifExp_*>(exp);
+    }
+
+    // If this if's test is x = con (or con = x), with x a simple variable, sets var and value
+    static bool compares(A_ifExp_* link, A_varExp_* &var, int &value) {
+        A_opExp_* test = dynamic_cast<A_opExp_*>(link->get_test());
+        if (test == 0 || test->get_oper() != A_eqOp) {
+            return false;
+        }
+        AST_node_* other = test->get_right();
+        var = dynamic_cast<A_varExp_*>(test->get_left());
+        if (var == 0 || var->get_var()->kind() != AST_kind_simpleVar) {
+            other = test->get_left();
+            var = dynamic_cast<A_varExp_*>(test->get_right());
+        }
+        return var != 0 && var->get_var()->kind() == AST_kind_simpleVar && HERA_constant_value(other, value);
+    }
+
+    void chain(A_ifExp_* first) {
+        OPT_switch tests;
+        tests.var = 0;
+        std::vector<A_ifExp_*> links;
+        std::set<int> seen;
+        Symbol name = 0;
+        AST_node_* rest = first;
+        for (A_ifExp_* link = first; link != 0; link = if_in(rest)) {
+            A_varExp_* var;
+            int value;
+            if (!compares(link, var, value) || OPT_kept_slot(link->get_test()) >= 0 || OPT_kept_slot(var) >= 0) {
+                break;
+            }
+            Symbol sym = static_cast<A_simpleVar_*>(var->get_var())->get_sym();
+            if (tests.var == 0) {
+                tests.var = var;
+                name = sym;
+            } else if (!Symbols_are_equal(sym, name)) {
+                break;
+            }
+            links.push_back(link);
+            if (seen.insert(value).second) {
+                tests.cases.push_back(std::make_pair(value, link->get_then()));
+            }
+            rest = link->get_else_or_null();
+        }
+        if (int(tests.cases.size()) < min_cases) {
+            return;
+        }
+        tests.default_or_null = rest;
+        std::stable_sort(tests.cases.begin(), tests.cases.end(),
+                         [](const std::pair<int, AST_node_*> &a, const std::pair<int, AST_node_*> &b) { return a.first < b.first; });
+        long entries = long(tests.cases.back().first) - tests.cases.front().first + 1;
+        tests.jump_table = entries <= 3 * long(tests.cases.size());
+        switches[first] = tests;
+        in_chain.insert(links.begin() + 1, links.end());
+
+        report.push_back("line " + std::to_string(first->pos().begin_line()) + ": the " + std::to_string(links.size()) +
+                         " tests of " + Symbol_to_string(name) + " go " +
+                         (tests.jump_table ? "through a jump table of " + std::to_string(entries) + " entries"
+                                           : "by a binary search of " + std::to_string(tests.cases.size()) + " constants"));
+    }
+};
+
+#endif
@@ -0,0 +1,460 @@
+#ifndef VALUE_NUMBER_VISITOR_H
+#define VALUE_NUMBER_VISITOR_H
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include "../AST.h"
+#include "../HERA_select.h"
+#include "../call_graph.h"
+#include "../optimize.h"
+#include "visitor.h"
+
+// Finds the expressions that compute a value the function has computed already, so they can load
+//  it from the frame instead (see optimize.h). Each expression gets a value number, in the order
+//  HERA_code generates the code (which, for reg op reg, is the operand that needs more registers
+//  first): the same number means the same value. A constant's number comes from its value, a
+//  variable's from its declaration and how many times it might have changed (its "version"),
+//  and arithmetic, a comparison, or a call of a pure function (by the call graph) from the
+//  operator or function and the numbers of its operands, in order, except that + * = <> don't
+//  care about the order. Anything else gets a number of its own.
+// A variable gets a new version when it's assigned to, when a function that writes outer variables
+//  is called (if a nested function assigns to it anywhere), and when a loop that might do either
+//  to it starts. Records and arrays are left alone, as in LoopInvariantVisitor.
+// An expression whose number was computed earlier by an expression that's still available can
+//  load that one's value; the earlier one stores it in a new slot at the top of the frame as soon
+//  as it's computed. What's computed before a branch, or a loop, is available in it; what's
+//  computed inside is only available until it ends, since the code after it may not have gone
+//  that way (the tree's structure gives us the dominators). Nothing is available across
+//  functions, or from a loop's hoisted expressions, which are computed somewhere else altogether.
+// It's only worth it for expressions that take more than a few cycles: a STORE and a LOAD cost
+//  two each (see HERA_sim.h), so we guess at the cycles each expression takes.
+// Which variables each loop assigns to, which loops call a function that writes outer variables,
+//  and which variables a nested function assigns to come from the call graph (CG_writes), as in
+//  LoopInvariantVisitor.
+struct ValueNumberVisitor : Visitor<ValueNumberVisitor, int, VoidContext> {
+    std::map<AST_node_*, int> kept;      // expression -> the slot it stores its value in
+    std::map<AST_node_*, int> reused;    // expression -> the slot it loads its value from
+    std::set<AST_node_*> frames;         // the A_fundec_s (0 for main) that got slots
+    std::vector<string> report;
+
+    void find(A_root_* root, const CG_graph &graph) {
+        writes = &graph.writes;
+        accept(root, VoidContext());
+
+        std::map<A_fundec_*, int> frame_sizes;  // 0 for main
+        frame_sizes[0] = root->get_frame_size();
+        for (Reuse &reuse : reuses) {
+            if (frame_sizes.count(reuse.function) == 0) {
+                frame_sizes[reuse.function] = reuse.function->get_frame_size();
+            }
+            if (kept.count(reuse.earlier) == 0) {
+                int slot = frame_sizes[reuse.function];
+                if (slot > 31) {
+                    continue;  // too far up the frame for a LOAD or STORE to reach
+                }
+                frame_sizes[reuse.function] = slot + 1;
+                frames.insert(reuse.function);
+                kept[reuse.earlier] = slot;
+            }
+            reused[reuse.node] = kept[reuse.earlier];
+            report.push_back("line " + std::to_string(reuse.node->pos().begin_line()) + ": reusing " + reuse.what +
+                             " computed at line " + std::to_string(reuse.earlier->pos().begin_line()));
+        }
+        root->set_frame_size(frame_sizes[0]);
+        for (auto &entry : frame_sizes) {
+            if (entry.first != 0) {
+                entry.first->set_frame_size(entry.second);
+            }
+        }
+    }
+
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return unique();
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        accept(node->get_main_expr(), ctx);
+        return unique();
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        cost = 1;
+        return number("nil");
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        cost = 1;
+        return number(node->get_value() ? "true" : "false");
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        cost = 1;
+        return constant(node->get_value());
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        cost = 2;
+        return number("string " + repr(node->get_value()));
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        accept(node->get_fields(), ctx);
+        return unique();
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        accept(node->get_size(), ctx);
+        accept(node->get_init(), ctx);
+        return unique();
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        A_simpleVar_* var = dynamic_cast<A_simpleVar_*>(node->get_var());
+        if (var == 0 || OPT_hoisted_slot(node) >= 0) {
+            accept(node->get_var(), ctx);
+            return unique();
+        }
+        AST_node_* declaration = CG_declaration_of(var);
+        if (declaration == 0) {
+            return unique();
+        }
+        cost = 2 + 2 * var->get_frames_out();  // a LOAD for each static link, too
+        int value = number("var " + std::to_string(versions[declaration]));  // each version is of just one variable
+        found(node, value, here(), "the variable " + Symbol_to_string(var->get_sym()));
+        return value;
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        if (OPT_hoisted_slot(node) >= 0) {
+            return unique();
+        }
+        A_oper op = node->get_oper();
+        bool arithmetic = op == A_plusOp || op == A_minusOp || op == A_timesOp;
+        if (arithmetic && HERA_select(node).rule != HERA_rule_registers) {
+            return selected(node, HERA_select(node), op, node->get_left(), node->get_right(), "an expression");
+        }
+        Mark mark = here();
+        // the operand that needs more registers goes first (see A_opExp_::HERA_code)
+        bool left_first = static_cast<A_exp_*>(node->get_left())->result_reg() >= static_cast<A_exp_*>(node->get_right())->result_reg();
+        int left, right, left_cost, right_cost;
+        if (left_first) {
+            left = accept(node->get_left(), ctx);
+            left_cost = cost;
+            right = accept(node->get_right(), ctx);
+            right_cost = cost;
+        } else {
+            right = accept(node->get_right(), ctx);
+            right_cost = cost;
+            left = accept(node->get_left(), ctx);
+            left_cost = cost;
+        }
+        bool strings = node->get_left()->typecheck() == Ty_String();
+        cost = left_cost + right_cost + (arithmetic ? 1 : strings ? 20 : 3);  // a comparison branches, or calls tstrcmp
+        int value = operation(std::to_string(op) + (strings ? "s" : ""), left, right, op == A_plusOp || op == A_timesOp || op == A_eqOp || op == A_neqOp);
+        found(node, value, mark, "an expression");
+        return value;
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        if (OPT_is_dead_store(node)) {
+            region([&]() { accept(node->get_exp(), ctx); });  // it may not be computed at all (see optimize.h)
+        } else {
+            accept(node->get_exp(), ctx);
+        }
+        accept(node->get_var(), ctx);
+        A_simpleVar_* var = dynamic_cast<A_simpleVar_*>(node->get_var());
+        if (var != 0) {
+            change(CG_declaration_of(var));
+        }
+        return unique();
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        accept(node->get_decs(), ctx);
+        accept(node->get_body(), ctx);
+        return unique();
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        if (OPT_hoisted_slot(node) >= 0) {
+            return unique();
+        }
+        if (HERA_is_division(node) && HERA_select(node).rule != HERA_rule_registers) {
+            std::vector<AST_node_*> args;
+            for (A_exp arg : *static_cast<A_expList_*>(node->get_args())) {
+                args.push_back(arg);
+            }
+            return selected(node, HERA_select(node), A_divideOp, args[0], args[1], "the call of div");
+        }
+        Mark mark = here();
+        string key = "call " + node->get_my_unique_function_name() + "(";
+        int args_cost = 0;
+        A_expList_* args = static_cast<A_expList_*>(node->get_args());
+        if (args != 0) {
+            for (A_exp arg : *args) {
+                key += std::to_string(accept(arg, ctx)) + ",";
+                args_cost += cost;
+            }
+        }
+        const CG_summary* callee = node->get_call_graph_summary();
+        if (callee == 0 || (callee->effects & CG_writes_outer)) {
+            change_written_by_nested();
+        }
+        if (callee == 0 || !callee->pure()) {
+            return unique();
+        }
+        cost = args_cost + 20;
+        int value = number(key + ")");
+        found(node, value, mark, "the call of " + Symbol_to_string(node->get_func()));
+        return value;
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        region([&]() { accept(node->get_then(), ctx); });
+        region([&]() { accept(node->get_else_or_null(), ctx); });
+        return unique();
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        region([&]() {
+            enter_loop(node);
+            accept(node->get_test(), ctx);
+            accept(node->get_body(), ctx);
+        });
+        return unique();
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        region([&]() {
+            enter_loop(node);
+            change(node);  // its variable
+            accept(node->get_body(), ctx);
+        });
+        return unique();
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        A_expList_* seq = static_cast<A_expList_*>(node->get_seq());
+        int value = accept(seq, ctx);
+        // just parentheses; anything else has side effects, and mustn't be left out in favour of a LOAD
+        return seq != 0 && seq->length() == 1 ? value : unique();
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return unique();
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
+        return unique();
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        int value = unique();
+        for (AST_node_* element : *node) {
+            if (OPT_is_dead(element)) {
+                region([&]() { accept(element, ctx); });  // it isn't generated (see optimize.h)
+                value = unique();
+            } else {
+                value = accept(element, ctx);
+            }
+        }
+        return value;
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        accept(node->get_exp(), ctx);
+        return unique();
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return unique();
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return unique();
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        if (OPT_is_dead_store(node)) {
+            region([&]() { accept(node->get_init(), ctx); });
+        } else {
+            accept(node->get_init(), ctx);
+        }
+        change(node);
+        return unique();
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        accept(node->get_theFunctions(), ctx);
+        return unique();
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return unique();
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        if (OPT_is_dead(node)) {
+            return unique();
+        }
+        A_fundec_* outer_function = function;
+        std::map<int, AST_node_*> outer_available;
+        outer_available.swap(available);  // nothing is available across functions
+        std::vector<int> outer_log;
+        outer_log.swap(log);
+        function = node;
+        A_fieldList_* params = node->cast_params();
+        if (params != 0) {
+            for (A_field_* param : *params) {
+                change(param);
+            }
+        }
+        accept(node->get_body(), ctx);
+        log.swap(outer_log);
+        available.swap(outer_available);
+        function = outer_function;
+        return unique();
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return unique();
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return unique();
+    }
+
+private:
+    struct Mark {                 // how much had been found when we started on an expression
+        size_t log, reuses;
+    };
+    struct Reuse {
+        AST_node_* node;
+        AST_node_* earlier;       // the expression whose value it loads
+        A_fundec_* function;      // whose frame keeps it; 0 for main
+        string what;              // for the report
+    };
+
+    const CG_writes* writes = 0;
+    A_fundec_* function = 0;
+
+    std::map<string, int> numbers;                       // the value number of each key
+    int next_number = 0;
+    std::map<AST_node_*, int> versions;                  // by declaration
+    int next_version = 0;
+    std::map<int, AST_node_*> available;                 // value number -> the expression that computed it
+    std::vector<int> log;                                // the value numbers made available, in order
+    std::vector<Reuse> reuses;
+    int cost = 0;                                        // our guess at the cycles the last expression took
+
+    int unique() {
+        cost = 100;  // nothing cares
+        return next_number++;
+    }
+    int number(string key) {
+        auto found = numbers.find(key);
+        return found != numbers.end() ? found->second : numbers[key] = next_number++;
+    }
+    int constant(int value) {
+        return number("int " + std::to_string(value));
+    }
+    int operation(string op, int left, int right, bool commutes) {
+        if (commutes && right < left) {
+            std::swap(left, right);
+        }
+        return number(op + "(" + std::to_string(left) + "," + std::to_string(right) + ")");
+    }
+    void change(AST_node_* declaration) {  // or declare it
+        versions[declaration] = ++next_version;
+    }
+    void change_written_by_nested() {
+        for (AST_node_* declaration : writes->written_by_nested) {
+            change(declaration);
+        }
+    }
+    void enter_loop(AST_node_* loop) {  // whatever it might change, it might have changed already
+        auto assigned = writes->assigned.find(loop);
+        if (assigned != writes->assigned.end()) {
+            for (AST_node_* declaration : assigned->second) {
+                change(declaration);
+            }
+        }
+        if (writes->calls_writer.count(loop)) {
+            change_written_by_nested();
+        }
+    }
+    Mark here() {
+        return Mark{log.size(), reuses.size()};
+    }
+    // What's computed in some code that may not run is only available until it ends
+    template <class Code> void region(Code code) {
+        size_t mark = log.size();
+        code();
+        forget(mark);
+    }
+    void forget(size_t mark) {
+        while (log.size() > mark) {
+            available.erase(log.back());
+            log.pop_back();
+        }
+    }
+    // An expression has been numbered: it can load the value of an earlier one with the same
+    //  number, if that's available (and then what was found inside it won't be computed after all),
+    //  or else make its own available
+    void found(AST_node_* node, int value, Mark mark, string what) {
+        if (cost <= 4) {
+            return;
+        }
+        auto earlier = available.find(value);
+        if (earlier != available.end()) {
+            forget(mark.log);
+            reuses.resize(mark.reuses);
+            reuses.push_back(Reuse{node, earlier->second, function, what});
+            cost = 2;
+            return;
+        }
+        available[value] = node;
+        log.push_back(value);
+    }
+    // reg op con and the like (see HERA_select.h), which only compute the one operand, if any
+    int selected(AST_node_* node, const HERA_selection &selection, A_oper op, AST_node_* left, AST_node_* right, string what) {
+        if (selection.rule == HERA_rule_constant) {
+            cost = 1;
+            return constant(selection.value);
+        }
+        Mark mark = here();
+        int operand = accept(selection.operand, VoidContext());
+        int constant_value = 0;
+        HERA_constant_value(selection.operand == left ? right : left, constant_value);
+        int con = constant(constant_value);
+        cost += selection.rule == HERA_rule_same ? 0 : selection.rule == HERA_rule_shift_left || selection.rule == HERA_rule_shift_right ? selection.value
+              : selection.rule == HERA_rule_constant_operand ? 2 : 1;
+        if (selection.rule == HERA_rule_same) {
+            return operand;  // e.g. x * 1 is x
+        }
+        int value = selection.operand == left ? operation(std::to_string(op), operand, con, op == A_plusOp || op == A_timesOp)
+                                              : operation(std::to_string(op), con, operand, op == A_plusOp || op == A_timesOp);
+        found(node, value, mark, what);
+        return value;
+    }
+};
+#endif
@@ -3,7 +3,7 @@
 #include "../AST.h"
 #include "visitor.h"
 
-struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
+struct VariableLibraryVisitor : Visitor<VariableLibraryVisitor, ST<var_info>, VoidContext> {
     ST<var_info> accept(AST_node_* node, VoidContext ctx) {
         if (node == 0) {
             return ST<var_info>();
@@ -16,7 +16,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitRoot(A_root_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_root_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_root_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -24,35 +24,35 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return accept(node->get_main_expr(), ctx);
     }
     ST<var_info> visitNilExp(A_nilExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_nilExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_nilExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         return ST<var_info>();
     }
     ST<var_info> visitBoolExp(A_boolExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_boolExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_boolExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         return ST<var_info>();
     }
     ST<var_info> visitIntExp(A_intExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_intExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_intExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         return ST<var_info>();
     }
     ST<var_info> visitStringExp(A_stringExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_stringExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_stringExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         return ST<var_info>();
     }
     ST<var_info> visitRecordExp(A_recordExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_recordExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_recordExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -62,7 +62,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_arrayExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_arrayExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -73,7 +73,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitVarExp(A_varExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_varExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_varExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -81,7 +81,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return accept(node->get_var(), ctx);
     }
     ST<var_info> visitOpExp(A_opExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_opExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_opExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -92,7 +92,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitAssignExp(A_assignExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_assignExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_assignExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -103,7 +103,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitLetExp(A_letExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_letExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_letExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -117,7 +117,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitCallExp(A_callExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_callExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_callExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -127,7 +127,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitIfExp(A_ifExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_ifExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_ifExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -139,7 +139,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitWhileExp(A_whileExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_whileExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_whileExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -150,7 +150,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitForExp(A_forExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_forExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_forExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -158,8 +158,8 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         accept(node->get_lo(), ctx);
         accept(node->get_hi(), ctx);
 
-        int this_SP_counter = node->calculate_my_SP(node);
-        ST<var_info> for_var_lib = ST<var_info>(node->get_var(), var_info(Ty_Int(), this_SP_counter, false));
+        int this_SP_counter = node->get_frame_slot();
+        ST<var_info> for_var_lib = ST<var_info>(node->get_var(), var_info(Ty_Int(), this_SP_counter, false, node));
         ST<var_info> new_local_var_lib = MergeAndShadow(for_var_lib, local_var_lib);
         ctx.local_variable_library = new_local_var_lib;
 
@@ -169,14 +169,14 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitBreakExp(A_breakExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_breakExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_breakExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         return ST<var_info>();
     }
     ST<var_info> visitSeqExp(A_seqExp_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_seqExp_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_seqExp_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -186,14 +186,14 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_simpleVar_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_simpleVar_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         return ST<var_info>();
     }
     ST<var_info> visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_fieldVar_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_fieldVar_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -203,28 +203,30 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_subscriptVar_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_subscriptVar_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         ctx.local_variable_library = local_var_lib;
         accept(node->get_var(), ctx);
+        accept(node->get_exp(), ctx);
 
         return ST<var_info>();
     }
     ST<var_info> visitExpList(A_expList_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_expList_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_expList_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         ctx.local_variable_library = local_var_lib;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
 
         return ST<var_info>();
     }
     ST<var_info> visitEfield(A_efield_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_efield_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_efield_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -234,33 +236,33 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitEfieldList(A_efieldList_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_efieldList_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_efieldList_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
 
         return ST<var_info>();
     }
     ST<var_info> visitDecList(A_decList_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_decList_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_decList_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
-        ctx.local_variable_library = local_var_lib;
-        ST<var_info> head_var_lib = accept(node->get_head(), ctx);
-
-        ST<var_info> new_local_var_lib = MergeAndShadow(head_var_lib, local_var_lib);
-        ctx.local_variable_library = new_local_var_lib;
-        ST<var_info> tail_var_lib = accept(node->get_tail(), ctx);
+        // each dec sees the ones before it, which shadow the enclosing scope
+        ST<var_info> declist_var_lib = ST<var_info>();
+        for (AST_node_* element : *node) {
+            ctx.local_variable_library = MergeAndShadow(declist_var_lib, local_var_lib);
+            declist_var_lib = MergeAndShadow(accept(element, ctx), declist_var_lib);
+        }
 
         // Return the decs that were declared 
-        ST<var_info> declist_var_lib = MergeAndShadow(tail_var_lib, head_var_lib);
         return declist_var_lib;
     }
     ST<var_info> visitVarDec(A_varDec_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_varDec_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_varDec_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -268,12 +270,12 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         accept(node->get_init(), ctx);
 
 
-        int my_SP = node->calculate_my_SP(node);
-        ST<var_info> declared_variable_library = ST<var_info>(node->get_var(), var_info(node->get_init()->typecheck(), my_SP, true));
+        int my_SP = node->get_frame_slot();
+        ST<var_info> declared_variable_library = ST<var_info>(node->get_var(), var_info(node->typecheck(), my_SP, true, node));  // the declared type, if there is one
         return declared_variable_library;
     }
     ST<var_info> visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_functionDec_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_functionDec_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -283,18 +285,19 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitFundecList(A_fundecList_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_fundecList_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_fundecList_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         ctx.local_variable_library = local_var_lib;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
 
         return ST<var_info>();
     }
     ST<var_info> visitFundec(A_fundec_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_fundec_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_fundec_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -308,7 +311,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitTypeDec(A_typeDec_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_typeDec_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_typeDec_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -318,18 +321,19 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitNametyList(A_nametyList_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_nametyList_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_nametyList_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         ctx.local_variable_library = local_var_lib;
-        accept(node->get_head(), ctx);
-        accept(node->get_tail(), ctx);
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
 
         return ST<var_info>();
     }
     ST<var_info> visitNamety(A_namety_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_namety_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_namety_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -339,50 +343,51 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitFieldList(A_fieldList_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_fieldList_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_fieldList_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
-        ctx.local_variable_library = local_var_lib;
-        ST<var_info> head_var_lib = accept(node->get_head(), ctx);
-
-        ST<var_info> new_local_var_lib = MergeAndShadow(head_var_lib, local_var_lib);
-        ctx.local_variable_library = new_local_var_lib;
-        ctx.field_index++;
-        ST<var_info> tail_var_lib = accept(node->get_tail(), ctx);
+        ST<var_info> fieldlist_var_lib = ST<var_info>();
+        for (AST_node_* element : *node) {
+            ctx.local_variable_library = MergeAndShadow(fieldlist_var_lib, local_var_lib);
+            fieldlist_var_lib = MergeAndShadow(accept(element, ctx), fieldlist_var_lib);
+            ctx.field_index++;
+        }
 
         // Return the decs that were declared 
-        ST<var_info> fieldlist_var_lib = MergeAndShadow(tail_var_lib, head_var_lib);
         return fieldlist_var_lib;
     }
     ST<var_info> visitField(A_field_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_field_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_field_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         int SP_OFFSET = 3;
         int field_index = ctx.field_index + SP_OFFSET; 
-        type_info type_struct = lookup(node->get_typ(), type_library);
-        Ty_ty field_type = type_struct.my_type();
+        Ty_ty field_type = node->lookup_type(node->get_typ());
+        if (field_type == 0) {
+            field_type = Ty_Error();
+        }
         ST<var_info> field_var_lib = ST<var_info>(
             node->get_name(),
             var_info(field_type,
                            field_index,
-                           true
+                           true,
+                           node
             )
         );
 
         return field_var_lib;
     }
     ST<var_info> visitNameTy(A_nameTy_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_nameTy_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_nameTy_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
         return ST<var_info>();
     }
     ST<var_info> visitRecordty(A_recordty_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_recordty_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_recordty_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -392,7 +397,7 @@ struct VariableLibraryVisitor : Visitor<ST<var_info>, VoidContext> {
         return ST<var_info>();
     }
     ST<var_info> visitArrayty(A_arrayty_* node, VoidContext ctx) {
-        EM_debug("setting variable library for A_arrayty_");
+        EM_DEBUG(EM_visitors, "setting variable library for A_arrayty_");
         ST<var_info> local_var_lib = ctx.local_variable_library;
         node->set_local_variable_library(local_var_lib);
 
@@ -79,46 +79,60 @@ struct VoidContext : public Context {
     FunctionPass curr_pass = FirstPass;   
 };
 
-template<typename T, typename Ctx>
+// One kind per leaf class of AST.h; AST_node_::kind() says which one a node is.
+// These are also the tags in .tast files (see AST_binary.h), so new kinds go at the end.
+enum AST_node_kind {
+    AST_kind_unknown,
+    AST_kind_root,
+    AST_kind_nilExp,
+    AST_kind_boolExp,
+    AST_kind_intExp,
+    AST_kind_stringExp,
+    AST_kind_recordExp,
+    AST_kind_arrayExp,
+    AST_kind_varExp,
+    AST_kind_opExp,
+    AST_kind_assignExp,
+    AST_kind_letExp,
+    AST_kind_callExp,
+    AST_kind_ifExp,
+    AST_kind_whileExp,
+    AST_kind_forExp,
+    AST_kind_breakExp,
+    AST_kind_seqExp,
+    AST_kind_simpleVar,
+    AST_kind_fieldVar,
+    AST_kind_subscriptVar,
+    AST_kind_expList,
+    AST_kind_efield,
+    AST_kind_efieldList,
+    AST_kind_decList,
+    AST_kind_varDec,
+    AST_kind_typeDec,
+    AST_kind_functionDec,
+    AST_kind_fundecList,
+    AST_kind_fundec,
+    AST_kind_namety,
+    AST_kind_nametyList,
+    AST_kind_fieldList,
+    AST_kind_field,
+    AST_kind_nameTy,
+    AST_kind_recordty,
+    AST_kind_arrayty
+};
+
+/*
+ * A visitor is a struct with a visitXxx method for each kind of node, e.g.
+ *     struct PrintVisitor : Visitor<PrintVisitor, string, StringContext> { ... string visitNilExp(A_nilExp_*, StringContext); ... };
+ * and then node->accept(visitor, ctx) (or visitor.dispatch(node, ctx)) calls the right one.
+ * This is the "curiously recurring template" pattern: since Visitor knows the Derived class,
+ *  dispatch is one switch on node->kind() followed by a direct (inlinable) call, rather than
+ *  two virtual calls, and a new pass doesn't need anything added to the AST classes.
+ * Leaving out a visitXxx method is a compile-time error, as with the pure virtual methods we used to have.
+ */
+template<typename Derived, typename T, typename Ctx>
 struct Visitor {
-    virtual ~Visitor() = default;
-    virtual T visitAST_node(AST_node_*, Ctx) = 0;
-    virtual T visitRoot(A_root_*, Ctx) = 0;
-    virtual T visitNilExp(A_nilExp_*, Ctx) = 0;
-    virtual T visitBoolExp(A_boolExp_*, Ctx) = 0;
-    virtual T visitIntExp(A_intExp_*, Ctx) = 0;
-    virtual T visitStringExp(A_stringExp_*, Ctx) = 0;
-    virtual T visitRecordExp(A_recordExp_*, Ctx) = 0;
-    virtual T visitArrayExp(A_arrayExp_*, Ctx) = 0;
-    virtual T visitVarExp(A_varExp_*, Ctx) = 0;
-    virtual T visitOpExp(A_opExp_*, Ctx) = 0;
-    virtual T visitAssignExp(A_assignExp_*, Ctx) = 0;
-    virtual T visitLetExp(A_letExp_*, Ctx) = 0;
-    virtual T visitCallExp(A_callExp_*, Ctx) = 0;
-    virtual T visitIfExp(A_ifExp_*, Ctx) = 0;
-    virtual T visitWhileExp(A_whileExp_*, Ctx) = 0;
-    virtual T visitForExp(A_forExp_*, Ctx) = 0;
-    virtual T visitBreakExp(A_breakExp_*, Ctx) = 0;
-    virtual T visitSeqExp(A_seqExp_*, Ctx) = 0;
-    virtual T visitSimpleVar(A_simpleVar_*, Ctx) = 0;
-    virtual T visitFieldVar(A_fieldVar_*, Ctx) = 0;
-    virtual T visitSubscriptVar(A_subscriptVar_*, Ctx) = 0;
-    virtual T visitExpList(A_expList_*, Ctx) = 0;
-    virtual T visitEfield(A_efield_*, Ctx) = 0;
-    virtual T visitEfieldList(A_efieldList_*, Ctx) = 0;
-    virtual T visitDecList(A_decList_*, Ctx) = 0;
-    virtual T visitVarDec(A_varDec_*, Ctx) = 0;
-    virtual T visitTypeDec(A_typeDec_*, Ctx) = 0;
-    virtual T visitFunctionDec(A_functionDec_*, Ctx) = 0;
-    virtual T visitFundecList(A_fundecList_*, Ctx) = 0;
-    virtual T visitFundec(A_fundec_*, Ctx) = 0;
-    virtual T visitNamety(A_namety_*, Ctx) = 0;
-    virtual T visitNametyList(A_nametyList_*, Ctx) = 0;
-    virtual T visitFieldList(A_fieldList_*, Ctx) = 0;
-    virtual T visitField(A_field_*, Ctx) = 0;
-    virtual T visitNameTy(A_nameTy_*, Ctx) = 0;
-    virtual T visitRecordty(A_recordty_*, Ctx) = 0;
-    virtual T visitArrayty(A_arrayty_*, Ctx) = 0;
+    T dispatch(AST_node_* node, Ctx ctx);  // defined in visitor.t, which AST.h includes once the node classes are complete
 };
 
 #endif
@@ -0,0 +1,84 @@
+/*
+ * visitor.t: the dispatch for Visitor (see visitor.h), included from the end of AST.h
+ */
+
+template<typename Derived, typename T, typename Ctx>
+T Visitor<Derived, T, Ctx>::dispatch(AST_node_* node, Ctx ctx) {
+    Derived& self = static_cast<Derived&>(*this);
+    switch (node->kind()) {
+    case AST_kind_root:
+        return self.visitRoot(static_cast<A_root_*>(node), ctx);
+    case AST_kind_nilExp:
+        return self.visitNilExp(static_cast<A_nilExp_*>(node), ctx);
+    case AST_kind_boolExp:
+        return self.visitBoolExp(static_cast<A_boolExp_*>(node), ctx);
+    case AST_kind_intExp:
+        return self.visitIntExp(static_cast<A_intExp_*>(node), ctx);
+    case AST_kind_stringExp:
+        return self.visitStringExp(static_cast<A_stringExp_*>(node), ctx);
+    case AST_kind_recordExp:
+        return self.visitRecordExp(static_cast<A_recordExp_*>(node), ctx);
+    case AST_kind_arrayExp:
+        return self.visitArrayExp(static_cast<A_arrayExp_*>(node), ctx);
+    case AST_kind_varExp:
+        return self.visitVarExp(static_cast<A_varExp_*>(node), ctx);
+    case AST_kind_opExp:
+        return self.visitOpExp(static_cast<A_opExp_*>(node), ctx);
+    case AST_kind_assignExp:
+        return self.visitAssignExp(static_cast<A_assignExp_*>(node), ctx);
+    case AST_kind_letExp:
+        return self.visitLetExp(static_cast<A_letExp_*>(node), ctx);
+    case AST_kind_callExp:
+        return self.visitCallExp(static_cast<A_callExp_*>(node), ctx);
+    case AST_kind_ifExp:
+        return self.visitIfExp(static_cast<A_ifExp_*>(node), ctx);
+    case AST_kind_whileExp:
+        return self.visitWhileExp(static_cast<A_whileExp_*>(node), ctx);
+    case AST_kind_forExp:
+        return self.visitForExp(static_cast<A_forExp_*>(node), ctx);
+    case AST_kind_breakExp:
+        return self.visitBreakExp(static_cast<A_breakExp_*>(node), ctx);
+    case AST_kind_seqExp:
+        return self.visitSeqExp(static_cast<A_seqExp_*>(node), ctx);
+    case AST_kind_simpleVar:
+        return self.visitSimpleVar(static_cast<A_simpleVar_*>(node), ctx);
+    case AST_kind_fieldVar:
+        return self.visitFieldVar(static_cast<A_fieldVar_*>(node), ctx);
+    case AST_kind_subscriptVar:
+        return self.visitSubscriptVar(static_cast<A_subscriptVar_*>(node), ctx);
+    case AST_kind_expList:
+        return self.visitExpList(static_cast<A_expList_*>(node), ctx);
+    case AST_kind_efield:
+        return self.visitEfield(static_cast<A_efield_*>(node), ctx);
+    case AST_kind_efieldList:
+        return self.visitEfieldList(static_cast<A_efieldList_*>(node), ctx);
+    case AST_kind_decList:
+        return self.visitDecList(static_cast<A_decList_*>(node), ctx);
+    case AST_kind_varDec:
+        return self.visitVarDec(static_cast<A_varDec_*>(node), ctx);
+    case AST_kind_typeDec:
+        return self.visitTypeDec(static_cast<A_typeDec_*>(node), ctx);
+    case AST_kind_functionDec:
+        return self.visitFunctionDec(static_cast<A_functionDec_*>(node), ctx);
+    case AST_kind_fundecList:
+        return self.visitFundecList(static_cast<A_fundecList_*>(node), ctx);
+    case AST_kind_fundec:
+        return self.visitFundec(static_cast<A_fundec_*>(node), ctx);
+    case AST_kind_namety:
+        return self.visitNamety(static_cast<A_namety_*>(node), ctx);
+    case AST_kind_nametyList:
+        return self.visitNametyList(static_cast<A_nametyList_*>(node), ctx);
+    case AST_kind_fieldList:
+        return self.visitFieldList(static_cast<A_fieldList_*>(node), ctx);
+    case AST_kind_field:
+        return self.visitField(static_cast<A_field_*>(node), ctx);
+    case AST_kind_nameTy:
+        return self.visitNameTy(static_cast<A_nameTy_*>(node), ctx);
+    case AST_kind_recordty:
+        return self.visitRecordty(static_cast<A_recordty_*>(node), ctx);
+    case AST_kind_arrayty:
+        return self.visitArrayty(static_cast<A_arrayty_*>(node), ctx);
+    default:
+        return self.visitAST_node(node, ctx);
+    }
+}
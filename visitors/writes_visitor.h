@@ -0,0 +1,211 @@
+#ifndef WRITES_VISITOR_H
+#define WRITES_VISITOR_H
+#include <vector>
+#include "../AST.h"
+#include "../call_graph.h"
+#include "visitor.h"
+
+// Finds which loops and functions assign to which variables for CG_build (call_graph.cc); see
+//  CG_writes in call_graph.h. It looks at everything, dead code included, so it may say a
+//  variable is assigned when it isn't, but never the other way around.
+// Variables are matched to their declarations with CG_declaration_of, and the calls that might
+//  write outer variables come from the call graph's summaries.
+struct WritesVisitor : Visitor<WritesVisitor, int, VoidContext> {
+    CG_writes &writes;
+
+    WritesVisitor(CG_writes &writes) : writes(writes) { }
+
+    int accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return 0;
+        }
+        return node->accept(*this, ctx);
+    }
+
+    int visitAST_node(AST_node_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRoot(A_root_* node, VoidContext ctx) {
+        return accept(node->get_main_expr(), ctx);
+    }
+    int visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        return accept(node->get_fields(), ctx);
+    }
+    int visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        accept(node->get_size(), ctx);
+        return accept(node->get_init(), ctx);
+    }
+    int visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitOpExp(A_opExp_* node, VoidContext ctx) {
+        accept(node->get_left(), ctx);
+        return accept(node->get_right(), ctx);
+    }
+    int visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        accept(node->get_exp(), ctx);
+        accept(node->get_var(), ctx);
+        A_simpleVar_* var = dynamic_cast<A_simpleVar_*>(node->get_var());
+        AST_node_* declaration = var == 0 ? 0 : CG_declaration_of(var);
+        if (declaration != 0) {
+            writes.assigned_anywhere.insert(declaration);
+            for (AST_node_* loop : loops) {
+                writes.assigned[loop].insert(declaration);
+            }
+            if (writes.declared_in[declaration] != function) {
+                writes.written_by_nested.insert(declaration);
+            }
+        }
+        return 0;
+    }
+    int visitLetExp(A_letExp_* node, VoidContext ctx) {
+        accept(node->get_decs(), ctx);
+        return accept(node->get_body(), ctx);
+    }
+    int visitCallExp(A_callExp_* node, VoidContext ctx) {
+        accept(node->get_args(), ctx);
+        const CG_summary* callee = node->get_call_graph_summary();
+        if (callee == 0 || (callee->effects & CG_writes_outer)) {
+            for (AST_node_* loop : loops) {
+                writes.calls_writer.insert(loop);
+            }
+        }
+        return 0;
+    }
+    int visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        accept(node->get_test(), ctx);
+        accept(node->get_then(), ctx);
+        return accept(node->get_else_or_null(), ctx);
+    }
+    int visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        loops.push_back(node);
+        accept(node->get_test(), ctx);
+        accept(node->get_body(), ctx);
+        loops.pop_back();
+        return 0;
+    }
+    int visitForExp(A_forExp_* node, VoidContext ctx) {
+        accept(node->get_lo(), ctx);
+        accept(node->get_hi(), ctx);
+        loops.push_back(node);
+        declare(node);  // inside the loop, since it changes every time around
+        accept(node->get_body(), ctx);
+        loops.pop_back();
+        return 0;
+    }
+    int visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    int visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    int visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        accept(node->get_var(), ctx);
+        return accept(node->get_exp(), ctx);
+    }
+    int visitExpList(A_expList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitEfield(A_efield_* node, VoidContext ctx) {
+        return accept(node->get_exp(), ctx);
+    }
+    int visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitDecList(A_decList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitVarDec(A_varDec_* node, VoidContext ctx) {
+        accept(node->get_init(), ctx);
+        declare(node);
+        return 0;
+    }
+    int visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    int visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return 0;
+    }
+    int visitFundec(A_fundec_* node, VoidContext ctx) {
+        A_fundec_* outer_function = function;
+        std::vector<AST_node_*> outer_loops;
+        outer_loops.swap(loops);  // a loop around the declaration doesn't run the body
+        function = node;
+        A_fieldList_* params = node->cast_params();
+        if (params != 0) {
+            for (A_field_* param : *params) {
+                declare(param);
+            }
+        }
+        accept(node->get_body(), ctx);
+        loops.swap(outer_loops);
+        function = outer_function;
+        return 0;
+    }
+    int visitNamety(A_namety_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitField(A_field_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return 0;
+    }
+    int visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return 0;
+    }
+
+private:
+    A_fundec_* function = 0;           // whose code we're in; 0 for main
+    std::vector<AST_node_*> loops;     // in the current function, innermost last
+
+    void declare(AST_node_* declaration) {
+        writes.declared_in[declaration] = function;
+        for (AST_node_* loop : loops) {
+            writes.declared[loop].insert(declaration);
+        }
+    }
+};
+#endif
@@ -0,0 +1,498 @@
+#ifndef X86_64_VISITOR_H
+#define X86_64_VISITOR_H
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "../AST.h"
+#include "visitor.h"
+
+// Generates x86-64 assembly (AT&T syntax, for the GNU assembler and the System V ABI) for a
+//  typechecked tree: the -target=x86-64 flag in tiger.cc.  Link it with runtime/tiger_runtime.c,
+//  which has main() and the Tiger library, e.g.
+//      tiger -target=x86-64 prog.tig > prog.s && cc prog.s runtime/tiger_runtime.c -o prog
+//
+// The frame layout follows the HERA code: a variable lives in the word at its var_info's my_SP()
+//  offset (8 bytes each, down from %rbp), so parameters are in words 3, 4, ...; the temporaries
+//  for expressions are below them, at fixed offsets from %rsp, so %rsp stays 16-byte aligned
+//  for calls.  Each expression leaves its value in %rax.  As on HERA, integers are 16 bits
+//  (sign-extended to 64 after each operation); strings are pointers to NUL-terminated chars.
+//
+// Tiger functions take their first six arguments in %rdi, %rsi, %rdx, %rcx, %r8 and %r9 and any
+//  more on the stack, as C functions do, and are called tiger_<unique name>; the library functions
+//  are tiger_lib_<name>, and the main program is tiger_main.  A function that takes a static link
+//  (see visitors/static_link_visitor.h) gets it in %r10, the ABI's static chain register, and keeps
+//  it in the word after its parameters, where the HERA code has it.
+// Records and arrays come from tiger_new_record and tiger_new_array in the runtime, and are laid
+//  out as in the HERA code, a word per field or element.
+struct X86_64Visitor : Visitor<X86_64Visitor, string, VoidContext> {
+
+    // The whole assembly-language program, or "" (after an EM_error) if it uses something we can't compile yet
+    string assembly(A_root_* root) {
+        accept(root, VoidContext());
+        if (EM_recorded_any_errors()) {
+            return "";
+        }
+        string strings = "";
+        for (auto &literal : string_labels) {
+            strings += literal.second + ":\n\t.string " + quoted(literal.first) + "\n";
+        }
+        return "# x86-64 code from the Tiger compiler; link with runtime/tiger_runtime.c\n"
+               "\t.text\n" + functions +
+               "\t.section .rodata\n" + strings +
+               "\t.section .note.GNU-stack,\"\",@progbits\n";
+    }
+
+    string accept(AST_node_* node, VoidContext ctx) {
+        if (node == 0) {
+            return "";
+        }
+        return node->accept(*this, ctx);
+    }
+
+    string visitAST_node(AST_node_* node, VoidContext ctx) {
+        EM_error("The x86-64 backend can't handle this kind of expression yet", false, node->pos());
+        return "";
+    }
+    string visitRoot(A_root_* node, VoidContext ctx) {
+        start_function();
+        string body = accept(node->get_main_expr(), ctx);
+        finish_function("tiger_main", body + "\txorl %eax, %eax\n");
+        return "";
+    }
+    string visitNilExp(A_nilExp_* node, VoidContext ctx) {
+        return "\txorl %eax, %eax\n";
+    }
+    string visitBoolExp(A_boolExp_* node, VoidContext ctx) {
+        return "\tmovq $" + std::to_string(node->get_value() ? 1 : 0) + ", %rax\n";
+    }
+    string visitIntExp(A_intExp_* node, VoidContext ctx) {
+        return "\tmovq $" + std::to_string(int16_t(node->get_value())) + ", %rax\n";
+    }
+    string visitStringExp(A_stringExp_* node, VoidContext ctx) {
+        string value = unrepr_for_std_string(node->get_value());
+        auto found = string_labels.find(value);
+        if (found == string_labels.end()) {
+            found = string_labels.insert(std::make_pair(value, ".LS" + std::to_string(string_labels.size()))).first;
+        }
+        return "\tleaq " + found->second + "(%rip), %rax\n";
+    }
+    string visitRecordExp(A_recordExp_* node, VoidContext ctx) {
+        Ty_ty record_type = node->typecheck();
+        int record = new_temp();
+        string code = "\tmovq $" + std::to_string(Ty_record_size(record_type)) + ", %rdi\n"
+                      "\tcall tiger_new_record\n"
+                      "\tmovq %rax, " + temp(record) + "\n";
+        A_efieldList_* fields = static_cast<A_efieldList_*>(node->get_fields());
+        int count = fields ? fields->length() : 0;
+        for (int i = 0; i < count; i++) {
+            A_efield_* field = fields->element(i);
+            code += accept(field->get_exp(), ctx) +
+                    "\tmovq " + temp(record) + ", %rcx\n"
+                    "\tmovq %rax, " + word(Ty_field_offset(record_type, field->get_name()), "%rcx") + "\n";
+        }
+        code += "\tmovq " + temp(record) + ", %rax\n";
+        free_temp(record);
+        return code;
+    }
+    string visitArrayExp(A_arrayExp_* node, VoidContext ctx) {
+        string code = accept(node->get_size(), ctx);
+        int size = new_temp();
+        code += "\tmovq %rax, " + temp(size) + "\n" +
+                accept(node->get_init(), ctx) +
+                "\tmovq %rax, %rsi\n"
+                "\tmovq " + temp(size) + ", %rdi\n"
+                "\tcall tiger_new_array\n";
+        free_temp(size);
+        return code;
+    }
+    string visitVarExp(A_varExp_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx);
+    }
+    string visitOpExp(A_opExp_* node, VoidContext ctx) {
+        string code = accept(node->get_left(), ctx);
+        int left = new_temp();
+        code += "\tmovq %rax, " + temp(left) + "\n" +
+                accept(node->get_right(), ctx) +
+                "\tmovq %rax, %rcx\n"
+                "\tmovq " + temp(left) + ", %rax\n";
+        free_temp(left);
+
+        if (node->get_left()->typecheck() == Ty_String()) {  // compare tstrcmp's -1/0/1 with 0
+            code += "\tmovq %rax, %rdi\n"
+                    "\tmovq %rcx, %rsi\n"
+                    "\tcall tiger_lib_tstrcmp\n"
+                    "\txorl %ecx, %ecx\n";
+        }
+        switch (node->get_oper()) {
+        case A_plusOp:   return code + "\taddq %rcx, %rax\n" + to_16_bits;
+        case A_minusOp:  return code + "\tsubq %rcx, %rax\n" + to_16_bits;
+        case A_timesOp:  return code + "\timulq %rcx, %rax\n" + to_16_bits;
+        case A_divideOp: {
+            string ok = new_label();
+            return code + "\ttestq %rcx, %rcx\n"
+                          "\tjnz " + ok + "\n"
+                          "\tcall tiger_division_by_zero\n" +
+                          ok + ":\n"
+                          "\tcqto\n"
+                          "\tidivq %rcx\n" + to_16_bits;
+        }
+        case A_eqOp:     return code + compare("sete");
+        case A_neqOp:    return code + compare("setne");
+        case A_ltOp:     return code + compare("setl");
+        case A_leOp:     return code + compare("setle");
+        case A_gtOp:     return code + compare("setg");
+        case A_geOp:     return code + compare("setge");
+        }
+        return visitAST_node(node, ctx);
+    }
+    string visitAssignExp(A_assignExp_* node, VoidContext ctx) {
+        // as in -run, the value first, and then where it goes
+        AST_node_* var = node->get_var();
+        if (var->kind() == AST_kind_simpleVar && static_cast<A_simpleVar_*>(var)->get_frames_out() == 0) {
+            return accept(node->get_exp(), ctx) + "\tmovq %rax, " + variable(static_cast<A_simpleVar_*>(var)) + "\n";
+        }
+        int value = new_temp();
+        string code = accept(node->get_exp(), ctx) + "\tmovq %rax, " + temp(value) + "\n";
+        if (var->kind() == AST_kind_simpleVar) {
+            A_simpleVar_* outer = static_cast<A_simpleVar_*>(var);
+            code += frame_pointer(outer->get_frames_out(), "%rcx") +
+                    "\tmovq " + temp(value) + ", %rax\n"
+                    "\tmovq %rax, " + slot(outer_word(outer), "%rcx") + "\n";
+        } else if (var->kind() == AST_kind_fieldVar) {
+            A_fieldVar_* field = static_cast<A_fieldVar_*>(var);
+            code += accept(field->get_var(), ctx) +
+                    nil_check() +
+                    "\tmovq " + temp(value) + ", %rcx\n"
+                    "\tmovq %rcx, " + word(field->get_offset(), "%rax") + "\n";
+        } else {
+            code += element_address(static_cast<A_subscriptVar_*>(var), ctx) +
+                    "\tmovq " + temp(value) + ", %rdx\n"
+                    "\tmovq %rdx, (%rax)\n";
+        }
+        free_temp(value);
+        return code;
+    }
+    string visitLetExp(A_letExp_* node, VoidContext ctx) {
+        return accept(node->get_decs(), ctx) + accept(node->get_body(), ctx);
+    }
+    string visitCallExp(A_callExp_* node, VoidContext ctx) {
+        function_info callee = lookup(node->get_func(), node->get_local_function_library());
+        string label = callee.tiger_function ? "tiger_lib_" + Symbol_to_string(node->get_func())
+                                             : "tiger_" + node->get_my_unique_function_name();
+
+        // work out all the arguments first, then put them where the callee wants them
+        A_expList_* args = static_cast<A_expList_*>(node->get_args());
+        int n = args ? args->length() : 0;
+        std::vector<int> temps;
+        string code = "";
+        for (int i = 0; i < n; i++) {
+            temps.push_back(new_temp());
+            code += accept(args->element(i), ctx) + "\tmovq %rax, " + temp(temps[i]) + "\n";
+        }
+        int on_stack = std::max(n - 6, 0);
+        int padding = on_stack % 2 == 1 ? 8 : 0;  // keep %rsp 16-byte aligned at the call
+        if (padding) {
+            code += "\tsubq $8, %rsp\n";
+        }
+        for (int i = n - 1; i >= 6; i--) {  // pushing moves %rsp, and so the temporaries, as we go
+            code += "\tpushq " + temp(temps[i], padding + 8 * (n - 1 - i)) + "\n";
+        }
+        for (int i = 0; i < n && i < 6; i++) {
+            code += "\tmovq " + temp(temps[i], padding + 8 * on_stack) + ", " + argument_registers[i] + "\n";
+        }
+        if (!callee.tiger_function && node->get_static_link() >= 0) {
+            code += frame_pointer(node->get_static_link(), "%r10");
+        }
+        code += "\tcall " + label + "\n";
+        if (on_stack > 0 || padding) {
+            code += "\taddq $" + std::to_string(8 * on_stack + padding) + ", %rsp\n";
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            free_temp(temps[i]);
+        }
+        return code;
+    }
+    string visitIfExp(A_ifExp_* node, VoidContext ctx) {
+        string else_label = new_label(), end_label = new_label();
+        string code = accept(node->get_test(), ctx) +
+                      "\ttestq %rax, %rax\n"
+                      "\tje " + else_label + "\n" +
+                      accept(node->get_then(), ctx);
+        if (node->get_else_or_null() == 0) {
+            return code + else_label + ":\n";
+        }
+        return code + "\tjmp " + end_label + "\n" +
+               else_label + ":\n" +
+               accept(node->get_else_or_null(), ctx) +
+               end_label + ":\n";
+    }
+    string visitWhileExp(A_whileExp_* node, VoidContext ctx) {
+        string top = new_label(), end = new_label();
+        loop_ends.push_back(end);
+        string code = top + ":\n" +
+                      accept(node->get_test(), ctx) +
+                      "\ttestq %rax, %rax\n"
+                      "\tje " + end + "\n" +
+                      accept(node->get_body(), ctx) +
+                      "\tjmp " + top + "\n" +
+                      end + ":\n";
+        loop_ends.pop_back();
+        return code;
+    }
+    string visitForExp(A_forExp_* node, VoidContext ctx) {
+        int var = declaration_slot(node), hi = var + 1;  // as in the HERA code, hi is kept just above the variable
+        use_slot(hi);
+        string top = new_label(), end = new_label();
+        loop_ends.push_back(end);
+        string code = accept(node->get_lo(), ctx) +
+                      "\tmovq %rax, " + slot(var) + "\n" +
+                      accept(node->get_hi(), ctx) +
+                      "\tmovq %rax, " + slot(hi) + "\n" +
+                      top + ":\n"
+                      "\tmovq " + slot(var) + ", %rax\n"
+                      "\tcmpq " + slot(hi) + ", %rax\n"
+                      "\tjg " + end + "\n" +
+                      accept(node->get_body(), ctx) +
+                      "\taddq $1, " + slot(var) + "\n"
+                      "\tjmp " + top + "\n" +
+                      end + ":\n";
+        loop_ends.pop_back();
+        return code;
+    }
+    string visitBreakExp(A_breakExp_* node, VoidContext ctx) {
+        return "\tjmp " + loop_ends.back() + "\n";
+    }
+    string visitSeqExp(A_seqExp_* node, VoidContext ctx) {
+        return accept(node->get_seq(), ctx);
+    }
+    string visitSimpleVar(A_simpleVar_* node, VoidContext ctx) {
+        if (node->get_frames_out() > 0) {
+            return frame_pointer(node->get_frames_out(), "%rcx") +
+                   "\tmovq " + slot(outer_word(node), "%rcx") + ", %rax\n";
+        }
+        return "\tmovq " + variable(node) + ", %rax\n";
+    }
+    string visitFieldVar(A_fieldVar_* node, VoidContext ctx) {
+        return accept(node->get_var(), ctx) +
+               nil_check() +
+               "\tmovq " + word(node->get_offset(), "%rax") + ", %rax\n";
+    }
+    string visitSubscriptVar(A_subscriptVar_* node, VoidContext ctx) {
+        return element_address(node, ctx) + "\tmovq (%rax), %rax\n";
+    }
+    string visitExpList(A_expList_* node, VoidContext ctx) {
+        string code = "";
+        for (AST_node_* element : *node) {
+            code += accept(element, ctx);
+        }
+        return code;
+    }
+    string visitEfield(A_efield_* node, VoidContext ctx) {
+        return visitAST_node(node, ctx);
+    }
+    string visitEfieldList(A_efieldList_* node, VoidContext ctx) {
+        return visitAST_node(node, ctx);
+    }
+    string visitDecList(A_decList_* node, VoidContext ctx) {
+        string code = "";
+        for (AST_node_* element : *node) {
+            code += accept(element, ctx);
+        }
+        return code;
+    }
+    string visitVarDec(A_varDec_* node, VoidContext ctx) {
+        return accept(node->get_init(), ctx) + "\tmovq %rax, " + slot(declaration_slot(node)) + "\n";
+    }
+    string visitTypeDec(A_typeDec_* node, VoidContext ctx) {
+        return "";
+    }
+    string visitFunctionDec(A_functionDec_* node, VoidContext ctx) {
+        return accept(node->get_theFunctions(), ctx);
+    }
+    string visitFundecList(A_fundecList_* node, VoidContext ctx) {
+        for (AST_node_* element : *node) {
+            accept(element, ctx);
+        }
+        return "";
+    }
+    string visitFundec(A_fundec_* node, VoidContext ctx) {
+        Function_state outer = state;  // the function we were in the middle of
+        start_function();
+        state.fundec = node;
+        A_fieldList_* params = node->cast_params();
+        int n = params ? params->length() : 0;
+        string code = "";
+        if (node->has_static_link()) {
+            use_slot(node->static_link_slot());
+            code += "\tmovq %r10, " + slot(node->static_link_slot()) + "\n";
+        }
+        for (int i = 0; i < n; i++) {  // the parameters go in words 3, 4, ... as in HERA
+            use_slot(3 + i);
+            if (i < 6) {
+                code += "\tmovq " + string(argument_registers[i]) + ", " + slot(3 + i) + "\n";
+            } else {
+                code += "\tmovq " + std::to_string(16 + 8 * (i - 6)) + "(%rbp), %rax\n"
+                        "\tmovq %rax, " + slot(3 + i) + "\n";
+            }
+        }
+        code += accept(node->get_body(), ctx);
+        finish_function("tiger_" + node->get_my_unique_function_name(), code);
+        state = outer;
+        return "";
+    }
+    string visitNamety(A_namety_* node, VoidContext ctx) {
+        return "";
+    }
+    string visitNametyList(A_nametyList_* node, VoidContext ctx) {
+        return "";
+    }
+    string visitFieldList(A_fieldList_* node, VoidContext ctx) {
+        return "";
+    }
+    string visitField(A_field_* node, VoidContext ctx) {
+        return "";
+    }
+    string visitNameTy(A_nameTy_* node, VoidContext ctx) {
+        return "";
+    }
+    string visitRecordty(A_recordty_* node, VoidContext ctx) {
+        return "";
+    }
+    string visitArrayty(A_arrayty_* node, VoidContext ctx) {
+        return "";
+    }
+
+private:
+    const char *argument_registers[6] = {"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"};
+    const string to_16_bits = "\tmovswq %ax, %rax\n";
+
+    struct Function_state {
+        A_fundec_* fundec = 0;   // 0 for main
+        int slots = 3;           // words for variables, from %rbp down; 0-2 are kept free, as in HERA
+        int next_temp = 0, max_temps = 0;
+        std::vector<string> loop_ends;  // where a break goes
+    };
+    Function_state state;
+    std::vector<string> &loop_ends = state.loop_ends;
+
+    string functions = "";  // the code for every function we've finished
+    std::map<string, string> string_labels;  // literal -> label
+    int labels = 0;
+
+    string new_label() {
+        return ".L" + std::to_string(labels++);
+    }
+    string compare(const string &set) {
+        return "\tcmpq %rcx, %rax\n"
+               "\t" + set + " %al\n"
+               "\tmovzbq %al, %rax\n";
+    }
+
+    void use_slot(int word) {
+        state.slots = std::max(state.slots, word + 1);
+    }
+    string slot(int word, const string &frame = "%rbp") {  // a word of this frame, or of the one frame points to
+        return std::to_string(-8 * (word + 1)) + "(" + frame + ")";
+    }
+    string variable(A_simpleVar_* var) {
+        int word = lookup(var->get_sym(), var->get_local_variable_library()).my_SP();
+        use_slot(word);
+        return slot(word);
+    }
+    int outer_word(A_simpleVar_* var) {  // in the frame of the function it's declared in
+        return lookup(var->get_sym(), var->get_local_variable_library()).my_SP();
+    }
+    // Put the frame pointer of the function that many out (0 for this one) in reg, following the
+    //  static links as A_fundec_::frame_pointer_HERA_code does
+    string frame_pointer(int frames_out, const string &reg) {
+        if (frames_out == 0) {
+            return "\tmovq %rbp, " + reg + "\n";
+        }
+        string code = "\tmovq " + slot(state.fundec->static_link_slot()) + ", " + reg + "\n";
+        A_fundec_* f = state.fundec->get_enclosing_function();
+        for (int out = 1; out < frames_out; out++) {
+            code += "\tmovq " + slot(f->static_link_slot(), reg) + ", " + reg + "\n";
+            f = f->get_enclosing_function();
+        }
+        return code;
+    }
+    string word(int n, const string &base) {  // word n of the record or array at base
+        return std::to_string(8 * n) + "(" + base + ")";
+    }
+    // Stop, as the HERA code does, if the record in %rax is nil
+    string nil_check() {
+        string ok = new_label();
+        return "\ttestq %rax, %rax\n"
+               "\tjnz " + ok + "\n"
+               "\tcall tiger_nil_record\n" +
+               ok + ":\n";
+    }
+    // The address of the element in %rax, after checking the subscript (an unsigned comparison catches negative ones too)
+    string element_address(A_subscriptVar_* node, VoidContext ctx) {
+        int array = new_temp();
+        string ok = new_label();
+        string code = accept(node->get_var(), ctx) +
+                      "\tmovq %rax, " + temp(array) + "\n" +
+                      accept(node->get_exp(), ctx) +
+                      "\tmovq " + temp(array) + ", %rcx\n"
+                      "\tcmpq (%rcx), %rax\n"
+                      "\tjb " + ok + "\n"
+                      "\tcall tiger_bad_subscript\n" +
+                      ok + ":\n"
+                      "\tleaq 8(%rcx,%rax,8), %rax\n";
+        free_temp(array);
+        return code;
+    }
+    template <class Declaration>
+    int declaration_slot(Declaration* dec) {  // for an A_varDec_ or A_forExp_
+        int word = dec->get_frame_slot();
+        use_slot(word);
+        return word;
+    }
+
+    int new_temp() {
+        int t = state.next_temp++;
+        state.max_temps = std::max(state.max_temps, state.next_temp);
+        return t;
+    }
+    void free_temp(int t) {
+        state.next_temp = t;
+    }
+    string temp(int t, int pushed = 0) {  // pushed: how far we've moved %rsp since the prologue
+        return std::to_string(8 * t + pushed) + "(%rsp)";
+    }
+
+    void start_function() {
+        state = Function_state();
+    }
+    // Now we know how big the frame has to be, add the prologue and epilogue
+    void finish_function(const string &label, const string &body) {
+        int frame_size = 8 * (state.slots + state.max_temps);
+        frame_size = (frame_size + 15) / 16 * 16;
+        functions += "\t.globl " + label + "\n" +
+                     label + ":\n"
+                     "\tpushq %rbp\n"
+                     "\tmovq %rsp, %rbp\n"
+                     "\tsubq $" + std::to_string(frame_size) + ", %rsp\n" +
+                     body +
+                     "\tleave\n"
+                     "\tret\n\n";
+        EM_DEBUG(EM_codegen, "Generated x86-64 code for " + label + ", with a frame of " + std::to_string(frame_size) + " bytes");
+    }
+
+    static string quoted(const string &s) {
+        string result = "\"";
+        for (unsigned char c : s) {
+            if (c >= ' ' && c < 0x7f && c != '"' && c != '\\') {
+                result += char(c);
+            } else {
+                char octal[5];
+                snprintf(octal, sizeof(octal), "\\%03o", c);
+                result += octal;
+            }
+        }
+        return result + "\"";
+    }
+};
+#endif